@@ -0,0 +1,281 @@
+/*
+ * rakbench - Benchmark every rakarrack effect type without JACK or a GUI.
+ *
+ * For each sample rate / period combination an offline engine is built,
+ * then every effect type is instantiated with RKR::New_Effect(), set to each
+ * of its factory presets and fed the test-audio clips and a few synthetic
+ * signals. Only the out() calls are timed. Results go to a JSON file so
+ * runs of different releases can be compared.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License
+ * as published by the Free Software Foundation.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <nlohmann/json.hpp>
+#include "global.hpp"
+#include "Effect.hpp"
+#include "EngineController.hpp"
+#include "rakbench_lib.hpp"
+
+#ifndef RAKBENCH_AUDIO_DIR
+#define RAKBENCH_AUDIO_DIR "test-audio"
+#endif
+
+// ---------------------------------------------------------------------------
+// Allocation counting. Every operator new in the process goes through here;
+// memory taken with malloc() or fftw_malloc() directly is not seen.
+// ---------------------------------------------------------------------------
+
+static std::atomic<std::uint64_t> allocations{0};
+
+void *
+operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *
+operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+struct Config
+{
+    int sample_rate;
+    int period;
+};
+
+static void
+show_help()
+{
+    fprintf(stderr, "Usage: rakbench [-o <results.json>] [options]\n\n");
+    fprintf(stderr, "Time every rakarrack effect type and factory preset, without JACK.\n\n");
+    fprintf(stderr, "  -o, --output <file>    JSON results (default: stdout)\n");
+    fprintf(stderr, "  -c, --configs <list>   rate:period pairs (default: 44100:128,48000:64,48000:256,96000:256)\n");
+    fprintf(stderr, "  -e, --effects <list>   effect types 0-46 to run (default: all)\n");
+    fprintf(stderr, "  -p, --presets <n>      first n factory presets per effect (default: all)\n");
+    fprintf(stderr, "  -s, --seconds <s>      audio per run (default: 1.0)\n");
+    fprintf(stderr, "  -d, --audio <dir>      directory with .wav clips (default: %s)\n", RAKBENCH_AUDIO_DIR);
+    fprintf(stderr, "  -n, --no-clips         synthetic signals only\n");
+    fprintf(stderr, "  -h, --help             display this help and exit\n\n");
+}
+
+static std::vector<Config>
+parse_configs(const char *list)
+{
+    std::vector<Config> configs;
+    for (const char *p = list; *p; ) {
+        int rate, period, used = 0;
+        if (sscanf(p, "%d:%d%n", &rate, &period, &used) != 2)
+            break;
+        if ((rate > 0) && (period > 0))
+            configs.push_back({rate, period});
+        p += used;
+        if (*p == ',')
+            p++;
+    }
+    return configs;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int option_index = 0, opt;
+    int help = 0;
+    const char *output_file = nullptr;
+    const char *audio_dir = RAKBENCH_AUDIO_DIR;
+    std::vector<Config> configs = parse_configs("44100:128,48000:64,48000:256,96000:256");
+    std::vector<int> types;
+    int max_presets = 0;
+    double seconds = 1.0;
+    bool clips = true;
+
+    struct option opts[] = {
+        {"output", 1, nullptr, 'o'},
+        {"configs", 1, nullptr, 'c'},
+        {"effects", 1, nullptr, 'e'},
+        {"presets", 1, nullptr, 'p'},
+        {"seconds", 1, nullptr, 's'},
+        {"audio", 1, nullptr, 'd'},
+        {"no-clips", 0, nullptr, 'n'},
+        {"help", 0, nullptr, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while (1) {
+        opt = getopt_long(argc, argv, "o:c:e:p:s:d:nh", opts, &option_index);
+        if (opt == -1)
+            break;
+
+        switch (opt) {
+        case 'o':
+            output_file = optarg;
+            break;
+        case 'c':
+            configs = parse_configs(optarg);
+            break;
+        case 'e':
+            types = parse_ints(optarg);
+            break;
+        case 'p':
+            max_presets = atoi(optarg);
+            break;
+        case 's':
+            seconds = atof(optarg);
+            break;
+        case 'd':
+            audio_dir = optarg;
+            break;
+        case 'n':
+            clips = false;
+            break;
+        default:
+            help = 1;
+            break;
+        }
+    }
+
+    if (help) {
+        show_help();
+        return 0;
+    }
+    if (configs.empty() || (seconds <= 0.0)) {
+        fprintf(stderr, "Try 'rakbench --help' for usage options.\n");
+        return 1;
+    }
+    if (types.empty())
+        for (int type = 0; type < kNumEffectTypes; type++)
+            types.push_back(type);
+
+    // Clips are played sample for sample at every rate; only their
+    // spectral content and dynamics matter for timing.
+    std::vector<Signal> clip_signals;
+    if (clips) {
+        clip_signals = load_clips(audio_dir);
+        if (clip_signals.empty())
+            fprintf(stderr, "rakbench: no clips in %s, synthetic signals only\n", audio_dir);
+    }
+
+    setup_offline_engine();
+
+    nlohmann::ordered_json results = nlohmann::ordered_json::array();
+
+    for (const Config &config : configs) {
+        auto rkr = std::make_unique<RKR>(config.sample_rate, config.period);
+        EngineController names(*rkr);
+
+        const size_t blocks = (size_t) ceil(seconds * config.sample_rate / config.period);
+        const size_t frames = blocks * (size_t) config.period;
+        const double budget_ns = 1.0e9 * config.period / config.sample_rate;
+
+        std::vector<Signal> signals = synthetic_signals(config.sample_rate, frames);
+        for (Signal sig : clip_signals) {
+            fit_signal(sig, frames);
+            signals.push_back(std::move(sig));
+        }
+
+        std::vector<float> l(PERIOD), r(PERIOD);
+
+        for (int type : types) {
+            int presets = RKR::Preset_Count(type);
+            if ((max_presets > 0) && (presets > max_presets))
+                presets = max_presets;
+            const std::string name = names.getEffectTypeName(type);
+            fprintf(stderr, "rakbench: %d Hz / %d  %-12s", config.sample_rate, config.period, name.c_str());
+
+            for (int npreset = 0; npreset < presets; npreset++) {
+                const std::uint64_t setup_start = allocations.load(std::memory_order_relaxed);
+                std::unique_ptr<Effect> efx = rkr->New_Effect(type);
+                if (!efx)
+                    break;
+                rkr->Effect_setpreset(type, efx.get(), npreset);
+                const std::uint64_t setup_allocs = allocations.load(std::memory_order_relaxed) - setup_start;
+
+                for (const Signal &sig : signals) {
+                    efx->cleanup();
+
+                    std::int64_t total_ns = 0;
+                    std::int64_t max_ns = 0;
+                    const std::uint64_t run_start = allocations.load(std::memory_order_relaxed);
+
+                    for (size_t off = 0; off < frames; off += (size_t) PERIOD) {
+                        memcpy(l.data(), sig.l.data() + off, sizeof(float) * PERIOD);
+                        memcpy(r.data(), sig.r.data() + off, sizeof(float) * PERIOD);
+                        // Vocoder modulator
+                        memcpy(rkr->auxresampled.data(), l.data(), sizeof(float) * PERIOD);
+
+                        const auto start = std::chrono::steady_clock::now();
+                        efx->out(l.data(), r.data());
+                        const auto stop = std::chrono::steady_clock::now();
+
+                        const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+                        total_ns += ns;
+                        if (ns > max_ns)
+                            max_ns = ns;
+                    }
+
+                    const std::uint64_t run_allocs = allocations.load(std::memory_order_relaxed) - run_start;
+                    const double audio_ns = budget_ns * (double) blocks;
+
+                    nlohmann::ordered_json row;
+                    row["effect"] = type;
+                    row["name"] = name;
+                    row["preset"] = npreset;
+                    row["signal"] = sig.name;
+                    row["sample_rate"] = config.sample_rate;
+                    row["period"] = config.period;
+                    row["ns_per_sample"] = (double) total_ns / (double) frames;
+                    row["rtf"] = (double) total_ns / audio_ns;
+                    row["max_block_us"] = (double) max_ns * 1.0e-3;
+                    row["budget_us"] = budget_ns * 1.0e-3;
+                    row["setup_allocs"] = setup_allocs;
+                    row["process_allocs"] = run_allocs;
+                    results.push_back(std::move(row));
+                }
+                fputc('.', stderr);
+            }
+            fputc('\n', stderr);
+        }
+    }
+
+    nlohmann::ordered_json doc;
+    doc["tool"] = "rakbench";
+    doc["version"] = VERSION;
+    doc["seconds"] = seconds;
+    doc["results"] = std::move(results);
+
+    if (output_file == nullptr) {
+        std::cout << doc.dump(1) << "\n";
+    } else {
+        std::ofstream out(output_file);
+        if (!out) {
+            fprintf(stderr, "rakbench: can not create %s\n", output_file);
+            return 1;
+        }
+        out << doc.dump(1) << "\n";
+    }
+    return 0;
+}
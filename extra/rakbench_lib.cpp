@@ -0,0 +1,183 @@
+/*
+ * rakbench library - Input signals and engine setup shared by the offline
+ * effect tools (rakbench, rakgolden, rakrender).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License
+ * as published by the Free Software Foundation.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <sndfile.h>
+#include "global.hpp"
+#include "Preferences.hpp"
+#include "smbPitchShift.hpp"
+#include "rakbench_lib.hpp"
+
+extern Preferences rakarrack;
+
+static bool
+load_clip(const std::filesystem::path& path, Signal& sig)
+{
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE* file = sf_open(path.string().c_str(), SFM_READ, &info);
+    if (file == nullptr)
+        return false;
+    if ((info.channels < 1) || (info.frames <= 0)) {
+        sf_close(file);
+        return false;
+    }
+
+    std::vector<float> frames((size_t) info.frames * info.channels);
+    sf_count_t n = sf_readf_float(file, frames.data(), info.frames);
+    sf_close(file);
+
+    sig.name = path.stem().string();
+    sig.l.resize((size_t) n);
+    sig.r.resize((size_t) n);
+    for (sf_count_t i = 0; i < n; i++) {
+        sig.l[i] = frames[(size_t) i * info.channels];
+        sig.r[i] = frames[(size_t) i * info.channels + (info.channels > 1 ? 1 : 0)];
+    }
+    return n > 0;
+}
+
+std::vector<Signal>
+load_clips(const char* dir)
+{
+    std::vector<std::filesystem::path> paths;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+        if (entry.path().extension() == ".wav")
+            paths.push_back(entry.path());
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Signal> clips;
+    for (const auto& path : paths) {
+        Signal sig;
+        if (load_clip(path, sig))
+            clips.push_back(std::move(sig));
+        else
+            fprintf(stderr, "skipping %s\n", path.string().c_str());
+    }
+    return clips;
+}
+
+void
+fit_signal(Signal& sig, std::size_t frames)
+{
+    const size_t n = sig.l.size();
+    std::vector<float> l(frames), r(frames);
+    for (size_t i = 0; i < frames; i++) {
+        l[i] = n ? sig.l[i % n] : 0.0f;
+        r[i] = n ? sig.r[i % n] : 0.0f;
+    }
+    sig.l.swap(l);
+    sig.r.swap(r);
+}
+
+std::vector<Signal>
+synthetic_signals(int rate, std::size_t frames)
+{
+    std::vector<Signal> sigs(5);
+    for (Signal& s : sigs) {
+        s.l.assign(frames, 0.0f);
+        s.r.assign(frames, 0.0f);
+    }
+
+    // Silence decays into denormals in recursive filters and reverbs.
+    sigs[0].name = "silence";
+
+    sigs[1].name = "impulse";
+    for (size_t i = 0; i < frames; i += (size_t) rate)
+        sigs[1].l[i] = sigs[1].r[i] = 1.0f;
+
+    sigs[2].name = "sine220";
+    for (size_t i = 0; i < frames; i++)
+        sigs[2].l[i] = sigs[2].r[i] = 0.5f * (float) sin(2.0 * M_PI * 220.0 * (double) i / rate);
+
+    sigs[3].name = "noise";
+    std::uint32_t seed = 22222;
+    for (size_t i = 0; i < frames; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        sigs[3].l[i] = 0.5f * ((float) (seed >> 8) / 8388608.0f - 1.0f);
+        seed = seed * 1664525u + 1013904223u;
+        sigs[3].r[i] = 0.5f * ((float) (seed >> 8) / 8388608.0f - 1.0f);
+    }
+
+    sigs[4].name = "sweep";
+    const double f0 = 40.0, f1 = 10000.0;
+    const double len = (double) frames / rate;
+    const double k = log(f1 / f0);
+    for (size_t i = 0; i < frames; i++) {
+        const double t = (double) i / rate;
+        const double phase = 2.0 * M_PI * f0 * len / k * (exp(t / len * k) - 1.0);
+        sigs[4].l[i] = sigs[4].r[i] = 0.5f * (float) sin(phase);
+    }
+
+    return sigs;
+}
+
+std::vector<int>
+parse_ints(const char* list)
+{
+    std::vector<int> values;
+    for (const char* p = list; *p; ) {
+        char* end;
+        long v = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        values.push_back((int) v);
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return values;
+}
+
+void
+setup_offline_engine()
+{
+    Pexitprogram = 0;
+    preset = 1000;
+    commandline = 1;
+    gui = 0;
+    needtoloadbank = 0;
+    needtoloadstate = 0;
+    offline = 1;
+
+    // The renders must not depend on the user's preferences. RKR(sample_rate,
+    // period) names itself "rakarrack", which prefixes every key it reads.
+    rakarrack.useDefaults();
+
+    static const struct {
+        const char* name;
+        int value;
+    } pinned[] = {
+        { "UpSampling", 0 },
+        { "Lazy Effects", 0 },
+        { "Vocoder Bands", 32 },
+        { "Pitch Shifter Mode", PitchShifter::REFERENCE },
+        { "Harmonizer Quality", 4 },
+        { "StereoHarm Quality", 4 },
+        { "Waveshape Resampling", 5 },
+        { "Waveshape Up Quality", 4 },
+        { "Waveshape Down Quality", 2 },
+        { "Distorsion Oversample", 5 },
+        { "Overdrive Oversample", 5 },
+        { "NewDist Oversample", 5 },
+        { "MBDist Oversample", 5 },
+        { "StompBox Oversample", 5 },
+        { "Valve Oversample", 0 },
+    };
+    char key[128];
+    for (const auto& p : pinned) {
+        snprintf(key, sizeof(key), "rakarrack %s", p.name);
+        rakarrack.set(key, p.value);
+    }
+}
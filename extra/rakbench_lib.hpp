@@ -0,0 +1,40 @@
+/*
+ * rakbench library - Input signals and engine setup shared by the offline
+ * effect tools (rakbench, rakgolden, rakrender).
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License
+ * as published by the Free Software Foundation.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// A stereo input signal.
+struct Signal
+{
+    std::string name;
+    std::vector<float> l, r;
+};
+
+/// Load every .wav file in dir, sorted by name. Mono files are copied to
+/// both channels. Files that can not be read are reported and skipped.
+std::vector<Signal> load_clips(const char* dir);
+
+/// Repeat or cut the signal to exactly `frames` samples.
+void fit_signal(Signal& sig, std::size_t frames);
+
+/// silence, impulse (one per second), sine220, noise and a 40 Hz - 10 kHz
+/// logarithmic sweep, `frames` samples long at `rate`. Deterministic.
+std::vector<Signal> synthetic_signals(int rate, std::size_t frames);
+
+/// Parse a comma separated list of integers.
+std::vector<int> parse_ints(const char* list);
+
+/// Set the engine globals the GUI entry point normally sets up, for an
+/// engine built with RKR(sample_rate, period), and pin the preferences the
+/// engine reads (quality, oversampling, lazy effects) to fixed values.
+void setup_offline_engine();
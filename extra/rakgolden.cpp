@@ -0,0 +1,499 @@
+/*
+ * rakgolden - Golden-output regression check for the rakarrack effects.
+ *
+ * Renders the test-audio clips through every effect type and factory preset
+ * with an offline engine and reduces each render to a fingerprint: a hash
+ * of the raw output samples, the RMS and peak level, and the average level
+ * in 24 logarithmic bands from 40 Hz to 16 kHz.
+ *
+ *   rakgolden -r golden.json    record the fingerprints of this build
+ *   rakgolden -c golden.json    compare this build against them
+ *   rakgolden --voices          check the shared pitch shifter voices
+ *
+ * A render passes a check when its hash matches (bit-exact), or when its
+ * RMS and every audible band are within the tolerance of its effect type.
+ * Tolerances are kept in the reference file: "tolerance_db" for all effects
+ * and "effect_tolerance_db" for per-type overrides; recording over an
+ * existing file keeps them.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License
+ * as published by the Free Software Foundation.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <fftw3.h>
+#include <nlohmann/json.hpp>
+#include "global.hpp"
+#include "smbPitchShift.hpp"
+#include "Effect.hpp"
+#include "EngineController.hpp"
+#include "rakbench_lib.hpp"
+
+#ifndef RAKBENCH_AUDIO_DIR
+#define RAKBENCH_AUDIO_DIR "test-audio"
+#endif
+
+namespace
+{
+constexpr int kSampleRate = 44100;   // rate of the test-audio clips
+constexpr int kPeriod = 256;
+constexpr int kBands = 24;
+constexpr double kLowHz = 40.0;
+constexpr double kHighHz = 16000.0;
+constexpr int kFFTSize = 4096;
+constexpr float kFloorDb = -120.0f;
+// Bands below this level in both renders are not compared.
+constexpr float kAudibleDb = -90.0f;
+constexpr double kDefaultTolerance = 0.5;
+// Exit status of --check against a file with no renders recorded yet;
+// CTest reports the test as skipped.
+constexpr int kExitNothingRecorded = 77;
+}
+
+struct Fingerprint
+{
+    std::uint64_t hash{0};
+    float rms_db{kFloorDb};
+    float peak_db{kFloorDb};
+    std::vector<float> bands;
+};
+
+static float
+to_db(double power)
+{
+    return power > 1.0e-12 ? std::max(kFloorDb, (float) (10.0 * log10(power))) : kFloorDb;
+}
+
+/*
+ * Average power spectrum of the mid signal, Hann windowed frames with 50%
+ * overlap, summed into logarithmic bands.
+ */
+class BandAnalyzer
+{
+public:
+    BandAnalyzer()
+    {
+        in = fftw_alloc_real(kFFTSize);
+        out = fftw_alloc_complex(kFFTSize / 2 + 1);
+        plan = fftw_plan_dft_r2c_1d(kFFTSize, in, out, FFTW_ESTIMATE);
+        window.resize(kFFTSize);
+        for (int i = 0; i < kFFTSize; i++)
+            window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / kFFTSize);
+    }
+
+    ~BandAnalyzer()
+    {
+        fftw_destroy_plan(plan);
+        fftw_free(in);
+        fftw_free(out);
+    }
+
+    std::vector<float> bands(const std::vector<float>& l, const std::vector<float>& r)
+    {
+        std::vector<double> power(kFFTSize / 2 + 1, 0.0);
+        int frames = 0;
+        for (size_t off = 0; off + kFFTSize <= l.size(); off += kFFTSize / 2) {
+            for (int i = 0; i < kFFTSize; i++)
+                in[i] = 0.5 * (l[off + i] + r[off + i]) * window[i];
+            fftw_execute(plan);
+            for (int b = 0; b <= kFFTSize / 2; b++)
+                power[b] += out[b][0] * out[b][0] + out[b][1] * out[b][1];
+            frames++;
+        }
+
+        std::vector<float> result(kBands, kFloorDb);
+        if (!frames)
+            return result;
+
+        const double hz_per_bin = (double) kSampleRate / kFFTSize;
+        const double norm = 4.0 / ((double) kFFTSize * kFFTSize * 0.375 * frames);
+        for (int k = 0; k < kBands; k++) {
+            const double lo = kLowHz * pow(kHighHz / kLowHz, (double) k / kBands);
+            const double hi = kLowHz * pow(kHighHz / kLowHz, (double) (k + 1) / kBands);
+            double sum = 0.0;
+            for (int b = (int) ceil(lo / hz_per_bin); b < hi / hz_per_bin && b <= kFFTSize / 2; b++)
+                sum += power[b];
+            result[k] = to_db(sum * norm);
+        }
+        return result;
+    }
+
+private:
+    double* in;
+    fftw_complex* out;
+    fftw_plan plan;
+    std::vector<double> window;
+};
+
+static Fingerprint
+render(RKR& rkr, int type, int npreset, const Signal& sig, BandAnalyzer& analyzer)
+{
+    // Effects draw from rand() when built and while running.
+    srand(1);
+
+    std::unique_ptr<Effect> efx = rkr.New_Effect(type);
+    rkr.Effect_setpreset(type, efx.get(), npreset);
+    efx->cleanup();
+
+    const size_t frames = sig.l.size();
+    std::vector<float> outl(frames), outr(frames);
+    std::vector<float> l(PERIOD), r(PERIOD);
+
+    for (size_t off = 0; off + PERIOD <= frames; off += PERIOD) {
+        memcpy(l.data(), sig.l.data() + off, sizeof(float) * PERIOD);
+        memcpy(r.data(), sig.r.data() + off, sizeof(float) * PERIOD);
+        memcpy(rkr.auxresampled.data(), l.data(), sizeof(float) * PERIOD);
+        efx->out(l.data(), r.data());
+        memcpy(outl.data() + off, l.data(), sizeof(float) * PERIOD);
+        memcpy(outr.data() + off, r.data(), sizeof(float) * PERIOD);
+    }
+
+    Fingerprint fp;
+    // FNV-1a over the sample bits, interleaved.
+    std::uint64_t hash = 14695981039346656037ull;
+    double sum = 0.0;
+    float peak = 0.0f;
+    for (size_t i = 0; i < frames; i++) {
+        for (float x : {outl[i], outr[i]}) {
+            std::uint32_t bits;
+            memcpy(&bits, &x, sizeof(bits));
+            for (int k = 0; k < 4; k++) {
+                hash ^= (bits >> (8 * k)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+            sum += (double) x * x;
+            peak = std::max(peak, fabsf(x));
+        }
+    }
+    fp.hash = hash;
+    fp.rms_db = to_db(frames ? sum / (2.0 * frames) : 0.0);
+    fp.peak_db = to_db((double) peak * peak);
+    fp.bands = analyzer.bands(outl, outr);
+    return fp;
+}
+
+/*
+ * A two voice FAST PitchShifter, the way StereoHarm runs it, against two
+ * one voice ones, sample for sample. The clips go in as a mono source (the
+ * same samples on both sides, which share one analysis), as a stereo one
+ * (which does not) and switching between the two every 50 periods; the
+ * right side also spends a stretch with no output taken, as StereoHarm
+ * does at a ratio of 1. Returns the number of sizes that do not match.
+ */
+static int
+check_voices(const std::vector<Signal>& clips)
+{
+    static const struct {
+        long window, osamp;
+    } sizes[] = { {2048, 4}, {1024, 8}, {512, 16} };
+    const float ratios[2] = {1.4983f, 0.7937f};   // a fifth up, a third down
+    int failed = 0;
+
+    for (const auto& size : sizes) {
+        auto shared = std::make_unique<PitchShifter>(size.window, size.osamp, kSampleRate, PitchShifter::FAST, 2);
+        auto left = std::make_unique<PitchShifter>(size.window, size.osamp, kSampleRate, PitchShifter::FAST);
+        auto right = std::make_unique<PitchShifter>(size.window, size.osamp, kSampleRate, PitchShifter::FAST);
+        std::vector<float> inr(kPeriod), outs[2], outl(kPeriod), outr(kPeriod);
+        outs[0].resize(kPeriod);
+        outs[1].resize(kPeriod);
+        size_t periods = 0, mismatched = 0;
+
+        for (const Signal& clip : clips) {
+            for (int mode = 0; mode < 3; mode++) {
+                for (size_t off = 0; off + kPeriod <= clip.l.size(); off += kPeriod, periods++) {
+                    const bool mono = (mode == 0) || ((mode == 2) && ((periods / 50) % 2 == 0));
+                    const float* l = clip.l.data() + off;
+                    for (int i = 0; i < kPeriod; i++)
+                        inr[i] = mono ? l[i] : clip.r[off + i] * 0.5f;
+                    const bool quiet = (mode == 2) && ((periods / 30) % 4 == 3);
+
+                    const float* in[2] = {l, inr.data()};
+                    float* out[2] = {outs[0].data(), quiet ? nullptr : outs[1].data()};
+                    shared->shiftVoices(ratios, kPeriod, in, out);
+
+                    float* one_l[1] = {outl.data()};
+                    float* one_r[1] = {quiet ? nullptr : outr.data()};
+                    left->shiftVoices(&ratios[0], kPeriod, &in[0], one_l);
+                    right->shiftVoices(&ratios[1], kPeriod, &in[1], one_r);
+
+                    if (memcmp(outs[0].data(), outl.data(), sizeof(float) * kPeriod)
+                        || (!quiet && memcmp(outs[1].data(), outr.data(), sizeof(float) * kPeriod)))
+                        mismatched++;
+                }
+            }
+        }
+
+        printf("%s   window %4ld osamp %2ld  %zu periods, %zu differ\n",
+               mismatched ? "DIFFER" : "exact ", size.window, size.osamp, periods, mismatched);
+        if (mismatched)
+            failed++;
+    }
+    return failed;
+}
+
+static std::string
+key_of(int type, int npreset, const std::string& signal)
+{
+    return std::to_string(type) + "/" + std::to_string(npreset) + "/" + signal;
+}
+
+static void
+show_help()
+{
+    fprintf(stderr, "Usage: rakgolden -r <golden.json> | -c <golden.json> [options]\n\n");
+    fprintf(stderr, "Record or check fingerprints of every effect type and factory preset\n");
+    fprintf(stderr, "rendered over the test-audio clips, without JACK.\n\n");
+    fprintf(stderr, "  -r, --record <file>    write the fingerprints of this build\n");
+    fprintf(stderr, "  -c, --check <file>     compare this build against a recorded file\n");
+    fprintf(stderr, "  -V, --voices           check that a two voice FAST pitch shifter matches\n");
+    fprintf(stderr, "                         two one voice ones sample for sample\n");
+    fprintf(stderr, "  -e, --effects <list>   effect types 0-46 to render (default: all)\n");
+    fprintf(stderr, "  -s, --seconds <s>      audio per clip when recording (default: 2.0)\n");
+    fprintf(stderr, "  -d, --audio <dir>      directory with .wav clips (default: %s)\n", RAKBENCH_AUDIO_DIR);
+    fprintf(stderr, "  -v, --verbose          list passing renders too\n");
+    fprintf(stderr, "  -h, --help             display this help and exit\n\n");
+    fprintf(stderr, "Exit status of --check: 0 all renders pass, 1 drift or missing renders,\n");
+    fprintf(stderr, "77 nothing recorded in the file yet.\n\n");
+}
+
+int
+main(int argc, char* argv[])
+{
+    int option_index = 0, opt;
+    int help = 0;
+    const char* record_file = nullptr;
+    const char* check_file = nullptr;
+    const char* audio_dir = RAKBENCH_AUDIO_DIR;
+    std::vector<int> types;
+    double seconds = 2.0;
+    bool verbose = false;
+    bool voices = false;
+
+    struct option opts[] = {
+        {"record", 1, nullptr, 'r'},
+        {"check", 1, nullptr, 'c'},
+        {"voices", 0, nullptr, 'V'},
+        {"effects", 1, nullptr, 'e'},
+        {"seconds", 1, nullptr, 's'},
+        {"audio", 1, nullptr, 'd'},
+        {"verbose", 0, nullptr, 'v'},
+        {"help", 0, nullptr, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while (1) {
+        opt = getopt_long(argc, argv, "r:c:Ve:s:d:vh", opts, &option_index);
+        if (opt == -1)
+            break;
+
+        switch (opt) {
+        case 'r':
+            record_file = optarg;
+            break;
+        case 'c':
+            check_file = optarg;
+            break;
+        case 'V':
+            voices = true;
+            break;
+        case 'e':
+            types = parse_ints(optarg);
+            break;
+        case 's':
+            seconds = atof(optarg);
+            break;
+        case 'd':
+            audio_dir = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            help = 1;
+            break;
+        }
+    }
+
+    if (help) {
+        show_help();
+        return 0;
+    }
+    if (voices) {
+        std::vector<Signal> clips = load_clips(audio_dir);
+        if (clips.empty()) {
+            fprintf(stderr, "rakgolden: no clips in %s\n", audio_dir);
+            return 2;
+        }
+        for (Signal& clip : clips)
+            fit_signal(clip, (size_t) ceil(seconds * kSampleRate / kPeriod) * kPeriod);
+        return check_voices(clips) ? 1 : 0;
+    }
+    if (((record_file == nullptr) == (check_file == nullptr)) || (seconds <= 0.0)) {
+        fprintf(stderr, "Try 'rakgolden --help' for usage options.\n");
+        return 2;
+    }
+    if (types.empty())
+        for (int type = 0; type < kNumEffectTypes; type++)
+            types.push_back(type);
+
+    // The reference: tolerances, and the renders of a previous build.
+    nlohmann::json reference = nlohmann::json::object();
+    {
+        std::ifstream in(check_file ? check_file : record_file);
+        if (in) {
+            try {
+                reference = nlohmann::json::parse(in);
+            } catch (const std::exception& e) {
+                fprintf(stderr, "rakgolden: can not parse %s: %s\n",
+                        check_file ? check_file : record_file, e.what());
+                if (check_file)
+                    return 2;
+            }
+        } else if (check_file) {
+            fprintf(stderr, "rakgolden: can not open %s\n", check_file);
+            return 2;
+        }
+    }
+    if (check_file)
+        seconds = reference.value("seconds", seconds);
+
+    const double tolerance = reference.value("tolerance_db", kDefaultTolerance);
+    std::map<int, double> effect_tolerance;
+    if (reference.contains("effect_tolerance_db"))
+        for (const auto& item : reference["effect_tolerance_db"].items())
+            effect_tolerance[atoi(item.key().c_str())] = item.value().get<double>();
+
+    std::map<std::string, Fingerprint> expected;
+    if (check_file && reference.contains("renders")) {
+        for (const auto& row : reference["renders"]) {
+            Fingerprint fp;
+            fp.hash = std::stoull(row.at("hash").get<std::string>(), nullptr, 16);
+            fp.rms_db = row.at("rms_db").get<float>();
+            fp.peak_db = row.at("peak_db").get<float>();
+            fp.bands = row.at("bands").get<std::vector<float>>();
+            expected[key_of(row.at("effect").get<int>(), row.at("preset").get<int>(),
+                            row.at("signal").get<std::string>())] = fp;
+        }
+    }
+
+    if (check_file && expected.empty()) {
+        fprintf(stderr, "rakgolden: no renders in %s, record them with -r first\n", check_file);
+        return kExitNothingRecorded;
+    }
+
+    std::vector<Signal> clips = load_clips(audio_dir);
+    if (clips.empty()) {
+        fprintf(stderr, "rakgolden: no clips in %s\n", audio_dir);
+        return 2;
+    }
+    const size_t frames = (size_t) ceil(seconds * kSampleRate / kPeriod) * kPeriod;
+    for (Signal& clip : clips)
+        fit_signal(clip, frames);
+
+    setup_offline_engine();
+    auto rkr = std::make_unique<RKR>(kSampleRate, kPeriod);
+    EngineController names(*rkr);
+
+    BandAnalyzer analyzer;
+    nlohmann::json renders = nlohmann::json::array();
+    int checked = 0, exact = 0, drifted = 0, missing = 0;
+
+    for (int type : types) {
+        const std::string name = names.getEffectTypeName(type);
+        const double limit = effect_tolerance.count(type) ? effect_tolerance[type] : tolerance;
+
+        for (int npreset = 0; npreset < RKR::Preset_Count(type); npreset++) {
+            for (const Signal& clip : clips) {
+                const std::string key = key_of(type, npreset, clip.name);
+                if (check_file && !expected.count(key))
+                    continue;
+
+                const Fingerprint fp = render(*rkr, type, npreset, clip, analyzer);
+
+                if (record_file) {
+                    char hash[17];
+                    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) fp.hash);
+                    nlohmann::json row;
+                    row["effect"] = type;
+                    row["name"] = name;
+                    row["preset"] = npreset;
+                    row["signal"] = clip.name;
+                    row["hash"] = hash;
+                    row["rms_db"] = fp.rms_db;
+                    row["peak_db"] = fp.peak_db;
+                    row["bands"] = fp.bands;
+                    renders.push_back(std::move(row));
+                    continue;
+                }
+
+                const Fingerprint& ref = expected[key];
+                checked++;
+                if (fp.hash == ref.hash) {
+                    exact++;
+                    if (verbose)
+                        printf("exact   %-12s preset %2d  %s\n", name.c_str(), npreset, clip.name.c_str());
+                    continue;
+                }
+
+                double diff = fabs(fp.rms_db - ref.rms_db);
+                for (int k = 0; k < kBands && k < (int) ref.bands.size(); k++)
+                    if ((fp.bands[k] > kAudibleDb) || (ref.bands[k] > kAudibleDb))
+                        diff = std::max(diff, (double) fabsf(fp.bands[k] - ref.bands[k]));
+
+                if (diff > limit) {
+                    drifted++;
+                    printf("DRIFT   %-12s preset %2d  %s  %.2f dB > %.2f dB\n",
+                           name.c_str(), npreset, clip.name.c_str(), diff, limit);
+                } else if (verbose) {
+                    printf("within  %-12s preset %2d  %s  %.2f dB\n",
+                           name.c_str(), npreset, clip.name.c_str(), diff);
+                }
+            }
+        }
+    }
+
+    if (record_file) {
+        nlohmann::json doc;
+        doc["tool"] = "rakgolden";
+        doc["version"] = VERSION;
+        doc["sample_rate"] = kSampleRate;
+        doc["period"] = kPeriod;
+        doc["seconds"] = seconds;
+        doc["tolerance_db"] = tolerance;
+        doc["effect_tolerance_db"] = reference.contains("effect_tolerance_db")
+                                     ? reference["effect_tolerance_db"]
+                                     : nlohmann::json::object();
+        doc["renders"] = std::move(renders);
+
+        std::ofstream out(record_file);
+        if (!out) {
+            fprintf(stderr, "rakgolden: can not create %s\n", record_file);
+            return 2;
+        }
+        out << doc.dump(1) << "\n";
+        return 0;
+    }
+
+    // Recorded renders of the selected types that were not rendered here,
+    // i.e. a clip or a preset that went away.
+    for (const auto& [key, fp] : expected)
+        if (std::find(types.begin(), types.end(), atoi(key.c_str())) != types.end())
+            missing++;
+    missing -= checked;
+
+    printf("%d renders: %d exact, %d within tolerance, %d drifted, %d missing\n",
+           checked, exact, checked - exact - drifted, drifted, missing);
+    return (drifted || missing) ? 1 : 0;
+}
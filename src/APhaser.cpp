@@ -279,6 +279,15 @@ Analog_Phaser::setdepth (int Pdepth)
 
 void
 Analog_Phaser::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Analog_Phaser::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 13;
     const int NUM_PRESETS = 6;
@@ -301,14 +310,12 @@ Analog_Phaser::setpreset (int npreset)
 
         FPreset::ReadPreset(18,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
 };
 
 
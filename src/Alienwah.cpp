@@ -180,6 +180,15 @@ Alienwah::setdelay (int Pdelay)
 
 void
 Alienwah::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Alienwah::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 11;
     const int NUM_PRESETS = 4;
@@ -198,16 +207,13 @@ Alienwah::setpreset (int npreset)
 
         FPreset::ReadPreset(11,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-
-    Ppreset = npreset;
 };
 
 
@@ -26,6 +26,50 @@
 #include <cstdio>
 #include "AnalogFilter.hpp"
 
+namespace
+{
+
+// One second order section of a cascade for CH channels. First order
+// filters run as one with c[2] = d[2] = 0.
+template <int CH>
+struct Section {
+    float c0[CH], c1[CH], c2[CH], d1[CH], d2[CH];
+    float x1[CH], x2[CH], y1[CH], y2[CH];
+};
+
+// Sample by sample through every section, so the signal stays in
+// registers between sections and the channels' recursions overlap.
+// Same arithmetic, in the same order, as singlefilterout.
+template <int CH>
+void
+cascade (Section<CH> *sec, int count, int n, float *const *smp)
+{
+    for (int i = 0; i < n; i++) {
+        float v[CH];
+        for (int ch = 0; ch < CH; ch++)
+            v[ch] = smp[ch][i];
+
+        for (int s = 0; s < count; s++) {
+            Section<CH> &q = sec[s];
+            for (int ch = 0; ch < CH; ch++) {
+                float y0 =
+                    (v[ch] * q.c0[ch]) + (q.x1[ch] * q.c1[ch]) + (q.x2[ch] * q.c2[ch]) +
+                    (q.y1[ch] * q.d1[ch]) + (q.y2[ch] * q.d2[ch]);
+                q.y2[ch] = q.y1[ch];
+                q.y1[ch] = y0 + DENORMAL_GUARD;
+                q.x2[ch] = q.x1[ch];
+                q.x1[ch] = v[ch];
+                v[ch] = y0;
+            }
+        }
+
+        for (int ch = 0; ch < CH; ch++)
+            smp[ch][i] = v[ch];
+    }
+}
+
+}
+
 
 AnalogFilter::AnalogFilter (unsigned char Ftype, float Ffreq, float Fq,
                             unsigned char Fstages)
@@ -431,6 +475,12 @@ void
 AnalogFilter::filterout (float * smp)
 {
     int i;
+    if (needsinterpolation == 0) {
+        AnalogFilter *self = this;
+        filterout_cascade (&self, nullptr, 1, smp, nullptr);
+        return;
+    };
+
     std::vector<float> ismp;	//used if it needs interpolation
     if (needsinterpolation != 0) {
         ismp.assign(smp, smp + PERIOD);
@@ -547,3 +597,79 @@ float AnalogFilter::H (float freq)
 };
 
 
+/*
+ * Runs l[0] .. l[count - 1] in turn on smpl and the matching r[] on smpr,
+ * or on smpl only when r is null.
+ */
+void
+AnalogFilter::filterout_cascade (AnalogFilter * const * l, AnalogFilter * const * r,
+                                 int count, float * smpl, float * smpr)
+{
+    // A filter crossfading from old coefficients, or an L/R pair with
+    // different stage counts, runs on its own
+    for (int k = 0; k < count; k++) {
+        if ((l[k]->needsinterpolation != 0)
+                || (r && ((r[k]->needsinterpolation != 0) || (r[k]->stages != l[k]->stages)))) {
+            for (int j = 0; j < count; j++) {
+                l[j]->filterout (smpl);
+                if (r)
+                    r[j]->filterout (smpr);
+            }
+            return;
+        }
+    }
+
+    if (r)
+        run_cascade<2> (l, r, count, smpl, smpr);
+    else
+        run_cascade<1> (l, nullptr, count, smpl, nullptr);
+};
+
+
+template <int CH>
+void
+AnalogFilter::run_cascade (AnalogFilter * const * l, AnalogFilter * const * r,
+                           int count, float * smpl, float * smpr)
+{
+    constexpr int kMaxSections = MAX_EQ_BANDS * MAX_FILTER_STAGES;
+    Section<CH> sec[kMaxSections];
+    float * const smp[2] = {smpl, smpr};
+
+    int k = 0;
+    while (k < count) {
+        // Gather as many whole filters as fit, run them, and put the
+        // state back
+        int n = 0, first = k;
+        for (; (k < count) && (n + l[k]->stages + 1 <= kMaxSections); k++) {
+            for (int st = 0; st <= l[k]->stages; st++, n++) {
+                for (int ch = 0; ch < CH; ch++) {
+                    const AnalogFilter &f = ch ? *r[k] : *l[k];
+                    sec[n].c0[ch] = f.c[0];
+                    sec[n].c1[ch] = f.c[1];
+                    sec[n].c2[ch] = f.c[2];
+                    sec[n].d1[ch] = f.d[1];
+                    sec[n].d2[ch] = f.d[2];
+                    sec[n].x1[ch] = f.x[st].c1;
+                    sec[n].x2[ch] = f.x[st].c2;
+                    sec[n].y1[ch] = f.y[st].c1;
+                    sec[n].y2[ch] = f.y[st].c2;
+                }
+            }
+        }
+
+        cascade<CH> (sec, n, PERIOD, smp);
+
+        n = 0;
+        for (int j = first; j < k; j++) {
+            for (int st = 0; st <= l[j]->stages; st++, n++) {
+                for (int ch = 0; ch < CH; ch++) {
+                    AnalogFilter &f = ch ? *r[j] : *l[j];
+                    f.x[st].c1 = sec[n].x1[ch];
+                    f.x[st].c2 = sec[n].x2[ch];
+                    f.y[st].c1 = sec[n].y1[ch];
+                    f.y[st].c2 = sec[n].y2[ch];
+                }
+            }
+        }
+    }
+};
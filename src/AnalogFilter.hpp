@@ -35,6 +35,10 @@ public:
                   unsigned char Fstages);
     ~AnalogFilter ();
     void filterout (float * smp);
+    /// l[0..count) on smpl and r[0..count) on smpr, or smpl only with a
+    /// null r, in one pass per block. Shared by EQ and the paired filters.
+    static void filterout_cascade (AnalogFilter * const * l, AnalogFilter * const * r,
+                                   int count, float * smpl, float * smpr);
     float filterout_s (float smp);
 
     void setfreq (float frequency);
@@ -62,6 +66,10 @@ private:
     float singlefilterout_s (float smp, fstage & x, fstage & y, float * c,
                              float * d);
 
+    template <int CH>
+    static void run_cascade (AnalogFilter * const * l, AnalogFilter * const * r,
+                             int count, float * smpl, float * smpr);
+
     void computefiltercoefs ();
     int type;			//The type of the filter (LPF1,HPF1,LPF2,HPF2...)
     int stages;			//how many times the filter is applied (0->1,1->2,etc.)
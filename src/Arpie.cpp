@@ -41,6 +41,7 @@ Arpie::Arpie ()
     Phidamp = 60;
     Pharms = 3;
     Psubdiv = 1;
+    subdiv = Psubdiv + 1;
 
     lrdelay = 0;
     harmonic = 1;
@@ -73,8 +74,11 @@ Arpie::cleanup ()
     oldr = 0.0;
     rvkl = 0;
     rvkr = 0;
+    rvfl = 0;
+    rvfr = 0;
     kl = 0;
     kr = 0;
+    envcnt = 0;
     harmonic = 1;
 };
 
@@ -291,6 +295,15 @@ Arpie::setpattern (int pattern_index)
 
 void
 Arpie::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Arpie::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 9;
     const int NUM_PRESETS = 9;
@@ -318,13 +331,12 @@ Arpie::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(24,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
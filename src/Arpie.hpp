@@ -35,6 +35,7 @@ public:
     ~Arpie ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -245,6 +245,15 @@ Chorus::setlrcross (int Plrcross)
 
 void
 Chorus::setpreset (int dgui, int npreset)
+{
+    PresetChanges changes;
+    preset_changes (dgui, npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Chorus::preset_changes (int dgui, int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 12;
     const int NUM_PRESETS = 10;
@@ -275,19 +284,16 @@ Chorus::setpreset (int dgui, int npreset)
     if((dgui==0) && (npreset>4)) {
         FPreset::ReadPreset(5,npreset-4);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
 
     } else if((dgui==1) && (npreset>9)) {
         FPreset::ReadPreset(7,npreset-9);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-
-
 };
 
 
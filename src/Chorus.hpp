@@ -39,6 +39,7 @@ public:
     void out (float * smpsl, float * smpsr);
     using Effect::setpreset;
     void setpreset (int dgui, int npreset);
+    static void preset_changes (int dgui, int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
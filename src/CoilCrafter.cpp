@@ -200,6 +200,15 @@ CoilCrafter::sethpf ([[maybe_unused]] int value)
 
 void
 CoilCrafter::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+CoilCrafter::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 9;
     const int NUM_PRESETS = 2;
@@ -215,15 +224,12 @@ CoilCrafter::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(33,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
-    cleanup ();
-
+    changes.cleanup ();
 };
 
 
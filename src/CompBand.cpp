@@ -264,6 +264,15 @@ CompBand::setCross3 (int value)
 
 void
 CompBand::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+CompBand::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 13;
     const int NUM_PRESETS = 3;
@@ -282,13 +291,12 @@ CompBand::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(43,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 };
 
 
@@ -43,6 +43,7 @@ public:
     ~CompBand ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
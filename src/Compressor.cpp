@@ -87,6 +87,21 @@ Compressor::cleanup ()
     clipping = 0;
 }
 
+/*
+ * The Effect interface, parameters and presets as the other effects have them
+ */
+void
+Compressor::setpreset (int npreset)
+{
+    Compressor_Change_Preset (0, npreset);
+}
+
+void
+Compressor::changepar (int npar, int value)
+{
+    Compressor_Change (npar, value);
+}
+
 
 void
 Compressor::Compressor_Change (int np, int value)
@@ -205,6 +220,14 @@ Compressor::getpar (int np)
 
 void
 Compressor::Compressor_Change_Preset (int dgui, int npreset)
+{
+    PresetChanges changes;
+    preset_changes (dgui, npreset, changes);
+    apply (changes);
+}
+
+void
+Compressor::preset_changes (int dgui, int npreset, PresetChanges &changes)
 {
 
     const int PRESET_SIZE = 10;
@@ -231,13 +254,12 @@ Compressor::Compressor_Change_Preset (int dgui, int npreset)
     if((dgui)&&(npreset>2)) {
         FPreset::ReadPreset(1,npreset-2);
         for (int n = 1; n < PRESET_SIZE; n++)
-            Compressor_Change (n , pdata[n-1]);
+            changes.add (n , pdata[n-1]);
 
     } else {
         for (int n = 1; n < PRESET_SIZE; n++)
-            Compressor_Change (n , presets[npreset][n-1]);
+            changes.add (n , presets[npreset][n-1]);
     }
-
 }
 
 
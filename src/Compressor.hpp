@@ -41,8 +41,11 @@ public:
 
     void out (float * smps_l, float * smps_r);
 
+    void setpreset (int npreset);
+    void changepar (int npar, int value);
     void Compressor_Change (int np, int value);
     void Compressor_Change_Preset (int dgui,int npreset);
+    static void preset_changes (int dgui, int npreset, PresetChanges &changes);
     int getpar (int npar);
     void cleanup ();
 
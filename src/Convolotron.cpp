@@ -25,9 +25,13 @@
 #include <cstring>
 #include <cstdlib>
 #include <cmath>
+#include <sndfile.h>
 #include "Convolotron.hpp"
 #include "FPreset.hpp"
 #include "EmbeddedResource.hpp"
+#include "FileCache.hpp"
+#include "mayer_fft.hpp"
+#include "NonUniformConvolver.hpp"
 
 // libsndfile virtual I/O callbacks for reading from in-memory data
 struct SfMemData {
@@ -63,7 +67,135 @@ static sf_count_t sf_mem_tell(void* user_data) {
     return static_cast<SfMemData*>(user_data)->pos;
 }
 
-Convolotron::Convolotron (int DS, int uq, int dq)
+/*
+ * A mono IR at the effect's sample rate: a file as decoded, or windowed and
+ * normalised for one length and mode. Immutable, shared through the cache.
+ */
+namespace {
+struct Impulse {
+    std::vector<float> smps;
+};
+}
+
+static FileCache<Impulse> impulses;
+
+// FileKey::options of a file as decoded, apart from the shaped ones whose
+// options hold Psafe.
+constexpr int kDecodedImpulse = 1 << 16;
+
+// Shaped IRs partitioned and transformed for one period and maximum length.
+static FileCache<NonUniformConvolver::Partitions> partitions;
+
+/*
+ * Decode a .wav file, keep at most maxx_read frames and resample them to
+ * rate. nullptr if libsndfile can't read it.
+ */
+static std::shared_ptr<const Impulse>
+decode_impulse(const unsigned char *data, std::size_t size, int rate, int maxx_read)
+{
+    SfMemData memdata{data, static_cast<sf_count_t>(size), 0};
+    SF_VIRTUAL_IO vio{sf_mem_get_filelen, sf_mem_seek, sf_mem_read, sf_mem_write, sf_mem_tell};
+    SF_INFO sfinfo{};
+    SNDFILE *infile = sf_open_virtual(&vio, SFM_READ, &sfinfo, &memdata);
+    if (!infile)
+        return nullptr;
+
+    int real_len;
+    if (sfinfo.frames > maxx_read) real_len = maxx_read;
+    else real_len = static_cast<int>(sfinfo.frames);
+    std::vector<float> buf((std::size_t) real_len * std::max(sfinfo.channels, 1), 0.0f);
+    sf_seek (infile,0, SEEK_SET);
+    sf_readf_float(infile,buf.data(),real_len);
+    sf_close(infile);
+
+    auto ir = std::make_shared<Impulse>();
+    if (sfinfo.samplerate != rate) {
+        double sr_ratio = (double)rate/((double) sfinfo.samplerate);
+        int out_len = (int) lrint((double)real_len*sr_ratio);
+        ir->smps.assign(std::max(out_len, (int) lrintf((float)real_len*(float)sr_ratio)), 0.0f);
+        Resample M_Resample(0, sr_ratio);
+        M_Resample.mono_out(buf.data(),ir->smps.data(),real_len,out_len);
+        ir->smps.resize(lrintf((float)real_len*(float)sr_ratio));
+    } else {
+        ir->smps.assign(buf.begin(), buf.begin() + real_len);
+    }
+    return ir;
+}
+
+/*
+ * Cut the IR to Plength ms with a Blackman tail, keep its power, and reduce
+ * it to the short "safe" IR if Psafe is set.
+ */
+static std::shared_ptr<const Impulse>
+shape_impulse(const Impulse &raw, float nfSAMPLE_RATE, int Plength, int Psafe, int maxx_read)
+{
+    const std::vector<float> &rbuf = raw.smps;
+    const int real_len = (int) rbuf.size();
+    int ii,j,N,N2;
+    float tailfader, alpha, a0, a1, a2, Nm1p, Nm1pp, IRpowa, IRpowb, ngain, maxamp;
+
+    int length = (int) (nfSAMPLE_RATE * ((float) Plength)/1000.0f);  //time in samples
+    if (length > real_len) length = real_len;
+    std::vector<float> buf(std::max(length, 256), 0.0f);
+    /*Blackman Window function
+    wn = a0 - a1*cos(2*pi*n/(N-1)) + a2 * cos(4*PI*n/(N-1)
+    a0 = (1 - alpha)/2; a1 = 0.5; a2 = alpha/2
+    */
+    alpha = 0.16f;
+    a0 = 0.5f*(1.0f - alpha);
+    a1 = 0.5f;
+    a2 = 0.5f*alpha;
+    N = length;
+    N2 = length/2;
+    Nm1p = D_PI/((float) (N - 1));
+    Nm1pp = 4.0f * PI/((float) (N - 1));
+
+    for(ii=0; ii<length; ii++) {
+        if (ii<N2) {
+            tailfader = 1.0f;
+        } else {
+            tailfader = a0 - a1*cosf(ii*Nm1p) + a2 * cosf(ii*Nm1pp);   //Calculate Blackman Window for right half of IR
+        }
+
+        buf[ii]= rbuf[ii] * tailfader;   //Apply window function
+
+    }
+
+    IRpowa = IRpowb = maxamp = 0.0f;
+    //compute IR signal power
+    for(j=0; j<length; j++) {
+        IRpowa += fabsf(rbuf[j]);
+        if(maxamp < fabsf(buf[j])) maxamp = fabsf(buf[j]);   //find maximum level to normalize
+
+        if(j < length) {
+            IRpowb += fabsf(buf[j]);
+        }
+
+    }
+
+    ngain = IRpowa/IRpowb;
+    if (ngain > maxx_read) ngain = static_cast<float>(maxx_read);
+    for(j=0; j<length; j++) buf[j] *= ngain;
+
+    if (Psafe) {
+        fft_filter impulse;
+        impulse.resample_impulse(length, buf.data());
+        length = 156;
+    }
+
+    buf.resize(length);
+    return std::make_shared<const Impulse>(Impulse{std::move(buf)});
+}
+
+/*
+ * A convolver loaded with a shaped IR. Built by the loader thread and only
+ * run by the audio thread after that.
+ */
+struct Convolotron::IR : LoadedFile {
+    std::unique_ptr<NonUniformConvolver> convolver;
+};
+
+Convolotron::Convolotron (int DS, int uq, int dq, float maxlength)
 {
     //default values
     Ppreset = 0;
@@ -75,8 +207,7 @@ Convolotron::Convolotron (int DS, int uq, int dq)
     Filenum = 0;
     Plength = 50;
     Puser = 0;
-    real_len = 0;
-    convlength = .5f;
+    convlength = maxlength;  //max IR memory, the long tail partitions run on worker threads
     fb = 0.0f;
     feedback = 0.0f;
     adjust(DS);
@@ -85,16 +216,15 @@ Convolotron::Convolotron (int DS, int uq, int dq)
     tempr.resize(PERIOD);
 
     maxx_size = (int) (nfSAMPLE_RATE * convlength);  //just to get the max memory allocated
-    buf.resize(maxx_size);
-    rbuf.resize(maxx_size);
-    lxn.resize(maxx_size);
     maxx_size--;
-    offset = 0;
-    M_Resample = std::make_unique<Resample>(0);
-    U_Resample = std::make_unique<Resample>(dq);//Downsample, uses sinc interpolation for bandlimiting to avoid aliasing
-    D_Resample = std::make_unique<Resample>(uq);
+    oldl = 0.0f;
+    lastyn = 0.0f;
+    U_Resample = std::make_unique<Resample>(dq, u_up);//Downsample, uses sinc interpolation for bandlimiting to avoid aliasing
+    D_Resample = std::make_unique<Resample>(uq, u_down);
+    loader = std::make_unique<FileLoader>([this] (const FileRequest &req) { return loadfile (req); }, !offline);
 
     setpreset (Ppreset);
+    waitfile ();
     cleanup ();
 };
 
@@ -194,43 +324,64 @@ Convolotron::adjust(int DS)
 void
 Convolotron::out (float * smpsl, float * smpsr)
 {
-    int i, j, xindex;
+    int i;
     float l,lyn;
 
     if(DS_state != 0) {
         memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
         memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
     }
 
 
-    for (i = 0; i < nPERIOD; i++) {
+    takefile();
+    NonUniformConvolver *convolver = ir->convolver.get();
 
-        l = smpsl[i] + smpsr[i] + feedback;
-        oldl = l * hidamp + oldl * (alpha_hidamp);  //apply damping while I'm in the loop
-        lxn[offset] = oldl;
+    if (fading) {
+        //crossfade from the old IR to the new one over this period
+        NonUniformConvolver *old = fading->convolver.get();
+        const float step = 1.0f / (float) nPERIOD;
 
+        for (i = 0; i < nPERIOD; i++) {
 
-        //Convolve left channel
-        lyn = 0;
-        xindex = offset;
+            l = smpsl[i] + smpsr[i] + feedback;
+            oldl = l * hidamp + oldl * (alpha_hidamp);
 
-        for (j =0; j<length; j++) {
-            if (--xindex<0) xindex = maxx_size;		//length of lxn is maxx_size.
-            lyn += buf[j] * lxn[xindex];		//this is all there is to convolution
-        }
+            const float g = (float) (i + 1) * step;
+            const float yo = old->tick(oldl);
+            lyn = lastyn;
+            lastyn = yo + (convolver->tick(oldl) - yo) * g;
 
-        feedback = fb * lyn;
-        templ[i] = lyn * levpanl;
-        tempr[i] = lyn * levpanr;
+            feedback = fb * lyn;
+            templ[i] = lyn * levpanl;
+            tempr[i] = lyn * levpanr;
+        };
 
-        if (++offset>maxx_size) offset = 0;
+        old->end_block();
+        loader->retire(fading.release());
 
+    } else {
 
-    };
+        for (i = 0; i < nPERIOD; i++) {
+
+            l = smpsl[i] + smpsr[i] + feedback;
+            oldl = l * hidamp + oldl * (alpha_hidamp);  //apply damping while I'm in the loop
+
+            //The IR is applied one sample late so the feedback path stays causal
+            lyn = lastyn;
+            lastyn = convolver->tick(oldl);
+
+            feedback = fb * lyn;
+            templ[i] = lyn * levpanl;
+            tempr[i] = lyn * levpanr;
+
+        };
+    }
+
+    convolver->end_block();
 
     if(DS_state != 0) {
-        D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD,u_down);
+        D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD);
 
     } else {
         memcpy(smpsl, templ.data(),sizeof(float)*PERIOD);
@@ -268,143 +419,122 @@ Convolotron::setpanning (int Ppanning)
 
 };
 
-int
-Convolotron::setfile(int value)
+/*
+ * Ask the loader for the IR the parameters call for. Filenum, Puser,
+ * Filename, Plength and Psafe all change what it builds.
+ */
+void
+Convolotron::requestfile()
 {
+    FileRequest req;
+    req.num = Filenum;
+    req.user = Puser;
+    req.name = Filename;
+    req.args = {Plength, Psafe};
+    loader->request(req);
+}
 
-    double sr_ratio;
-
-    offset = 0;
-    maxx_read = maxx_size / 2;
-    memset(buf.data(),0,sizeof(float) * maxx_size);
-    memset(rbuf.data(),0,sizeof(float) * maxx_size);
-
-    SfMemData memdata{};
-    SF_VIRTUAL_IO vio{sf_mem_get_filelen, sf_mem_seek, sf_mem_read, sf_mem_write, sf_mem_tell};
-
-    if(!Puser) {
-        Filenum = value;
-        if(Filenum >= 0 && Filenum < NUM_WAV_RESOURCES) {
-            memdata = {wav_resources[Filenum].data,
-                       static_cast<sf_count_t>(*wav_resources[Filenum].len), 0};
-            sfinfo.format = 0;
-            infile = sf_open_virtual(&vio, SFM_READ, &sfinfo, &memdata);
-        } else {
-            real_len = 1; length = 1; rbuf[0] = 1.0f;
-            process_rbuf();
-            return(0);
-        }
+/*
+ * RT thread. Put a newly loaded IR in place; out() fades over from the old
+ * one. One that arrives while a fade is running replaces the IR fading in.
+ */
+void
+Convolotron::takefile()
+{
+    IR *next = static_cast<IR *>(loader->take());
+    if (!next)
+        return;
+    if (!next->found)
+        error_num = 1;
+
+    if (!ir)
+        ir.reset(next);
+    else if (fading) {
+        loader->retire(ir.release());
+        ir.reset(next);
     } else {
-        sfinfo.format = 0;
-        infile = sf_open(Filename.data(), SFM_READ, &sfinfo);
-    }
-
-    if(!infile) {
-        real_len = 1;
-        length = 1;
-        rbuf[0] = 1.0f;
-        process_rbuf();
-        return(0);
+        fading = std::move(ir);
+        ir.reset(next);
     }
-
-    if (sfinfo.frames > maxx_read) real_len = maxx_read;
-    else real_len = static_cast<int>(sfinfo.frames);
-    sf_seek (infile,0, SEEK_SET);
-    sf_readf_float(infile,buf.data(),real_len);
-    sf_close(infile);
-
-
-
-
-    if (sfinfo.samplerate != (int)nSAMPLE_RATE) {
-        sr_ratio = (double)nSAMPLE_RATE/((double) sfinfo.samplerate);
-        M_Resample->mono_out(buf.data(),rbuf.data(),real_len,sr_ratio,lrint((double)real_len*sr_ratio));
-        real_len =lrintf((float)real_len*(float)sr_ratio);
-    }
-
-    else memcpy(rbuf.data(),buf.data(),real_len*sizeof(float));
-
-    process_rbuf();
-
-    return(1);
-};
-
+}
 
 void
-Convolotron::process_rbuf()
+Convolotron::waitfile()
 {
-    int ii,j,N,N2;
-    float tailfader, alpha, a0, a1, a2, Nm1p, Nm1pp, IRpowa, IRpowb, ngain, maxamp;
-    memset(buf.data(),0, sizeof(float)*real_len);
-
-    if (length > real_len) length = real_len;
-    /*Blackman Window function
-    wn = a0 - a1*cos(2*pi*n/(N-1)) + a2 * cos(4*PI*n/(N-1)
-    a0 = (1 - alpha)/2; a1 = 0.5; a2 = alpha/2
-    */
-    alpha = 0.16f;
-    a0 = 0.5f*(1.0f - alpha);
-    a1 = 0.5f;
-    a2 = 0.5f*alpha;
-    N = length;
-    N2 = length/2;
-    Nm1p = D_PI/((float) (N - 1));
-    Nm1pp = 4.0f * PI/((float) (N - 1));
+    loader->wait();
+    takefile();
+    fading.reset();
+}
 
-    for(ii=0; ii<length; ii++) {
-        if (ii<N2) {
-            tailfader = 1.0f;
-        } else {
-            tailfader = a0 - a1*cosf(ii*Nm1p) + a2 * cosf(ii*Nm1pp);   //Calculate Blackman Window for right half of IR
+/*
+ * The file is hashed and looked up in the shared caches before it is
+ * processed again: transformed for this period, shaped for this length and
+ * mode, and as decoded.
+ */
+std::unique_ptr<LoadedFile>
+Convolotron::loadfile(const FileRequest &req) const
+{
+    const int Plength = req.args[0];
+    const int Psafe = req.args[1];
+    const int maxx_read = maxx_size / 2;
+    auto ir = std::make_unique<IR>();
+
+    std::vector<unsigned char> bytes;
+    const unsigned char *data = nullptr;
+    std::size_t size = 0;
+    if(!req.user) {
+        if(req.num >= 0 && req.num < NUM_WAV_RESOURCES) {
+            data = wav_resources[req.num].data;
+            size = *wav_resources[req.num].len;
         }
-
-        buf[ii]= rbuf[ii] * tailfader;   //Apply window function
-
+    } else if (read_file(req.name.data(), bytes)) {
+        data = bytes.data();
+        size = bytes.size();
     }
 
-
-    //memcpy(buf,rbuf,real_len*sizeof(float));
-
-    IRpowa = IRpowb = maxamp = 0.0f;
-    //compute IR signal power
-    for(j=0; j<length; j++) {
-        IRpowa += fabsf(rbuf[j]);
-        if(maxamp < fabsf(buf[j])) maxamp = fabsf(buf[j]);   //find maximum level to normalize
-
-        if(j < length) {
-            IRpowb += fabsf(buf[j]);
+    FileKey key{0, nSAMPLE_RATE, maxx_read, Plength, Psafe};
+    FileKey partkey{0, nSAMPLE_RATE, maxx_size, Plength, Psafe, nPERIOD};
+    std::shared_ptr<const NonUniformConvolver::Partitions> parts;
+    std::shared_ptr<const Impulse> impulse, raw;
+    if (data) {
+        key.hash = partkey.hash = file_hash(data, size);
+        parts = partitions.find(partkey);
+        if (!parts)
+            impulse = impulses.find(key);
+        if (!parts && !impulse) {
+            FileKey rawkey{key.hash, nSAMPLE_RATE, maxx_read, 0, kDecodedImpulse};
+            raw = impulses.find(rawkey);
+            if (!raw && (raw = decode_impulse(data, size, nSAMPLE_RATE, maxx_read)))
+                raw = impulses.insert(rawkey, raw);
         }
-
     }
 
-    //if(maxamp < 0.3f) maxamp = 0.3f;
-    ngain = IRpowa/IRpowb;
-    if (ngain > maxx_read) ngain = static_cast<float>(maxx_read);
-    for(j=0; j<length; j++) buf[j] *= ngain;
-
-    if (Psafe) {
-        impulse.resample_impulse(length, buf.data());
-        length = 156;
-        convlength = length/fSAMPLE_RATE;
-    }
-    /*
-    //This section can be uncommented to make a text file you can plot
-    //with something like gnuplot
-    FILE * textfile;
-    textfile = fopen("IR.txt", "w");
-    if (textfile!=nullptr)
-    {
-    for(j=0;j<length;j++) {
-    fprintf (textfile, "%d\t%f\n",j,buf[j]);
-    }
-    fclose (textfile);
+    if (!parts && !impulse) {
+        if (!raw) {
+            //a unit impulse stands in for a missing file
+            ir->found = false;
+            raw = std::make_shared<const Impulse>(Impulse{{1.0f}});
+        }
+        impulse = shape_impulse(*raw, nfSAMPLE_RATE, Plength, Psafe, maxx_read);
+        if (ir->found)
+            impulse = impulses.insert(key, impulse);
     }
-    */
-
 
+    //IR head is convolved in nPERIOD sized partitions, so no latency is added.
+    if (!parts) {
+        const std::vector<float> &smps = impulse->smps;
+        parts = NonUniformConvolver::transform(nPERIOD, maxx_size, smps.data(), (int) smps.size());
+        if (ir->found)
+            parts = partitions.insert(partkey, parts);
+    }
 
+    //Offline renders compute the long partitions inline to stay deterministic.
+    ir->convolver = std::make_unique<NonUniformConvolver>(nPERIOD, maxx_size, !offline);
+    ir->convolver->set_impulse(std::move(parts));
+    return ir;
 }
 
+
 void
 Convolotron::sethidamp (int Phidamp)
 {
@@ -415,6 +545,15 @@ Convolotron::sethidamp (int Phidamp)
 
 void
 Convolotron::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Convolotron::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 11;
     const int NUM_PRESETS = 4;
@@ -432,23 +571,14 @@ Convolotron::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(29,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
-void
-Convolotron::UpdateLength ()
-{
-    convlength = ((float) Plength)/1000.0f;                   //time in seconds
-    length = (int) (nfSAMPLE_RATE * convlength);        //time in samples
-    process_rbuf();
-}
-
 void
 Convolotron::changepar (int npar, int value)
 {
@@ -461,15 +591,15 @@ Convolotron::changepar (int npar, int value)
         break;
     case 2:
         Psafe = value;
-        UpdateLength();
+        requestfile();
         break;
     case 3:
         Plength = value;
-        UpdateLength();
+        requestfile();
         break;
     case 8:
-        if(!setfile(value)) error_num=1;
-        UpdateLength();
+        if(!Puser) Filenum = value;
+        requestfile();
         break;
     case 5:
         break;
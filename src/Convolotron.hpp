@@ -24,24 +24,27 @@
 #ifndef CONVOLOTRON_H
 #define CONVOLOTRON_H
 
-#include <sndfile.h>
+#include <memory>
 #include "dsp_constants.hpp"
 #include "Resample.hpp"
-#include "mayer_fft.hpp"
+#include "FileLoader.hpp"
 #include "Effect.hpp"
 
 class Convolotron : public Effect
 {
 public:
-    Convolotron (int DS, int uq, int dq);
+    Convolotron (int DS, int uq, int dq, float maxlength = 5.0f);
     ~Convolotron ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
-    int setfile (int value);
     void adjust(int DS);
+    /// Not on the RT thread: wait for the IR asked for last and put it in
+    /// place, for an instance that is not playing yet.
+    void waitfile();
     void loaddefault();
 
 
@@ -64,11 +67,14 @@ private:
     void setvolume (int Pvolume);
     void setpanning (int Ppanning);
     void sethidamp (int Phidamp);
-    void process_rbuf();
-    void UpdateLength ();
+    void requestfile();
+    void takefile();
 
-    int offset;
-    int maxx_size,maxx_read,real_len,length;
+    /// Worker thread: reads, resamples and windows the IR and loads it
+    /// into a new convolver.
+    std::unique_ptr<LoadedFile> loadfile(const FileRequest &req) const;
+
+    int maxx_size;
     int DS_state;
     int nPERIOD;
     int nSAMPLE_RATE;
@@ -78,22 +84,22 @@ private:
     float nfSAMPLE_RATE;
 
 
-    float lpanning, rpanning, hidamp, alpha_hidamp, convlength, oldl;
-    std::vector<float> rbuf, buf, lxn;
+    float lpanning, rpanning, hidamp, alpha_hidamp, convlength, oldl, lastyn;
     std::vector<float> templ, tempr;
 
     float level,fb, feedback;
     float levpanl,levpanr;
 
-    SNDFILE *infile;
-    SF_INFO sfinfo;
-
     //Parametrii reali
 
-    std::unique_ptr<Resample> M_Resample;
     std::unique_ptr<Resample> U_Resample;
     std::unique_ptr<Resample> D_Resample;
-    fft_filter impulse;
+
+    // The IR playing, and for one period after a new one arrives, the one
+    // it fades in over
+    struct IR;
+    std::unique_ptr<IR> ir, fading;
+    std::unique_ptr<FileLoader> loader;
 
 
 };
@@ -30,7 +30,7 @@
 #include "Distorsion.hpp"
 #include "FPreset.hpp"
 
-Distorsion::Distorsion()
+Distorsion::Distorsion(int oversample)
 {
     octoutl.resize(PERIOD);
     octoutr.resize(PERIOD);
@@ -48,8 +48,8 @@ Distorsion::Distorsion()
     DCl->setfreq (30.0f);
     DCr->setfreq (30.0f);
 
-    dwshapel = std::make_unique<Waveshaper>();
-    dwshaper = std::make_unique<Waveshaper>();
+    dwshapel = std::make_unique<Waveshaper>(oversample);
+    dwshaper = std::make_unique<Waveshaper>(oversample);
 
     //default values
     Ppreset = 0;
@@ -98,13 +98,9 @@ Distorsion::cleanup ()
 void
 Distorsion::applyfilters (float * smpsl, float * smpsr)
 {
-    lpfl->filterout (smpsl);
-    hpfl->filterout (smpsl);
-    if (Pstereo != 0) {
-        //stereo
-        lpfr->filterout (smpsr);
-        hpfr->filterout (smpsr);
-    };
+    AnalogFilter *l[] = {lpfl.get(), hpfl.get()};
+    AnalogFilter *r[] = {lpfr.get(), hpfr.get()};
+    AnalogFilter::filterout_cascade (l, (Pstereo != 0) ? r : nullptr, 2, smpsl, smpsr);
 };
 
 /*
@@ -262,6 +258,15 @@ Distorsion::setoctave (int Poctave)
 
 void
 Distorsion::setpreset (int dgui, int npreset)
+{
+    PresetChanges changes;
+    preset_changes (dgui, npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+}
+
+void
+Distorsion::preset_changes (int dgui, int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE{11};
     const int NUM_PRESETS{6};
@@ -283,17 +288,16 @@ Distorsion::setpreset (int dgui, int npreset)
     if((dgui==0) && (npreset>5)) {
         FPreset::ReadPreset(2,npreset-5);
         for (int n = 0; n < PRESET_SIZE; n++)
-            {changepar (n, pdata[n]);}
+            {changes.add (n, pdata[n]);}
     } else if((dgui==1) && (npreset>1)) {
         FPreset::ReadPreset(3,npreset-1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            {changepar (n, pdata[n]);}
+            {changes.add (n, pdata[n]);}
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            {changepar (n, presets[npreset][n]);}
+            {changes.add (n, presets[npreset][n]);}
     }
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 }
 
 void
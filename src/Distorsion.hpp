@@ -33,11 +33,13 @@
 class Distorsion : public Effect
 {
 public:
-    Distorsion();
+    /// oversample as for Waveshaper
+    Distorsion(int oversample = 0);
     ~Distorsion ();
     void out (float * smpsl, float * smpr);
     using Effect::setpreset;
     void setpreset (int dgui, int npreset);
+    static void preset_changes (int dgui, int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
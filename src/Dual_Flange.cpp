@@ -63,7 +63,7 @@ Dflange::Dflange ()
     fhidamp = 1.0f;
     fwidth = 800;
     fdepth = 50;
-    zcenter = static_cast<int>(fSAMPLE_RATE/floorf(0.5f * (fdepth + fwidth)));
+    setcenter ();
     base = 7.0f;		//sets curve of modulation to frequency relationship
     ibase = 1.0f/base;
     //default values
@@ -103,7 +103,26 @@ Dflange::cleanup ()
     lflange0 = 0.0f;
     rflange1 = 0.0f;
     lflange1 = 0.0f;
+    oldrflange0 = 0.0f;
+    oldrflange1 = 0.0f;
+    oldlflange0 = 0.0f;
+    oldlflange1 = 0.0f;
+    oldl = 0.0f;
+    oldr = 0.0f;
+    kl = kr = 0;
+    zl = zr = 0;
+
+};
 
+/*
+ * The zero delay line wraps at zcenter, keep it inside the buffer
+ * for small Depth + Width sums.
+ */
+void
+Dflange::setcenter ()
+{
+    zcenter = static_cast<int>(fSAMPLE_RATE/floorf(0.5f * (fdepth + fwidth)));
+    if (zcenter >= maxx_delay) zcenter = maxx_delay - 1;
 };
 
 
@@ -339,9 +358,9 @@ Dflange::out (float * smpsl, float * smpsr)
 
 
             if (--kl < 0)   //Cycle delay buffer in reverse so delay time can be indexed directly with addition
-                kl =  maxx_delay;
+                kl =  maxx_delay - 1;
             if (--kr < 0)
-                kr =  maxx_delay;
+                kr =  maxx_delay - 1;
 
 
 
@@ -403,13 +422,13 @@ Dflange::changepar (int npar, int value)
     case 3:
         Pdepth = value;
         fdepth =  (float) Pdepth;
-        zcenter = static_cast<int>(fSAMPLE_RATE/floorf(0.5f * (fdepth + fwidth)));
+        setcenter ();
         logmax = logf( (fdepth + fwidth)/fdepth )/LOG_2;
         break;
     case 4:
         Pwidth = value;
         fwidth = (float) Pwidth;
-        zcenter = static_cast<int>(fSAMPLE_RATE/floorf(0.5f * (fdepth + fwidth)));
+        setcenter ();
         logmax = logf( (fdepth + fwidth)/fdepth )/LOG_2;
         break;
     case 5:
@@ -517,6 +536,15 @@ Dflange::getpar (int npar)
 
 void
 Dflange::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Dflange::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 15;
     const int NUM_PRESETS = 9;
@@ -544,11 +572,10 @@ Dflange::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(20,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
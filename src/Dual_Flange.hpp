@@ -42,6 +42,7 @@ public:
     ~Dflange ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -50,6 +51,8 @@ public:
 
 
 private:
+    void setcenter ();
+
     //Parameters
     int Pwetdry;		// 0 //Wet/Dry mix.  Range -64 to 64
     int Ppanning;		// 1 //Panning.  Range -64 to 64
@@ -154,6 +154,15 @@ DynamicFilter::reinitfilter ()
 
 void
 DynamicFilter::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+DynamicFilter::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 10;
     const int NUM_PRESETS = 5;
@@ -174,13 +183,25 @@ DynamicFilter::setpreset (int npreset)
 
         FPreset::ReadPreset(10,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
 
+    changes.add (10, npreset);
+};
+
+
+/*
+ * Filter shape of factory preset npreset, plain filter for the rest. A
+ * parameter of its own (10), so a preset comes down to changepar() calls.
+ */
+void
+DynamicFilter::setfilter (int npreset)
+{
+    Pfilter = npreset;
     filterpars->defaults ();
     switch (npreset) {
     case 0:
@@ -269,8 +290,6 @@ DynamicFilter::setpreset (int npreset)
 //              printf("freq=%d  amp=%d  q=%d\n",filterpars->Pvowels[0].formants[i].freq,filterpars->Pvowels[0].formants[i].amp,filterpars->Pvowels[0].formants[i].q);
 //          };
 
-    Ppreset = npreset;
-
     reinitfilter ();
 };
 
@@ -315,6 +334,9 @@ DynamicFilter::changepar (int npar, int value)
         Pampsmooth = value;
         setampsns (Pampsns);
         break;
+    case 10:
+        setfilter (value);
+        break;
 
 
     };
@@ -354,6 +376,9 @@ DynamicFilter::getpar (int npar)
     case 9:
         return (Pampsmooth);
         break;
+    case 10:
+        return (Pfilter);
+        break;
     default:
         return (0);
     };
@@ -38,6 +38,7 @@ public:
     void out (float * smpsl, float * smpsr);
 
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -56,12 +57,14 @@ private:
     int Pampsns;	//how the filter varies according to the input amplitude
     int Pampsnsinv;	//if the filter freq is lowered if the input amplitude rises
     int Pampsmooth;	//how smooth the input amplitude changes the filter
+    int Pfilter;	//preset the filter shape comes from
 
     //Control Parametrii
     void setvolume (int Pvolume);
     void setpanning (int Ppanning);
     void setdepth (int Pdepth);
     void setampsns (int Pampsns);
+    void setfilter (int npreset);
 
     void reinitfilter ();
 
@@ -71,12 +71,15 @@ void
 EQ::out (float * smpsl, float * smpsr)
 {
     int i;
+    AnalogFilter *l[MAX_EQ_BANDS], *r[MAX_EQ_BANDS];
+    int bands = 0;
     for (i = 0; i < MAX_EQ_BANDS; i++) {
         if (filter[i].Ptype == 0)
             continue;
-        filter[i].l->filterout (smpsl);
-        filter[i].r->filterout (smpsr);
+        l[bands] = filter[i].l.get();
+        r[bands++] = filter[i].r.get();
     };
+    AnalogFilter::filterout_cascade (l, r, bands, smpsl, smpsr);
 
 
     for (i = 0; i < PERIOD; i++) {
@@ -103,6 +106,15 @@ EQ::setvolume (int Pvolume)
 
 void
 EQ::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+EQ::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 1;
     const int NUM_PRESETS = 2;
@@ -114,8 +126,7 @@ EQ::setpreset (int npreset)
     };
 
     for (int n = 0; n < PRESET_SIZE; n++)
-        changepar (n, presets[npreset][n]);
-    Ppreset = npreset;
+        changes.add (n, presets[npreset][n]);
 };
 
 
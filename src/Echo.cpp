@@ -25,11 +25,15 @@
 
 */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
 #include "Echo.hpp"
 
+// Longest run of samples out() reads at once
+static constexpr int kRun = 64;
+
 Echo::Echo ()
 {
     //default values
@@ -47,8 +51,8 @@ Echo::Echo ()
     maxx_delay = SAMPLE_RATE * MAX_DELAY;
     fade = SAMPLE_RATE / 5;    //1/5 SR fade time available
 
-    ldelay = std::make_unique<delayline>(2.0f, 1);
-    rdelay = std::make_unique<delayline>(2.0f, 1);
+    ldelay = std::make_unique<delayline>(2.0f, 2);	//tap 1 is the reverse tap
+    rdelay = std::make_unique<delayline>(2.0f, 2);
 
     setpreset (Ppreset);
     cleanup ();
@@ -96,45 +100,67 @@ Echo::initdelays ()
 void
 Echo::out (float * smpsl, float * smpsr)
 {
-    int i;
+    int i, j, n;
     float l, r, ldl, rdl, ldlout, rdlout, rvl, rvr;
-
-    for (i = 0; i < PERIOD; i++) {
-
-        ldl = ldelay->delay_simple(oldl, ltime, 0, 1, 0);
-        rdl = rdelay->delay_simple(oldr, rtime, 0, 1, 0);
-
-        if(Preverse) {
-            rvl = ldelay->delay_simple(oldl, ltime, 1, 0, 1)*ldelay->envelope();
-            rvr = rdelay->delay_simple(oldr, rtime, 1, 0, 1)*rdelay->envelope();
-            ldl = ireverse*ldl + reverse*rvl;
-            rdl = ireverse*rdl + reverse*rvr;
+    float ltimes[kRun], rtimes[kRun];
+    float ltaps[kRun], rtaps[kRun];
+
+    std::fill_n(ltimes, kRun, ltime);
+    std::fill_n(rtimes, kRun, rtime);
+
+    for (i = 0; i < PERIOD; i += n) {
+        //Read the taps for as many samples as the delay allows, then write
+        //the rest of them as their feedback comes out
+        ldelay->write(oldl);
+        rdelay->write(oldr);
+
+        n = std::min(PERIOD - i, kRun);
+        n = ldelay->span_simple(ltimes, 0, n);
+        n = rdelay->span_simple(rtimes, 0, n);
+        ldelay->read_simple(ltimes, 0, ltaps, n);
+        rdelay->read_simple(rtimes, 0, rtaps, n);
+
+        for (j = 0; j < n; j++) {
+            if (j) {
+                ldelay->write(oldl);
+                rdelay->write(oldr);
+            }
+
+            ldl = ltaps[j];
+            rdl = rtaps[j];
+
+            if(Preverse) {
+                rvl = ldelay->delay_simple(oldl, ltime, 1, 0, 1)*ldelay->envelope();
+                rvr = rdelay->delay_simple(oldr, rtime, 1, 0, 1)*rdelay->envelope();
+                ldl = ireverse*ldl + reverse*rvl;
+                rdl = ireverse*rdl + reverse*rvr;
+            }
+
+            l = ldl * (1.0f - lrcross) + rdl * lrcross;
+            r = rdl * (1.0f - lrcross) + ldl * lrcross;
+            ldl = l;
+            rdl = r;
+
+            ldlout = -ldl*fb;
+            rdlout = -rdl*fb;
+            if (!Pdirect) {
+                l = ldl = smpsl[i + j] * panning + ldlout;
+                r = rdl = smpsr[i + j] * (1.0f - panning) + rdlout;
+            } else {
+                ldl = smpsl[i + j] * panning + ldlout;
+                rdl = smpsr[i + j] * (1.0f - panning) + rdlout;
+            }
+
+            smpsl[i + j]= l;
+            smpsr[i + j]= r;
+
+            //LowPass Filter
+            oldl = ldl * hidamp + oldl * (1.0f - hidamp);
+            oldr = rdl * hidamp + oldr * (1.0f - hidamp);
+            oldl += DENORMAL_GUARD;
+            oldr += DENORMAL_GUARD;
         }
 
-        l = ldl * (1.0f - lrcross) + rdl * lrcross;
-        r = rdl * (1.0f - lrcross) + ldl * lrcross;
-        ldl = l;
-        rdl = r;
-
-        ldlout = -ldl*fb;
-        rdlout = -rdl*fb;
-        if (!Pdirect) {
-            l = ldl = smpsl[i] * panning + ldlout;
-            r = rdl = smpsr[i] * (1.0f - panning) + rdlout;
-        } else {
-            ldl = smpsl[i] * panning + ldlout;
-            rdl = smpsr[i] * (1.0f - panning) + rdlout;
-        }
-
-        smpsl[i]= l;
-        smpsr[i]= r;
-
-        //LowPass Filter
-        oldl = ldl * hidamp + oldl * (1.0f - hidamp);
-        oldr = rdl * hidamp + oldr * (1.0f - hidamp);
-        oldl += DENORMAL_GUARD;
-        oldr += DENORMAL_GUARD;
-
     };
 
 };
@@ -233,6 +259,15 @@ Echo::setdirect (int Pdirect)
 
 void
 Echo::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Echo::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 9;
     const int NUM_PRESETS = 9;
@@ -259,8 +294,7 @@ Echo::setpreset (int npreset)
 
 
     for (int n = 0; n < PRESET_SIZE; n++)
-        changepar (n, presets[npreset][n]);
-    Ppreset = npreset;
+        changes.add (n, presets[npreset][n]);
 };
 
 
@@ -31,7 +31,27 @@
 #include "EmbeddedResource.hpp"
 #include "portable_crt.hpp"
 
-Echotron::Echotron ()
+/*
+ * The taps of a delay file as read, up to the first bad line.
+ */
+struct Echotron::DelayFile : LoadedFile {
+    float fPan[ECHOTRON_F_SIZE]{};
+    float fTime[ECHOTRON_F_SIZE]{};
+    float fLevel[ECHOTRON_F_SIZE]{};
+    float fLP[ECHOTRON_F_SIZE]{};
+    float fBP[ECHOTRON_F_SIZE]{};
+    float fHP[ECHOTRON_F_SIZE]{};
+    float fFreq[ECHOTRON_F_SIZE]{};
+    float fQ[ECHOTRON_F_SIZE]{};
+    int iStages[ECHOTRON_F_SIZE]{};
+    float subdiv_fmod{1.0f}, subdiv_dmod{1.0f};
+    int f_qmode{0};
+    int count{0};
+    int error{0};           ///< error_num for the first bad line, or 0
+    bool keeplength{false}; ///< Pchange was set when it was asked for
+};
+
+Echotron::Echotron (float maxdelay)
 {
     initparams=0;
     //default values
@@ -46,17 +66,19 @@ Echotron::Echotron ()
     fb = 0.0f;
     lfeedback = 0.0f;
     rfeedback = 0.0f;
+    ldmod = rdmod = 0.0f;
+    oldldmod = oldrdmod = 0.0f;
+    interpl = interpr = 0.0f;
     subdiv_dmod = 1.0f;
     subdiv_fmod = 1.0f;
     f_qmode = 0;
+    fadelength = 0;
 
-    maxx_size = (SAMPLE_RATE * 6);   //6 Seconds delay time
+    maxx_size = lrintf(fSAMPLE_RATE * maxdelay);   //maxdelay seconds, 6 by default
 
-    lxn = std::make_unique<delayline>(6.0f, ECHOTRON_F_SIZE);
-    rxn = std::make_unique<delayline>(6.0f, ECHOTRON_F_SIZE);
-
-    lxn->set_mix(0.0f);
-    rxn->set_mix(0.0f);
+    const int dlysize = SAMPLE_RATE * lrintf(ceilf(maxdelay));
+    lxn = std::make_unique<MultiTap>(dlysize, ECHOTRON_F_SIZE, fSAMPLE_RATE * maxdelay);
+    rxn = std::make_unique<MultiTap>(dlysize, ECHOTRON_F_SIZE, fSAMPLE_RATE * maxdelay);
 
     offset = 0;
 
@@ -80,7 +102,10 @@ Echotron::Echotron ()
         filterbank[i].r->setmix (1,filterbank[i].sLP , filterbank[i].sBP,filterbank[i].sHP);
     };
 
+    loader = std::make_unique<FileLoader>([this] (const FileRequest &req) { return loadfile (req); }, !offline);
+
     setpreset (Ppreset);
+    waitfile ();
     cleanup ();
 };
 
@@ -110,10 +135,18 @@ void
 Echotron::out (float * smpsl, float * smpsr)
 {
 
-    int i, j, k;
+    int i, j, k, n;
+    float lyn, ryn;
+
+    takefile();
     int length = Plength;
-    float l,r,lyn, ryn;
-    float rxindex,lxindex;
+    const float *lgain = ldata;
+    const float *rgain = rdata;
+    if (fadelength) {
+        length = fadelength;
+        lgain = fadel;
+        rgain = fader;
+    }
 
 
     if((Pmoddly)||(Pmodfilts)) modulate_delay();
@@ -122,54 +155,71 @@ Echotron::out (float * smpsl, float * smpsr)
     float tmpmodl = oldldmod;
     float tmpmodr = oldrdmod;
 
-    for (i = 0; i < PERIOD; i++) {
-        tmpmodl+=interpl;
-        tmpmodr+=interpr;
+    for (i = 0; i < PERIOD; i += n) {
+        //Read every tap for as many samples as the shortest delay allows,
+        //then write the rest of them as their feedback comes out
+        lxn->write(lpfl->filterout_s(smpsl[i] + lfeedback));  //High Freq damping
+        rxn->write(lpfr->filterout_s(smpsr[i] + rfeedback));
+
+        n = std::min(lxn->span(ltime, length, tmpmodl, interpl, PERIOD - i),
+                     rxn->span(rtime, length, tmpmodr, interpr, PERIOD - i));
+        lxn->read(ltime, length, tmpmodl, interpl, n);
+        rxn->read(rtime, length, tmpmodr, interpr, n);
+
+        for (int s = 0; s < n; s++) {
+            if (s) {
+                lxn->write(lpfl->filterout_s(smpsl[i + s] + lfeedback));
+                rxn->write(lpfr->filterout_s(smpsr[i + s] + rfeedback));
+            }
 
-        l = lxn->delay( (lpfl->filterout_s(smpsl[i] + lfeedback) ), 0.0f, 0, 1, 0);  //High Freq damping
-        r = rxn->delay( (lpfr->filterout_s(smpsr[i] + rfeedback) ), 0.0f, 0, 1, 0);
+            if (fadelength) {
+                const float g = (float) (i + s + 1) / fPERIOD;
+                for (k=0; k<length; k++) {
+                    fadel[k] = oldldata[k] + (ldata[k] - oldldata[k]) * g;
+                    fader[k] = oldrdata[k] + (rdata[k] - oldrdata[k]) * g;
+                }
+            }
 
-        //Convolve
-        lyn = 0.0f;
-        ryn = 0.0f;
+            const float *ltap = lxn->tap(s);
+            const float *rtap = rxn->tap(s);
 
-        if(Pfilters) {
+            //Convolve
+            lyn = 0.0f;
+            ryn = 0.0f;
 
-            j=0;
-            for (k=0; k<length; k++) {
-                lxindex = ltime[k] + tmpmodl;
-                rxindex = rtime[k] + tmpmodr;
+            if(Pfilters) {
 
-                if((iStages[k]>=0)&&(j<ECHOTRON_MAXFILTERS)) {
-                    lyn += filterbank[j].l->filterout_s(lxn->delay(l, lxindex, k, 0, 0)) * ldata[k];		//filter each tap specified
-                    ryn += filterbank[j].r->filterout_s(rxn->delay(r, lxindex, k, 0, 0)) * rdata[k];
-                    j++;
-                } else {
-                    lyn += lxn->delay(l, lxindex, k, 0, 0) * ldata[k];
-                    ryn += rxn->delay(r, rxindex, k, 0, 0) * rdata[k];
-                }
+                j=0;
+                for (k=0; k<length; k++) {
+                    if((iStages[k]>=0)&&(j<ECHOTRON_MAXFILTERS)) {
+                        lyn += filterbank[j].l->filterout_s(ltap[k]) * lgain[k];		//filter each tap specified
+                        ryn += filterbank[j].r->filterout_s(rtap[k]) * rgain[k];
+                        j++;
+                    } else {
+                        lyn += ltap[k] * lgain[k];
+                        ryn += rtap[k] * rgain[k];
+                    }
 
-            }
+                }
 
-        } else {
-            for (k=0; k<length; k++) {
-                lxindex = ltime[k] + tmpmodl;
-                rxindex = rtime[k] + tmpmodr;
+            } else {
+                for (k=0; k<length; k++) {
+                    lyn += ltap[k] * lgain[k];
+                    ryn += rtap[k] * rgain[k];
+                }
 
-                lyn += lxn->delay(l, lxindex, k, 0, 0) * ldata[k];
-                ryn += rxn->delay(r, rxindex, k, 0, 0) * rdata[k];
             }
 
+            lfeedback =  (lrcross*ryn + ilrcross*lyn) * lpanning;
+            rfeedback = (lrcross*lyn + ilrcross*ryn) * rpanning;
+            smpsl[i + s] = lfeedback;
+            smpsr[i + s] = rfeedback;
+            lfeedback *= fb;
+            rfeedback *= fb;
         }
 
-        lfeedback =  (lrcross*ryn + ilrcross*lyn) * lpanning;
-        rfeedback = (lrcross*lyn + ilrcross*ryn) * rpanning;
-        smpsl[i] = lfeedback;
-        smpsr[i] = rfeedback;
-        lfeedback *= fb;
-        rfeedback *= fb;
-
     };
+    fadelength = 0;
 
     if(initparams) init_params();
 
@@ -205,8 +255,79 @@ Echotron::setpanning (int value)
     if(rpanning>1.0f) rpanning = 1.0f;
 };
 
-int
-Echotron::setfile(int value)
+/*
+ * Ask the loader for the delay file Filenum, or Filename when Puser is set.
+ */
+void
+Echotron::requestfile()
+{
+    FileRequest req;
+    req.num = Filenum;
+    req.user = Puser;
+    req.name = Filename;
+    req.args = {Pchange, 0};
+    loader->request(req);
+}
+
+/*
+ * RT thread. Put a newly read file in place. The delay lines keep their
+ * history: tap times glide there, and out() ramps the tap levels from the
+ * old file to the new one.
+ */
+void
+Echotron::takefile()
+{
+    DelayFile *file = static_cast<DelayFile *>(loader->take());
+    if (!file)
+        return;
+
+    const int oldlength = Plength;
+    memcpy(oldldata, ldata, sizeof(ldata));
+    memcpy(oldrdata, rdata, sizeof(rdata));
+
+    memcpy(fPan, file->fPan, sizeof(fPan));
+    memcpy(fTime, file->fTime, sizeof(fTime));
+    memcpy(fLevel, file->fLevel, sizeof(fLevel));
+    memcpy(fLP, file->fLP, sizeof(fLP));
+    memcpy(fBP, file->fBP, sizeof(fBP));
+    memcpy(fHP, file->fHP, sizeof(fHP));
+    memcpy(fFreq, file->fFreq, sizeof(fFreq));
+    memcpy(fQ, file->fQ, sizeof(fQ));
+    memcpy(iStages, file->iStages, sizeof(iStages));
+    subdiv_fmod = file->subdiv_fmod;
+    subdiv_dmod = file->subdiv_dmod;
+    f_qmode = file->f_qmode;
+
+    if (!file->found) {
+        Plength = file->count;
+        error_num = 4;
+    } else if (!file->keeplength) {
+        Plength = file->count;
+    }
+    if (file->error)
+        error_num = file->error;
+    loader->retire(file);
+
+    init_params();
+
+    //taps the new file does not have fade out, new ones fade in
+    fadelength = std::max(oldlength, Plength);
+    for (int k = Plength; k < fadelength; k++)
+        ldata[k] = rdata[k] = 0.0f;
+    for (int k = oldlength; k < fadelength; k++)
+        oldldata[k] = oldrdata[k] = 0.0f;
+}
+
+void
+Echotron::waitfile()
+{
+    loader->wait();
+    takefile();
+    fadelength = 0;
+}
+
+std::unique_ptr<LoadedFile>
+Echotron::loadfile(const FileRequest &req) const
 {
     float tPan=0.0f;
     float tTime=0.0f;
@@ -218,25 +339,37 @@ Echotron::setfile(int value)
     float tQ=1.0f;
     int tiStages = 0;
 
+    auto file = std::make_unique<DelayFile>();
+    DelayFile &f = *file;
+    file->keeplength = req.args[0] != 0;
+
     FILE *fs = nullptr;
     std::unique_ptr<MemStream> ms;
 
     char wbuf[128];
 
-    if(!Puser) {
-        Filenum = value;
-        if(Filenum >= 0 && Filenum < NUM_DLY_RESOURCES) {
-            ms = std::make_unique<MemStream>(dly_resources[Filenum].data,
-                                             *dly_resources[Filenum].len);
-        } else {
-            loaddefault();
-            return(0);
-        }
+    if(!req.user) {
+        if(req.num >= 0 && req.num < NUM_DLY_RESOURCES)
+            ms = std::make_unique<MemStream>(dly_resources[req.num].data,
+                                             *dly_resources[req.num].len);
     } else {
-        if ((fs = rkr::portable_fopen (Filename.data(), "r")) == nullptr) {
-            loaddefault();
-            return(0);
-        }
+        fs = rkr::portable_fopen (req.name.data(), "r");
+    }
+
+    if (!ms && !fs) {
+        //one tap a measure late stands in for a missing file
+        f.found = false;
+        f.count = 1;
+        f.fPan[0] = 0.0f;
+        f.fTime[0] = 1.0f;
+        f.fLevel[0] = 0.7f;
+        f.fLP[0] = 1.0f;
+        f.fBP[0] = -1.0f;
+        f.fHP[0] = 1.0f;
+        f.fFreq[0] = 800.0f;
+        f.fQ[0] = 2.0f;
+        f.iStages[0] = 1;
+        return file;
     }
 
     auto readline = [&](char* buf, int bufsize) -> char* {
@@ -249,12 +382,9 @@ Echotron::setfile(int value)
         memset(wbuf,0,sizeof(wbuf));
     }
 
-    RKR_SSCANF(wbuf,"%f\t%f\t%d",&subdiv_fmod,&subdiv_dmod,&f_qmode); //Second line has tempo subdivision
+    RKR_SSCANF(wbuf,"%f\t%f\t%d",&f.subdiv_fmod,&f.subdiv_dmod,&f.f_qmode); //Second line has tempo subdivision
 
     int count = 0;
-    memset(iStages,0,sizeof(iStages));
-
-
 
     while ((readline(wbuf,sizeof wbuf) != nullptr) && (count<ECHOTRON_F_SIZE)) {
         if(wbuf[0]==10) break;  // Check Carriage Return
@@ -262,49 +392,49 @@ Echotron::setfile(int value)
         RKR_SSCANF(wbuf,"%f\t%f\t%f\t%f\t%f\t%f\t%f\t%f\t%d",&tPan, &tTime, &tLevel,
                &tLP,  &tBP,  &tHP,  &tFreq,  &tQ,  &tiStages);
         if((tPan<-1.0f) || (tPan>1.0f)) {
-            error_num=5;
+            f.error=5;
             break;
-        } else fPan[count]=tPan;
+        } else f.fPan[count]=tPan;
 
         if((tTime <-6.0) || (tTime>6.0f)) {
-            error_num=6;
+            f.error=6;
             break;
-        } else fTime[count]=fabs(tTime);
+        } else f.fTime[count]=fabs(tTime);
 
         if((tLevel <-10.0f) || (tLevel>10.0f)) {
-            error_num=7;
+            f.error=7;
             break;
-        } else fLevel[count]=tLevel;
+        } else f.fLevel[count]=tLevel;
 
         if((tLP <-2.0f) || (tLP>2.0f)) {
-            error_num=8;
+            f.error=8;
             break;
-        } else fLP[count]=tLP;
+        } else f.fLP[count]=tLP;
 
         if((tBP<-2.0f) || (tBP>2.0f)) {
-            error_num=9;
+            f.error=9;
             break;
-        } else fBP[count]=tBP;
+        } else f.fBP[count]=tBP;
 
         if((tHP<-2.0f) || (tHP>2.0f)) {
-            error_num=10;
+            f.error=10;
             break;
-        } else fHP[count]=tHP;
+        } else f.fHP[count]=tHP;
 
         if((tFreq <20.0f) || (tFreq>26000.0f)) {
-            error_num=11;
+            f.error=11;
             break;
-        } else fFreq[count]=tFreq;
+        } else f.fFreq[count]=tFreq;
 
         if((tQ <0.0) || (tQ>300.0f)) {
-            error_num=12;
+            f.error=12;
             break;
-        } else fQ[count]=tQ;
+        } else f.fQ[count]=tQ;
 
         if((tiStages<0) || (tiStages>MAX_FILTER_STAGES)) {
-            error_num=13;
+            f.error=13;
             break;
-        } else iStages[count]=tiStages-1;   //check in main loop if <0, then skip filter
+        } else f.iStages[count]=tiStages-1;   //check in main loop if <0, then skip filter
 
 
         memset(wbuf,0,sizeof(wbuf));
@@ -312,30 +442,10 @@ Echotron::setfile(int value)
     }
     if(fs) fclose(fs);
 
-    if(!Pchange) Plength=count;
-    cleanup();
-    init_params();
-    return(1);
+    f.count = count;
+    return file;
 };
 
-void
-Echotron::loaddefault()
-{
-    Plength = 1;
-    fPan[0] = 0.0f;  //
-    fTime[0] = 1.0f;  //default 1 measure delay
-    fLevel[0] = 0.7f;
-    fLP[0] = 1.0f;
-    fBP[0] = -1.0f;
-    fHP[0] = 1.0f;
-    fFreq[0]=800.0f;;
-    fQ[0]=2.0f;
-    iStages[0]=1;
-    subdiv_dmod = 1.0f;
-    subdiv_fmod = 1.0f;
-    init_params();
-}
-
 void Echotron::init_params()
 {
 
@@ -453,6 +563,15 @@ Echotron::setfb(int value)
 
 void
 Echotron::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Echotron::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 16;
     const int NUM_PRESETS = 5;
@@ -473,12 +592,11 @@ Echotron::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(41,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
@@ -525,7 +643,8 @@ Echotron::changepar (int npar, int value)
         ilrcross = 1.0f - abs(lrcross);
         break;
     case 8:
-        if(!setfile(value)) error_num=4;
+        if(!Puser) Filenum = value;
+        requestfile();
         break;
     case 9:
         lfo.Pstereo = value;
@@ -24,30 +24,37 @@
 #ifndef ECHOTRON_H
 #define ECHOTRON_H
 
+#include <memory>
 #include "dsp_constants.hpp"
 #include "RBFilter.hpp"
 #include "AnalogFilter.hpp"
 #include "EffectLFO.hpp"
-#include "delayline.hpp"
+#include "MultiTap.hpp"
+#include "FileLoader.hpp"
 #include "Effect.hpp"
 
 #define  ECHOTRON_F_SIZE   128       //Allow up to 150 points in the file
 #define  ECHOTRON_MAXFILTERS  32      //filters available
 
+static_assert(ECHOTRON_F_SIZE <= MultiTap::kLanes, "Echotron taps must fit MultiTap lanes");
+
 
 class Echotron : public Effect
 {
 public:
-    Echotron ();
+    Echotron (float maxdelay = 6.0f);
     ~Echotron ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
-    int setfile (int value);
+    /// Not on the RT thread: wait for the delay file asked for last and put
+    /// it in place, for an instance that is not playing yet.
+    void waitfile();
 
-    int Pchange;
+    int Pchange{};
 
 
     std::array<char, 128> Filename{};
@@ -63,7 +70,11 @@ private:
     void init_params();
     void modulate_delay();
     void modulate_filters();
-    void loaddefault();
+    void requestfile();
+    void takefile();
+
+    /// Worker thread: reads and checks the delay file.
+    std::unique_ptr<LoadedFile> loadfile(const FileRequest &req) const;
 
 
     //User input parameters
@@ -91,23 +102,31 @@ private:
 
 
     //arrays of parameters from text file:
-    float fPan[ECHOTRON_F_SIZE];  //1+Pan from text file
-    float fTime[ECHOTRON_F_SIZE];
-    float fLevel[ECHOTRON_F_SIZE];
-    float fLP[ECHOTRON_F_SIZE];
-    float fBP[ECHOTRON_F_SIZE];
-    float fHP[ECHOTRON_F_SIZE];
-    float fFreq[ECHOTRON_F_SIZE];
-    float fQ[ECHOTRON_F_SIZE];
-    int iStages[ECHOTRON_F_SIZE];
+    float fPan[ECHOTRON_F_SIZE]{};  //1+Pan from text file
+    float fTime[ECHOTRON_F_SIZE]{};
+    float fLevel[ECHOTRON_F_SIZE]{};
+    float fLP[ECHOTRON_F_SIZE]{};
+    float fBP[ECHOTRON_F_SIZE]{};
+    float fHP[ECHOTRON_F_SIZE]{};
+    float fFreq[ECHOTRON_F_SIZE]{};
+    float fQ[ECHOTRON_F_SIZE]{};
+    int iStages[ECHOTRON_F_SIZE]{};
     float subdiv_dmod;
     float subdiv_fmod;
     int f_qmode;
 
-    float rtime[ECHOTRON_F_SIZE];
-    float ltime[ECHOTRON_F_SIZE];
-    float ldata[ECHOTRON_F_SIZE];
-    float rdata[ECHOTRON_F_SIZE];
+    float rtime[ECHOTRON_F_SIZE]{};
+    float ltime[ECHOTRON_F_SIZE]{};
+    float ldata[ECHOTRON_F_SIZE]{};
+    float rdata[ECHOTRON_F_SIZE]{};
+
+    // Tap levels of the file before the last one, and the levels ramping
+    // from them to the new ones over one period
+    float oldldata[ECHOTRON_F_SIZE]{};
+    float oldrdata[ECHOTRON_F_SIZE]{};
+    float fadel[ECHOTRON_F_SIZE]{};
+    float fader[ECHOTRON_F_SIZE]{};
+    int fadelength;
 
 //end text configurable parameters
 
@@ -119,7 +138,7 @@ private:
     float width, depth;
     float lpanning, rpanning, hidamp, alpha_hidamp, convlength;
 
-    std::unique_ptr<delayline> lxn, rxn;
+    std::unique_ptr<MultiTap> lxn, rxn;
 
     float level,fb, rfeedback, lfeedback,levpanl,levpanr, lrcross, ilrcross;
     float tempo_coeff;
@@ -131,6 +150,9 @@ private:
         std::unique_ptr<RBFilter> l, r;
 
     } filterbank[ECHOTRON_MAXFILTERS];
+
+    struct DelayFile;
+    std::unique_ptr<FileLoader> loader;
 };
 
 
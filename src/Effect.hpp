@@ -23,10 +23,52 @@
 #ifndef EFFECT_H
 #define EFFECT_H
 
+#include <array>
+#include <utility>
 #include "dsp_constants.hpp"
 #include "FilterParams.hpp"
 
 
+/*
+ * The changepar() calls, in order, that loading one preset makes. Parameter
+ * -1 stands for a cleanup() call. Effects with presets fill one from their
+ * preset table in a static preset_changes(), which needs no instance, and
+ * setpreset() applies it. Fixed size, so it costs no allocation on the
+ * audio thread.
+ */
+struct PresetChanges
+{
+    static constexpr int kMax = 128;
+
+    void add (int npar, int value)
+    {
+        if (count < kMax)
+            items[count++] = {npar, value};
+    }
+    void cleanup ()
+    {
+        add (-1, 0);
+    }
+
+    const std::pair<int, int> *begin () const
+    {
+        return items.data ();
+    }
+    const std::pair<int, int> *end () const
+    {
+        return items.data () + count;
+    }
+    [[nodiscard]] int size () const
+    {
+        return count;
+    }
+
+private:
+    std::array<std::pair<int, int>, kMax> items{};
+    int count{0};
+};
+
+
 class Effect
 {
 public:
@@ -54,6 +96,16 @@ public:
         return (0);
     }				//this is only used for EQ (for user interface)
 
+    void apply (const PresetChanges &changes)
+    {
+        for (const auto &[npar, value] : changes) {
+            if (npar < 0)
+                cleanup ();
+            else
+                changepar (npar, value);
+        }
+    }
+
     int Ppreset{};
 
     float outvolume{};
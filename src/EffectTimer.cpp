@@ -0,0 +1,93 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  EffectTimer.cpp - Per-slot timing of the effect chain.
+*/
+
+#include "EffectTimer.hpp"
+
+namespace
+{
+// Windows closed per second of audio.
+constexpr unsigned int kWindowsPerSecond = 4;
+}
+
+EffectTimer::EffectTimer()
+{
+    reset();
+}
+
+std::uint64_t
+EffectTimer::bucket_top(int index) noexcept
+{
+    if (index < 8)
+        return (std::uint64_t) index + 1;
+    const int width = index / 4 + 2;
+    return (std::uint64_t) (5 + index % 4) << (width - 3);
+}
+
+bool
+EffectTimer::end_period(int period, unsigned int sample_rate) noexcept
+{
+    if (!enabled()) {
+        if (frames)
+            reset();
+        return false;
+    }
+
+    frames += (std::uint64_t) period;
+    periods++;
+    if (frames * kWindowsPerSecond < sample_rate)
+        return false;
+
+    publish(period, sample_rate);
+    reset();
+    return true;
+}
+
+void
+EffectTimer::publish(int period, unsigned int sample_rate) noexcept
+{
+    snapshot.budget_us = sample_rate ? 1.0e6f * (float) period / (float) sample_rate : 0.0f;
+    snapshot.periods = periods;
+    snapshot.chain_avg_us = 0.0f;
+
+    for (int i = 0; i < MAX_EFFECT_SLOTS; i++) {
+        const Slot &s = slots[i];
+        SlotTiming &out = snapshot.slots[i];
+
+        out = SlotTiming{};
+        if (!s.calls)
+            continue;
+
+        out.effect_type = s.type;
+        out.calls = s.calls;
+        out.min_us = (float) s.min_ns * 1.0e-3f;
+        out.max_us = (float) s.max_ns * 1.0e-3f;
+        out.avg_us = (float) ((double) s.sum_ns / (double) s.calls) * 1.0e-3f;
+
+        // Smallest bucket with 99% of the calls at or below it.
+        const std::uint64_t target = ((std::uint64_t) s.calls * 99 + 99) / 100;
+        std::uint64_t seen = 0;
+        for (int b = 0; b < kBuckets; b++) {
+            seen += s.hist[b];
+            if (seen >= target) {
+                const std::uint64_t top = bucket_top(b);
+                out.p99_us = (float) (top < s.max_ns ? top : s.max_ns) * 1.0e-3f;
+                break;
+            }
+        }
+
+        snapshot.chain_avg_us += out.avg_us;
+    }
+}
+
+void
+EffectTimer::reset() noexcept
+{
+    for (Slot &s : slots)
+        s = Slot{};
+    frames = 0;
+    periods = 0;
+}
@@ -0,0 +1,122 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  EffectTimer.hpp - Per-slot timing of the effect chain.
+
+  RKR::Effect_Chain() times every effect's out() call and hands the
+  duration to record(). The RT thread keeps, per slot, the call count, sum,
+  min, max and a quarter-octave histogram of the durations, so recording is
+  a handful of integer operations. Every quarter second of audio
+  end_period() turns them into an EffectTiming snapshot (min/avg/max/p99 in
+  microseconds) and starts a new window; the JACK callback pushes the
+  snapshot to the GUI through EngineController.
+
+  Two ways to switch it off:
+    - configure with -DENABLE_EFFECT_TIMING=OFF, which compiles the clock
+      reads out of the chain loop entirely;
+    - set_enabled(false) at run time, which leaves one relaxed load per
+      period.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include "dsp_constants.hpp"
+
+/// Timing of one chain slot over the last window.
+struct SlotTiming
+{
+    int   effect_type{EMPTY_SLOT};  ///< efx_order[] entry timed, EMPTY_SLOT if it did not run
+    std::uint32_t calls{0};
+    float min_us{0.0f};
+    float avg_us{0.0f};
+    float max_us{0.0f};
+    float p99_us{0.0f};             ///< Upper edge of the quarter-octave bucket
+};
+
+/// Snapshot pushed from the RT thread once per window.
+struct EffectTiming
+{
+    std::array<SlotTiming, MAX_EFFECT_SLOTS> slots{};
+    float budget_us{0.0f};          ///< Length of one period in real time
+    float chain_avg_us{0.0f};       ///< Sum of the slot averages
+    std::uint32_t periods{0};       ///< Periods in the window
+};
+
+class EffectTimer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    EffectTimer();
+
+    [[nodiscard]] bool enabled() const noexcept
+    {
+        return on.load(std::memory_order_relaxed);
+    }
+
+    /// Any thread. Takes effect from the next period.
+    void set_enabled(bool enable) noexcept
+    {
+        on.store(enable, std::memory_order_relaxed);
+    }
+
+    /// RT thread. One out() call of the effect in chain slot `slot`.
+    void record(int slot, int type, Clock::duration elapsed) noexcept
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        const std::uint32_t t = ns < 0 ? 0 : ns > UINT32_MAX ? UINT32_MAX : (std::uint32_t) ns;
+        Slot &s = slots[slot];
+        s.type = type;
+        s.calls++;
+        s.sum_ns += t;
+        if (t < s.min_ns) s.min_ns = t;
+        if (t > s.max_ns) s.max_ns = t;
+        s.hist[bucket(t)]++;
+    }
+
+    /// RT thread, once per period after Alg(). Returns true when a window
+    /// was closed; the snapshot is then available from last().
+    bool end_period(int period, unsigned int sample_rate) noexcept;
+
+    [[nodiscard]] const EffectTiming &last() const noexcept { return snapshot; }
+
+private:
+    static constexpr int kBuckets = 128;
+
+    struct Slot
+    {
+        int type{EMPTY_SLOT};
+        std::uint32_t calls{0};
+        std::uint64_t sum_ns{0};
+        std::uint32_t min_ns{UINT32_MAX};
+        std::uint32_t max_ns{0};
+        std::array<std::uint32_t, kBuckets> hist{};
+    };
+
+    // Durations below 8 ns get a bucket each, above that four per octave:
+    // the octave from the bit width, the quarter from the next two bits.
+    static int bucket(std::uint32_t ns) noexcept
+    {
+        if (ns < 8)
+            return (int) ns;
+        const int width = std::bit_width(ns);
+        return (width - 2) * 4 + (int) ((ns >> (width - 3)) & 3);
+    }
+    static std::uint64_t bucket_top(int index) noexcept;
+
+    void publish(int period, unsigned int sample_rate) noexcept;
+    void reset() noexcept;
+
+    std::array<Slot, MAX_EFFECT_SLOTS> slots{};
+    std::uint64_t frames{0};
+    std::uint32_t periods{0};
+    EffectTiming snapshot{};
+
+    std::atomic<bool> on{true};
+};
@@ -5,123 +5,12 @@
   EngineController.cpp - Thread-safe bridge between GUI and audio engine.
 */
 
+#include <algorithm>
+#include <thread>
 #include "EngineController.hpp"
 #include "global.hpp"
 #include "AllEffects.hpp"
 
-// ─── Helper: index → Effect pointer ────────────────────────────────
-// Maps an effect index (0–46) to its Effect* in the RKR engine.
-static Effect* effectByIndex(RKR& rkr, int index)
-{
-    switch (index)
-    {
-    case  0: return rkr.efx_EQ1.get();
-    case  1: return rkr.efx_Compressor.get();
-    case  2: return rkr.efx_Distorsion.get();
-    case  3: return rkr.efx_Overdrive.get();
-    case  4: return rkr.efx_Echo.get();
-    case  5: return rkr.efx_Chorus.get();
-    case  6: return rkr.efx_Phaser.get();
-    case  7: return rkr.efx_Flanger.get();
-    case  8: return rkr.efx_Rev.get();
-    case  9: return rkr.efx_EQ2.get();
-    case 10: return rkr.efx_WhaWha.get();
-    case 11: return rkr.efx_Alienwah.get();
-    case 12: return rkr.efx_Cabinet.get();
-    case 13: return rkr.efx_Pan.get();
-    case 14: return rkr.efx_Har.get();
-    case 15: return rkr.efx_MusDelay.get();
-    case 16: return rkr.efx_Gate.get();
-    case 17: return rkr.efx_NewDist.get();
-    case 18: return rkr.efx_APhaser.get();
-    case 19: return rkr.efx_Valve.get();
-    case 20: return rkr.efx_DFlange.get();
-    case 21: return rkr.efx_Ring.get();
-    case 22: return rkr.efx_Exciter.get();
-    case 23: return rkr.efx_MBDist.get();
-    case 24: return rkr.efx_Arpie.get();
-    case 25: return rkr.efx_Expander.get();
-    case 26: return rkr.efx_Shuffle.get();
-    case 27: return rkr.efx_Synthfilter.get();
-    case 28: return rkr.efx_MBVvol.get();
-    case 29: return rkr.efx_Convol.get();
-    case 30: return rkr.efx_Looper.get();
-    case 31: return rkr.efx_RyanWah.get();
-    case 32: return rkr.efx_RBEcho.get();
-    case 33: return rkr.efx_CoilCrafter.get();
-    case 34: return rkr.efx_ShelfBoost.get();
-    case 35: return rkr.efx_Vocoder.get();
-    case 36: return rkr.efx_Sustainer.get();
-    case 37: return rkr.efx_Sequence.get();
-    case 38: return rkr.efx_Shifter.get();
-    case 39: return rkr.efx_StompBox.get();
-    case 40: return rkr.efx_Reverbtron.get();
-    case 41: return rkr.efx_Echotron.get();
-    case 42: return rkr.efx_StereoHarm.get();
-    case 43: return rkr.efx_CompBand.get();
-    case 44: return rkr.efx_Opticaltrem.get();
-    case 45: return rkr.efx_Vibe.get();
-    case 46: return rkr.efx_Infinity.get();
-    default: return nullptr;
-    }
-}
-
-// ─── Helper: index → Bypass flag pointer ───────────────────────────
-static int* bypassByIndex(RKR& rkr, int index)
-{
-    switch (index)
-    {
-    case  0: return &rkr.EQ1_Bypass;
-    case  1: return &rkr.Compressor_Bypass;
-    case  2: return &rkr.Distorsion_Bypass;
-    case  3: return &rkr.Overdrive_Bypass;
-    case  4: return &rkr.Echo_Bypass;
-    case  5: return &rkr.Chorus_Bypass;
-    case  6: return &rkr.Phaser_Bypass;
-    case  7: return &rkr.Flanger_Bypass;
-    case  8: return &rkr.Reverb_Bypass;
-    case  9: return &rkr.EQ2_Bypass;
-    case 10: return &rkr.WhaWha_Bypass;
-    case 11: return &rkr.Alienwah_Bypass;
-    case 12: return &rkr.Cabinet_Bypass;
-    case 13: return &rkr.Pan_Bypass;
-    case 14: return &rkr.Harmonizer_Bypass;
-    case 15: return &rkr.MusDelay_Bypass;
-    case 16: return &rkr.Gate_Bypass;
-    case 17: return &rkr.NewDist_Bypass;
-    case 18: return &rkr.APhaser_Bypass;
-    case 19: return &rkr.Valve_Bypass;
-    case 20: return &rkr.DFlange_Bypass;
-    case 21: return &rkr.Ring_Bypass;
-    case 22: return &rkr.Exciter_Bypass;
-    case 23: return &rkr.MBDist_Bypass;
-    case 24: return &rkr.Arpie_Bypass;
-    case 25: return &rkr.Expander_Bypass;
-    case 26: return &rkr.Shuffle_Bypass;
-    case 27: return &rkr.Synthfilter_Bypass;
-    case 28: return &rkr.MBVvol_Bypass;
-    case 29: return &rkr.Convol_Bypass;
-    case 30: return &rkr.Looper_Bypass;
-    case 31: return &rkr.RyanWah_Bypass;
-    case 32: return &rkr.RBEcho_Bypass;
-    case 33: return &rkr.CoilCrafter_Bypass;
-    case 34: return &rkr.ShelfBoost_Bypass;
-    case 35: return &rkr.Vocoder_Bypass;
-    case 36: return &rkr.Sustainer_Bypass;
-    case 37: return &rkr.Sequence_Bypass;
-    case 38: return &rkr.Shifter_Bypass;
-    case 39: return &rkr.StompBox_Bypass;
-    case 40: return &rkr.Reverbtron_Bypass;
-    case 41: return &rkr.Echotron_Bypass;
-    case 42: return &rkr.StereoHarm_Bypass;
-    case 43: return &rkr.CompBand_Bypass;
-    case 44: return &rkr.Opticaltrem_Bypass;
-    case 45: return &rkr.Vibe_Bypass;
-    case 46: return &rkr.Infinity_Bypass;
-    default: return nullptr;
-    }
-}
-
 // ─── Construction ──────────────────────────────────────────────────
 
 EngineController::EngineController(RKR& engine)
@@ -133,26 +22,41 @@ EngineController::EngineController(RKR& engine)
 
 void EngineController::setEffectParameter(int effectIndex, int paramId, int value)
 {
-    if (auto* efx = effectByIndex(m_engine, effectIndex))
-        efx->changepar(paramId, value);
+    postCommand({CommandType::Parameter, effectIndex, paramId, value});
 }
 
 int EngineController::getEffectParameter(int effectIndex, int paramId) const
 {
-    if (auto* efx = effectByIndex(const_cast<RKR&>(m_engine), effectIndex))
+    const auto hold = m_engine.lazy_efx.hold();
+    if (auto* efx = const_cast<RKR&>(m_engine).Effect_By_Type(effectIndex))
         return efx->getpar(paramId);
     return 0;
 }
 
-void EngineController::setEffectPreset(int effectIndex, int preset)
+// Every change of a preset must fit the RT thread's staging buffer
+static_assert(PresetChanges::kMax <= kMaxPresetChanges);
+
+bool EngineController::setEffectPreset(int effectIndex, int preset)
 {
-    if (auto* efx = effectByIndex(m_engine, effectIndex))
-        efx->setpreset(preset);
+    // Here rather than on the RT thread: user presets are read from disk
+    PresetChanges changes;
+    RKR::Preset_Changes(effectIndex, preset, changes);
+    // All or nothing, a part of a preset must not be applied
+    if (m_cmd_rb.space() < static_cast<std::size_t>(changes.size()) + 1)
+    {
+        m_cmd_overflows.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    for (const auto& [npar, value] : changes)
+        postCommand({CommandType::PresetParam, effectIndex, npar, value});
+    postCommand({CommandType::Preset, effectIndex, 0, preset});
+    return true;
 }
 
 int EngineController::getEffectPreset(int effectIndex) const
 {
-    if (auto* efx = effectByIndex(const_cast<RKR&>(m_engine), effectIndex))
+    const auto hold = m_engine.lazy_efx.hold();
+    if (auto* efx = const_cast<RKR&>(m_engine).Effect_By_Type(effectIndex))
         return efx->Ppreset;
     return 0;
 }
@@ -161,8 +65,26 @@ int EngineController::getEffectPreset(int effectIndex) const
 
 void EngineController::setEffectOrder(std::span<const int> order)
 {
-    for (std::size_t i = 0; i < order.size() && i < m_engine.efx_order.size(); ++i)
-        m_engine.efx_order[i] = order[i];
+    m_order_count = static_cast<int>(std::min(order.size(), m_order.size()));
+    std::copy_n(order.begin(), m_order_count, m_order.begin());
+    // Full size instances of parked effects are built on a worker and
+    // swapped in with the commit, which waits for them
+    m_order_ticket = m_engine.lazy_efx.request(m_order.data(), m_order_count);
+    m_order_waiting = true;
+    postPendingOrder();
+}
+
+void EngineController::postPendingOrder()
+{
+    if (!m_order_waiting || !m_engine.lazy_efx.unparked(m_order_ticket))
+        return;
+    // All slots and the commit, or try again later
+    if (m_cmd_rb.space() < static_cast<std::size_t>(m_order_count) + 1)
+        return;
+    m_order_waiting = false;
+    for (int i = 0; i < m_order_count; ++i)
+        postCommand({CommandType::OrderSlot, 0, i, m_order[i]});
+    postCommand({CommandType::OrderCommit, 0, 0, m_order_count});
 }
 
 std::array<int, kMaxEffectSlots> EngineController::getEffectOrder() const
@@ -175,13 +97,12 @@ std::array<int, kMaxEffectSlots> EngineController::getEffectOrder() const
 
 void EngineController::setEffectEnabled(int effectIndex, bool enabled)
 {
-    if (auto* bp = bypassByIndex(m_engine, effectIndex))
-        *bp = enabled ? 1 : 0;
+    postCommand({CommandType::EffectEnabled, effectIndex, 0, enabled ? 1 : 0});
 }
 
 bool EngineController::isEffectEnabled(int effectIndex) const
 {
-    if (auto* bp = bypassByIndex(const_cast<RKR&>(m_engine), effectIndex))
+    if (auto* bp = const_cast<RKR&>(m_engine).Bypass_By_Type(effectIndex))
         return *bp != 0;
     return false;
 }
@@ -190,7 +111,17 @@ bool EngineController::isEffectEnabled(int effectIndex) const
 
 void EngineController::loadPreset(int bankSlot)
 {
-    m_engine.Bank_to_Preset(bankSlot);
+    m_engine.switcher->request(bankSlot);
+}
+
+bool EngineController::isPresetPending() const
+{
+    return !m_engine.switcher->done();
+}
+
+PresetSwitchStats EngineController::getPresetSwitchStats() const
+{
+    return m_engine.switcher->stats();
 }
 
 void EngineController::savePreset(int bankSlot)
@@ -210,6 +141,43 @@ std::string EngineController::getPresetName([[maybe_unused]] int bankSlot) const
     return {};
 }
 
+// ─── Looper Sessions ───────────────────────────────────────────────
+
+bool EngineController::saveLoop(const std::string& path)
+{
+    // The RT thread notes the loop lengths and keeps the tracks in place
+    if (!postCommand({CommandType::LoopHold, 30, 0, 1}))
+        return false;
+    bool ok = waitForCommands();
+    if (ok)
+    {
+        const auto hold = m_engine.lazy_efx.hold();
+        ok = m_engine.efx_Looper->saveloop(path.c_str());
+    }
+    // Queued behind the hold, so one applied after a timeout is let go too
+    for (int tries = 0; !postCommand({CommandType::LoopHold, 30, 0, 0}) && tries < 500; ++tries)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return ok;
+}
+
+bool EngineController::loadLoop(const std::string& path)
+{
+    // A parked Looper is too short for any session
+    const int looper = 30;
+    m_engine.lazy_efx.unpark(&looper, 1);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (m_engine.lazy_efx.parked(looper))
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const auto hold = m_engine.lazy_efx.hold();
+    m_engine.efx_Looper->loadloop(path.c_str());
+    return true;
+}
+
 // ─── Global Controls ───────────────────────────────────────────────
 
 void EngineController::setMasterVolume(int value)
@@ -238,7 +206,7 @@ void EngineController::setBypass(bool bypass)
 {
     // Engine convention: Bypass == 1 means "process effects" (active).
     // Semantic wrapper: setBypass(true) means "skip effects" → Bypass = 0.
-    m_engine.Bypass = bypass ? 0 : 1;
+    postCommand({CommandType::Bypass, 0, 0, bypass ? 0 : 1});
 }
 
 bool EngineController::isBypassed() const
@@ -262,6 +230,20 @@ void EngineController::tapTempo()
     m_engine.TapTempo();
 }
 
+void EngineController::setEffectTiming(bool enabled)
+{
+    m_engine.efx_timer.set_enabled(enabled);
+}
+
+bool EngineController::isEffectTimingEnabled() const
+{
+#ifdef ENABLE_EFFECT_TIMING
+    return m_engine.efx_timer.enabled();
+#else
+    return false;
+#endif
+}
+
 std::string EngineController::getEffectTypeName(int effectType) const
 {
     static constexpr const char* names[] = {
@@ -283,56 +265,166 @@ std::string EngineController::getEffectTypeName(int effectType) const
     return "Unknown";
 }
 
+float EngineController::getPitchShiftLatency(int effectType) const
+{
+    const auto hold = m_engine.lazy_efx.hold();
+    switch (effectType) {
+    case 14: return 1000.0f * m_engine.efx_Har->latency();
+    case 37: return 1000.0f * m_engine.efx_Sequence->latency();
+    case 38: return 1000.0f * m_engine.efx_Shifter->latency();
+    case 42: return 1000.0f * m_engine.efx_StereoHarm->latency();
+    default: return -1.0f;
+    }
+}
+
+// ─── Command Queue ─────────────────────────────────────────────────
+
+bool EngineController::postCommand(const ParamCommand& cmd)
+{
+    if (m_cmd_rb.push(cmd))
+    {
+        m_cmd_posted.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+    m_cmd_overflows.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool EngineController::waitForCommands(std::chrono::milliseconds timeout)
+{
+    const auto target = m_cmd_posted.load(std::memory_order_acquire);
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (m_cmd_applied.load(std::memory_order_acquire) < target)
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+void EngineController::processCommands()
+{
+    ParamCommand cmd;
+    std::uint64_t applied = 0;
+    while (m_cmd_rb.pop(cmd))
+    {
+        switch (cmd.type)
+        {
+        case CommandType::Parameter:
+            if (auto* efx = m_engine.Effect_By_Type(cmd.effect_index))
+                efx->changepar(cmd.param_id, cmd.value);
+            break;
+        case CommandType::PresetParam:
+            if (m_pending_preset_count < kMaxPresetChanges)
+                m_pending_preset[m_pending_preset_count++] = cmd;
+            break;
+        case CommandType::Preset:
+            if (auto* efx = m_engine.Effect_By_Type(cmd.effect_index))
+            {
+                for (int i = 0; i < m_pending_preset_count; ++i)
+                {
+                    const ParamCommand& change = m_pending_preset[i];
+                    if (change.effect_index != cmd.effect_index)
+                        continue;
+                    if (change.param_id < 0)
+                        efx->cleanup();
+                    else if (cmd.effect_index == 30)
+                        m_engine.efx_Looper->loadpreset(change.param_id, change.value);
+                    else
+                        efx->changepar(change.param_id, change.value);
+                }
+                efx->Ppreset = cmd.value;
+            }
+            m_pending_preset_count = 0;
+            break;
+        case CommandType::EffectEnabled:
+            if (auto* bp = m_engine.Bypass_By_Type(cmd.effect_index))
+                *bp = cmd.value;
+            break;
+        case CommandType::OrderSlot:
+            if (cmd.param_id >= 0 && cmd.param_id < kMaxEffectSlots)
+                m_pending_order[cmd.param_id] = cmd.value;
+            break;
+        case CommandType::OrderCommit:
+            // Before any parameter change queued behind the order
+            m_engine.lazy_efx.swap_in();
+            for (int i = 0; i < cmd.value && i < kMaxEffectSlots; ++i)
+                m_engine.efx_order[i] = m_pending_order[i];
+            break;
+        case CommandType::Bypass:
+            m_engine.Bypass = cmd.value;
+            break;
+        case CommandType::LoopHold:
+            m_engine.efx_Looper->holdloop(cmd.value != 0);
+            break;
+        }
+        ++applied;
+    }
+    if (applied)
+        m_cmd_applied.fetch_add(applied, std::memory_order_release);
+}
+
 // ─── Real-Time Telemetry (GUI polls) ───────────────────────────────
 
 bool EngineController::pollLevels(AudioLevels& out)
 {
-    return m_levels_rb.pop_latest(out);
+    return m_levels.read(out);
 }
 
 bool EngineController::pollTuner(TunerData& out)
 {
-    return m_tuner_rb.pop_latest(out);
+    return m_tuner.read(out);
 }
 
 bool EngineController::pollLooper(LooperStatus& out)
 {
-    return m_looper_rb.pop_latest(out);
+    return m_looper.read(out);
 }
 
 bool EngineController::pollTapTempo(TapTempoStatus& out)
 {
-    return m_tap_rb.pop_latest(out);
+    return m_tap.read(out);
 }
 
 bool EngineController::pollChord(ChordInfo& out)
 {
-    return m_chord_rb.pop_latest(out);
+    return m_chord.read(out);
+}
+
+bool EngineController::pollEffectTiming(EffectTiming& out)
+{
+    return m_timing.read(out);
 }
 
 // ─── RT Thread Push ────────────────────────────────────────────────
 
 void EngineController::pushLevels(const AudioLevels& levels)
 {
-    (void)m_levels_rb.push(levels); // drop if full — never block RT thread
+    m_levels.write(levels);
 }
 
 void EngineController::pushTuner(const TunerData& data)
 {
-    (void)m_tuner_rb.push(data);
+    m_tuner.write(data);
 }
 
 void EngineController::pushLooper(const LooperStatus& status)
 {
-    (void)m_looper_rb.push(status);
+    m_looper.write(status);
 }
 
 void EngineController::pushTapTempo(const TapTempoStatus& status)
 {
-    (void)m_tap_rb.push(status);
+    m_tap.write(status);
 }
 
 void EngineController::pushChord(const ChordInfo& info)
 {
-    (void)m_chord_rb.push(info);
+    m_chord.write(info);
+}
+
+void EngineController::pushEffectTiming(const EffectTiming& timing)
+{
+    m_timing.write(timing);
 }
@@ -5,16 +5,21 @@
   EngineController.hpp - Thread-safe interface between GUI and audio engine.
 
   The GUI layer talks to the engine exclusively through this class.
-  Parameter changes are communicated via atomic operations;
-  real-time telemetry (levels, tuner, spectrum) flows through lock-free
-  ring buffers from the RT thread to the GUI poll timer.
+  Parameter, preset, order and bypass changes are queued in a lock-free
+  command ring and applied by the RT thread between periods;
+  real-time telemetry (levels, tuner, per-slot timing) flows through lock-free
+  latest-value mailboxes from the RT thread to the GUI poll timer.
 */
 
 #pragma once
 
+#include "EffectTimer.hpp"
+#include "PresetSwitcher.hpp"
 #include "RingBuffer.hpp"
+#include "TripleBuffer.hpp"
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <span>
 #include <string>
@@ -53,6 +58,7 @@ struct LooperStatus
     int stopped{0};
     int quarter{0};
     int bar{0};
+    unsigned dropped{0};        ///< Recorded frames lost, see Looper::dropped()
 };
 
 /// Snapshot of tap tempo state.
@@ -69,9 +75,23 @@ struct ChordInfo
     char name[32]{};
 };
 
-/// Command from GUI → Engine for parameter changes.
+/// Kind of change carried by a ParamCommand.
+enum class CommandType : int
+{
+    Parameter,      ///< efx->changepar(param_id, value)
+    PresetParam,    ///< staged preset change: changepar(param_id, value), -1 = cleanup()
+    Preset,         ///< apply the staged preset changes, then efx->Ppreset = value
+    EffectEnabled,  ///< effect bypass flag = value
+    OrderSlot,      ///< staged efx_order[param_id] = value
+    OrderCommit,    ///< publish the first `value` staged order slots
+    Bypass,         ///< global RKR::Bypass = value
+    LoopHold,       ///< efx_Looper->holdloop(value)
+};
+
+/// Command from GUI → Engine, applied by the RT thread between periods.
 struct ParamCommand
 {
+    CommandType type{CommandType::Parameter};
     int effect_index{0};
     int param_id{0};
     int value{0};
@@ -80,6 +100,9 @@ struct ParamCommand
 /// Number of effect slots in the processing chain.
 inline constexpr int kMaxEffectSlots = 16;
 
+/// Most changes one effect preset can make (Cabinet makes 81).
+inline constexpr int kMaxPresetChanges = 128;
+
 /// Total number of effect types.
 inline constexpr int kNumEffectTypes = 47;
 
@@ -107,21 +130,29 @@ public:
     /// Get an effect parameter. Reads current engine state.
     [[nodiscard]] int getEffectParameter(int effectIndex, int paramId) const;
 
-    /// Set effect preset.
-    void setEffectPreset(int effectIndex, int preset);
+    /// Set effect preset. The preset is resolved here into the changepar()
+    /// calls it makes, which the RT thread applies together. Returns false,
+    /// queueing nothing, if the command ring has no room for all of them.
+    bool setEffectPreset(int effectIndex, int preset);
 
     /// Get effect preset.
     [[nodiscard]] int getEffectPreset(int effectIndex) const;
 
     // ─── Effect Chain (GUI thread) ──────────────────────────────────
 
-    /// Set the effect processing order (10 slots).
+    /// Set the effect processing order (queued, applied as a whole). Held
+    /// back until parked effects in it are rebuilt full size on a worker;
+    /// postPendingOrder() sends it on.
     void setEffectOrder(std::span<const int> order);
 
+    /// Queue an order held back by setEffectOrder() once its effects are
+    /// ready. Call periodically from the GUI timer.
+    void postPendingOrder();
+
     /// Get the current effect order.
     [[nodiscard]] std::array<int, kMaxEffectSlots> getEffectOrder() const;
 
-    /// Enable/disable an effect in the chain.
+    /// Enable/disable an effect in the chain (queued for RT thread).
     void setEffectEnabled(int effectIndex, bool enabled);
 
     /// Check if an effect is enabled.
@@ -129,11 +160,31 @@ public:
 
     // ─── Presets / Banks (GUI thread) ───────────────────────────────
 
+    /// Switch to a bank preset. The effects are prepared off the RT thread
+    /// and swapped in with a one-period crossfade; returns immediately.
     void loadPreset(int bankSlot);
+
+    /// The last loadPreset() is not playing yet, getters still reflect the
+    /// old preset. Poll it from a timer, never wait on it.
+    [[nodiscard]] bool isPresetPending() const;
+
+    /// Switch latency and RT-side cost of preset changes.
+    [[nodiscard]] PresetSwitchStats getPresetSwitchStats() const;
+
     void savePreset(int bankSlot);
     void newPreset();
     [[nodiscard]] std::string getPresetName(int bankSlot) const;
 
+    // ─── Looper Sessions (GUI thread) ───────────────────────────────
+
+    /// Write the Looper tracks to a session file. Blocks until written;
+    /// false if the RT thread did not respond or the file failed.
+    bool saveLoop(const std::string& path);
+
+    /// Read a session file into the Looper in the background; it is put
+    /// in place stopped. False if the Looper could not be made full size.
+    bool loadLoop(const std::string& path);
+
     // ─── Global Controls (GUI thread) ───────────────────────────────
 
     void setMasterVolume(int value);
@@ -150,9 +201,43 @@ public:
 
     void tapTempo();
 
+    /// Time each effect's out() call in the RT thread. On by default when
+    /// built with ENABLE_EFFECT_TIMING; without it this does nothing.
+    void setEffectTiming(bool enabled);
+    [[nodiscard]] bool isEffectTimingEnabled() const;
+
     /// Get the display name for an effect type (0-46).
     [[nodiscard]] std::string getEffectTypeName(int effectType) const;
 
+    /// Delay through the pitch shifter of Harmonizer, Sequence, Shifter or
+    /// StereoHarm (14, 37, 38, 42) as currently built, in ms. -1 otherwise.
+    /// PSOLA lags half a period of the note playing now, so this changes
+    /// with the note; PsolaShifter::latency() gives its range.
+    [[nodiscard]] float getPitchShiftLatency(int effectType) const;
+
+    // ─── Command Queue (GUI thread) ─────────────────────────────────
+
+    /// Block until the RT thread has applied every queued command, so
+    /// getters reflect the latest set calls. Returns false on timeout
+    /// (e.g. the JACK client is gone).
+    bool waitForCommands(std::chrono::milliseconds timeout =
+                             std::chrono::milliseconds(100));
+
+    /// Queued commands the RT thread has not applied yet. For a GUI timer
+    /// to refresh once they are, without blocking.
+    [[nodiscard]] bool hasPendingCommands() const noexcept
+    {
+        return m_order_waiting ||
+               (m_cmd_applied.load(std::memory_order_acquire) <
+                m_cmd_posted.load(std::memory_order_acquire));
+    }
+
+    /// Commands dropped because the command ring was full.
+    [[nodiscard]] std::uint64_t getCommandOverflows() const noexcept
+    {
+        return m_cmd_overflows.load(std::memory_order_relaxed);
+    }
+
     // ─── Real-Time Telemetry (GUI thread reads, RT thread writes) ──
 
     /// Poll the latest audio levels from the RT thread.
@@ -170,8 +255,15 @@ public:
     /// Poll chord recognition.
     [[nodiscard]] bool pollChord(ChordInfo& out);
 
+    /// Poll per-slot effect timing (a new snapshot every 250 ms of audio).
+    [[nodiscard]] bool pollEffectTiming(EffectTiming& out);
+
     // ─── RT Thread Interface (called from JACK callback) ───────────
 
+    /// Apply all queued GUI commands. Called at the start of each period,
+    /// before the effect chain runs. Wait-free.
+    void processCommands();
+
     /// Push audio levels snapshot. Called once per JACK period.
     void pushLevels(const AudioLevels& levels);
 
@@ -187,6 +279,9 @@ public:
     /// Push chord info.
     void pushChord(const ChordInfo& info);
 
+    /// Push per-slot effect timing.
+    void pushEffectTiming(const EffectTiming& timing);
+
     // ─── Direct Engine Access (escape hatch during migration) ──────
 
     /// Direct access to the underlying engine.
@@ -195,12 +290,31 @@ public:
     [[nodiscard]] const RKR& engine() const noexcept { return m_engine; }
 
 private:
+    bool postCommand(const ParamCommand& cmd);
+
     RKR& m_engine;
 
-    // Ring buffers: RT thread → GUI thread (power-of-2 sizes)
-    RingBuffer<AudioLevels, 16>    m_levels_rb;
-    RingBuffer<TunerData, 16>      m_tuner_rb;
-    RingBuffer<LooperStatus, 8>    m_looper_rb;
-    RingBuffer<TapTempoStatus, 8>  m_tap_rb;
-    RingBuffer<ChordInfo, 8>       m_chord_rb;
+    // Command ring: GUI thread → RT thread
+    RingBuffer<ParamCommand, 1024> m_cmd_rb;
+    std::atomic<std::uint64_t>     m_cmd_posted{0};
+    std::atomic<std::uint64_t>     m_cmd_applied{0};
+    std::atomic<std::uint64_t>     m_cmd_overflows{0};
+    std::array<int, kMaxEffectSlots> m_pending_order{};  // RT thread only
+
+    // Order waiting for its effects to be unparked, GUI thread only
+    std::array<int, kMaxEffectSlots> m_order{};
+    int           m_order_count{0};
+    std::uint64_t m_order_ticket{0};
+    bool          m_order_waiting{false};
+    std::array<ParamCommand, kMaxPresetChanges> m_pending_preset{};  // RT thread only
+    int m_pending_preset_count{0};
+
+    // Latest snapshots: RT thread → GUI thread. A new one replaces an
+    // unread one, so they never back up while the GUI is not polling.
+    TripleBuffer<AudioLevels>      m_levels;
+    TripleBuffer<TunerData>        m_tuner;
+    TripleBuffer<LooperStatus>     m_looper;
+    TripleBuffer<TapTempoStatus>   m_tap;
+    TripleBuffer<ChordInfo>        m_chord;
+    TripleBuffer<EffectTiming>     m_timing;
 };
@@ -111,6 +111,15 @@ Exciter::sethar(int num,int value)
 
 void
 Exciter::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Exciter::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 13;
     const int NUM_PRESETS = 5;
@@ -131,14 +140,13 @@ Exciter::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(22,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 };
 
 
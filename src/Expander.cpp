@@ -85,6 +85,21 @@ Expander::sethpf (int value)
 };
 
 
+/*
+ * The Effect interface, parameters and presets as the other effects have them
+ */
+void
+Expander::setpreset (int npreset)
+{
+    Expander_Change_Preset (npreset);
+}
+
+void
+Expander::changepar (int npar, int value)
+{
+    Expander_Change (npar, value);
+}
+
 void
 Expander::Expander_Change (int np, int value)
 {
@@ -162,6 +177,14 @@ Expander::getpar (int np)
 
 void
 Expander::Expander_Change_Preset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+}
+
+void
+Expander::preset_changes (int npreset, PresetChanges &changes)
 {
 
     const int PRESET_SIZE = 7;
@@ -179,12 +202,11 @@ Expander::Expander_Change_Preset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(25,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            Expander_Change (n+1, pdata[n]);
+            changes.add (n + 1, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            Expander_Change (n + 1, presets[npreset][n]);
+            changes.add (n + 1, presets[npreset][n]);
     }
-
 }
 
 
@@ -45,8 +45,11 @@ public:
 
     void out (float * smps_l, float * smps_r);
 
+    void setpreset (int npreset);
+    void changepar (int npar, int value);
     void Expander_Change (int np, int value);
     void Expander_Change_Preset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void cleanup ();
     int getpar (int npar);
 
@@ -0,0 +1,17 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  FFTWPlanner.hpp - Lock around the FFTW planner.
+
+  Only fftw(f)_execute is thread safe. Creating and destroying plans touches
+  the planner's global state, shared by fftw and fftwf, and effects and their
+  convolvers are built on loader and switcher threads while the GUI builds
+  others. Hold this lock around every fftw(f)_plan_* and fftw(f)_destroy_plan.
+*/
+
+#pragma once
+
+#include <mutex>
+
+inline std::mutex fftw_planner_mutex;
@@ -0,0 +1,38 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  FileCache.cpp - Process-wide cache of decoded impulse response and tap files.
+*/
+
+#include <cstdio>
+#include "FileCache.hpp"
+#include "portable_crt.hpp"
+
+std::uint64_t
+file_hash(const void *data, std::size_t size)
+{
+    const auto *p = static_cast<const unsigned char *>(data);
+    std::uint64_t h = 14695981039346656037ull;
+    for (std::size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool
+read_file(const char *name, std::vector<unsigned char> &out)
+{
+    FILE *fs = rkr::portable_fopen(name, "rb");
+    if (!fs)
+        return false;
+
+    out.clear();
+    unsigned char chunk[65536];
+    std::size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fs)) > 0)
+        out.insert(out.end(), chunk, chunk + n);
+    fclose(fs);
+    return true;
+}
@@ -0,0 +1,109 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  FileCache.hpp - Process-wide cache of decoded impulse response and tap files.
+
+  Banks reuse the same few cabinet and room files, and every preset change
+  read, decoded and resampled them again for each instance. FileCache maps
+  the hash of a file's contents, together with the settings its processing
+  depends on, to the finished result. The result is immutable and shared:
+  every instance loading the same key holds the same object, which lives as
+  long as one of them uses it. The last few results used are kept after
+  that, so going back to a preset is a lookup.
+
+  Only FileLoader threads use it, never the RT thread; it takes a mutex.
+  The last reference to an entry is dropped on a loader thread too, since
+  the owners retire their loaded files there.
+
+  Usage:
+    static FileCache<Impulse> cache;
+    FileKey key{file_hash(data, size), rate, ...};
+    std::shared_ptr<const Impulse> ir = cache.find(key);
+    if (!ir) ir = cache.insert(key, build(data, size));
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// What a cached file was built from.
+struct FileKey
+{
+    std::uint64_t hash{0};   ///< file_hash() of the contents
+    int rate{0};             ///< Sample rate it was resampled to, if any
+    int size{0};             ///< Most samples kept, if capped
+    int length{0};           ///< Owner's length setting, 0 for the plain file
+    int options{0};          ///< Owner specific processing flags
+    int block{0};            ///< Partition size, for a transformed file
+
+    auto operator<=>(const FileKey &) const = default;
+};
+
+/// 64 bit FNV-1a of a file's contents.
+std::uint64_t file_hash(const void *data, std::size_t size);
+
+/// Read a whole file into out. False if it cannot be opened.
+bool read_file(const char *name, std::vector<unsigned char> &out);
+
+/// @tparam T     The processed file. Built once per key and never changed.
+/// @tparam Keep  How many unused entries stay loaded.
+template <typename T, std::size_t Keep = 16>
+class FileCache
+{
+public:
+    /// The entry for key, or nullptr if nobody has it loaded.
+    std::shared_ptr<const T> find(const FileKey &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it == entries.end())
+            return nullptr;
+        std::shared_ptr<const T> t = it->second.lock();
+        if (!t) {
+            entries.erase(it);
+            return nullptr;
+        }
+        touch(t);
+        return t;
+    }
+
+    /// Store t under key. If another thread stored the same key first, its
+    /// entry is returned instead and t is dropped.
+    std::shared_ptr<const T> insert(const FileKey &key, std::shared_ptr<const T> t)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::weak_ptr<const T> &slot = entries[key];
+        if (std::shared_ptr<const T> first = slot.lock())
+            t = std::move(first);
+        else
+            slot = t;
+        touch(t);
+        std::erase_if(entries, [] (const auto &e) { return e.second.expired(); });
+        return t;
+    }
+
+private:
+    // Make t the most recently used and drop the oldest past Keep.
+    void touch(const std::shared_ptr<const T> &t)
+    {
+        auto it = std::find(recent.begin(), recent.end(), t);
+        if (it != recent.end())
+            recent.erase(it);
+        recent.push_front(t);
+        if (recent.size() > Keep)
+            recent.pop_back();
+    }
+
+    std::mutex mutex;
+    std::map<FileKey, std::weak_ptr<const T>> entries;
+    std::deque<std::shared_ptr<const T>> recent;
+};
@@ -0,0 +1,114 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  FileLoader.cpp - Background loading of impulse response and tap files.
+*/
+
+#include <chrono>
+#include <utility>
+#include "FileLoader.hpp"
+
+FileLoader::FileLoader(Load load_, bool threaded_)
+    : load(std::move(load_)), threaded(threaded_)
+{
+    if (threaded)
+        worker = std::thread(&FileLoader::work, this);
+}
+
+FileLoader::~FileLoader()
+{
+    if (worker.joinable()) {
+        quit.store(true, std::memory_order_release);
+        wake.release();
+        worker.join();
+    }
+
+    delete ready.exchange(nullptr, std::memory_order_acq_rel);
+    LoadedFile *file;
+    while (retired.pop(file))
+        delete file;
+}
+
+void
+FileLoader::request(const FileRequest &req)
+{
+    stash = req;
+    stash.seq = ++seq;
+    stashed = true;
+
+    if (!threaded) {
+        stashed = false;
+        publish(load(stash), stash.seq);
+        return;
+    }
+    flush();
+}
+
+void
+FileLoader::flush() noexcept
+{
+    if (!stashed || !requests.push(stash))
+        return;
+    stashed = false;
+    wake.release();
+}
+
+LoadedFile *
+FileLoader::take() noexcept
+{
+    flush();
+    if (!ready.load(std::memory_order_relaxed))
+        return nullptr;
+    return ready.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void
+FileLoader::retire(LoadedFile *file) noexcept
+{
+    if (!threaded) {
+        delete file;
+        return;
+    }
+
+    // The worker empties the ring every time it wakes, so this only fails
+    // if it is stuck. Leak rather than free on the audio thread.
+    if (retired.push(file))
+        wake.release();
+}
+
+void
+FileLoader::wait()
+{
+    flush();
+    while (loaded.load(std::memory_order_acquire) < seq) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        flush();
+    }
+}
+
+void
+FileLoader::publish(std::unique_ptr<LoadedFile> file, std::uint64_t done)
+{
+    // A file the owner has not taken yet is out of date now.
+    delete ready.exchange(file.release(), std::memory_order_acq_rel);
+    loaded.store(done, std::memory_order_release);
+}
+
+void
+FileLoader::work()
+{
+    for (;;) {
+        wake.acquire();
+        if (quit.load(std::memory_order_acquire))
+            return;
+
+        LoadedFile *file;
+        while (retired.pop(file))
+            delete file;
+
+        FileRequest req;
+        if (requests.pop_latest(req))
+            publish(load(req), req.seq);
+    }
+}
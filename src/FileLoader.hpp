@@ -0,0 +1,102 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  FileLoader.hpp - Background loading of impulse response and tap files.
+
+  Convolotron, Reverbtron and Echotron take a new file through changepar(),
+  which the audio thread applies between periods. Opening, parsing and
+  resampling the file there, and clearing seconds of history after it,
+  made every cabinet or room change an xrun. FileLoader runs the owner's
+  load function on a worker thread instead. It builds a fresh object that
+  nobody changes after it is published; the audio thread takes it with one
+  atomic exchange, crossfades from the old one and hands that back to the
+  worker to be freed.
+
+  Only the latest request matters: requests the worker has not started on
+  are dropped, and so is a loaded file the audio thread has not taken yet
+  when a newer one is ready.
+
+  Usage:
+    Owner (RT too):  loader.request(req);
+    RT:              if (LoadedFile *f = loader.take()) { ...; loader.retire(old); }
+    Not RT:          loader.wait();  then take(), e.g. before the owner plays
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <semaphore>
+#include <thread>
+#include "RingBuffer.hpp"
+
+/// Which file to load, as the owner's changepar() saw it.
+struct FileRequest
+{
+    std::uint64_t seq{0};
+    int num{0};                       ///< Embedded file, unless user is set
+    int user{0};                      ///< Read name from disk instead
+    std::array<char, 128> name{};
+    std::array<int, 2> args{};        ///< Owner specific settings baked into the file
+};
+
+/// A loaded file. Owners derive their own, built by the load function.
+struct LoadedFile
+{
+    virtual ~LoadedFile() = default;
+    bool found{true};                 ///< False if the owner's default stands in
+};
+
+class FileLoader
+{
+public:
+    using Load = std::function<std::unique_ptr<LoadedFile>(const FileRequest &)>;
+
+    /// With threaded false (offline rendering) request() loads in place.
+    FileLoader(Load load, bool threaded = true);
+    ~FileLoader();
+
+    FileLoader(const FileLoader&) = delete;
+    FileLoader& operator=(const FileLoader&) = delete;
+
+    /// Queue a load. Never blocks. Only the owner's thread calls request(),
+    /// take() and wait().
+    void request(const FileRequest &req);
+
+    /// RT thread. The latest loaded file, or nullptr. The caller owns it.
+    [[nodiscard]] LoadedFile *take() noexcept;
+
+    /// RT thread. Frees file on the worker.
+    void retire(LoadedFile *file) noexcept;
+
+    /// Not the RT thread. Block until the last request is ready to take().
+    void wait();
+
+private:
+    void flush() noexcept;
+    void publish(std::unique_ptr<LoadedFile> file, std::uint64_t seq);
+    void work();
+
+    Load load;
+    bool threaded;
+
+    // Owner side. The newest request waits here while the ring is full.
+    std::uint64_t seq{0};
+    FileRequest stash;
+    bool stashed{false};
+
+    RingBuffer<FileRequest, 8> requests;
+    std::atomic<std::uint64_t> loaded{0};
+
+    // Worker → RT: one loaded file. RT → worker: files done with.
+    std::atomic<LoadedFile *> ready{nullptr};
+    RingBuffer<LoadedFile *, 16> retired;
+
+    std::counting_semaphore<> wake{0};
+    std::atomic<bool> quit{false};
+    std::thread worker;
+};
@@ -82,6 +82,21 @@ Gate::sethpf (int value)
     hpfr->setfreq (fr);
 };
 
+/*
+ * The Effect interface, parameters and presets as the other effects have them
+ */
+void
+Gate::setpreset (int npreset)
+{
+    Gate_Change_Preset (npreset);
+}
+
+void
+Gate::changepar (int npar, int value)
+{
+    Gate_Change (npar, value);
+}
+
 
 void
 Gate::Gate_Change (int np, int value)
@@ -159,6 +174,14 @@ Gate::getpar (int np)
 
 void
 Gate::Gate_Change_Preset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+}
+
+void
+Gate::preset_changes (int npreset, PresetChanges &changes)
 {
 
     const int PRESET_SIZE = 7;
@@ -176,12 +199,11 @@ Gate::Gate_Change_Preset (int npreset)
 
         FPreset::ReadPreset(16,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            Gate_Change(n + 1, pdata[n]);
+            changes.add (n + 1, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            Gate_Change (n + 1, presets[npreset][n]);
+            changes.add (n + 1, presets[npreset][n]);
     }
-
 }
 
 
@@ -30,7 +30,7 @@
 
 
 
-Harmonizer::Harmonizer (long int Quality, int DS, int uq, int dq)
+Harmonizer::Harmonizer (long int Quality, int DS, int uq, int dq, int pmode)
 {
 
 
@@ -48,13 +48,13 @@ Harmonizer::Harmonizer (long int Quality, int DS, int uq, int dq)
     std::fill(outi.begin(), outi.end(), 0.0f);
     std::fill(outo.begin(), outo.end(), 0.0f);
 
-    U_Resample = std::make_unique<Resample>(dq);
-    D_Resample = std::make_unique<Resample>(uq);
+    U_Resample = std::make_unique<Resample>(dq, u_up);
+    D_Resample = std::make_unique<Resample>(uq, u_down);
 
 
     pl = std::make_unique<AnalogFilter>(6, 22000.0f, 1.0f, 0);
 
-    PS = std::make_unique<PitchShifter>(window, hq, nfSAMPLE_RATE);
+    PS = std::make_unique<PitchShifter>(window, hq, nfSAMPLE_RATE, pmode);
     PS->ratio = 1.0f;
 
     Ppreset = 0;
@@ -97,7 +97,7 @@ Harmonizer::out (float *smpsl, float *smpsr)
     if((DS_state != 0) && (Pinterval !=12)) {
         memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
         memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
     }
 
 
@@ -117,7 +117,7 @@ Harmonizer::out (float *smpsl, float *smpsr)
         PS->smbPitchShift (PS->ratio, nPERIOD, window, hq, nfSAMPLE_RATE, outi.data(), outo.data());
 
         if((DS_state != 0) && (Pinterval != 12)) {
-            D_Resample->mono_out(outo.data(),templ.data(),nPERIOD,u_down,PERIOD);
+            D_Resample->mono_out(outo.data(),templ.data(),nPERIOD,PERIOD);
         } else {
             memcpy(templ.data(), outo.data(),sizeof(float)*PERIOD);
         }
@@ -308,6 +308,15 @@ Harmonizer::adjust(int DS)
 
 void
 Harmonizer::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Harmonizer::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 11;
     const int NUM_PRESETS = 3;
@@ -325,16 +334,12 @@ Harmonizer::setpreset (int npreset)
 
         FPreset::ReadPreset(14,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
-
-
 };
 
 
@@ -37,16 +37,20 @@ class Harmonizer : public Effect
 {
 
 public:
-    Harmonizer (long int Quality, int DS, int uq, int dq);
+    Harmonizer (long int Quality, int DS, int uq, int dq, int pmode = PitchShifter::REFERENCE);
     ~Harmonizer ();
     void out (float *smpsl, float *smpsr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
     void applyfilters (float * smpsl);
     void adjust(int DS);
 
+    /// Delay through the pitch shifter, seconds
+    float latency () const { return PS->latency (); }
+
 
     int Pinterval;
     int PMIDI;
@@ -30,11 +30,12 @@
 Infinity::Infinity ()
 {
     int i;
+    filters = std::make_unique<RBFilterBank>(0, 70.0f, 1);
     for (i = 0; i<NUM_INF_BANDS; i++) {
-        filterl[i] = std::make_unique<RBFilter>(0, 80.0f, 70.0f, 1);
-        filterr[i] = std::make_unique<RBFilter>(0, 80.0f, 70.0f, 1);
         rbandstate[i].level = 1.0f;
         rbandstate[i].vol = 1.0f;
+        lbandstate[i].level = 1.0f;
+        lbandstate[i].vol = 1.0f;
         lphaser[i].gain = 0.5f;
         rphaser[i].gain = 0.5f;
         for (int j = 0; j<MAX_PHASER_STAGES; j++) {
@@ -46,6 +47,7 @@ Infinity::Infinity ()
 
         Pb[i] = 1;
     }
+    stdiff = 0.0f;
     Ppreset = 2;
     setpreset (Ppreset);
     Pvolume = 64;
@@ -71,6 +73,10 @@ Infinity::Infinity ()
     beta = 1.0f - alpha;
 
     adjustfreqs();
+    //the oscillators glide to these, start them there
+    rampconst = crampconst;
+    irampconst = cirampconst;
+    fconst = cfconst;
     reinitfilter();
 
 };
@@ -163,8 +169,8 @@ Infinity::oscillator()
         lmodulate = 1.0f - 0.25f*lbandstate[i].ramp;
         rmodulate = 1.0f - 0.25f*rbandstate[i].ramp;
 
-        filterl[i]->directmod(lbandstate[i].ramp);
-        filterr[i]->directmod(rbandstate[i].ramp);
+        bandfreq[i] = lbandstate[i].ramp;
+        bandfreq[NUM_INF_BANDS + i] = rbandstate[i].ramp;
 
         lphaser[i].gain = lmodulate;
         rphaser[i].gain = rmodulate;
@@ -180,24 +186,28 @@ Infinity::out (float * smpsl, float * smpsr)
 {
     int i, j;
     float tmpr, tmpl;
+    float in[RBFilterBank::kLanes], band[RBFilterBank::kLanes];
 
     for (i = 0; i<PERIOD; i++)  {
         //modulate
         oscillator();
         tmpr = tmpl = 0.0f;
         //run filter
-
-
+        for (j=0; j<NUM_INF_BANDS; j++)  {
+            in[j] = lbandstate[j].vol*smpsl[i];
+            in[NUM_INF_BANDS + j] = rbandstate[j].vol*smpsr[i];
+        }
+        filters->filterout_s(in, bandfreq, band);
 
         if(Pstages) {
             for (j=0; j<NUM_INF_BANDS; j++)  {
-                tmpl+=phaser(lphaser, filterl[j]->filterout_s(lbandstate[j].vol*smpsl[i]), j );
-                tmpr+=phaser(rphaser, filterr[j]->filterout_s(rbandstate[j].vol*smpsr[i]), j );
+                tmpl+=phaser(lphaser, band[j], j );
+                tmpr+=phaser(rphaser, band[NUM_INF_BANDS + j], j );
             }
         } else {
             for (j=0; j<NUM_INF_BANDS; j++)  {
-                tmpl+=filterl[j]->filterout_s(lbandstate[j].vol*smpsl[i]);
-                tmpr+=filterr[j]->filterout_s(rbandstate[j].vol*smpsr[i]);
+                tmpl+=band[j];
+                tmpr+=band[NUM_INF_BANDS + j];
             }
         }
 
@@ -218,9 +228,8 @@ void
 Infinity::cleanup ()
 {
     reinitfilter ();
+    filters->cleanup();
     for ( int i = 0; i<NUM_INF_BANDS; i++) {
-        filterl[i]->cleanup();
-        filterr[i]->cleanup();
         lphaser[i].gain = 0.5f;
         rphaser[i].gain = 0.5f;
         for (int j = 0; j<MAX_PHASER_STAGES; j++) {
@@ -258,10 +267,7 @@ Infinity::setq ()
         volmaster = (1.0f-fq/1500.0f)/sqrt(qq);
     }
 
-    for (int i=0; i<NUM_INF_BANDS; i++)  {
-        filterl[i]->setq(qq);
-        filterr[i]->setq(qq);
-    }
+    filters->setq(qq);
 }
 void
 Infinity::reinitfilter ()
@@ -286,18 +292,13 @@ Infinity::reinitfilter ()
         lbandstate[i].lfo = 0.5f*(1.0f + rbandstate[i].sinp);  //lfo modulates filter band volume
 //printf("i: %d sin: %f lfo: %f ramp: %f max: %f min: %f\n",i,rbandstate[i].sinp, rbandstate[i].lfo, rbandstate[i].ramp, maxlevel, minlevel);
 
-        filterl[i]->setmix(0, 80.0f, 70.0f, 1.0f);
-        filterr[i]->setmix(0, 80.0f, 70.0f, 1.0f);
-        filterl[i]->setmode(1);
-        filterr[i]->setmode(1);
-        filterl[i]->settype(2);
-        filterr[i]->settype(2);  //bandpass
-        filterl[i]->setq(qq);
-        filterr[i]->setq(qq);
-        filterl[i]->directmod(lbandstate[i].ramp);
-        filterr[i]->directmod(rbandstate[i].ramp);
+        bandfreq[i] = lbandstate[i].ramp;
+        bandfreq[NUM_INF_BANDS + i] = rbandstate[i].ramp;
 
     }
+    filters->setmode(1);
+    filters->settype(2);  //bandpass
+    filters->setq(qq);
     msin = 0.0f;
     mcos = 1.0f;
 };
@@ -339,6 +340,16 @@ Infinity::adjustfreqs()
 
 void
 Infinity::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+    reinitfilter ();
+};
+
+void
+Infinity::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 18;
     const int NUM_PRESETS = 10;
@@ -369,16 +380,12 @@ Infinity::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(46,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
-
-    reinitfilter ();
 };
 
 
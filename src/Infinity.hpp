@@ -36,6 +36,7 @@ public:
     void out (float * smpsl, float * smpsr);
 
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -97,7 +98,10 @@ private:
     float ratescale;
     int tflag;
 
-    std::unique_ptr<RBFilter> filterl[NUM_INF_BANDS], filterr[NUM_INF_BANDS];
+    // Left bands in lanes 0 .. NUM_INF_BANDS - 1, right bands after them
+    static_assert(2 * NUM_INF_BANDS == RBFilterBank::kLanes);
+    std::unique_ptr<RBFilterBank> filters;
+    float bandfreq[RBFilterBank::kLanes];   // directmod input per lane
 };
 
 #endif
@@ -0,0 +1,338 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  LazyEffects.cpp - Full size instances only for effects that are in use.
+*/
+
+#include <algorithm>
+#include "LazyEffects.hpp"
+#include "global.hpp"
+#include "AllEffects.hpp"
+
+namespace
+{
+constexpr int kConvolotron = 29;
+constexpr int kLooper = 30;
+constexpr int kReverbtron = 40;
+constexpr int kEchotron = 41;
+
+// Parameters a rebuild copies, the ranges Config_Effect() loads
+int last_par(int type)
+{
+    switch (type) {
+    case kConvolotron: return 10;
+    case kLooper: return 13;
+    default: return 15;
+    }
+}
+}
+
+LazyEffects::LazyEffects(RKR &rkr_)
+    : rkr(rkr_)
+{
+}
+
+LazyEffects::~LazyEffects()
+{
+    if (worker.joinable()) {
+        quit.store(true, std::memory_order_release);
+        wake.release();
+        worker.join();
+    }
+    for (int i = 0; i < kCount; i++) {
+        delete staged_full[i].exchange(nullptr);
+        delete staged_park[i].exchange(nullptr);
+    }
+    free_retired();
+}
+
+bool
+LazyEffects::parkable(int type) noexcept
+{
+    return index_of(type) >= 0;
+}
+
+int
+LazyEffects::index_of(int type) noexcept
+{
+    for (int i = 0; i < kCount; i++)
+        if (kParkable[i] == type)
+            return i;
+    return -1;
+}
+
+void
+LazyEffects::init()
+{
+    const auto now = Clock::now();
+    for (int i = 0; i < kCount; i++) {
+        last_used[i] = now;
+        parked_efx[i].store(enabled ? rkr.Effect_By_Type(kParkable[i]) : nullptr);
+    }
+    worker = std::thread(&LazyEffects::work, this);
+}
+
+bool
+LazyEffects::parked(int type) const noexcept
+{
+    const int i = index_of(type);
+    if (i < 0)
+        return false;
+    const Effect *efx = parked_efx[i].load();
+    return (efx != nullptr) && (efx == rkr.Effect_By_Type(type));
+}
+
+bool
+LazyEffects::in_chain(int type) const noexcept
+{
+    for (int slot : rkr.efx_order)
+        if (slot == type)
+            return true;
+    return false;
+}
+
+LazyEffects::Snapshot
+LazyEffects::snapshot(int type)
+{
+    Effect *live = rkr.Effect_By_Type(type);
+    Snapshot from;
+    from.type = type;
+    from.preset = live->Ppreset;
+    for (int i = 0; i <= last_par(type); i++)
+        from.pars[i] = live->getpar(i);
+
+    switch (type) {
+    case kConvolotron:
+        from.file = static_cast<Convolotron *>(live)->Filename;
+        break;
+    case kReverbtron:
+        from.file = static_cast<Reverbtron *>(live)->Filename;
+        break;
+    case kEchotron:
+        from.file = static_cast<Echotron *>(live)->Filename;
+        break;
+    }
+    return from;
+}
+
+/*
+ * A new instance of from.type with the parameters of the live one. The
+ * files are asked for by changepar(), so the names go first and the load
+ * is waited for after.
+ */
+std::unique_ptr<Effect>
+LazyEffects::rebuild(const Snapshot &from, bool park)
+{
+    std::unique_ptr<Effect> efx = rkr.New_Effect(from.type, park);
+    const int last = last_par(from.type);
+
+    switch (from.type) {
+    case kConvolotron:
+        static_cast<Convolotron *>(efx.get())->Filename = from.file;
+        for (int i = 0; i <= last; i++)
+            efx->changepar(i, from.pars[i]);
+        static_cast<Convolotron *>(efx.get())->waitfile();
+        break;
+    case kLooper:
+        for (int i = 0; i <= last; i++)
+            static_cast<Looper *>(efx.get())->loadpreset(i, from.pars[i]);
+        break;
+    case kReverbtron:
+        static_cast<Reverbtron *>(efx.get())->Filename = from.file;
+        for (int i = 0; i <= last; i++)
+            efx->changepar(i, from.pars[i]);
+        static_cast<Reverbtron *>(efx.get())->waitfile();
+        break;
+    case kEchotron: {
+        auto *echo = static_cast<Echotron *>(efx.get());
+        echo->Filename = from.file;
+        echo->Pchange = 1;
+        for (int i = 0; i <= last; i++)
+            efx->changepar(i, from.pars[i]);
+        echo->Pchange = 0;
+        echo->waitfile();
+        break;
+    }
+    }
+
+    efx->Ppreset = from.preset;
+    return efx;
+}
+
+void
+LazyEffects::stage(std::atomic<Effect *> &slot, std::unique_ptr<Effect> efx)
+{
+    // Not taken by the audio thread yet, so it never ran.
+    delete slot.exchange(efx.release(), std::memory_order_acq_rel);
+}
+
+void
+LazyEffects::free_retired()
+{
+    Effect *efx;
+    while (retired.pop(efx))
+        delete efx;
+}
+
+void
+LazyEffects::unpark(const int *order, int count)
+{
+    std::array<Snapshot, kCount> todo;
+    int n_todo = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_retired();
+
+        const auto now = Clock::now();
+        for (int n = 0; n < count; n++) {
+            const int type = order[n];
+            const int i = index_of(type);
+            if (i < 0)
+                continue;
+
+            // Pairs with swap_in(): either the audio thread sees this
+            // increment and takes its parked instance back out, or parked()
+            // below sees it.
+            uses[i].fetch_add(1);
+            last_used[i] = now;
+            delete staged_park[i].exchange(nullptr);
+
+            if (parked(type) && (staged_full[i].load() == nullptr))
+                todo[n_todo++] = snapshot(type);
+        }
+    }
+
+    // Built outside the lock, which the GUI takes to read parameters
+    for (int n = 0; n < n_todo; n++) {
+        std::unique_ptr<Effect> efx = rebuild(todo[n], false);
+        std::lock_guard<std::mutex> lock(mutex);
+        const int i = index_of(todo[n].type);
+        if (parked(todo[n].type) && (staged_full[i].load() == nullptr))
+            stage(staged_full[i], std::move(efx));
+    }
+}
+
+std::uint64_t
+LazyEffects::request(const int *order, int count)
+{
+    // Nothing parked, nothing to build: no need to wait for the worker
+    bool build = false;
+    for (int n = 0; n < count; n++)
+        build = build || parked(order[n]);
+    if (!build) {
+        unpark(order, count);
+        return 0;
+    }
+
+    std::uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        request_count = std::min(count, MAX_EFFECT_SLOTS);
+        std::copy(order, order + request_count, request_order.begin());
+        seq = ++request_seq;
+    }
+    wake.release();
+    return seq;
+}
+
+void
+LazyEffects::collect()
+{
+    std::array<Snapshot, kCount> todo;
+    int n_todo = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free_retired();
+
+        if ((!enabled) || (release_time <= 0))
+            return;
+
+        const auto now = Clock::now();
+        for (int i = 0; i < kCount; i++) {
+            const int type = kParkable[i];
+            if (type == kLooper)
+                continue;
+            if (in_chain(type) || (staged_full[i].load() != nullptr)) {
+                last_used[i] = now;
+                continue;
+            }
+            if (parked(type) || (staged_park[i].load() != nullptr))
+                continue;
+            if (now - last_used[i] < std::chrono::seconds(release_time))
+                continue;
+
+            park_uses[i].store(uses[i].load());
+            todo[n_todo++] = snapshot(type);
+        }
+    }
+
+    for (int n = 0; n < n_todo; n++) {
+        std::unique_ptr<Effect> efx = rebuild(todo[n], true);
+        std::lock_guard<std::mutex> lock(mutex);
+        const int i = index_of(todo[n].type);
+        // Not if unpark() wanted the effect meanwhile
+        if (uses[i].load() == park_uses[i].load())
+            stage(staged_park[i], std::move(efx));
+    }
+}
+
+void
+LazyEffects::work()
+{
+    for (;;) {
+        // Woken by request(), else now and then to free and park
+        (void) wake.try_acquire_for(kCollectInterval);
+        if (quit.load(std::memory_order_acquire))
+            return;
+
+        std::array<int, MAX_EFFECT_SLOTS> order;
+        int count;
+        std::uint64_t seq;
+        {
+            std::lock_guard<std::mutex> lock(request_mutex);
+            order = request_order;
+            count = request_count;
+            seq = request_seq;
+        }
+        if (seq != served.load(std::memory_order_relaxed)) {
+            unpark(order.data(), count);
+            served.store(seq, std::memory_order_release);
+        }
+
+        collect();
+    }
+}
+
+void
+LazyEffects::swap_in() noexcept
+{
+    for (int i = 0; i < kCount; i++) {
+        const int type = kParkable[i];
+
+        // Each swap retires one instance. With no room for it left in the
+        // ring, the staged one waits a period for the worker to empty it,
+        // rather than leak or free on the audio thread.
+        if (retired.space() == 0)
+            return;
+        if (Effect *full = staged_full[i].exchange(nullptr, std::memory_order_acq_rel)) {
+            parked_efx[i].store(nullptr);
+            (void) retired.push(rkr.Swap_Effect(type, full));
+        }
+
+        if (retired.space() == 0)
+            return;
+        if (Effect *park = staged_park[i].exchange(nullptr, std::memory_order_acq_rel)) {
+            // Install first, then look at `uses`; unpark() does the opposite,
+            // so one of the two always sees the other.
+            Effect *old = rkr.Swap_Effect(type, park);
+            parked_efx[i].store(park);
+            if ((uses[i].load() != park_uses[i].load()) || in_chain(type)) {
+                rkr.Swap_Effect(type, old);
+                parked_efx[i].store(nullptr);
+                old = park;
+            }
+            (void) retired.push(old);
+        }
+    }
+}
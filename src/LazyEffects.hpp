@@ -0,0 +1,162 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  LazyEffects.hpp - Full size instances only for effects that are in use.
+
+  Convolotron, Looper, Reverbtron and Echotron size their buffers for
+  seconds of audio, several megabytes between them, yet a preset rarely
+  uses any of them. With "Lazy Effects" on, RKR builds these four "parked":
+  the same class, holding and reporting the same parameters, but with
+  buffers a fraction of a second long. Parked instances are never run; MIDI,
+  the GUI and preset files talk to them as to any other effect.
+
+  Before an order that contains a parked effect is published, unpark()
+  builds the full size instance off the audio thread and copies the
+  parameters across; the audio thread swaps it in at the start of the next
+  period, ahead of the chain. The GUI hands the order to request() instead,
+  which does the same on a worker thread, and publishes the order once
+  unparked() says so. The worker also frees the instances the audio thread
+  swapped out and, with "Release Unused Effects" set, parks effects again
+  once they have been out of the chain for that many seconds. Looper is
+  only ever unparked: its recorded loop has to survive.
+
+  Every other effect keeps a single instance built by the RKR constructor;
+  MIDI, file and GUI code reach them through the efx_* members directly.
+  Instances swapped out here or by PresetSwitcher are only freed under
+  hold(), so code off the audio thread holds it while it dereferences an
+  efx_* member.
+
+  Usage:
+    Any thread but RT:  lazy.unpark(order, n);
+    GUI thread:         t = lazy.request(order, n);  ...  if (lazy.unparked(t)) ...
+    RT (Alg):           lazy.swap_in();
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include "RingBuffer.hpp"
+#include "dsp_constants.hpp"
+
+class RKR;
+class Effect;
+
+class LazyEffects
+{
+public:
+    explicit LazyEffects(RKR &rkr);
+    ~LazyEffects();
+
+    LazyEffects(const LazyEffects&) = delete;
+    LazyEffects& operator=(const LazyEffects&) = delete;
+
+    /// Buffer length of a parked instance, seconds.
+    static constexpr float kParkedLength = 0.1f;
+
+    /// Effect types that have a parked form.
+    [[nodiscard]] static bool parkable(int type) noexcept;
+
+    /// Called by the RKR constructor once the effects exist. Records which
+    /// instances were built parked and starts the worker.
+    void init();
+
+    [[nodiscard]] bool parked(int type) const noexcept;
+
+    /// Make sure every effect in order[0..count) is full size by the time
+    /// the audio thread next runs the chain. Not on the RT thread; blocks
+    /// while impulse and delay files load.
+    void unpark(const int *order, int count);
+
+    /// unpark() on the worker thread, for callers that must not block.
+    /// Returns a ticket for unparked(), or 0 when nothing had to be built
+    /// and the order can be published at once. A newer request replaces
+    /// one the worker has not started on.
+    [[nodiscard]] std::uint64_t request(const int *order, int count);
+
+    /// The request() that returned ticket is done.
+    [[nodiscard]] bool unparked(std::uint64_t ticket) const noexcept
+    {
+        return served.load(std::memory_order_acquire) >= ticket;
+    }
+
+    /// RT thread, at the start of Alg(). Pointer moves only.
+    void swap_in() noexcept;
+
+    /// Keeps every live effect instance alive until released. Not on the
+    /// RT thread.
+    [[nodiscard]] std::unique_lock<std::mutex> hold()
+    {
+        return std::unique_lock<std::mutex>(mutex);
+    }
+
+    int enabled{1};         ///< Build the heavy effects parked
+    int release_time{0};    ///< Seconds out of the chain before parking again, 0 = never
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kParkable[] = {29, 30, 40, 41};
+    static constexpr int kCount = 4;
+
+    // How often the worker frees and parks when nothing wakes it
+    static constexpr std::chrono::milliseconds kCollectInterval{250};
+
+    // What an instance is rebuilt from, read from the live one under the
+    // mutex so the slow part (allocation, file loads) can run outside it.
+    struct Snapshot {
+        int type{-1};
+        int preset{0};
+        std::array<int, 16> pars{};
+        std::array<char, 128> file{};
+    };
+
+    static int index_of(int type) noexcept;
+
+    Snapshot snapshot(int type);
+    std::unique_ptr<Effect> rebuild(const Snapshot &from, bool park);
+    void stage(std::atomic<Effect *> &slot, std::unique_ptr<Effect> efx);
+    void free_retired();
+    void collect();
+    void work();
+    bool in_chain(int type) const noexcept;
+
+    RKR &rkr;
+
+    // Non-RT callers: GUI thread, PresetSwitcher worker; see hold()
+    std::mutex mutex;
+    std::array<Clock::time_point, kCount> last_used{};
+
+    // Non-RT → RT: prepared instances, full size and parked. A parked one
+    // carries the use count it was prepared at; if unpark() has seen the
+    // effect since, the audio thread drops it.
+    std::array<std::atomic<Effect *>, kCount> staged_full{};
+    std::array<std::atomic<Effect *>, kCount> staged_park{};
+    std::array<std::atomic<unsigned int>, kCount> park_uses{};
+    std::array<std::atomic<unsigned int>, kCount> uses{};
+
+    // The live instance while it is parked. Only compared, never
+    // dereferenced: PresetSwitcher may replace and free it.
+    std::array<std::atomic<Effect *>, kCount> parked_efx{};
+
+    // RT → non-RT: swapped out instances
+    RingBuffer<Effect *, 16> retired;
+
+    // request() → worker: the latest order to unpark
+    std::mutex request_mutex;
+    std::array<int, MAX_EFFECT_SLOTS> request_order{};
+    int request_count{0};
+    std::uint64_t request_seq{0};
+    std::atomic<std::uint64_t> served{0};
+
+    std::counting_semaphore<> wake{0};
+    std::atomic<bool> quit{false};
+    std::thread worker;
+};
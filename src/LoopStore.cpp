@@ -0,0 +1,417 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  LoopStore.cpp - Disk backed sample store for a Looper track.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "LoopStore.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// The file is mapped kSegment chunks at a time, as the recording reaches them.
+static constexpr int kSegment = 64;
+static constexpr std::size_t kChunkBytes = sizeof(float) * 2 * LoopStore::kChunk;
+static constexpr std::size_t kSegmentBytes = kChunkBytes * kSegment;
+
+struct LoopStore::Segment
+{
+    float *data{nullptr};
+    void *map{nullptr};         // file mapping handle, Windows only
+};
+
+// Extend fs to hold segment seg and map it.
+static bool
+map_segment(FILE *fs, int seg, float *&data, void *&handle)
+{
+    const unsigned long long offset = (unsigned long long) seg * kSegmentBytes;
+    const unsigned long long end = offset + kSegmentBytes;
+    handle = nullptr;
+#ifdef _WIN32
+    HANDLE h = (HANDLE) _get_osfhandle(_fileno(fs));
+    HANDLE map = CreateFileMappingW(h, nullptr, PAGE_READWRITE,
+                                    (DWORD) (end >> 32), (DWORD) end, nullptr);
+    if (!map)
+        return false;
+    void *p = MapViewOfFile(map, FILE_MAP_ALL_ACCESS,
+                            (DWORD) (offset >> 32), (DWORD) offset, kSegmentBytes);
+    if (!p) {
+        CloseHandle(map);
+        return false;
+    }
+    handle = map;
+#else
+    const int fd = fileno(fs);
+    if (ftruncate(fd, (off_t) end) != 0)
+        return false;
+    void *p = mmap(nullptr, kSegmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t) offset);
+    if (p == MAP_FAILED)
+        return false;
+#endif
+    data = static_cast<float *>(p);
+    return true;
+}
+
+static void
+unmap_segment(float *data, void *handle)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE) handle);
+#else
+    (void) handle;
+    munmap(data, kSegmentBytes);
+#endif
+}
+
+LoopStore::LoopStore(int frames_, bool threaded_)
+    : frames(std::clamp(frames_, 1, kMaxFrames))
+{
+    nchunks = (frames + kChunk - 1) >> kShift;
+    const int nslots = std::min(nchunks, kSlots);
+
+    // A loop that fits in memory stays there and needs no worker.
+    threaded = threaded_ && nchunks > nslots;
+
+    arena.resize((std::size_t) nslots * 2 * kChunk);
+    slots.resize(nslots);
+    table = std::make_unique<std::atomic<int>[]>(nchunks);
+    stored.resize(nchunks, 0);
+
+    for (int c = 0; c < nchunks; c++)
+        table[c].store(-1, std::memory_order_relaxed);
+
+    // Start with the first chunks in memory, silent
+    for (int s = 0; s < nslots; s++) {
+        slots[s].data = arena.data() + (std::size_t) s * 2 * kChunk;
+        slots[s].chunk = s;
+        table[s].store(s, std::memory_order_relaxed);
+    }
+
+    if (threaded)
+        worker = std::thread(&LoopStore::work, this);
+}
+
+LoopStore::~LoopStore()
+{
+    if (worker.joinable()) {
+        quit.store(true, std::memory_order_release);
+        wake.release();
+        worker.join();
+    }
+
+    for (Segment &seg : segments)
+        unmap_segment(seg.data, seg.map);
+    if (file)
+        fclose(file);
+}
+
+void
+LoopStore::begin() noexcept
+{
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+void
+LoopStore::end(int head_, int rvhead_, int length_) noexcept
+{
+    epoch.fetch_add(1, std::memory_order_release);
+
+    if (nchunks <= (int) slots.size())
+        return;
+
+    // The worker has work when a head enters another chunk
+    const int h = head_ >> kShift, rv = rvhead_ >> kShift;
+    if (h == lasthead && rv == lastrv && length_ == lastlength)
+        return;
+    lasthead = h;
+    lastrv = rv;
+    lastlength = length_;
+
+    head.store(head_, std::memory_order_relaxed);
+    rvhead.store(rvhead_, std::memory_order_relaxed);
+    length.store(length_, std::memory_order_relaxed);
+
+    if (!threaded)
+        service();
+    else if (!pending.exchange(true, std::memory_order_acq_rel))
+        wake.release();
+}
+
+/*
+ * RT thread. The chunk table entry is loaded after begin() marked the
+ * period as running, so the worker either sees the period and waits for
+ * it, or took the chunk out of the table before this load.
+ */
+float *
+LoopStore::chunk(int c, bool write) noexcept
+{
+    if (c >= nchunks)
+        return nullptr;
+    const int s = table[c].load(std::memory_order_seq_cst);
+    if (s < 0)
+        return nullptr;
+
+    Slot &slot = slots[s];
+    const unsigned g = gen.load(std::memory_order_acquire);
+    if (slot.gen != g) {	//cleared since it was loaded
+        std::fill_n(slot.data, 2 * kChunk, 0.0f);
+        slot.gen = g;
+        slot.dirty = false;
+    }
+    slot.dirty |= write;
+    return slot.data;
+}
+
+void
+LoopStore::clear() noexcept
+{
+    gen.fetch_add(1, std::memory_order_acq_rel);
+}
+
+// Forget what the file holds once the track was cleared.
+void
+LoopStore::sync_gen()
+{
+    const unsigned g = gen.load(std::memory_order_acquire);
+    if (g == seen)
+        return;
+    std::fill(stored.begin(), stored.end(), 0);
+    seen = g;
+}
+
+// Wait for the period running now, if any, to end.
+void
+LoopStore::wait_rt() const
+{
+    const unsigned e = epoch.load(std::memory_order_seq_cst);
+    if (!(e & 1))
+        return;
+    while (epoch.load(std::memory_order_acquire) == e)
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+}
+
+float *
+LoopStore::mapped(int c, bool grow)
+{
+    const int seg = c / kSegment;
+    while (seg >= (int) segments.size()) {
+        if (!grow || failed)
+            return nullptr;
+        if (!file)
+            file = tmpfile();
+
+        Segment next;
+        if (!file || !map_segment(file, (int) segments.size(), next.data, next.map)) {
+            fprintf(stderr, "Looper: cannot extend the loop file, audio that does not fit in memory is lost\n");
+            failed = true;
+            return nullptr;
+        }
+        segments.push_back(next);
+    }
+    return segments[seg].data + (std::size_t) (c % kSegment) * 2 * kChunk;
+}
+
+void
+LoopStore::writeback(int s)
+{
+    Slot &slot = slots[s];
+    sync_gen();
+    if (!slot.dirty || slot.gen != seen)
+        return;
+    if (float *dst = mapped(slot.chunk, true)) {
+        memcpy(dst, slot.data, kChunkBytes);
+        stored[slot.chunk] = 1;
+    }
+    slot.dirty = false;
+}
+
+void
+LoopStore::evict(int s)
+{
+    Slot &slot = slots[s];
+    table[slot.chunk].store(-1, std::memory_order_seq_cst);
+    wait_rt();
+    writeback(s);
+    slot.chunk = -1;
+}
+
+void
+LoopStore::load(int s, int c)
+{
+    Slot &slot = slots[s];
+    const float *src = stored[c] ? mapped(c, false) : nullptr;
+    if (src)
+        memcpy(slot.data, src, kChunkBytes);
+    else
+        std::fill_n(slot.data, 2 * kChunk, 0.0f);
+
+    slot.chunk = c;
+    slot.gen = seen;
+    slot.dirty = false;
+    table[c].store(s, std::memory_order_seq_cst);
+}
+
+/*
+ * Bring the chunks around the heads into memory, nearest first, in place
+ * of the ones wanted least recently.
+ */
+void
+LoopStore::service()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    sync_gen();
+
+    const unsigned missed = lost.load(std::memory_order_relaxed);
+    if (missed != reported) {
+        fprintf(stderr, "Looper: %u recorded frames lost, their chunk was not in memory yet\n",
+                missed - reported);
+        reported = missed;
+    }
+
+    const long long len = std::clamp(length.load(std::memory_order_relaxed), 1, frames);
+    const long long h = head.load(std::memory_order_relaxed);
+    const long long rv = rvhead.load(std::memory_order_relaxed);
+
+    int want[2 * kAhead + 4];
+    int nwant = 0;
+    auto add = [&] (long long pos) {
+        pos %= len;
+        if (pos < 0)
+            pos += len;
+        const int c = (int) (pos >> kShift);
+        if (std::find(want, want + nwant, c) == want + nwant)
+            want[nwant++] = c;
+    };
+    for (int i = 0; i <= kAhead; i++) {
+        add(h + (long long) i * kChunk);
+        add(rv - (long long) i * kChunk);
+    }
+    add(0);
+    add(len - 1);
+
+    tick++;
+    for (int k = 0; k < nwant; k++) {
+        const int s = table[want[k]].load(std::memory_order_relaxed);
+        if (s >= 0)
+            slots[s].used = tick;
+    }
+
+    const int nslots = (int) slots.size();
+    for (int k = 0; k < nwant; k++) {
+        const int c = want[k];
+        if (table[c].load(std::memory_order_relaxed) >= 0)
+            continue;
+
+        int victim = -1;
+        for (int s = 0; s < nslots; s++) {
+            if (slots[s].chunk < 0) {
+                victim = s;
+                break;
+            }
+            if (slots[s].used != tick && (victim < 0 || slots[s].used < slots[victim].used))
+                victim = s;
+        }
+        if (victim < 0)
+            break;
+
+        if (slots[victim].chunk >= 0)
+            evict(victim);
+        load(victim, c);
+        slots[victim].used = tick;
+    }
+}
+
+bool
+LoopStore::save(FILE *fs, int frames_)
+{
+    frames_ = std::clamp(frames_, 0, frames);
+    const int n = (frames_ + kChunk - 1) >> kShift;
+
+    // Write back what was recorded into the chunks in memory. They are out
+    // of the table, and silent, for about a period.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Slot &slot : slots)
+            if (slot.chunk >= 0)
+                table[slot.chunk].store(-1, std::memory_order_seq_cst);
+        wait_rt();
+        for (int s = 0; s < (int) slots.size(); s++)
+            if (slots[s].chunk >= 0) {
+                writeback(s);
+                table[slots[s].chunk].store(s, std::memory_order_seq_cst);
+            }
+    }
+
+    // A chunk at a time, so the worker keeps up meanwhile
+    std::vector<float> buf(2 * kChunk);
+    for (int c = 0; c < n; c++) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sync_gen();
+            const float *src = stored[c] ? mapped(c, false) : nullptr;
+            if (src)
+                memcpy(buf.data(), src, kChunkBytes);
+            else
+                std::fill(buf.begin(), buf.end(), 0.0f);
+        }
+        const int m = std::min(kChunk, frames_ - c * kChunk);
+        if (fwrite(buf.data(), sizeof(float) * 2, m, fs) != (std::size_t) m)
+            return false;
+    }
+    return true;
+}
+
+bool
+LoopStore::fill(FILE *fs, int frames_)
+{
+    frames_ = std::clamp(frames_, 1, frames);
+    const int n = (frames_ + kChunk - 1) >> kShift;
+    bool ok = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int c = 0; c < n && ok; c++) {
+            float *dst = mapped(c, true);
+            const int m = std::min(kChunk, frames_ - c * kChunk);
+            if (!dst || fread(dst, sizeof(float) * 2, m, fs) != (std::size_t) m)
+                ok = false;
+            stored[c] = dst != nullptr;
+        }
+
+        // The chunks in memory are the silent ones the constructor made
+        for (int s = 0; s < (int) slots.size(); s++)
+            load(s, slots[s].chunk);
+    }
+
+    head.store(0, std::memory_order_relaxed);
+    rvhead.store(frames_ - 1, std::memory_order_relaxed);
+    length.store(frames_, std::memory_order_relaxed);
+    if (nchunks > (int) slots.size())
+        service();
+    return ok;
+}
+
+void
+LoopStore::work()
+{
+    for (;;) {
+        wake.acquire();
+        if (quit.load(std::memory_order_acquire))
+            return;
+
+        pending.store(false, std::memory_order_seq_cst);
+        service();
+    }
+}
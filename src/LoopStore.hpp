@@ -0,0 +1,163 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  LoopStore.hpp - Disk backed sample store for a Looper track.
+
+  Looper kept each track in vectors as long as the longest loop allowed,
+  so the "Looper Size" setting both capped the loop and was committed as
+  RAM whether or not anything was recorded. LoopStore keeps a track in
+  chunks of kChunk stereo frames. Only up to kSlots of them are in memory,
+  in an arena allocated once; the rest live in a memory mapped temporary
+  file that grows with the recording. Loops that fit in the arena never
+  touch the disk.
+
+  The audio thread never waits on the disk. It finds a chunk through one
+  atomic load from the chunk table; a chunk that is not in memory reads as
+  silence and drops what is recorded into it; the worker logs how much was
+  dropped, and Looper reports it to the Looper panel. A worker thread keeps
+  the chunks around the heads in memory: the next kAhead chunks (1.4 s at
+  48 kHz) ahead of the play head and behind the reverse head, enough to
+  ride out a slow disk, and both ends of the loop, which
+  the heads jump to. To make room it takes a chunk out of the table, waits
+  for the period that may still hold it to end, writes it to the file if
+  it was recorded into, and loads the wanted chunk in its place.
+
+  Usage:
+    RT:      begin();  frame(cursor, pos) for each sample;  dropped(n);
+             end(head, rvhead, length);  clear() (any thread)
+    Not RT:  save(fs, frames);  fill(fs, frames) before the store is used
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+class LoopStore
+{
+public:
+    static constexpr int kShift = 14;
+    static constexpr int kChunk = 1 << kShift;   ///< Frames per chunk
+    static constexpr int kSlots = 16;            ///< Most chunks in memory
+    static constexpr int kAhead = 4;             ///< Chunks read ahead of each head
+    static constexpr int kMaxFrames = 1 << 30;   ///< Longest track
+    static_assert(2 * (kAhead + 1) + 2 <= kSlots, "the chunks service() wants must fit");
+
+    /// Chunk a run of frame() calls is in. Declare one per head, once per
+    /// period, so no chunk is held past end().
+    struct Cursor
+    {
+        bool write{false};      ///< Frames are recorded into
+        int chunk{-1};
+        float *data{nullptr};
+    };
+
+    /// @param frames    Longest loop, up to kMaxFrames.
+    /// @param threaded  With false (offline rendering) end() moves chunks itself.
+    LoopStore(int frames, bool threaded = true);
+    ~LoopStore();
+
+    LoopStore(const LoopStore&) = delete;
+    LoopStore& operator=(const LoopStore&) = delete;
+
+    /// RT. Start of a period, before any frame().
+    void begin() noexcept;
+
+    /// RT. End of a period. head plays forward, rvhead backward, in a loop
+    /// of length frames.
+    void end(int head, int rvhead, int length) noexcept;
+
+    /// RT. Frame pos of the track, left and right, or nullptr while its
+    /// chunk is not in memory.
+    inline float *frame(Cursor &at, int pos) noexcept
+    {
+        const int c = pos >> kShift;
+        if (c != at.chunk) {
+            at.chunk = c;
+            at.data = chunk(c, at.write);
+        }
+        return at.data ? at.data + 2 * (pos & (kChunk - 1)) : nullptr;
+    }
+
+    /// RT. Count n frames recorded while frame() returned nullptr; the
+    /// worker logs them.
+    void dropped(int n) noexcept
+    {
+        if (n)
+            lost.fetch_add((unsigned) n, std::memory_order_relaxed);
+    }
+
+    /// Erase the track. Never blocks.
+    void clear() noexcept;
+
+    /// Not RT. Write frames frames of the track to fs, left and right
+    /// interleaved. Chunks in memory are taken out of the table for a
+    /// period to be written back first.
+    bool save(FILE *fs, int frames);
+
+    /// Not RT, before the store is first used. Read the track from fs as
+    /// save() wrote it, and load the chunks a loop of that length starts
+    /// with.
+    bool fill(FILE *fs, int frames);
+
+    [[nodiscard]] int size() const noexcept { return frames; }
+
+private:
+    struct Slot
+    {
+        float *data{nullptr};
+        int chunk{-1};
+        unsigned gen{0};        // clear() count the contents belong to
+        bool dirty{false};      // recorded into since it was loaded
+        unsigned used{0};       // last service() that wanted it
+    };
+    struct Segment;
+
+    float *chunk(int c, bool write) noexcept;
+
+    // The rest run off the RT thread, holding mutex.
+    void service();
+    void sync_gen();
+    void wait_rt() const;
+    void evict(int s);
+    void load(int s, int c);
+    void writeback(int s);
+    float *mapped(int c, bool grow);
+    void work();
+
+    int frames;
+    int nchunks;
+    bool threaded;
+
+    std::vector<float> arena;
+    std::vector<Slot> slots;
+    std::unique_ptr<std::atomic<int>[]> table;     // chunk → slot, -1 if not in memory
+
+    // RT → worker
+    std::atomic<unsigned> gen{0};
+    std::atomic<unsigned> epoch{0};     // odd while a period is running
+    std::atomic<int> head{0}, rvhead{0}, length{1};
+    std::atomic<bool> pending{false};
+    std::atomic<unsigned> lost{0};
+    int lasthead{-1}, lastrv{-1}, lastlength{-1};
+
+    // Worker side
+    std::mutex mutex;
+    unsigned seen{0};                   // gen the stored flags belong to
+    unsigned tick{0};
+    unsigned reported{0};               // lost frames logged so far
+    std::vector<char> stored;           // chunk has contents in the file
+    std::vector<Segment> segments;
+    FILE *file{nullptr};
+    bool failed{false};
+
+    std::counting_semaphore<> wake{0};
+    std::atomic<bool> quit{false};
+    std::thread worker;
+};
@@ -23,11 +23,27 @@
 
 */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <cmath>
 #include "Looper.hpp"
 #include "FPreset.hpp"
+#include "portable_crt.hpp"
+
+/*
+ * A session file: kLoopMagic, the sample rate and the length of each
+ * track (0 if it was never recorded) as 32 bit ints, then the frames of
+ * track 1 and of track 2, left and right interleaved.
+ */
+static const char kLoopMagic[8] = {'R', 'K', 'R', 'L', 'O', 'O', 'P', '1'};
+
+struct Looper::LoopSession : LoadedFile {
+    std::unique_ptr<LoopStore> track1, track2;
+    int length1{0}, length2{0};
+};
 
 Looper::Looper (float size)
 {
@@ -50,13 +66,12 @@ Looper::Looper (float size)
     ticker.cleanup();
 
     Srate_Attack_Coeff = 1.0f / (fSAMPLE_RATE * ATTACK);
-    maxx_delay = lrintf(fSAMPLE_RATE * size);
+    maxx_delay = lrintf(std::min(fSAMPLE_RATE * size, (float) LoopStore::kMaxFrames));
     fade = (int) SAMPLE_RATE / 2;    //1/2 SR fade time available
 
-    ldelay.resize(maxx_delay);
-    rdelay.resize(maxx_delay);
-    t2ldelay.resize(maxx_delay);
-    t2rdelay.resize(maxx_delay);
+    track1 = std::make_unique<LoopStore>(maxx_delay, !offline);
+    track2 = std::make_unique<LoopStore>(maxx_delay, !offline);
+    loader = std::make_unique<FileLoader>([this] (const FileRequest &req) { return readloop (req); }, !offline);
 
     setpreset (Ppreset);
     cleanup ();
@@ -70,28 +85,19 @@ Looper::~Looper () = default;
 void
 Looper::cleanuppt1 ()
 {
-    int i;
-    for (i = 0; i < maxx_delay; i++) {
-        ldelay[i] = 0.0f;
-        rdelay[i] = 0.0f;
-    }
-
+    track1->clear ();
 };
 void
 Looper::cleanuppt2 ()
 {
-    int i;
-    for (i = 0; i < maxx_delay; i++) {
-        t2ldelay[i] = 0.0f;
-        t2rdelay[i] = 0.0f;
-    }
-
+    track2->clear ();
 };
 
 void Looper::cleanup ()
 {
     cleanuppt1 ();
     cleanuppt2 ();
+    lostframes = 0;
 
 };
 /*
@@ -128,23 +134,44 @@ Looper::out (float * smpsl, float * smpsr)
 {
     int i;
     float rswell, lswell;
+    const float silent[2] = {0.0f, 0.0f};
+    const float *t1, *t2;
+
+    takeloop ();
+
     ticktock.resize(PERIOD);
     if ((Pmetro) && (Pplay) && (!Pstop))
     {
         ticker.metronomeout(ticktock.data());
     }
 
+    //Chunks of the tracks at the heads. A frame not in memory yet plays silence.
+    LoopStore::Cursor at1{(Precord) && (Prec1) && (PT1)}, at2{(Precord) && (Prec2) && (PT2)};
+    LoopStore::Cursor rv1, rv2;
+    int lost1 = 0, lost2 = 0;
+    track1->begin ();
+    track2->begin ();
+
     for (i = 0; i < PERIOD; i++) {
 
         if((Pplay) && (!Pstop)) {
             if(Precord) {
+                float *f;
                 if((Prec1) && (PT1)) {
-                    ldelay[kl] += pregain1*smpsl[i];
-                    rdelay[kl] += pregain1*smpsr[i];
+                    if((f = track1->frame(at1, kl))) {
+                        f[0] += pregain1*smpsl[i];
+                        f[1] += pregain1*smpsr[i];
+                    } else {
+                        lost1++;
+                    }
                 }
                 if((Prec2) && (PT2)) {
-                    t2ldelay[kl2] += pregain2*smpsl[i];
-                    t2rdelay[kl2] += pregain2*smpsr[i];
+                    if((f = track2->frame(at2, kl2))) {
+                        f[0] += pregain2*smpsl[i];
+                        f[1] += pregain2*smpsr[i];
+                    } else {
+                        lost2++;
+                    }
                 }
 
             }
@@ -162,27 +189,31 @@ Looper::out (float * smpsl, float * smpsr)
             }
 
             if(Preverse) {
+                if (!(t1 = track1->frame(rv1, rvkl))) t1 = silent;
+                if (!(t2 = track2->frame(rv2, rvkl2))) t2 = silent;
 
                 lswell =	(float)(abs(kl - rvkl)) * Srate_Attack_Coeff;
                 if (lswell <= PI) {
                     lswell = 0.5f * (1.0f - cosf(lswell));  //Clickless transition
-                    smpsl[i] = (fade1 * ldelay[rvkl] + fade2 * t2ldelay[rvkl2]) * lswell;   //Volume ducking near zero crossing.
+                    smpsl[i] = (fade1 * t1[0] + fade2 * t2[0]) * lswell;   //Volume ducking near zero crossing.
                 } else {
-                    smpsl[i] = fade1 * ldelay[rvkl] + fade2 * t2ldelay[rvkl2];
+                    smpsl[i] = fade1 * t1[0] + fade2 * t2[0];
                 }
 
                 rswell = 	(float)(abs(kl - rvkl)) * Srate_Attack_Coeff;
                 if (rswell <= PI) {
                     rswell = 0.5f * (1.0f - cosf(rswell));   //Clickless transition
-                    smpsr[i] = ( fade1 * rdelay[rvkl] + fade2 * t2rdelay[rvkl2] )* rswell;  //Volume ducking near zero crossing.
+                    smpsr[i] = ( fade1 * t1[1] + fade2 * t2[1] )* rswell;  //Volume ducking near zero crossing.
                 } else {
-                    smpsr[i] = fade1 * rdelay[rvkl] + fade2 * t2rdelay[rvkl2];
+                    smpsr[i] = fade1 * t1[1] + fade2 * t2[1];
                 }
 
             } else {
+                if (!(t1 = track1->frame(at1, kl))) t1 = silent;
+                if (!(t2 = track2->frame(at2, kl2))) t2 = silent;
 
-                smpsl[i]= fade1*ldelay[kl] + fade2*t2ldelay[kl2];
-                smpsr[i]= fade1*rdelay[kl] + fade2*t2rdelay[kl2];
+                smpsl[i]= fade1*t1[0] + fade2*t2[0];
+                smpsr[i]= fade1*t1[1] + fade2*t2[1];
 
             }
 
@@ -196,6 +227,119 @@ Looper::out (float * smpsl, float * smpsr)
             smpsr[i] += ticktock[i] * mvol;
         }
     }
+
+    track1->dropped (lost1);
+    track2->dropped (lost2);
+    lostframes += (unsigned) (lost1 + lost2);
+    track1->end (kl, rvkl, dl);
+    track2->end (kl2, rvkl2, dl2);
+}
+
+
+/*
+ * RT thread. Put a session read by loadloop() in place, stopped.
+ */
+void
+Looper::takeloop ()
+{
+    if (held)
+        return;	//saveloop() is reading the tracks
+    LoopSession *session = static_cast<LoopSession *>(loader->take());
+    if (!session)
+        return;
+
+    if (session->found) {
+        track1.swap (session->track1);
+        track2.swap (session->track2);
+
+        first_time1 = (session->length1 == 0);
+        first_time2 = (session->length2 == 0);
+        dl = first_time1 ? maxx_delay : session->length1;
+        dl2 = first_time2 ? maxx_delay : session->length2;
+        kl = 0;
+        kl2 = 0;
+        rvkl = dl - 1;
+        rvkl2 = dl2 - 1;
+        Srate_Attack_Coeff = 90.0f / (dl + dl2);   // Set swell time
+
+        Precord = 0;
+        Pplay = 0;
+        Pstop = 1;
+        Pclear = 0;
+        ticker.cleanup();
+        getstate();
+    }
+    loader->retire(session);	//the tracks swapped out go with it
+}
+
+void
+Looper::loadloop (const char *filename)
+{
+    FileRequest req;
+    req.user = 1;
+    snprintf(req.name.data(), req.name.size(), "%s", filename);
+    loader->request(req);
+}
+
+void
+Looper::waitloop ()
+{
+    loader->wait();
+    takeloop();
+}
+
+std::unique_ptr<LoadedFile>
+Looper::readloop (const FileRequest &req) const
+{
+    auto session = std::make_unique<LoopSession>();
+    session->found = false;
+
+    FILE *fs = rkr::portable_fopen (req.name.data(), "rb");
+    if (!fs)
+        return session;
+
+    char magic[sizeof(kLoopMagic)];
+    std::int32_t head[3];
+    if (fread(magic, sizeof(magic), 1, fs) != 1 || memcmp(magic, kLoopMagic, sizeof(magic))
+            || fread(head, sizeof(head), 1, fs) != 1 || head[0] != (std::int32_t) SAMPLE_RATE
+            || head[1] < 0 || head[1] > maxx_delay || head[2] < 0 || head[2] > maxx_delay) {
+        fclose(fs);
+        return session;
+    }
+
+    session->track1 = std::make_unique<LoopStore>(maxx_delay, !offline);
+    session->track2 = std::make_unique<LoopStore>(maxx_delay, !offline);
+    session->length1 = head[1];
+    session->length2 = head[2];
+    session->found = (!head[1] || session->track1->fill(fs, head[1]))
+                     && (!head[2] || session->track2->fill(fs, head[2]));
+    fclose(fs);
+    return session;
+}
+
+void
+Looper::holdloop (bool hold)
+{
+    held = hold;
+    if (hold) {
+        held_len1 = first_time1 ? 0 : std::min(dl, maxx_delay);
+        held_len2 = first_time2 ? 0 : std::min(dl2, maxx_delay);
+    }
+}
+
+bool
+Looper::saveloop (const char *filename)
+{
+    FILE *fs = rkr::portable_fopen (filename, "wb");
+    if (!fs)
+        return false;
+
+    const std::int32_t head[3] = {(std::int32_t) SAMPLE_RATE, held_len1, held_len2};
+    bool ok = fwrite(kLoopMagic, sizeof(kLoopMagic), 1, fs) == 1
+              && fwrite(head, sizeof(head), 1, fs) == 1
+              && track1->save(fs, head[1])
+              && track2->save(fs, head[2]);
+    return (fclose(fs) == 0) && ok;
 }
 
 
@@ -309,11 +453,29 @@ void Looper::setfade ()
     fade1 *= track1gain;
     fade2 *= track2gain;
 };
+
+// The built in presets. They are loaded through loadpreset(), which leaves
+// the transport alone; user presets after them go through changepar().
+static const int NUM_PRESETS = 2;
+
 void
 Looper::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    if (npreset > NUM_PRESETS - 1) {
+        apply (changes);
+    } else {
+        for (const auto &[npar, value] : changes)
+            loadpreset (npar, value);
+    }
+    Ppreset = npreset;
+};
+
+void
+Looper::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 14;
-    const int NUM_PRESETS = 2;
     int presets[NUM_PRESETS][PRESET_SIZE] = {
         //Looper 2 seconds
         {64, 0, 1, 0, 1, 0, 64, 1, 0, 1, 64, 1, 0, 0},
@@ -323,13 +485,12 @@ Looper::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(30,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            loadpreset (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
@@ -26,9 +26,12 @@
 #ifndef LOOPER_H
 #define LOOPER_H
 
+#include <memory>
 #include "dsp_constants.hpp"
 #include "metronome.hpp"
 #include "Effect.hpp"
+#include "FileLoader.hpp"
+#include "LoopStore.hpp"
 
 class Looper : public Effect
 {
@@ -37,6 +40,7 @@ public:
     ~Looper ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void loadpreset (int npar, int value);  // to set one from a preset
     void changepar (int npar, int value);
     int getpar (int npar);
@@ -51,6 +55,21 @@ public:
 
     void getstate ();
 
+    /// RT thread. While held, note the track lengths for saveloop() and keep
+    /// the tracks in place; a loaded session waits until let go.
+    void holdloop (bool hold);
+    /// Not on the RT thread, between holdloop(true) and holdloop(false).
+    /// Write both tracks and their lengths to a session file. False if it
+    /// could not be written.
+    bool saveloop (const char *filename);
+    /// Read a session file in the background; out() puts it in place,
+    /// stopped at the start of the loop.
+    void loadloop (const char *filename);
+    /// Not on the RT thread: wait for the session asked for last.
+    void waitloop ();
+    /// RT thread. Frames recorded while their chunk was not in memory
+    /// yet, since the tracks were last erased.
+    unsigned dropped () const { return lostframes; }
 
 
     int Pplay;	//set to 1
@@ -65,6 +84,8 @@ private:
     void timeposition(int value);
     int set_len(int value);
     int cal_len(int value);
+    void takeloop ();
+    std::unique_ptr<LoadedFile> readloop (const FileRequest &req) const;
 
 
 
@@ -89,8 +110,13 @@ private:
     int kl, kl2, rvkl, rvkl2, maxx_delay, fade, dl, dl2, first_time1, first_time2, rplaystate;
     int barlen, looper_ts;
 
-    std::vector<float> ldelay, rdelay;
-    std::vector<float> t2ldelay, t2rdelay;
+    std::unique_ptr<LoopStore> track1, track2;	//left and right interleaved
+    bool held{false};
+    int held_len1{0}, held_len2{0};	//set by holdloop() for saveloop()
+    unsigned lostframes{0};
+
+    struct LoopSession;
+    std::unique_ptr<FileLoader> loader;
 
     float oldl, oldr;		//pt. lpf
 
@@ -34,7 +34,7 @@
 
 
 
-MBDist::MBDist ()
+MBDist::MBDist (int oversample)
 {
     lowl.resize(PERIOD);
     lowr.resize(PERIOD);
@@ -58,13 +58,13 @@ MBDist::MBDist ()
     DCr->setfreq (30.0f);
 
 
-    mbwshape1l = std::make_unique<Waveshaper>();
-    mbwshape2l = std::make_unique<Waveshaper>();
-    mbwshape3l = std::make_unique<Waveshaper>();
+    mbwshape1l = std::make_unique<Waveshaper>(oversample);
+    mbwshape2l = std::make_unique<Waveshaper>(oversample);
+    mbwshape3l = std::make_unique<Waveshaper>(oversample);
 
-    mbwshape1r = std::make_unique<Waveshaper>();
-    mbwshape2r = std::make_unique<Waveshaper>();
-    mbwshape3r = std::make_unique<Waveshaper>();
+    mbwshape1r = std::make_unique<Waveshaper>(oversample);
+    mbwshape2r = std::make_unique<Waveshaper>(oversample);
+    mbwshape3r = std::make_unique<Waveshaper>(oversample);
 
     //default values
     Ppreset = 0;
@@ -245,6 +245,15 @@ MBDist::setCross2 (int value)
 
 void
 MBDist::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+MBDist::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 15;
     const int NUM_PRESETS = 8;
@@ -270,14 +279,13 @@ MBDist::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(23,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 };
 
 
@@ -34,10 +34,12 @@
 class MBDist : public Effect
 {
 public:
-    MBDist ();
+    /// oversample as for Waveshaper
+    MBDist (int oversample = 0);
     ~MBDist ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -65,6 +65,7 @@ MBVvol::MBVvol ()
     Pvolume = 50;
     coeff = 1.0f / (float) PERIOD;
     volL=volLr=volML=volMLr=volMH=volMHr=volH=volHr=2.0f;
+    v1l=v1r=v2l=v2r=0.0f;
 
     setpreset (Ppreset);
     cleanup ();
@@ -318,6 +319,15 @@ MBVvol::setCross3 (int value)
 
 void
 MBVvol::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+MBVvol::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 11;
     const int NUM_PRESETS = 3;
@@ -333,14 +343,13 @@ MBVvol::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(28,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 };
 
 
@@ -0,0 +1,160 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  MultiTap.cpp - Delay line read by many taps a run of samples at a time.
+*/
+
+#include <algorithm>
+#include "MultiTap.hpp"
+#include "dsp_constants.hpp"
+
+// Per tap state of read(), one lane per tap. Fixed size members of a struct
+// reached through a reference, so the lane loops unroll and vectorize.
+struct MultiTap::lanes {
+    float avg[kLanes];          // smoothed tap time, seconds
+    float fract[4][kLanes];     // fractional delay of the last 4 reads
+    float last[4][kLanes];      // the last 4 samples read
+    int pos[kLanes];
+    float out[kBlock][kLanes];
+};
+
+MultiTap::MultiTap(int size_, int maxtaps, float maxtime_)
+    : size(size_), maxtime(maxtime_ > 0.0f ? maxtime_ : (float) size_)
+{
+    ring.resize(size);
+    if (maxtaps > 0)
+        taps = std::make_unique<lanes>();
+    cleanup();
+}
+
+MultiTap::~MultiTap() = default;
+
+void
+MultiTap::cleanup()
+{
+    std::fill(ring.begin(), ring.end(), 0.0f);
+    w = 0;
+    if (taps)
+        *taps = lanes{};
+    set_averaging(0.25f);
+}
+
+void
+MultiTap::set_averaging(float tc)
+{
+    float dt = 1.0f / fSAMPLE_RATE;
+    alpha = dt / (tc + dt);
+    beta = 1.0f - alpha;	//time change smoothing parameters
+}
+
+void
+MultiTap::sum(const int *time, const float *gain, int ntaps, float *out, int n) const
+{
+    for (int k = 0; k < ntaps; k++) {
+        const float g = gain[k];
+        int p = w - n - time[k];
+        while (p < 0)
+            p += size;
+
+        // The run is contiguous in the ring unless it wraps once
+        int m = std::min(n, size - p);
+        const float *src = ring.data() + p;
+        for (int i = 0; i < m; i++)
+            out[i] += src[i] * g;
+        src = ring.data();
+        for (int i = m; i < n; i++)
+            out[i] += src[i - m] * g;
+    }
+}
+
+int
+MultiTap::span(const float *time, int ntaps, float mod, float dmod, int n) const
+{
+    const lanes &L = *taps;
+    n = std::min(n, kBlock);
+
+    // Every smoothed time stays above the least of where it starts and the
+    // targets it moves toward during the run.
+    float least = std::min(mod + dmod, mod + dmod * (float) n);
+    float lo = L.avg[0];
+    for (int k = 0; k < ntaps; k++)
+        lo = std::min({lo, L.avg[k], time[k] + least});
+
+    // Sample i of the run reads floor(1 + rate * avg) - 1 samples before
+    // its own, which must not be one of samples 1..i. Keep a sample spare
+    // for rounding.
+    const float reach = fSAMPLE_RATE * lo;
+    if (!(reach >= 2.0f))
+        return 1;
+    return std::min(n, (int) std::min(reach, maxtime));
+}
+
+void
+MultiTap::read(const float *time, int ntaps, float &mod, float dmod, int n)
+{
+    lanes &L = *taps;
+    const float *buf = ring.data();
+    const float rate = fSAMPLE_RATE;
+    const float a = alpha, b = beta, top = maxtime;
+    const int len = size;
+
+    for (int i = 0; i < n; i++) {
+        mod += dmod;
+        const float m = mod;
+        const int base = w + i;
+
+        for (int k = 0; k < ntaps; k++) {
+            L.avg[k] = a * (time[k] + m) + b * L.avg[k];	//smoothing the rate of time change
+            float t = 1.0f + rate * L.avg[k];
+            t = t > top ? top : t;
+            t = t >= 0.0f ? t : 0.0f;	//and NaN, which would index far outside the ring
+
+            L.fract[3][k] = L.fract[2][k];
+            L.fract[2][k] = L.fract[1][k];
+            L.fract[1][k] = L.fract[0][k];
+            L.fract[0][k] = t;
+            L.pos[k] = (int) t;
+        }
+
+        // Split from the loop above, which gcc does not vectorize with the
+        // int round trip in it
+        for (int k = 0; k < ntaps; k++) {
+            L.fract[0][k] -= (float) L.pos[k];
+            int p = base - L.pos[k];
+            p = p < 0 ? p + len : p;
+            p = p >= len ? p - len : p;
+            L.pos[k] = p;
+        }
+
+        for (int k = 0; k < ntaps; k++) {
+            L.last[3][k] = L.last[2][k];
+            L.last[2][k] = L.last[1][k];
+            L.last[1][k] = L.last[0][k];
+            L.last[0][k] = buf[L.pos[k]];
+        }
+
+        float *out = L.out[i];
+        for (int k = 0; k < ntaps; k++) {
+            //order 4 Lagrange polynomial, factored as in delayline::lagrange()
+            const float x = 0.5f * (L.fract[1][k] + L.fract[2][k]);
+            const float c0p0 = -0.16666666667f * L.last[0][k];
+            const float c1p1 = 0.5f * L.last[1][k];
+            const float c2p2 = -0.5f * L.last[2][k];
+            const float c3p3 = 0.16666666667f * L.last[3][k];
+
+            const float a = c3p3 + c2p2 + c1p1 + c0p0;
+            const float b = -3.0f * c0p0 - L.last[1][k] - c2p2;
+            const float c = 2.0f * c0p0 - c1p1 + L.last[2][k] - c3p3;
+            const float d = L.last[1][k];
+
+            out[k] = ((a * x + b) * x + c) * x + d;
+        }
+    }
+}
+
+const float *
+MultiTap::tap(int i) const
+{
+    return taps->out[i];
+}
@@ -0,0 +1,98 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  MultiTap.hpp - Delay line read by many taps a run of samples at a time.
+
+  delayline::delay() serves one tap for one sample per call and keeps the
+  tap state in memory between calls, so a 128 tap Echotron file made 256
+  calls per sample, and Reverbtron walked up to 1500 taps through a bounds
+  check each. MultiTap reads every tap of a run of samples in one call:
+
+    sum()   Taps at whole sample times, weighted and summed. Each tap is a
+            contiguous run of the ring, so the multiply-add vectorizes
+            across samples (Reverbtron).
+    read()  Taps with the time smoothing and 4 point Lagrange interpolation
+            of delayline::delay() (with mix 0). The taps are lanes of one
+            loop, so the smoothing and interpolation vectorize across taps.
+            A modulation offset added to every tap time ramps linearly over
+            the run (Echotron).
+
+  Effects feed their output back into the line, so a run can only be as
+  long as the shortest delay: samples it reads must be written before it.
+
+  Usage:
+    RT, sum():   write() the n input samples of the run, sum(), then add()
+                 the feedback of each sample
+    RT, read():  write() the first input sample of the run, n = span(),
+                 read(), then write() the other n - 1 as their feedback is
+                 known, taking the taps of sample i from tap(i)
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+class MultiTap
+{
+public:
+    static constexpr int kLanes = 128;   ///< Most taps read() serves
+    static constexpr int kBlock = 32;    ///< Longest read() run
+
+    /// @param size     Samples kept.
+    /// @param maxtaps  Taps read() serves, up to kLanes; 0 if only sum() is used.
+    /// @param maxtime  Longest read() tap time in samples, size if 0.
+    MultiTap(int size, int maxtaps = 0, float maxtime = 0.0f);
+    ~MultiTap();
+
+    MultiTap(const MultiTap&) = delete;
+    MultiTap& operator=(const MultiTap&) = delete;
+
+    void cleanup();
+
+    /// Time constant of the read() tap time smoothing, in seconds.
+    void set_averaging(float tc);
+
+    inline void write(float x)
+    {
+        ring[w] = x;
+        if (++w == size)
+            w = 0;
+    }
+
+    /// Add x to the sample written `back` writes before the last one.
+    inline void add(int back, float x)
+    {
+        int p = w - 1 - back;
+        if (p < 0)
+            p += size;
+        ring[p] += x;
+    }
+
+    /// For the last n samples written, oldest first: out[i] += the sum of
+    /// gain[k] times the sample time[k] writes before sample i.
+    void sum(const int *time, const float *gain, int ntaps, float *out, int n) const;
+
+    /// How many samples, up to n, read() may cover without reading one that
+    /// is written during the run. The arguments are those of read().
+    int span(const float *time, int ntaps, float mod, float dmod, int n) const;
+
+    /// Read ntaps taps for n samples. Sample 0 is the last one written, the
+    /// rest are written after. Tap k of sample i is delayed by time[k] plus
+    /// mod, in seconds, where mod grows by dmod before each sample.
+    void read(const float *time, int ntaps, float &mod, float dmod, int n);
+
+    /// The taps of sample i of the last read().
+    const float *tap(int i) const;
+
+private:
+    int size;
+    int w{0};            // next sample written
+    float maxtime;
+    float alpha{}, beta{};
+    std::vector<float> ring;
+
+    struct lanes;
+    std::unique_ptr<lanes> taps;
+};
@@ -324,6 +324,15 @@ MusicDelay::settempo (int Ptempo)
 
 void
 MusicDelay::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+MusicDelay::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 13;
     const int NUM_PRESETS = 3;
@@ -338,13 +347,11 @@ MusicDelay::setpreset (int npreset)
 
         FPreset::ReadPreset(15,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = (int) npreset;
 };
 
 
@@ -33,7 +33,7 @@
  * Waveshape (this is called by OscilGen::waveshape and Distorsion::process)
  */
 
-NewDist::NewDist ()
+NewDist::NewDist (int oversample)
 {
     octoutl.resize(PERIOD);
     octoutr.resize(PERIOD);
@@ -46,8 +46,8 @@ NewDist::NewDist ()
     hpfr = std::make_unique<AnalogFilter>(3, 20.0f, 1.0f, 0);
     blockDCl = std::make_unique<AnalogFilter>(2, 75.0f, 1.0f, 0);
     blockDCr = std::make_unique<AnalogFilter>(2, 75.0f, 1.0f, 0);
-    wshapel = std::make_unique<Waveshaper>();
-    wshaper = std::make_unique<Waveshaper>();
+    wshapel = std::make_unique<Waveshaper>(oversample);
+    wshaper = std::make_unique<Waveshaper>(oversample);
 
     blockDCl->setfreq (75.0f);
     blockDCr->setfreq (75.0f);
@@ -131,10 +131,9 @@ NewDist::cleanup ()
 void
 NewDist::applyfilters (float * smpsl, float * smpsr)
 {
-    lpfl->filterout(smpsl);
-    hpfl->filterout(smpsl);
-    lpfr->filterout(smpsr);
-    hpfr->filterout(smpsr);
+    AnalogFilter *l[] = {lpfl.get(), hpfl.get()};
+    AnalogFilter *r[] = {lpfr.get(), hpfr.get()};
+    AnalogFilter::filterout_cascade (l, r, 2, smpsl, smpsr);
 
 };
 
@@ -292,6 +291,15 @@ NewDist::setoctave (int Poctave)
 
 void
 NewDist::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+NewDist::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 11;
     const int NUM_PRESETS = 3;
@@ -308,14 +316,12 @@ NewDist::setpreset (int npreset)
 
         FPreset::ReadPreset(17,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 };
 
 
@@ -39,10 +39,12 @@
 class NewDist : public Effect
 {
 public:
-    NewDist ();
+    /// oversample as for Waveshaper
+    NewDist (int oversample = 0);
     ~NewDist ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -0,0 +1,422 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  NonUniformConvolver.cpp - Zero-latency non-uniform partitioned convolution.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <fftw3.h>
+#include "FFTWPlanner.hpp"
+#include "NonUniformConvolver.hpp"
+#include "RingBuffer.hpp"
+
+namespace
+{
+// Each level uses partitions kGrowth times larger than the previous one.
+constexpr int kGrowth = 4;
+// Partitions never grow past this size, unless the first level already
+// does; the last level takes the rest.
+constexpr int kMaxPartition = 8192;
+
+/*
+ * The worker threads that run the level jobs of all convolvers. Only the RT
+ * thread posts, so the queue is a single producer ring; the workers take
+ * turns popping under a mutex. A job is short next to its deadline, so a few
+ * threads serve every instance.
+ */
+class LevelPool
+{
+public:
+    static LevelPool &get()
+    {
+        static LevelPool pool;
+        return pool;
+    }
+
+    /// RT thread. False if the queue is full.
+    bool post(NonUniformConvolver::Level *level) noexcept
+    {
+        if (!jobs.push(level))
+            return false;
+        wake.release();
+        return true;
+    }
+
+private:
+    LevelPool()
+    {
+        const unsigned n = std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+        for (unsigned i = 0; i < n; i++)
+            threads.emplace_back(&LevelPool::work, this);
+    }
+
+    ~LevelPool()
+    {
+        quit.store(true, std::memory_order_release);
+        wake.release((std::ptrdiff_t) threads.size());
+        for (std::thread &t : threads)
+            t.join();
+    }
+
+    void work();
+
+    RingBuffer<NonUniformConvolver::Level *, 256> jobs;
+    std::mutex popping;
+    std::counting_semaphore<> wake{0};
+    std::atomic<bool> quit{false};
+    std::vector<std::thread> threads;
+};
+}
+
+/*
+ * One segment of the impulse response, convolved with uniform partitions of
+ * `size` samples. The RT thread collects input into `acc`; every `size`
+ * samples it hands the block to the pool through `jobin` and picks up the
+ * previous result from `jobout`. `posted`/`finished` carry the block number
+ * of the last handed over / completed job, so the RT side can tell whether
+ * the job is done and whether its result belongs to the expected block.
+ */
+struct NonUniformConvolver::Level
+{
+    Level(int size, int offset, int maxparts, bool threaded);
+    ~Level();
+
+    void set_impulse(const std::vector<double> &spectra);
+    void cleanup();
+    bool boundary();
+    void run_job();
+    void push_spectrum(const float *block);
+
+    int size;
+    int offset;          // first IR sample covered by this level
+    int maxparts;
+    int fftsize;
+    int nbins;
+    bool threaded;
+    std::atomic<int> nparts{0};
+
+    // RT side
+    std::vector<float> acc;        // input block being collected
+    std::vector<float> cur;        // output block being read
+    int fill{0};
+    std::uint64_t blockno{1};
+
+    // Handed between RT and worker
+    std::vector<float> jobin;
+    std::vector<float> jobout;
+    std::atomic<std::uint64_t> posted{0};
+    std::atomic<std::uint64_t> finished{0};
+    std::atomic<bool> reset{false};
+
+    // Worker side
+    std::vector<float> prev;       // previous input block (overlap-save)
+    std::uint64_t lastseq{0};
+    int fdl_pos{0};
+    double *fft_real{};
+    fftw_complex *fft_spec{};
+    const fftw_complex *irspec{};  // nparts * nbins partition spectra, shared
+    fftw_complex *fdl{};           // maxparts * nbins input spectra
+    fftw_plan plan_forward{};
+    fftw_plan plan_inverse{};
+};
+
+NonUniformConvolver::Level::Level(int size_, int offset_, int maxparts_, bool threaded_)
+    : size(size_), offset(offset_), maxparts(maxparts_), threaded(threaded_)
+{
+    fftsize = 2 * size;
+    nbins = size + 1;
+
+    acc.resize(size, 0.0f);
+    cur.resize(size, 0.0f);
+    jobin.resize(size, 0.0f);
+    jobout.resize(size, 0.0f);
+    prev.resize(size, 0.0f);
+
+    fft_real = fftw_alloc_real(fftsize);
+    fft_spec = fftw_alloc_complex(nbins);
+    fdl = fftw_alloc_complex((size_t) maxparts * nbins);
+
+    // These run off the RT thread, so a quick estimate plan is good enough
+    // and keeps effect construction fast for the large sizes.
+    {
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+        plan_forward = fftw_plan_dft_r2c_1d(fftsize, fft_real, fft_spec, FFTW_ESTIMATE);
+        plan_inverse = fftw_plan_dft_c2r_1d(fftsize, fft_spec, fft_real, FFTW_ESTIMATE);
+    }
+
+    memset(fdl, 0, sizeof(fftw_complex) * maxparts * nbins);
+
+    if (threaded)
+        LevelPool::get();
+}
+
+NonUniformConvolver::Level::~Level()
+{
+    // A queued or running job still uses this level. finished is the last
+    // thing the job touches. Levels are freed on loader threads, not RT.
+    while (finished.load(std::memory_order_acquire) != posted.load(std::memory_order_relaxed))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    {
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+        fftw_destroy_plan(plan_forward);
+        fftw_destroy_plan(plan_inverse);
+    }
+    fftw_free(fft_real);
+    fftw_free(fft_spec);
+    fftw_free(fdl);
+}
+
+void
+NonUniformConvolver::Level::set_impulse(const std::vector<double> &spectra)
+{
+    const int parts = (int) (spectra.size() / ((std::size_t) nbins * 2));
+    irspec = reinterpret_cast<const fftw_complex *>(spectra.data());
+    nparts.store(std::min(parts, maxparts), std::memory_order_release);
+}
+
+void
+NonUniformConvolver::Level::cleanup()
+{
+    std::fill(acc.begin(), acc.end(), 0.0f);
+    std::fill(cur.begin(), cur.end(), 0.0f);
+    fill = 0;
+    reset.store(true, std::memory_order_release);
+}
+
+/*
+ * RT thread, called when `acc` holds a full block. Returns true if the
+ * worker missed its deadline.
+ */
+bool
+NonUniformConvolver::Level::boundary()
+{
+    const std::uint64_t done = finished.load(std::memory_order_acquire);
+    const bool idle = done == posted.load(std::memory_order_relaxed);
+    bool late = false;
+
+    // The output read during the next block comes from the block before.
+    if (idle && done == blockno - 1)
+        memcpy(cur.data(), jobout.data(), sizeof(float) * size);
+    else {
+        std::fill(cur.begin(), cur.end(), 0.0f);
+        late = !idle;
+    }
+
+    if (idle && nparts.load(std::memory_order_relaxed) > 0) {
+        memcpy(jobin.data(), acc.data(), sizeof(float) * size);
+        posted.store(blockno, std::memory_order_release);
+        if (!threaded)
+            run_job();
+        else if (!LevelPool::get().post(this)) {
+            // Nobody will run it, so this block counts as skipped.
+            posted.store(done, std::memory_order_relaxed);
+            late = true;
+        }
+    }
+
+    blockno++;
+    fill = 0;
+    return late;
+}
+
+void
+NonUniformConvolver::Level::push_spectrum(const float *block)
+{
+    for (int i = 0; i < size; i++) {
+        fft_real[i] = (double) prev[i];
+        fft_real[size + i] = block ? (double) block[i] : 0.0;
+    }
+    fftw_execute(plan_forward);
+    if (++fdl_pos >= maxparts) fdl_pos = 0;
+    memcpy(fdl + (size_t) fdl_pos * nbins, fft_spec, sizeof(fftw_complex) * nbins);
+
+    if (block)
+        memcpy(prev.data(), block, sizeof(float) * size);
+    else
+        std::fill(prev.begin(), prev.end(), 0.0f);
+}
+
+void
+NonUniformConvolver::Level::run_job()
+{
+    const std::uint64_t seq = posted.load(std::memory_order_acquire);
+
+    if (reset.exchange(false, std::memory_order_acq_rel))
+        lastseq = 0;
+
+    // Blocks the RT thread skipped (level idle or worker late) were silence
+    // as far as this level is concerned.
+    std::uint64_t gap = lastseq ? seq - lastseq - 1 : (std::uint64_t) maxparts;
+    if (gap >= (std::uint64_t) maxparts) {
+        std::fill(prev.begin(), prev.end(), 0.0f);
+        memset(fdl, 0, sizeof(fftw_complex) * maxparts * nbins);
+    } else {
+        for (std::uint64_t g = 0; g < gap; g++)
+            push_spectrum(nullptr);
+    }
+
+    push_spectrum(jobin.data());
+
+    memset(fft_spec, 0, sizeof(fftw_complex) * nbins);
+    const int np = nparts.load(std::memory_order_acquire);
+    int slot = fdl_pos;
+    for (int k = 0; k < np; k++) {
+        const fftw_complex *X = fdl + (size_t) slot * nbins;
+        const fftw_complex *H = irspec + (size_t) k * nbins;
+        for (int b = 0; b < nbins; b++) {
+            fft_spec[b][0] += X[b][0] * H[b][0] - X[b][1] * H[b][1];
+            fft_spec[b][1] += X[b][0] * H[b][1] + X[b][1] * H[b][0];
+        }
+        if (--slot < 0) slot = maxparts - 1;
+    }
+    fftw_execute(plan_inverse);
+
+    for (int i = 0; i < size; i++)
+        jobout[i] = (float) fft_real[size + i];
+
+    lastseq = seq;
+    finished.store(seq, std::memory_order_release);
+}
+
+void
+LevelPool::work()
+{
+    for (;;) {
+        wake.acquire();
+        if (quit.load(std::memory_order_acquire))
+            return;
+        NonUniformConvolver::Level *level;
+        {
+            std::lock_guard<std::mutex> lock(popping);
+            if (!jobs.pop(level))
+                continue;
+        }
+        level->run_job();
+    }
+}
+
+int
+NonUniformConvolver::head_length(int blocksize, int maxlength)
+{
+    return std::min(maxlength, 2 * kGrowth * blocksize);
+}
+
+/*
+ * Level k covers [2 * size, 2 * kGrowth * size), so its result is due one of
+ * its own blocks after the input block is complete.
+ */
+std::vector<NonUniformConvolver::Span>
+NonUniformConvolver::level_spans(int blocksize, int maxlength)
+{
+    std::vector<Span> spans;
+    int size = kGrowth * blocksize;
+    int offset = head_length(blocksize, maxlength);
+    while (offset < maxlength) {
+        bool last = size * kGrowth > std::max(kMaxPartition, kGrowth * blocksize);
+        int end = last ? maxlength : std::min(maxlength, 2 * kGrowth * size);
+        int parts = (end - offset + size - 1) / size;
+        spans.push_back({size, offset, parts});
+        offset += parts * size;
+        size *= kGrowth;
+    }
+    return spans;
+}
+
+NonUniformConvolver::NonUniformConvolver(int blocksize_, int maxlength, bool threaded)
+    : blocksize(blocksize_ > 0 ? blocksize_ : 1),
+      headmax(head_length(blocksize, maxlength)),
+      maxlen(0),
+      irlength(0),
+      pos(0),
+      head(blocksize, headmax)
+{
+    blockin.resize(blocksize, 0.0f);
+    levelout.resize(blocksize, 0.0f);
+
+    int end = headmax;
+    for (const Span &span : level_spans(blocksize, maxlength)) {
+        levels.push_back(std::make_unique<Level>(span.size, span.offset, span.parts, threaded));
+        end = span.offset + span.parts * span.size;
+    }
+    maxlen = end;
+}
+
+NonUniformConvolver::~NonUniformConvolver() = default;
+
+std::shared_ptr<const NonUniformConvolver::Partitions>
+NonUniformConvolver::transform(int blocksize, int maxlength, const float *ir, int length)
+{
+    if (blocksize < 1) blocksize = 1;
+    if (length < 0) length = 0;
+    const int headmax = head_length(blocksize, maxlength);
+
+    auto p = std::make_shared<Partitions>();
+    p->blocksize = blocksize;
+    p->maxlength = maxlength;
+    p->head = PartitionedConvolver::transform(blocksize, headmax, ir, std::min(length, headmax));
+
+    int end = headmax;
+    for (const Span &span : level_spans(blocksize, maxlength)) {
+        end = span.offset + span.parts * span.size;
+        p->levels.push_back(PartitionedConvolver::transform_partitions(
+                                ir, span.offset, std::min(length, end), span.size));
+    }
+    p->length = std::min(length, std::max(end, headmax));
+    return p;
+}
+
+void
+NonUniformConvolver::set_impulse(std::shared_ptr<const Partitions> p)
+{
+    head.set_impulse(p->head);
+    for (std::size_t k = 0; k < levels.size() && k < p->levels.size(); k++)
+        levels[k]->set_impulse(p->levels[k]);
+    irlength = std::min(p->length, maxlen);
+    partitions = std::move(p);
+}
+
+void
+NonUniformConvolver::cleanup()
+{
+    head.cleanup();
+    for (auto &level : levels)
+        level->cleanup();
+    std::fill(blockin.begin(), blockin.end(), 0.0f);
+    std::fill(levelout.begin(), levelout.end(), 0.0f);
+    pos = 0;
+}
+
+void
+NonUniformConvolver::process(const float *in, float *out)
+{
+    for (int i = 0; i < blocksize; i++)
+        out[i] = tick(in[i]);
+    end_block();
+}
+
+void
+NonUniformConvolver::end_block()
+{
+    head.end_block();
+
+    std::fill(levelout.begin(), levelout.end(), 0.0f);
+    for (auto &level : levels) {
+        memcpy(level->acc.data() + level->fill, blockin.data(), sizeof(float) * blocksize);
+        level->fill += blocksize;
+        if (level->fill >= level->size && level->boundary())
+            overruns.fetch_add(1, std::memory_order_relaxed);
+
+        const float *src = level->cur.data() + level->fill;
+        for (int i = 0; i < blocksize; i++)
+            levelout[i] += src[i];
+    }
+
+    pos = 0;
+}
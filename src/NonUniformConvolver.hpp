@@ -0,0 +1,137 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  NonUniformConvolver.hpp - Zero-latency non-uniform partitioned convolution.
+
+  The impulse response is cut into segments of growing partition size:
+
+    [0, 2*B1)              PartitionedConvolver, block B (direct head +
+                           block-sized FFT partitions, computed in the RT thread)
+    [2*Bk, 2*Bk+1)         uniform FFT partitions of Bk = B * 4^k samples,
+                           computed off the RT thread, up to 8192 samples
+
+  The last level takes whatever is left of the impulse response. A level only
+  starts reading the result of an input block 2*Bk samples after that block
+  began, so the job has Bk samples of wall time to finish. This lets long
+  cabinet and room IRs run without adding latency and without paying for the
+  large FFTs inside the audio callback.
+
+  The jobs of every level of every convolver run on one small pool of worker
+  threads, started with the first threaded convolver. Building a convolver,
+  as every IR load does, starts no threads.
+
+  If a worker misses its deadline the level outputs silence for one of its
+  blocks and resynchronises; get_overruns() counts those events.
+
+  transform() cuts and transforms an impulse response for one block size and
+  maximum length into immutable Partitions, which any number of convolvers
+  with that layout can share.
+
+  Usage is the same as PartitionedConvolver:
+    Non-RT:  NonUniformConvolver conv(block, max_ir_len);
+             conv.set_impulse(NonUniformConvolver::transform(block, max_ir_len, ir, len));
+    RT:      conv.process(in, out);                 // whole block, or
+             for (i...) y = conv.tick(x); conv.end_block();
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "PartitionedConvolver.hpp"
+
+class NonUniformConvolver
+{
+public:
+    /// @param blocksize  Samples per call to process() / per end_block().
+    /// @param maxlength  Longest impulse response that set_impulse() accepts.
+    /// @param threaded   Run the large partitions on the worker pool. When
+    ///                   false they are computed inline at the block where
+    ///                   they become due (offline rendering, tests).
+    NonUniformConvolver(int blocksize, int maxlength, bool threaded = true);
+    ~NonUniformConvolver();
+
+    NonUniformConvolver(const NonUniformConvolver&) = delete;
+    NonUniformConvolver& operator=(const NonUniformConvolver&) = delete;
+
+    /// The head and level partitions of one impulse response. Never
+    /// changed after transform().
+    struct Partitions
+    {
+        int blocksize{0};
+        int maxlength{0};
+        int length{0};
+        std::shared_ptr<const PartitionedConvolver::Impulse> head;
+        std::vector<std::vector<double>> levels;   // (re, im) bins of each level's partitions
+    };
+
+    /// Partition and transform ir for convolvers of this block size and
+    /// maxlength. Lengths above maxlength are truncated. Not for the RT thread.
+    static std::shared_ptr<const Partitions>
+    transform(int blocksize, int maxlength, const float *ir, int length);
+
+    /// Use an impulse response from transform() with the same block size
+    /// and maxlength. Does not allocate. Only before the convolver runs:
+    /// the workers read the partitions without a lock.
+    void set_impulse(std::shared_ptr<const Partitions> partitions);
+
+    /// Clear the input history (impulse response is kept).
+    void cleanup();
+
+    /// Convolve one block of blocksize samples. in and out may alias.
+    void process(const float *in, float *out);
+
+    /// Push one input sample and return the matching output sample.
+    /// Exactly blocksize calls must be followed by end_block().
+    inline float tick(float x)
+    {
+        float y = head.tick(x) + levelout[pos];
+        blockin[pos] = x;
+        pos++;
+        return y;
+    }
+
+    /// Close the current block and prepare the next one.
+    void end_block();
+
+    [[nodiscard]] int get_blocksize() const noexcept { return blocksize; }
+    [[nodiscard]] int get_length() const noexcept { return irlength; }
+    [[nodiscard]] int get_levels() const noexcept { return (int) levels.size(); }
+
+    /// Number of blocks a worker delivered too late since construction.
+    [[nodiscard]] unsigned get_overruns() const noexcept
+    {
+        return overruns.load(std::memory_order_relaxed);
+    }
+
+    struct Level;
+
+private:
+    struct Span
+    {
+        int size;
+        int offset;      // first IR sample covered
+        int parts;
+    };
+
+    /// IR samples the head takes, and the levels after it.
+    static int head_length(int blocksize, int maxlength);
+    static std::vector<Span> level_spans(int blocksize, int maxlength);
+
+    int blocksize;
+    int headmax;         // IR samples handled by the RT-side head convolver
+    int maxlen;          // IR samples covered by head and levels together
+    int irlength;
+    int pos;
+
+    PartitionedConvolver head;
+    std::vector<std::unique_ptr<Level>> levels;
+    std::shared_ptr<const Partitions> partitions;
+
+    std::vector<float> blockin;    // input of the current block
+    std::vector<float> levelout;   // summed level output for the current block
+
+    std::atomic<unsigned> overruns{0};
+};
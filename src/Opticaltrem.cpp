@@ -166,6 +166,14 @@ Opticaltrem::setpanning (int value)
 
 void
 Opticaltrem::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+};
+
+void
+Opticaltrem::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 7;
     const int NUM_PRESETS = 6;
@@ -188,12 +196,11 @@ Opticaltrem::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(44,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
 };
 
 void
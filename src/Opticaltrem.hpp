@@ -41,6 +41,7 @@ public:
     void out (float * smpsl, float * smpsr);
     void setpanning(int value);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -151,6 +151,15 @@ Pan::setextra (int Pextra)
 
 void
 Pan::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Pan::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 9;
     const int NUM_PRESETS = 2;
@@ -165,16 +174,12 @@ Pan::setpreset (int npreset)
 
         FPreset::ReadPreset(13,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
-
-
 };
 
 
@@ -36,6 +36,7 @@ public:
     ~Pan ();
     void out (float *smpsl, float *smpsr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
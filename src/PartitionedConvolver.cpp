@@ -0,0 +1,192 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  PartitionedConvolver.cpp - Uniformly partitioned FFT convolution.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "FFTWPlanner.hpp"
+#include "PartitionedConvolver.hpp"
+
+PartitionedConvolver::PartitionedConvolver(int blocksize_, int maxlength)
+{
+    blocksize = blocksize_ > 0 ? blocksize_ : 1;
+    fftsize = 2 * blocksize;
+    nbins = blocksize + 1;
+    maxparts = (maxlength + blocksize - 1) / blocksize;
+    if (maxparts < 1) maxparts = 1;
+
+    hist.resize(fftsize, 0.0f);
+    tail.resize(blocksize, 0.0f);
+
+    fft_real = fftw_alloc_real(fftsize);
+    fft_spec = fftw_alloc_complex(nbins);
+    fdl = fftw_alloc_complex((size_t) maxparts * nbins);
+
+    // Built on loader threads, so estimate rather than time trial plans.
+    {
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+        plan_forward = fftw_plan_dft_r2c_1d(fftsize, fft_real, fft_spec, FFTW_ESTIMATE);
+        plan_inverse = fftw_plan_dft_c2r_1d(fftsize, fft_spec, fft_real, FFTW_ESTIMATE);
+    }
+
+    nparts = 0;
+    headlen = 0;
+    irlength = 0;
+    cleanup();
+}
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+    {
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+        fftw_destroy_plan(plan_forward);
+        fftw_destroy_plan(plan_inverse);
+    }
+    fftw_free(fft_real);
+    fftw_free(fft_spec);
+    fftw_free(fdl);
+}
+
+void
+PartitionedConvolver::cleanup()
+{
+    std::fill(hist.begin(), hist.end(), 0.0f);
+    std::fill(tail.begin(), tail.end(), 0.0f);
+    memset(fdl, 0, sizeof(fftw_complex) * maxparts * nbins);
+    pos = 0;
+    fdl_pos = 0;
+}
+
+std::vector<double>
+PartitionedConvolver::transform_partitions(const float *ir, int start, int end, int size)
+{
+    const int fftsize = 2 * size;
+    const int nbins = size + 1;
+    const int parts = end > start ? (end - start + size - 1) / size : 0;
+    std::vector<double> spectra((size_t) parts * nbins * 2);
+    if (!parts)
+        return spectra;
+
+    double *real = fftw_alloc_real(fftsize);
+    fftw_complex *spec = fftw_alloc_complex(nbins);
+    fftw_plan plan;
+    {
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+        plan = fftw_plan_dft_r2c_1d(fftsize, real, spec, FFTW_ESTIMATE);
+    }
+
+    const double scale = 1.0 / (double) fftsize;
+    for (int k = 0; k < parts; k++) {
+        int first = start + k * size;
+        int n = end - first;
+        if (n > size) n = size;
+        for (int i = 0; i < fftsize; i++)
+            real[i] = (i < n) ? (double) ir[first + i] : 0.0;
+        fftw_execute(plan);
+        double *H = spectra.data() + (size_t) k * nbins * 2;
+        for (int b = 0; b < nbins; b++) {
+            H[2 * b] = spec[b][0] * scale;
+            H[2 * b + 1] = spec[b][1] * scale;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+        fftw_destroy_plan(plan);
+    }
+    fftw_free(real);
+    fftw_free(spec);
+    return spectra;
+}
+
+std::shared_ptr<const PartitionedConvolver::Impulse>
+PartitionedConvolver::transform(int blocksize, int maxlength, const float *ir, int length)
+{
+    if (blocksize < 1) blocksize = 1;
+    const int maxparts = std::max((maxlength + blocksize - 1) / blocksize, 1);
+    if (length > maxparts * blocksize) length = maxparts * blocksize;
+    if (length < 0) length = 0;
+
+    auto imp = std::make_shared<Impulse>();
+    imp->blocksize = blocksize;
+    imp->length = length;
+
+    // Head: first partition, kept in the time domain.
+    int hl = length < blocksize ? length : blocksize;
+    imp->headrev.resize(hl);
+    for (int t = 0; t < hl; t++)
+        imp->headrev[t] = ir[hl - 1 - t];
+
+    // Tail: one spectrum per remaining partition.
+    imp->spectra = transform_partitions(ir, blocksize, length, blocksize);
+    return imp;
+}
+
+void
+PartitionedConvolver::set_impulse(std::shared_ptr<const Impulse> imp)
+{
+    const int parts = 1 + (int) (imp->spectra.size() / ((size_t) nbins * 2));
+
+    headrev = imp->headrev.data();
+    irspec = reinterpret_cast<const fftw_complex *>(imp->spectra.data());
+    headlen = (int) imp->headrev.size();
+    nparts = headlen ? std::min(parts, maxparts) : 0;
+    irlength = imp->length;
+    impulse = std::move(imp);
+}
+
+void
+PartitionedConvolver::process(const float *in, float *out)
+{
+    for (int i = 0; i < blocksize; i++)
+        out[i] = tick(in[i]);
+    end_block();
+}
+
+void
+PartitionedConvolver::end_block()
+{
+    // Spectrum of [previous block | this block] goes into the delay line.
+    for (int i = 0; i < fftsize; i++)
+        fft_real[i] = (double) hist[i];
+    fftw_execute(plan_forward);
+    if (++fdl_pos >= maxparts) fdl_pos = 0;
+    memcpy(fdl + (size_t) fdl_pos * nbins, fft_spec, sizeof(fftw_complex) * nbins);
+
+    memcpy(hist.data(), hist.data() + blocksize, sizeof(float) * blocksize);
+    pos = 0;
+
+    compute_tail();
+}
+
+void
+PartitionedConvolver::compute_tail()
+{
+    if (nparts < 2) {
+        std::fill(tail.begin(), tail.end(), 0.0f);
+        return;
+    }
+
+    memset(fft_spec, 0, sizeof(fftw_complex) * nbins);
+
+    // Partition k of the next block sees the input spectrum k-1 blocks old.
+    int slot = fdl_pos;
+    for (int k = 1; k < nparts; k++) {
+        const fftw_complex *X = fdl + (size_t) slot * nbins;
+        const fftw_complex *H = irspec + (size_t) (k - 1) * nbins;
+        for (int b = 0; b < nbins; b++) {
+            fft_spec[b][0] += X[b][0] * H[b][0] - X[b][1] * H[b][1];
+            fft_spec[b][1] += X[b][0] * H[b][1] + X[b][1] * H[b][0];
+        }
+        if (--slot < 0) slot = maxparts - 1;
+    }
+
+    fftw_execute(plan_inverse);
+
+    // Overlap-save: only the second half is free of circular wrap.
+    for (int i = 0; i < blocksize; i++)
+        tail[i] = (float) fft_real[blocksize + i];
+}
@@ -0,0 +1,122 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  PartitionedConvolver.hpp - Uniformly partitioned FFT convolution.
+
+  The impulse response is split into partitions of one audio block each.
+  The first partition (the "head") is evaluated in the time domain one sample
+  at a time, every later partition is evaluated in the frequency domain
+  against a delay line of input spectra (overlap-save, FFT size 2 * block).
+
+  Because the tail partitions only ever see input from previous blocks, the
+  whole tail contribution of a block is known before its first sample is
+  processed. This keeps the latency at zero beyond the audio period and lets
+  callers with a per-sample feedback path (Convolotron) use tick() and still
+  get sample-exact results.
+
+  The partitioned, transformed impulse response is an immutable Impulse, so
+  convolvers with the same block size can share one instead of transforming
+  the same file each.
+
+  Usage:
+    Non-RT:  PartitionedConvolver conv(block, max_ir_len);
+             conv.set_impulse(PartitionedConvolver::transform(block, max_ir_len, ir, len));
+    RT:      conv.process(in, out);                 // whole block, or
+             for (i...) y = conv.tick(x); conv.end_block();
+*/
+
+#pragma once
+
+#include <fftw3.h>
+#include <memory>
+#include <vector>
+
+class PartitionedConvolver
+{
+public:
+    /// @param blocksize  Samples per call to process() / per end_block().
+    /// @param maxlength  Longest impulse response that set_impulse() accepts.
+    PartitionedConvolver(int blocksize, int maxlength);
+    ~PartitionedConvolver();
+
+    PartitionedConvolver(const PartitionedConvolver&) = delete;
+    PartitionedConvolver& operator=(const PartitionedConvolver&) = delete;
+
+    /// An impulse response cut into partitions of one block: the head taps
+    /// reversed, the rest transformed. Never changed after transform().
+    struct Impulse
+    {
+        int blocksize{0};
+        int length{0};
+        std::vector<float> headrev;    // head taps, reversed for a forward dot product
+        std::vector<double> spectra;   // (re, im) bins of partitions 1..n-1
+    };
+
+    /// Partition and transform ir for convolvers of this block size and
+    /// maxlength. Lengths above maxlength are truncated. Not for the RT thread.
+    static std::shared_ptr<const Impulse>
+    transform(int blocksize, int maxlength, const float *ir, int length);
+
+    /// Spectra of ir[start, end) in partitions of size samples, each zero
+    /// padded to 2 * size, with the 1/N of the unnormalised inverse FFT
+    /// folded in. Not for the RT thread.
+    static std::vector<double>
+    transform_partitions(const float *ir, int start, int end, int size);
+
+    /// Use an impulse response from transform() with the same block size
+    /// and maxlength. Does not allocate; input history is kept so the change
+    /// is seamless.
+    void set_impulse(std::shared_ptr<const Impulse> impulse);
+
+    /// Clear the input history (impulse response is kept).
+    void cleanup();
+
+    /// Convolve one block of blocksize samples. in and out may alias.
+    void process(const float *in, float *out);
+
+    /// Push one input sample and return the matching output sample.
+    /// Exactly blocksize calls must be followed by end_block().
+    inline float tick(float x)
+    {
+        hist[blocksize + pos] = x;
+        const float *xn = &hist[blocksize + pos - headlen + 1];
+        float y = tail[pos];
+        for (int t = 0; t < headlen; t++)
+            y += headrev[t] * xn[t];
+        pos++;
+        return y;
+    }
+
+    /// Close the current block and prepare the tail of the next one.
+    void end_block();
+
+    [[nodiscard]] int get_blocksize() const noexcept { return blocksize; }
+    [[nodiscard]] int get_length() const noexcept { return irlength; }
+
+private:
+    void compute_tail();
+
+    int blocksize;
+    int fftsize;
+    int nbins;
+    int maxparts;
+    int nparts;          // partitions in use, including the head
+    int headlen;         // taps evaluated in the time domain
+    int irlength;
+    int pos;             // sample position inside the current block
+    int fdl_pos;         // slot of the most recent input spectrum
+
+    std::shared_ptr<const Impulse> impulse;
+    const float *headrev{};      // impulse->headrev
+    const fftw_complex *irspec{};  // impulse->spectra, partition 1 first
+
+    std::vector<float> hist;     // [previous block | current block]
+    std::vector<float> tail;     // contribution of partitions 1..nparts-1
+
+    double *fft_real{};          // 2 * blocksize scratch
+    fftw_complex *fft_spec{};    // nbins scratch / accumulator
+    fftw_complex *fdl{};         // maxparts * nbins input spectra
+    fftw_plan plan_forward{};
+    fftw_plan plan_inverse{};
+};
@@ -191,6 +191,15 @@ Phaser::setphase (int Pphase)
 
 void
 Phaser::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Phaser::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 12;
     const int NUM_PRESETS = 6;
@@ -213,12 +222,11 @@ Phaser::setpreset (int npreset)
 
         FPreset::ReadPreset(6,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
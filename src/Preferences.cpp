@@ -99,6 +99,12 @@ void Preferences::flush()
     save();
 }
 
+void Preferences::useDefaults()
+{
+    m_data = nlohmann::json::object();
+    m_filepath.clear();
+}
+
 void Preferences::load()
 {
     if (std::filesystem::exists(m_filepath)) {
@@ -119,6 +125,8 @@ void Preferences::load()
 
 void Preferences::save()
 {
+    if (m_filepath.empty())
+        return;
     try {
         std::filesystem::create_directories(m_filepath.parent_path());
         std::ofstream f(m_filepath);
@@ -77,6 +77,11 @@ public:
     /// Explicitly flush to disk.
     void flush();
 
+    /// Drop the stored values and stop persisting, every get() then returns
+    /// its default until set(). For tools that must not depend on, or write
+    /// to, the user's preferences.
+    void useDefaults();
+
 private:
     void load();
     void save();
@@ -27,6 +27,21 @@ struct Preset_Bank_Struct {
     std::array<int, 128> XMIDIrangeMax{};
 };
 
+// Parameter table of a preset: one row of 20 per effect (see RKR::lv).
+using Preset_Params = std::array<std::array<int, 20>, 70>;
+
+// A bank slot decoded for loading: all RKR::Load_State() puts in place.
+struct Preset_State {
+    std::array<char, 64> Preset_Name{};
+    std::array<char, 64> Author{};
+    Preset_Params lv{};
+    std::array<int, 47> bypass{};   // on/off per effect type
+    std::array<std::array<int, 20>, 128> XUserMIDI{};
+    float Input_Gain{};
+    float Master_Volume{};
+    float Balance{};
+};
+
 struct MIDI_Table_Entry {
     int bank;
     int preset;
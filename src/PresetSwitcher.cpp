@@ -0,0 +1,438 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  PresetSwitcher.cpp - Gapless bank preset changes.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include "PresetSwitcher.hpp"
+#include "global.hpp"
+#include "AllEffects.hpp"
+
+namespace
+{
+// Effect types, as stored in efx_order[].
+constexpr int kEffectTypes = 47;
+constexpr int kConvolotron = 29;
+constexpr int kLooper = 30;
+constexpr int kReverbtron = 40;
+constexpr int kEchotron = 41;
+constexpr int kStereoHarm = 42;
+
+using Clock = std::chrono::steady_clock;
+
+// Single writer (the RT thread), so a plain load/compare/store is enough.
+void store_max(std::atomic<float> &peak, float value)
+{
+    if (value > peak.load(std::memory_order_relaxed))
+        peak.store(value, std::memory_order_relaxed);
+}
+}
+
+/*
+ * Everything the RT thread needs to put a preset in place, decoded by the
+ * worker without touching lv[], the *_B flags or anything else the engine
+ * is running on; install() copies it in. After the swap `efx` holds the
+ * retired instances, and the unused fresh ones of the types that kept
+ * theirs. `changes` are the Config_Effect() calls for the types that were
+ * in the chain when the job was prepared, to bring a kept instance over.
+ */
+struct PresetSwitcher::Job
+{
+    std::uint64_t seq{0};
+    Clock::time_point requested;
+    float prepare_ms{0.0f};
+
+    Preset_State state;
+    std::array<int, MAX_EFFECT_SLOTS> order{};
+    std::array<std::unique_ptr<Effect>, kEffectTypes> efx{};
+    std::array<std::vector<std::pair<int, int>>, kEffectTypes> changes{};
+
+    std::array<int, 14> looper{};
+    bool rc_cleanup{false};
+
+    std::array<char, 128> convo_file{};
+    std::array<char, 128> rev_file{};
+    std::array<char, 128> echo_file{};
+};
+
+PresetSwitcher::PresetSwitcher(RKR &rkr_)
+    : rkr(rkr_)
+{
+    oldl.resize(PERIOD, 0.0f);
+    oldr.resize(PERIOD, 0.0f);
+
+    worker = std::thread(&PresetSwitcher::work, this);
+}
+
+PresetSwitcher::~PresetSwitcher()
+{
+    quit.store(true, std::memory_order_release);
+    wake.release();
+    worker.join();
+
+    delete ready.exchange(nullptr, std::memory_order_acq_rel);
+    Job *job;
+    while (retired.pop(job))
+        delete job;
+}
+
+void
+PresetSwitcher::request(int num)
+{
+    if (num < 0 || num >= (int) std::size(rkr.presets.Bank))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        request_num = num;
+        request_seq++;
+        request_time = Clock::now();
+        requested.store(request_seq, std::memory_order_release);
+    }
+    wake.release();
+}
+
+PresetSwitchStats
+PresetSwitcher::stats() const
+{
+    PresetSwitchStats s;
+    s.switches = switches.load(std::memory_order_relaxed);
+    s.superseded = superseded.load(std::memory_order_relaxed);
+    s.last_latency_ms = last_latency_ms.load(std::memory_order_relaxed);
+    s.max_latency_ms = max_latency_ms.load(std::memory_order_relaxed);
+    s.last_prepare_ms = last_prepare_ms.load(std::memory_order_relaxed);
+    s.last_rt_us = last_rt_us.load(std::memory_order_relaxed);
+    s.max_rt_us = max_rt_us.load(std::memory_order_relaxed);
+    return s;
+}
+
+/*
+ * Worker thread. Decodes bank slot num (names, lv[], on/off flags) like
+ * Bank_to_Preset() does, then builds and configures a new instance of
+ * every effect in the new chain from it.
+ */
+PresetSwitcher::Job *
+PresetSwitcher::prepare(int num)
+{
+    const auto start = Clock::now();
+    const Preset_Bank_Struct &bank = rkr.presets.Bank[num];
+
+    auto job = std::make_unique<Job>();
+    rkr.Bank_to_State(num, job->state);
+    const Preset_Params &lv = job->state.lv;
+
+    for (int j = 0; j < MAX_EFFECT_SLOTS; j++)
+        job->order[j] = lv[10][j];
+    for (int i = 0; i < (int) job->looper.size(); i++)
+        job->looper[i] = lv[31][i];
+
+    job->convo_file = bank.ConvoFiname;
+    job->rev_file = bank.RevFiname;
+    job->echo_file = bank.EchoFiname;
+    job->convo_file.back() = 0;
+    job->rev_file.back() = 0;
+    job->echo_file.back() = 0;
+
+    // Read off the audio thread, so only a hint; install() checks again.
+    const std::array<int, MAX_EFFECT_SLOTS> live = rkr.efx_order;
+
+    for (int type : job->order) {
+        if (type < 0 || type >= kEffectTypes || job->efx[type])
+            continue;
+        if (type == kLooper) {
+            // Configured in place at swap time, so it has to be full size
+            // by then; install() takes it before touching it.
+            rkr.lazy_efx.unpark(&type, 1);
+            continue;
+        }
+        if (type == kStereoHarm && lv[43][10])
+            job->rc_cleanup = true;
+        if (std::find(live.begin(), live.end(), type) != live.end())
+            job->changes[type] = rkr.Config_Changes(type, lv);
+
+        std::unique_ptr<Effect> efx = rkr.New_Effect(type);
+        if (!efx)
+            continue;
+
+        // The file is asked for by changepar(), so it has to be there first.
+        switch (type) {
+        case 29:
+            static_cast<Convolotron *>(efx.get())->Filename = job->convo_file;
+            break;
+        case 40:
+            static_cast<Reverbtron *>(efx.get())->Filename = job->rev_file;
+            break;
+        case 41:
+            static_cast<Echotron *>(efx.get())->Filename = job->echo_file;
+            break;
+        }
+
+        rkr.Config_Effect(type, efx.get(), lv);
+
+        // Loaded on the loader thread; have it in place before the swap.
+        switch (type) {
+        case 29:
+            static_cast<Convolotron *>(efx.get())->waitfile();
+            break;
+        case 40:
+            static_cast<Reverbtron *>(efx.get())->waitfile();
+            break;
+        case 41:
+            static_cast<Echotron *>(efx.get())->waitfile();
+            break;
+        }
+        job->efx[type] = std::move(efx);
+    }
+
+    job->prepare_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    return job.release();
+}
+
+/*
+ * RT thread. The compiled chain, by slot.
+ */
+PresetSwitcher::Slots
+PresetSwitcher::running() const
+{
+    Slots slots{};
+    for (int n = 0; n < rkr.chain_len; n++)
+        slots[rkr.chain[n].slot] = rkr.chain[n];
+    return slots;
+}
+
+/*
+ * RT thread. Whether `type`, running in `live`, can stay in place: its
+ * file is the same and, for the effects that load one, no parameter
+ * changes, so no load is asked for here.
+ */
+static bool
+keeps_instance(RKR &rkr, const PresetSwitcher::Job &job, int type,
+               const std::array<ChainNode, MAX_EFFECT_SLOTS> &live)
+{
+    if (job.changes[type].empty())
+        return false;
+    Effect *efx = rkr.Effect_By_Type(type);
+    if (std::none_of(live.begin(), live.end(),
+                     [efx] (const ChainNode &node) { return node.efx == efx; }))
+        return false;
+
+    switch (type) {
+    case kConvolotron:
+        if (strcmp(rkr.efx_Convol->Filename.data(), job.convo_file.data()) != 0)
+            return false;
+        break;
+    case kReverbtron:
+        if (strcmp(rkr.efx_Reverbtron->Filename.data(), job.rev_file.data()) != 0)
+            return false;
+        break;
+    case kEchotron:
+        if (strcmp(rkr.efx_Echotron->Filename.data(), job.echo_file.data()) != 0)
+            return false;
+        break;
+    default:
+        return true;
+    }
+
+    for (const auto &[npar, value] : job.changes[type])
+        if ((npar >= 0) && (efx->getpar(npar) != value))
+            return false;
+    return true;
+}
+
+/*
+ * RT thread. Pointer moves and flag copies, and the parameter changes of the
+ * instances that stay; the retired instances stay in the job until the
+ * worker deletes it. `live` is the chain that ran up to now, empty when it
+ * was off and there is nothing to keep.
+ */
+void
+PresetSwitcher::install(Job *job, const Slots &live)
+{
+    rkr.Load_State(job->state);
+
+    rkr.Harmonizer_Bypass = 0;
+    rkr.Ring_Bypass = 0;
+    rkr.StereoHarm_Bypass = 0;
+
+    for (int j = 0; j < MAX_EFFECT_SLOTS; j++)
+        rkr.efx_order[j] = job->order[j];
+
+    // A Looper unparked by prepare()
+    rkr.lazy_efx.swap_in();
+
+    for (int type = 0; type < kEffectTypes; type++) {
+        if (!job->efx[type])
+            continue;
+        if (keeps_instance(rkr, *job, type, live)) {
+            // No cleanup(), that is the point
+            Effect *efx = rkr.Effect_By_Type(type);
+            for (const auto &[npar, value] : job->changes[type])
+                if ((npar >= 0) && (efx->getpar(npar) != value))
+                    efx->changepar(npar, value);
+            efx->Ppreset = job->efx[type]->Ppreset;
+            continue;
+        }
+        Effect *old = rkr.Swap_Effect(type, job->efx[type].release());
+        job->efx[type].reset(old);
+    }
+
+    for (int type : job->order) {
+        if (type == kLooper) {
+            for (int i = 0; i < (int) job->looper.size(); i++)
+                rkr.efx_Looper->loadpreset(i, job->looper[i]);
+        }
+        if (int *bypass = rkr.Bypass_By_Type(type))
+            *bypass = job->state.bypass[type];
+    }
+
+    if (job->rc_cleanup)
+        rkr.RC->cleanup();
+
+    rkr.efx_Convol->Filename = job->convo_file;
+    rkr.efx_Reverbtron->Filename = job->rev_file;
+    rkr.efx_Echotron->Filename = job->echo_file;
+
+    if ((rkr.Tap_Updated) && (rkr.Tap_Bypass) && (rkr.Tap_TempoSet > 0) && (rkr.Tap_TempoSet < 601))
+        rkr.Update_tempo();
+}
+
+void
+PresetSwitcher::finish(Job *job, Clock::time_point start)
+{
+    const auto now = Clock::now();
+    const float rt_us = std::chrono::duration<float, std::micro>(now - start).count();
+    const float latency_ms = std::chrono::duration<float, std::milli>(now - job->requested).count();
+
+    last_rt_us.store(rt_us, std::memory_order_relaxed);
+    store_max(max_rt_us, rt_us);
+    last_latency_ms.store(latency_ms, std::memory_order_relaxed);
+    store_max(max_latency_ms, latency_ms);
+    last_prepare_ms.store(job->prepare_ms, std::memory_order_relaxed);
+    switches.fetch_add(1, std::memory_order_relaxed);
+    applied.store(job->seq, std::memory_order_release);
+
+    // At most one job retires per period and the worker empties the ring
+    // every time it wakes, so this only fails if the worker is stuck. Leak
+    // rather than free on the audio thread.
+    if (retired.push(job))
+        wake.release();
+}
+
+void
+PresetSwitcher::swap_in()
+{
+    const auto start = Clock::now();
+    Job *job = ready.exchange(nullptr, std::memory_order_acq_rel);
+    if (!job)
+        return;
+    install(job, Slots{});
+    finish(job, start);
+}
+
+void
+PresetSwitcher::crossfade()
+{
+    const auto start = Clock::now();
+    Job *job = ready.exchange(nullptr, std::memory_order_acq_rel);
+    if (!job) {
+        rkr.Effect_Chain();
+        return;
+    }
+
+    if (rkr.Chain_Changed())
+        rkr.Compile_Chain();
+    const Slots before = running();
+
+    if ((int) oldl.size() < PERIOD) {
+        install(job, before);
+        rkr.Effect_Chain();
+        finish(job, start);
+        return;
+    }
+
+    install(job, before);
+    rkr.Compile_Chain();
+    const Slots after = running();
+
+    // Slot by slot, the old effect and the new one on the same input. An
+    // instance in both chains (kept, or the Looper) only runs in the new
+    // one; where it left, its old slot fades from the plain input.
+    float *l = rkr.efxoutl.data();
+    float *r = rkr.efxoutr.data();
+    const size_t bytes = sizeof(float) * PERIOD;
+    const float step = 1.0f / fPERIOD;
+
+    for (int slot = 0; slot < MAX_EFFECT_SLOTS; slot++) {
+        const ChainNode &was = before[slot];
+        const ChainNode &now = after[slot];
+        if (was.efx == now.efx) {
+            if (now.efx)
+                rkr.Run_Node(now, l, r);
+            continue;
+        }
+
+        memcpy(oldl.data(), l, bytes);
+        memcpy(oldr.data(), r, bytes);
+        if (was.efx && std::none_of(after.begin(), after.end(),
+                                    [&was] (const ChainNode &node) { return node.efx == was.efx; }))
+            rkr.Run_Node(was, oldl.data(), oldr.data());
+        if (now.efx)
+            rkr.Run_Node(now, l, r);
+
+        for (int i = 0; i < PERIOD; i++) {
+            const float g = (float) (i + 1) * step;
+            l[i] = oldl[i] + (l[i] - oldl[i]) * g;
+            r[i] = oldr[i] + (r[i] - oldr[i]) * g;
+        }
+    }
+
+    finish(job, start);
+}
+
+void
+PresetSwitcher::work()
+{
+    for (;;) {
+        wake.acquire();
+        if (quit.load(std::memory_order_acquire))
+            return;
+
+        Job *job;
+        {
+            // The GUI may still be reading the instances they retired
+            auto hold = rkr.lazy_efx.hold();
+            while (retired.pop(job))
+                delete job;
+        }
+
+        int num;
+        std::uint64_t seq;
+        Clock::time_point when;
+        {
+            std::lock_guard<std::mutex> lock(request_mutex);
+            num = request_num;
+            seq = request_seq;
+            when = request_time;
+            request_num = -1;
+        }
+        if (num < 0)
+            continue;
+
+        // A preset the RT thread has not picked up yet is out of date now.
+        if (Job *stale = ready.exchange(nullptr, std::memory_order_acq_rel)) {
+            superseded.fetch_add(1, std::memory_order_relaxed);
+            delete stale;
+        }
+
+        job = prepare(num);
+        job->seq = seq;
+        job->requested = when;
+        ready.store(job, std::memory_order_release);
+    }
+}
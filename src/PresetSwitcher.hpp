@@ -0,0 +1,138 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  PresetSwitcher.hpp - Gapless bank preset changes.
+
+  RKR::Bank_to_Preset() reconfigures the live effects in place: cleanup(),
+  dozens of changepar() calls, IR and tap file loads, filter bank rebuilds,
+  all while the audio callback keeps running. PresetSwitcher moves that
+  work to a background thread that builds and configures fresh instances
+  of every effect in the new chain. Once they are ready the audio thread
+  swaps them in between periods. During that one period it runs each slot's
+  old and new effect on the same input and crossfades from one to the
+  other, then hands the retired instances back to the worker to be freed
+  under LazyEffects::hold().
+
+  An effect that is running in the old chain and stays in the new one keeps
+  its instance, so delay and reverb tails ring on: the audio thread only
+  makes the changepar() calls whose values differ, as a MIDI controller
+  would. Convolotron, Reverbtron and Echotron keep theirs only when file
+  and parameters are all the same; the fresh instance has the file loaded.
+
+  Looper always stays in place, its recorded loop has to survive preset
+  changes; it only gets its parameters reloaded at swap time, as
+  Actualizar_Audio() always did.
+
+  Usage:
+    Any thread:  switcher.request(slot);  ...  if (switcher.done()) ...
+    RT (Alg):    if (switcher.pending()) switcher.crossfade();
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+#include "RingBuffer.hpp"
+#include "dsp_constants.hpp"
+
+class RKR;
+struct ChainNode;
+
+/// Timing of bank preset switches.
+struct PresetSwitchStats
+{
+    std::uint64_t switches{0};     ///< Presets swapped in so far
+    std::uint64_t superseded{0};   ///< Prepared presets dropped for a newer request
+    float last_latency_ms{0.0f};   ///< Request until the new preset plays
+    float max_latency_ms{0.0f};
+    float last_prepare_ms{0.0f};   ///< Worker time spent building the instances
+    float last_rt_us{0.0f};        ///< Audio thread time of the swap period
+    float max_rt_us{0.0f};
+};
+
+class PresetSwitcher
+{
+public:
+    explicit PresetSwitcher(RKR &rkr);
+    ~PresetSwitcher();
+
+    PresetSwitcher(const PresetSwitcher&) = delete;
+    PresetSwitcher& operator=(const PresetSwitcher&) = delete;
+
+    /// Switch to bank slot num. Returns at once; a request the worker has
+    /// not started on yet, or whose preset is not playing yet, is replaced.
+    void request(int num);
+
+    /// The last requested preset plays (or none was requested).
+    [[nodiscard]] bool done() const noexcept
+    {
+        return applied.load(std::memory_order_acquire) >=
+               requested.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] PresetSwitchStats stats() const;
+
+    /// RT thread. A prepared preset is waiting to be swapped in.
+    [[nodiscard]] bool pending() const noexcept
+    {
+        return ready.load(std::memory_order_relaxed) != nullptr;
+    }
+
+    /// RT thread, in place of RKR::Effect_Chain(). Swaps the prepared
+    /// preset in and crossfades each slot from its old effect over this
+    /// period.
+    void crossfade();
+
+    /// RT thread. Swaps the prepared preset in without running it, for
+    /// periods where the effect chain is off.
+    void swap_in();
+
+    struct Job;
+
+private:
+    // Compiled chain nodes by slot, efx is null for an empty or off slot
+    using Slots = std::array<ChainNode, MAX_EFFECT_SLOTS>;
+
+    Job *prepare(int num);
+    void install(Job *job, const Slots &live);
+    Slots running() const;
+    void finish(Job *job, std::chrono::steady_clock::time_point start);
+    void work();
+
+    RKR &rkr;
+
+    // RT side: a slot's input, run through its old effect
+    std::vector<float> oldl, oldr;
+
+    // Latest request, GUI/MIDI thread → worker
+    std::mutex request_mutex;
+    int request_num{-1};
+    std::uint64_t request_seq{0};
+    std::chrono::steady_clock::time_point request_time;
+
+    // Worker → RT: one prepared preset. RT → worker: swapped out jobs.
+    std::atomic<Job *> ready{nullptr};
+    RingBuffer<Job *, 16> retired;
+
+    std::atomic<std::uint64_t> requested{0};
+    std::atomic<std::uint64_t> applied{0};
+
+    std::atomic<std::uint64_t> switches{0};
+    std::atomic<std::uint64_t> superseded{0};
+    std::atomic<float> last_latency_ms{0.0f};
+    std::atomic<float> max_latency_ms{0.0f};
+    std::atomic<float> last_prepare_ms{0.0f};
+    std::atomic<float> last_rt_us{0.0f};
+    std::atomic<float> max_rt_us{0.0f};
+
+    std::counting_semaphore<> wake{0};
+    std::atomic<bool> quit{false};
+    std::thread worker;
+};
@@ -0,0 +1,100 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  PsolaShifter.cpp - Pitch synchronous overlap-add pitch shifter.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include "dsp_constants.hpp"
+#include "PsolaShifter.hpp"
+
+PsolaShifter::PsolaShifter (float sampleRate_)
+    : sampleRate(sampleRate_)
+{
+    // A grain reads at most one period behind the input
+    size_t size = 1;
+    while (size < (size_t) (sampleRate / kMinFreq) + 64)
+        size <<= 1;
+    buffer.assign(size, 0.0f);
+    mask = (std::int64_t) size - 1;
+
+    for (int i = 0; i <= kWindowSize; i++)
+        window[i] = 0.5f - 0.5f * cosf (D_PI * (float) i / (float) kWindowSize);
+
+    cleanup ();
+}
+
+void
+PsolaShifter::cleanup ()
+{
+    std::fill(buffer.begin(), buffer.end(), 0.0f);
+    period = sampleRate * kNoPitchPeriod;
+    now = 0;
+    synMark = 0.0;
+    anaMark = 0.0;
+    active = 0;
+}
+
+float
+PsolaShifter::latency (float freq)
+{
+    if ((freq >= kMinFreq) && (freq <= kMaxFreq))
+        return 0.5f / freq;
+    return 0.5f * kNoPitchPeriod;
+}
+
+void
+PsolaShifter::out (float ratio, float freq, long n, const float *in, float *out)
+{
+    if ((freq >= kMinFreq) && (freq <= kMaxFreq))
+        period = sampleRate / freq;
+    ratio = CLAMP(ratio, 0.25f, 4.0f);
+
+    const double synStep = period / ratio;
+    // Downwards the grains grow to cover the wider output spacing
+    const int half = (int) lrintf (std::max (period, (float) synStep));
+
+    for (long i = 0; i < n; i++) {
+        buffer[now & mask] = in[i];
+
+        // Next grain, centred `half` samples ahead. The marks keep their
+        // fractions so the spacing does not round to whole samples.
+        const double centre = (double) (now + half);
+        if (centre >= synMark + synStep) {
+            synMark += synStep;
+            if (synMark < centre - synStep)
+                synMark = centre;
+
+            // Latest input mark at or before the output mark
+            if (synMark - anaMark >= period)
+                anaMark += period * floor ((synMark - anaMark) / period);
+
+            if (active < kMaxGrains) {
+                Grain &g = grains[active++];
+                g.src = (std::int64_t) lrint (anaMark + centre - synMark) - half;
+                g.len = 2 * half;
+                g.pos = 0;
+                g.wpos = 0.0f;
+                g.wstep = (float) kWindowSize / (float) g.len;
+                // Hann grains `synStep` apart add up to len / (2 synStep)
+                g.gain = (float) synStep / (float) half;
+            }
+        }
+
+        float sum = 0.0f;
+        for (int k = 0; k < active; ) {
+            Grain &g = grains[k];
+            sum += g.gain * window[(int) g.wpos] * buffer[(g.src + g.pos) & mask];
+            g.wpos += g.wstep;
+            if (++g.pos >= g.len)
+                g = grains[--active];
+            else
+                k++;
+        }
+
+        out[i] = sum;
+        now++;
+    }
+}
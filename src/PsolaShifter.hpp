@@ -0,0 +1,70 @@
+/*
+  rakarrack - guitar multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  PsolaShifter.hpp - Pitch synchronous overlap-add pitch shifter.
+
+  A time domain alternative to the smb phase vocoder for live playing.
+  Grains two pitch periods long are cut from the input at marks one period
+  apart and overlap-added at marks period / ratio apart, so the waveform
+  repeats (ratio > 1) or drops (ratio < 1) whole cycles and the grains
+  always add up in phase. The period comes from the Recognize pitch
+  detector; with no pitch known a 5 ms grid is used.
+
+  A grain is taken from the latest input mark at or before its output
+  centre, so the output lags the input by less than one period, half a
+  period on average: from 8.3 ms at kMinFreq (60 Hz) down to 0.25 ms at
+  kMaxFreq (2 kHz), 4.5 ms at A2 (110 Hz) and 1.5 ms at E4 (330 Hz). The phase
+  vocoder lags by fftFrameSize - stepSize samples, 40 ms or more.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class PsolaShifter
+{
+public:
+    explicit PsolaShifter (float sampleRate);
+
+    /// Shift in[0..n) by ratio into out, which may be in. freq is the
+    /// pitch of the input in Hz, <= 0 when not known.
+    void out (float ratio, float freq, long n, const float *in, float *out);
+    void cleanup ();
+
+    /// Mean delay in seconds for input of pitch freq. Outside kMinFreq to
+    /// kMaxFreq (no note found) it is that of the kNoPitchPeriod grid.
+    [[nodiscard]] static float latency (float freq);
+
+    static constexpr float kMinFreq = 60.0f;    ///< Lowest pitch followed, Hz
+    static constexpr float kMaxFreq = 2000.0f;  ///< Highest pitch followed, Hz
+    static constexpr float kNoPitchPeriod = 0.005f;  ///< Grid with no pitch, seconds
+
+private:
+    struct Grain {
+        std::int64_t src;   // input position of the first sample
+        int len;
+        int pos;
+        float wpos, wstep;  // position in the window table
+        float gain;
+    };
+
+    static constexpr int kMaxGrains = 12;
+    static constexpr int kWindowSize = 1024;
+
+    float sampleRate;
+    float period;           // samples
+    std::int64_t now{0};    // samples taken so far
+    double synMark{0.0};    // output centre of the latest grain
+    double anaMark{0.0};    // input centre of the latest grain
+
+    std::vector<float> buffer;
+    std::int64_t mask;
+
+    std::array<Grain, kMaxGrains> grains{};
+    int active{0};
+
+    std::array<float, kWindowSize + 1> window{};
+};
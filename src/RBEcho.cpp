@@ -23,12 +23,16 @@
 
 */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
 #include "RBEcho.hpp"
 #include "FPreset.hpp"
 
+// Longest run of samples out() reads at once
+static constexpr int kRun = 64;
+
 RBEcho::RBEcho ()
 {
     //default values
@@ -71,6 +75,8 @@ RBEcho::cleanup ()
     rdelay->set_averaging(0.25f);
     oldl = 0.0;
     oldr = 0.0;
+    lfeedback = 0.0f;
+    rfeedback = 0.0f;
 };
 
 
@@ -106,53 +112,78 @@ RBEcho::initdelays ()
 void
 RBEcho::out (float * smpsl, float * smpsr)
 {
-    int i;
+    int i, j, n;
     float ldl, rdl;
     float avg, ldiff, rdiff, tmp;
+    float times[kRun], ltimes[kRun], rtimes[kRun];
+    float ltaps[kRun], rtaps[kRun], lpps[kRun], rpps[kRun];
 
+    std::fill_n(times, kRun, delay);
+    std::fill_n(ltimes, kRun, ltime);
+    std::fill_n(rtimes, kRun, rtime);
 
-    for (i = 0; i < PERIOD; i++) {
+    for (i = 0; i < PERIOD; i += n) {
+        n = std::min(PERIOD - i, kRun);
 
-        //LowPass Filter
-        ldl = lfeedback * hidamp + oldl * (1.0f - hidamp);
-        rdl = rfeedback * hidamp + oldr * (1.0f - hidamp);
-        oldl = ldl + DENORMAL_GUARD;
-        oldr = rdl + DENORMAL_GUARD;
+        for (j = 0; j < n; j++) {
 
-        ldl = ldelay->delay_simple((ldl + smpsl[i]), delay, 0, 1, 0);
-        rdl = rdelay->delay_simple((rdl + smpsr[i]), delay, 0, 1, 0);
+            //LowPass Filter
+            ldl = lfeedback * hidamp + oldl * (1.0f - hidamp);
+            rdl = rfeedback * hidamp + oldr * (1.0f - hidamp);
+            oldl = ldl + DENORMAL_GUARD;
+            oldr = rdl + DENORMAL_GUARD;
 
+            ldelay->write(ldl + smpsl[i + j]);
+            rdelay->write(rdl + smpsr[i + j]);
 
-        if(Preverse) {
-            rvl = ldelay->delay_simple(oldl, delay, 1, 0, 1)*ldelay->envelope();
-            rvr = rdelay->delay_simple(oldr, delay, 1, 0, 1)*rdelay->envelope();
-            ldl = ireverse*ldl + reverse*rvl;
-            rdl = ireverse*rdl + reverse*rvr;
+            if (j == 0) {
+                //Read the taps for as many samples as the delay allows,
+                //the rest are written as their feedback comes out
+                n = ldelay->span_simple(times, 0, n);
+                n = rdelay->span_simple(times, 0, n);
+                n = ldelay->span_simple(ltimes, 2, n);
+                n = rdelay->span_simple(rtimes, 2, n);
 
-        }
+                ldelay->read_simple(times, 0, ltaps, n);
+                rdelay->read_simple(times, 0, rtaps, n);
+                ldelay->read_simple(ltimes, 2, lpps, n);
+                rdelay->read_simple(rtimes, 2, rpps, n);
+            }
+
+            ldl = ltaps[j];
+            rdl = rtaps[j];
 
+            if(Preverse) {
+                rvl = ldelay->delay_simple(oldl, delay, 1, 0, 1)*ldelay->envelope();
+                rvr = rdelay->delay_simple(oldr, delay, 1, 0, 1)*rdelay->envelope();
+                ldl = ireverse*ldl + reverse*rvl;
+                rdl = ireverse*rdl + reverse*rvr;
 
-        lfeedback = lpanning * fb * ldl;
-        rfeedback = rpanning * fb * rdl;
+            }
 
-        if(Pes) {
-            ldl *= cosf(lrcross);
-            rdl *= sinf(lrcross);
 
-            avg = (ldl + rdl) * 0.5f;
-            ldiff = ldl - avg;
-            rdiff = rdl - avg;
+            lfeedback = lpanning * fb * ldl;
+            rfeedback = rpanning * fb * rdl;
 
-            tmp = avg + ldiff * pes;
-            ldl = 0.5f * tmp;
+            if(Pes) {
+                ldl *= cosf(lrcross);
+                rdl *= sinf(lrcross);
 
-            tmp = avg + rdiff * pes;
-            rdl = 0.5f * tmp;
+                avg = (ldl + rdl) * 0.5f;
+                ldiff = ldl - avg;
+                rdiff = rdl - avg;
 
+                tmp = avg + ldiff * pes;
+                ldl = 0.5f * tmp;
 
+                tmp = avg + rdiff * pes;
+                rdl = 0.5f * tmp;
+
+
+            }
+            smpsl[i + j] = (ipingpong*ldl + pingpong *lpps[j]) * lpanning;
+            smpsr[i + j] = (ipingpong*rdl + pingpong *rpps[j]) * rpanning;
         }
-        smpsl[i] = (ipingpong*ldl + pingpong *ldelay->delay_simple(0.0f, ltime, 2, 0, 0)) * lpanning;
-        smpsr[i] = (ipingpong*rdl + pingpong *rdelay->delay_simple(0.0f, rtime, 2, 0, 0)) * rpanning;
 
     };
 
@@ -241,6 +272,15 @@ RBEcho::sethidamp (int Phidamp)
 
 void
 RBEcho::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+RBEcho::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 10;
     const int NUM_PRESETS = 3;
@@ -256,12 +296,11 @@ RBEcho::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(32,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
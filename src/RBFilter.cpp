@@ -22,6 +22,7 @@
 
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include "RBFilter.hpp"
@@ -71,22 +72,23 @@ RBFilter::computefiltercoefs ()
     par.f = 2.0f * sinf(PI*freq / fSAMPLE_RATE);
     if (par.f > 0.99999f)
         par.f = 0.99999f;
-    par.q = 1.0f - atanf (sqrtf (q)) * 2.0f / PI;
-    par.q = powf (par.q, 1.0f / (float)(stages + 1));
-    par.q_sqrt = sqrtf (par.q);
+    computeqcoefs ();
 
 };
 
 void
-RBFilter::computefiltercoefs_hiQ ()  //potentially unstable at some settings, but better sound
+RBFilter::computeqcoefs ()
 {
-    par.f = 2.0f * sinf(PI*freq / fSAMPLE_RATE);
-    if (par.f > 0.99999f)
-        par.f = 0.99999f;
-    if(q<0.5f) q = 0.5f;
-    par.q = 1.0f/q;
-    par.q = powf (par.q, 1.0f / (float)(stages + 1));
-    par.q_sqrt = 1.0f;
+    if(!qmode) {
+        par.q = 1.0f - atanf (sqrtf (q)) * 2.0f / PI;
+        par.q = powf (par.q, 1.0f / (float)(stages + 1));
+        par.q_sqrt = sqrtf (par.q);
+    } else {  //potentially unstable at some settings, but better sound
+        if(q<0.5f) q = 0.5f;
+        par.q = 1.0f/q;
+        par.q = powf (par.q, 1.0f / (float)(stages + 1));
+        par.q_sqrt = 1.0f;
+    }
 
 };
 
@@ -132,8 +134,7 @@ RBFilter::setfreq (float frequency)
     };
     freq = frequency;
 
-    if(!qmode) computefiltercoefs ();
-    else computefiltercoefs_hiQ ();
+    computefiltercoefs ();
     firsttime = 0;
 
 };
@@ -149,24 +150,21 @@ void
 RBFilter::setq (float q_)
 {
     q = q_;
-    if(!qmode) computefiltercoefs ();
-    else computefiltercoefs_hiQ ();
+    computefiltercoefs ();
 };
 
 void
 RBFilter::settype (int type_)
 {
     type = type_;
-    if(!qmode) computefiltercoefs ();
-    else computefiltercoefs_hiQ ();
+    computefiltercoefs ();
 };
 
 void
 RBFilter::setgain (float dBgain)
 {
     gain = dB2rap (dBgain);
-    if(!qmode) computefiltercoefs ();
-    else computefiltercoefs_hiQ ();
+    computefiltercoefs ();
 };
 
 void
@@ -176,8 +174,7 @@ RBFilter::setstages (int stages_)
         stages_ = MAX_FILTER_STAGES - 1;
     stages = stages_;
     cleanup ();
-    if(!qmode) computefiltercoefs ();
-    else computefiltercoefs_hiQ ();
+    computefiltercoefs ();
 };
 void
 RBFilter::setmix (int mix, float lpmix, float bpmix, float hpmix)
@@ -198,21 +195,6 @@ void
 RBFilter::singlefilterout (float * smp, fstage & x, parameters & par)
 {
     int i;
-    float *out = nullptr;
-    switch (type) {
-    case 0:
-        out = &x.low;
-        break;
-    case 1:
-        out = &x.high;
-        break;
-    case 2:
-        out = &x.band;
-        break;
-    case 3:
-        out = &x.notch;
-        break;
-    };
 
     float tmpq, tmpsq, tmpf, qdiff, sqdiff, fdiff;
     qdiff = (par.q - oldq)*iper;
@@ -222,24 +204,45 @@ RBFilter::singlefilterout (float * smp, fstage & x, parameters & par)
     tmpsq = oldsq;
     tmpf = oldf;
 
+    // The state stays in registers; smp could alias it as a member
+    float low = x.low, high = x.high, band = x.band, notch = x.notch;
+
     for (i = 0; i < PERIOD; i++) {
         tmpq += qdiff;
         tmpsq += sqdiff;
         tmpf += fdiff;   //Modulation interpolation
 
-        x.low = x.low + tmpf * x.band;
-        x.high = tmpsq * smp[i] - x.low - tmpq * x.band;
-        //x.high = smp[i] - x.low - tmpq * x.band;
-        x.band = tmpf * x.high + x.band;
+        low = low + tmpf * band;
+        high = tmpsq * smp[i] - low - tmpq * band;
+        //high = smp[i] - low - tmpq * band;
+        band = tmpf * high + band;
 
         if(en_mix) {
-            smp[i] = lpg * x.low + hpg * x.high + bpg * x.band;
+            smp[i] = lpg * low + hpg * high + bpg * band;
         } else {
-            x.notch = x.high + x.low;
-            smp[i] = *out;
+            notch = high + low;
+            switch (type) {
+            case 0:
+                smp[i] = low;
+                break;
+            case 1:
+                smp[i] = high;
+                break;
+            case 2:
+                smp[i] = band;
+                break;
+            case 3:
+                smp[i] = notch;
+                break;
+            };
         }
     };
 
+    x.low = low;
+    x.high = high;
+    x.band = band;
+    x.notch = notch;
+
     oldf = par.f;
     oldq = par.q;
     oldsq = par.q_sqrt;
@@ -290,6 +293,21 @@ RBFilter::filterout_s (float smp)
 
 };
 
+void
+RBFilter::filterout_mod (float * smp, const float * fmod, const float * qmod, int n)
+{
+    for (int i = 0; i < n; i++) {
+        // directmod replaces the frequency setq would compute
+        if (qmod != nullptr) {
+            q = qmod[i];
+            computeqcoefs ();
+        }
+        directmod (fmod[i]);
+        smp[i] = filterout_s (smp[i]);
+    }
+
+};
+
 float inline
 RBFilter::singlefilterout_s (float smp, fstage & x, parameters & par)
 {
@@ -333,3 +351,112 @@ RBFilter::singlefilterout_s (float smp, fstage & x, parameters & par)
 };
 
 
+
+
+
+RBFilterBank::RBFilterBank (int Ftype, float Fq, int Fstages)
+{
+    type = Ftype;
+    q = Fq;
+    stages = std::min (Fstages, MAX_FILTER_STAGES);
+    qmode = 0;
+    oldq = 0.0f;
+    oldsq = 0.0f;
+    for (int k = 0; k < kLanes; k++)
+        oldf[k] = 0.0f;
+    a_smooth_tc = cSAMPLE_RATE/(cSAMPLE_RATE + 0.01f);  //10ms time constant for averaging coefficients
+    b_smooth_tc = 1.0f - a_smooth_tc;
+    cleanup ();
+    computefiltercoefs ();
+};
+
+void
+RBFilterBank::cleanup ()
+{
+    for (int i = 0; i < MAX_FILTER_STAGES + 1; i++)
+        st[i] = lanes{};
+};
+
+void
+RBFilterBank::computefiltercoefs ()
+{
+    // RBFilter::computeqcoefs, the frequency comes from fmod
+    if(!qmode) {
+        parq = 1.0f - atanf (sqrtf (q)) * 2.0f / PI;
+        parq = powf (parq, 1.0f / (float)(stages + 1));
+        parq_sqrt = sqrtf (parq);
+    } else {
+        if(q<0.5f) q = 0.5f;
+        parq = 1.0f/q;
+        parq = powf (parq, 1.0f / (float)(stages + 1));
+        parq_sqrt = 1.0f;
+    }
+};
+
+void
+RBFilterBank::setq (float q_)
+{
+    q = q_;
+    computefiltercoefs ();
+};
+
+void
+RBFilterBank::settype (int type_)
+{
+    type = type_;
+};
+
+void
+RBFilterBank::setmode (int mode)
+{
+    qmode = mode ? 1 : 0;
+};
+
+void
+RBFilterBank::filterout_s (const float * smp, const float * fmod, float * out)
+{
+    float v[kLanes], f[kLanes];
+    for (int k = 0; k < kLanes; k++) {
+        v[k] = smp[k];
+        f[k] = std::min (fabsf (fmod[k]), 0.99999f);
+    }
+
+    // Same steps as RBFilter::singlefilterout_s. Q is shared, so its
+    // smoothing is too.
+    for (int i = 0; i < stages + 1; i++) {
+        lanes &x = st[i];
+        const float sq = b_smooth_tc*oldsq + a_smooth_tc*parq_sqrt;
+        const float qq = b_smooth_tc*oldq + a_smooth_tc*parq;
+
+        for (int k = 0; k < kLanes; k++) {
+            const float sf = b_smooth_tc*oldf[k] + a_smooth_tc*f[k];   //modulation interpolation
+
+            x.low[k] = x.low[k] + sf * x.band[k];
+            x.high[k] = sq * v[k] - x.low[k] - qq * x.band[k];
+            x.band[k] = sf * x.high[k] + x.band[k];
+            x.notch[k] = x.high[k] + x.low[k];
+
+            oldf[k] = f[k];
+        }
+
+        switch (type) {
+        case 0:
+            std::copy (x.low, x.low + kLanes, v);
+            break;
+        case 1:
+            std::copy (x.high, x.high + kLanes, v);
+            break;
+        case 2:
+            std::copy (x.band, x.band + kLanes, v);
+            break;
+        case 3:
+            std::copy (x.notch, x.notch + kLanes, v);
+            break;
+        };
+
+        oldq = parq;
+        oldsq = parq_sqrt;
+    }
+
+    std::copy (v, v + kLanes, out);
+};
@@ -37,6 +37,9 @@ public:
     ~RBFilter () = default;
     void filterout (float * smp);
     float filterout_s (float smp);
+    /// n samples in place, each as directmod (fmod[i]) then filterout_s,
+    /// with setq (qmod[i]) first unless qmod is null.
+    void filterout_mod (float * smp, const float * fmod, const float * qmod, int n);
 
     void setfreq (float frequency);
     void setfreq_and_q (float frequency, float q_);
@@ -66,7 +69,7 @@ private:
     void singlefilterout (float * smp, fstage & x, parameters & par);
     float singlefilterout_s (float smp, fstage & x, parameters & par);
     void computefiltercoefs ();
-    void computefiltercoefs_hiQ ();
+    void computeqcoefs ();
 
     int type;			//The type of the filter (LPF1,HPF1,LPF2,HPF2...)
     int stages;			//how many times the filter is applied (0->1,1->2,etc.)
@@ -86,4 +89,39 @@ private:
 };
 
 
+/// kLanes band-limited RBFilters in directmod mode that share their type,
+/// stages and Q, stepped through a sample together with one lane each.
+/// Lane k of filterout_s does what directmod (fmod[k]) then filterout_s
+/// (smp[k]) does on an RBFilter of its own with the same settings and no
+/// setmix. Infinity runs its 16 band passes through one.
+class RBFilterBank
+{
+public:
+    static constexpr int kLanes = 16;
+
+    RBFilterBank (int Ftype, float Fq, int Fstages);
+    void filterout_s (const float * smp, const float * fmod, float * out);
+
+    void setq (float q_);
+    void settype (int type_);
+    void setmode (int mode);
+    void cleanup ();
+
+private:
+    void computefiltercoefs ();
+
+    struct lanes {
+        float low[kLanes], high[kLanes], band[kLanes], notch[kLanes];
+    } st[MAX_FILTER_STAGES + 1];
+
+    int type;
+    int stages;
+    int qmode;
+    float q;
+    float parq, parq_sqrt;
+    float oldq, oldsq, oldf[kLanes];
+    float a_smooth_tc, b_smooth_tc;
+};
+
+
 #endif
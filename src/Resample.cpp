@@ -1,7 +1,7 @@
 /*
 
   Resample.C  -  Class
-  Using Erik de Castro Lopo libsamplerate
+  Polyphase FIR sample rate converter
   Copyright (C) 2008-2009 Josep Andreu (Holborn)
   Author: Josep Andreu
 
@@ -21,78 +21,201 @@
 
 */
 
-#include <cstdio>
-#include <cstdlib>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include "Resample.hpp"
 
-
-Resample::Resample(int type)
+namespace
 {
-    statel = src_new(type , 1 , &errorl);
-    stater = src_new(type , 1 , &errorr);
 
-}
+struct Quality {
+    double atten;   // stopband, dB
+    double pass;    // passband edge, fraction of the lower Nyquist
+};
 
-Resample::~Resample()
+constexpr Quality kQuality[] = {
+    {120.0, 0.94},
+    { 97.0, 0.86},
+    { 97.0, 0.80},
+    { 40.0, 0.50},
+    { 60.0, 0.60},
+};
+
+// Zeroth order modified Bessel function of the first kind
+double
+bessel_i0 (double x)
 {
-    src_delete(statel);
-    src_delete(stater);
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; term > 1e-12 * sum; k++) {
+        term *= (x * x) / (4.0 * k * k);
+        sum += term;
+    }
+    return sum;
 }
 
-
+// Closest up / down to ratio with neither above kMaxPhases
 void
-Resample::cleanup()
+rational (double ratio, int &up, int &down)
 {
-    src_reset(statel);
-    src_reset(stater);
-
-};
+    long p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    double x = ratio;
+    for (int i = 0; i < 32; i++) {
+        long a = (long) floor (x);
+        long p2 = a * p1 + p0, q2 = a * q1 + q0;
+        if ((p2 > Resample::kMaxPhases) || (q2 > Resample::kMaxPhases))
+            break;
+        p0 = p1; q0 = q1; p1 = p2; q1 = q2;
+        if (fabs (x - (double) a) < 1e-9)
+            break;
+        x = 1.0 / (x - (double) a);
+    }
+    up = (int) std::max (p1, 1L);
+    down = (int) std::max (q1, 1L);
+}
 
+}
 
 
-void
-Resample::out(float *inl, float *inr, float *outl, float *outr, int frames, double ratio)
+Resample::Resample(int type, double ratio_)
+    : ratio(ratio_ > 0.0 ? ratio_ : 1.0)
 {
+    const Quality &q = kQuality[std::clamp (type, 0, 4)];
+    rational (ratio, up, down);
+
+    // Kaiser's estimate of the length for the transition band, at the input
+    // rate, then widened by the decimation factor when converting down
+    double length = (q.atten - 8.0) / (2.285 * M_PI * (1.0 - q.pass));
+    length *= std::max (1.0, (double) down / (double) up);
+    taps = ((int) ceil (length) + 7) & ~7;
+
+    double beta = 0.0;
+    if (q.atten > 50.0)
+        beta = 0.1102 * (q.atten - 8.7);
+    else if (q.atten > 21.0)
+        beta = 0.5842 * pow (q.atten - 21.0, 0.4) + 0.07886 * (q.atten - 21.0);
+
+    // Prototype at up times the input rate, cut off midway through the
+    // transition band below the lower of the two Nyquist frequencies
+    const int n = taps * up;
+    const double centre = 0.5 * (double) (n - 1);
+    const double fc = 0.25 * (1.0 + q.pass) / (double) std::max (up, down);
+    const double norm = 1.0 / bessel_i0 (beta);
+
+    coefs.resize((size_t) n);
+    for (int j = 0; j < n; j++) {
+        double t = (double) j - centre;
+        double s = (t == 0.0) ? 1.0 : sin (2.0 * M_PI * fc * t) / (2.0 * M_PI * fc * t);
+        double r = t / (centre + 0.5);
+        double w = bessel_i0 (beta * sqrt (std::max (0.0, 1.0 - r * r))) * norm;
+
+        // Tap j of phase j % up, which reads j / up frames back
+        int ph = j % up;
+        int k = taps - 1 - j / up;
+        coefs[(size_t) ph * taps + k] = (float) (2.0 * fc * (double) up * s * w);
+    }
+
+    hist.resize((size_t) 2 * (taps + kChunk));
+    cleanup();
+}
 
 
-    long int o_frames = lrint((double)frames*ratio);
-    srcinfol.data_in = inl;
-    srcinfol.input_frames = frames;
-    srcinfol.data_out = outl;
-    srcinfol.output_frames = o_frames;
-    srcinfol.src_ratio = ratio;
-    srcinfol.end_of_input = 0;
-
-    srcinfor.data_in = inr;
-    srcinfor.input_frames = frames;
-    srcinfor.data_out = outr;
-    srcinfor.output_frames = o_frames;
-    srcinfor.src_ratio = ratio;
-    srcinfor.end_of_input = 0;
-
-    errorl = src_process(statel, &srcinfol);
-    errorr = src_process(stater, &srcinfor);
+void
+Resample::cleanup()
+{
+    std::fill(hist.begin(), hist.end(), 0.0f);
+    base = 0;
+    phase = 0;
+}
 
 
+double
+Resample::latency() const
+{
+    return 0.5 * (double) (taps * up - 1) / (double) up;
 }
 
 
 void
-Resample::mono_out(float *inl, float *outl, int frames, double ratio, int o_frames)
+Resample::out(float *inl, float *inr, float *outl, float *outr, int frames)
 {
-
-    srcinfol.data_in = inl;
-    srcinfol.input_frames = frames;
-    srcinfol.data_out = outl;
-    srcinfol.output_frames = o_frames;
-    srcinfol.src_ratio = ratio;
-    srcinfol.end_of_input = 0;
-
-    errorl = src_process(statel, &srcinfol);
-
+    float *x = hist.data() + 2 * taps;
+    const int o_frames = (int) lrint((double) frames * ratio);
+    int done = 0;
+
+    for (int start = 0; start < frames; start += kChunk) {
+        const int n = std::min(kChunk, frames - start);
+        for (int i = 0; i < n; i++) {
+            x[2 * i] = inl[start + i];
+            x[2 * i + 1] = inr[start + i];
+        }
+        done = filter(n, o_frames, done, outl, outr);
+    }
+
+    for (; done < o_frames; done++)
+        outl[done] = outr[done] = 0.0f;
 }
 
 
+void
+Resample::mono_out(float *inl, float *outl, int frames, int o_frames)
+{
+    float *x = hist.data() + 2 * taps;
+    int done = 0;
+
+    for (int start = 0; start < frames; start += kChunk) {
+        const int n = std::min(kChunk, frames - start);
+        for (int i = 0; i < n; i++)
+            x[2 * i] = inl[start + i];
+        done = filter(n, o_frames, done, outl, nullptr);
+    }
+
+    for (; done < o_frames; done++)
+        outl[done] = 0.0f;
+}
 
 
+int
+Resample::filter(int n, int o_frames, int done, float *outl, float *outr)
+{
+    const int step = down / up, rem = down % up;
+
+    while ((base < n) && (done < o_frames)) {
+        // Frames base - taps + 1 .. base, interleaved
+        const float *x = hist.data() + 2 * (base + 1);
+        const float *c = coefs.data() + (size_t) phase * taps;
+
+        // Eight partial sums, even for left and odd for right, so the
+        // loop vectorizes without reassociating the adds
+        float acc[8] = {};
+        if (outr) {
+            for (int k = 0; k < taps; k += 4)
+                for (int j = 0; j < 4; j++) {
+                    acc[2 * j] += c[k + j] * x[2 * (k + j)];
+                    acc[2 * j + 1] += c[k + j] * x[2 * (k + j) + 1];
+                }
+            outl[done] = (acc[0] + acc[2]) + (acc[4] + acc[6]);
+            outr[done] = (acc[1] + acc[3]) + (acc[5] + acc[7]);
+        } else {
+            for (int k = 0; k < taps; k += 8)
+                for (int j = 0; j < 8; j++)
+                    acc[j] += c[k + j] * x[2 * (k + j)];
+            outl[done] = ((acc[0] + acc[1]) + (acc[2] + acc[3]))
+                         + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+        }
+        done++;
+
+        base += step;
+        phase += rem;
+        if (phase >= up) {
+            phase -= up;
+            base++;
+        }
+    }
+
+    // Keep the last taps frames for the next chunk
+    memmove(hist.data(), hist.data() + 2 * n, sizeof(float) * 2 * taps);
+    base = std::max(base - n, -1L);
+
+    return done;
+}
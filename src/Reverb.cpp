@@ -22,6 +22,7 @@
 
 */
 
+#include <algorithm>
 #include <cstdio>
 
 #include <cmath>
@@ -52,14 +53,15 @@ Reverb::Reverb ()
     Proomsize = 64;
     roomsize = 1.0f;
     rs = 1.0f;
-    rs_coeff = rs / (float) REV_COMBS;
+    rs_coeff = rs / sqrtf (8.0f * (float) REV_COMBS);
 
     for (int i = 0; i < REV_COMBS * 2; i++) {
         comblen[i] = 800 + (int) (RND() * 1400);
         combk[i] = 0;
-        lpcomb[i] = 0;
-        combfb[i] = -0.97f;
+        combs.lp[i] = 0;
+        combs.fb[i] = -0.97f;
     };
+    minlen = *std::min_element (comblen, comblen + REV_COMBS * 2);
 
     for (int i = 0; i < REV_APS * 2; i++) {
         aplen[i] = 500 + (int) (RND() * 500);
@@ -84,7 +86,7 @@ Reverb::cleanup ()
 {
     int i, j;
     for (i = 0; i < REV_COMBS * 2; i++) {
-        lpcomb[i] = 0.0;
+        combs.lp[i] = 0.0;
         for (j = 0; j < comblen[i]; j++)
             comb[i][j] = 0.0;
     };
@@ -104,47 +106,92 @@ Reverb::cleanup ()
 };
 
 /*
- * Process one channel; 0=left,1=right
+ * Run every comb, left and right, as one lane each. A block no longer than
+ * the shortest comb only reads what was written before it, so the delayed
+ * samples are gathered first, the damped feedback runs across the lanes,
+ * and the results go back into the rings.
  */
 void
-Reverb::processmono (int ch, float * output)
+Reverb::processcombs (float * outl, float * outr)
 {
-    int i, j;
-    float fbout, tmp;
-    //TODO: implement the high part from lohidamp
-
-    for (j = REV_COMBS * ch; j < REV_COMBS * (ch + 1); j++) {
-
-        int ck = combk[j];
-        int comblength = comblen[j];
-        float lpcombj = lpcomb[j];
-
-        for (i = 0; i < PERIOD; i++) {
-            fbout = comb[j][ck] * combfb[j];
-            fbout = fbout * (1.0f - lohifb) + (lpcombj * lohifb);
-            lpcombj = fbout;
-
-            comb[j][ck] = inputbuf[i] + fbout;
-            output[i] += fbout;
-
-            if ((++ck) >= comblength)
-                ck = 0;
-        };
-
-        combk[j] = ck;
-        lpcomb[j] = lpcombj;
-    };
+    constexpr int L = REV_COMBS * 2;
+    const float damp = 1.0f - lohifb;
+    comblanes &q = combs;
+
+    for (int start = 0; start < PERIOD; ) {
+        const int n = std::min ({minlen, kBlock, PERIOD - start});
+        const float *in = inputbuf.data () + start;
+
+        for (int j = 0; j < L; j++) {
+            const float *c = comb[j].data ();
+            int ck = combk[j];
+            for (int i = 0; i < n; ) {
+                const int m = std::min (comblen[j] - ck, n - i);
+                for (int k = 0; k < m; k++)
+                    q.io[i + k][j] = c[ck + k];
+                i += m;
+                ck += m;
+                if (ck >= comblen[j])
+                    ck = 0;
+            }
+        }
+
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < L; j++) {
+                float fbout = q.io[i][j] * q.fb[j];
+                fbout = fbout * damp + (q.lp[j] * lohifb);
+                q.lp[j] = fbout;
+                q.io[i][j] = fbout;
+            }
+
+        //summed comb by comb, in the order they always were
+        for (int j = 0; j < L; j++) {
+            float *c = comb[j].data ();
+            float *output = ((j < REV_COMBS) ? outl : outr) + start;
+            int ck = combk[j];
+            for (int i = 0; i < n; ) {
+                const int m = std::min (comblen[j] - ck, n - i);
+                for (int k = 0; k < m; k++) {
+                    const float fbout = q.io[i + k][j];
+                    c[ck + k] = in[i + k] + fbout;
+                    output[i + k] += fbout;
+                }
+                i += m;
+                ck += m;
+                if (ck >= comblen[j])
+                    ck = 0;
+            }
+            combk[j] = ck;
+        }
+
+        start += n;
+    }
+};
 
-    for (j = REV_APS * ch; j < REV_APS * (1 + ch); j++) {
+/*
+ * The allpasses of one channel; 0=left,1=right. Each sample only touches
+ * its own slot, so they run a contiguous stretch of the ring at a time.
+ */
+void
+Reverb::processaps (int ch, float * output)
+{
+    for (int j = REV_APS * ch; j < REV_APS * (1 + ch); j++) {
+        float *a = ap[j].data ();
         int ak = apk[j];
-        int aplength = aplen[j];
-        for (i = 0; i < PERIOD; i++) {
-            tmp = ap[j][ak];
-            ap[j][ak] = 0.7f * tmp + output[i];
-            output[i] = tmp - 0.7f * ap[j][ak];
-            if ((++ak) >= aplength)
+        for (int start = 0; start < PERIOD; ) {
+            const int n = std::min (aplen[j] - ak, PERIOD - start);
+            float *x = output + start;
+            for (int i = 0; i < n; i++) {
+                const float tmp = a[ak + i];
+                const float v = 0.7f * tmp + x[i];
+                a[ak + i] = v;
+                x[i] = tmp - 0.7f * v;
+            }
+            start += n;
+            ak += n;
+            if (ak >= aplen[j])
                 ak = 0;
-        };
+        }
         apk[j] = ak;
     };
 };
@@ -174,8 +221,9 @@ Reverb::out (float * smps_l, float * smps_r)
     lpf->filterout (inputbuf.data());
     hpf->filterout (inputbuf.data());
 
-    processmono (0, smps_l);	//left
-    processmono (1, smps_r);	//right
+    processcombs (smps_l, smps_r);
+    processaps (0, smps_l);	//left
+    processaps (1, smps_r);	//right
 
 
 
@@ -220,7 +268,7 @@ Reverb::settime (int Ptime)
     t = powf (60.0f, (float) Ptime / 127.0f) - 0.97f;
 
     for (i = 0; i < REV_COMBS * 2; i++) {
-        combfb[i] =
+        combs.fb[i] =
             -expf ((float) comblen[i] / fSAMPLE_RATE * logf (0.001f) /
                    t);
         //the feedback is negative because it removes the DC
@@ -294,11 +342,15 @@ void
 Reverb::settype (int Ptype)
 {
     const int NUM_TYPES = 2;
-    int combtunings[NUM_TYPES][REV_COMBS] = {
+    //the even entries are Freeverb's eight, the odd ones fill in for 16 combs
+    constexpr int MAX_COMBS = 16;
+    static_assert (REV_COMBS == 8 || REV_COMBS == 16, "REV_COMBS must be 8 or 16");
+    int combtunings[NUM_TYPES][MAX_COMBS] = {
         //this is unused (for random)
-        {0, 0, 0, 0, 0, 0, 0, 0},
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
         //Freeverb by Jezar at Dreampoint
-        {1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617}
+        {1116, 1151, 1188, 1237, 1277, 1319, 1356, 1399,
+         1422, 1453, 1491, 1523, 1557, 1583, 1617, 1657}
     };
     int aptunings[NUM_TYPES][REV_APS] = {
         //this is unused (for random)
@@ -316,7 +368,7 @@ Reverb::settype (int Ptype)
         if (Ptype == 0)
             tmp = 800.0f + (float)(RND()*1400.0f);
         else
-            tmp = (float)combtunings[Ptype][i % REV_COMBS];
+            tmp = (float)combtunings[Ptype][(i % REV_COMBS) * (MAX_COMBS / REV_COMBS)];
         tmp *= roomsize;
         if (i > REV_COMBS)
             tmp += 23.0f;
@@ -326,9 +378,10 @@ Reverb::settype (int Ptype)
 
         comblen[i] = lrintf(tmp);
         combk[i] = 0;
-        lpcomb[i] = 0;
+        combs.lp[i] = 0;
         comb[i].assign(comblen[i], 0.0f);
     };
+    minlen = *std::min_element (comblen, comblen + REV_COMBS * 2);
 
     for (int i = 0; i < REV_APS * 2; i++) {
         if (Ptype == 0)
@@ -360,12 +413,22 @@ Reverb::setroomsize (int Proomsize)
         roomsize *= 2.0f;
     roomsize = powf (10.0f, roomsize);
     rs = sqrtf (roomsize);
-    rs_coeff = rs / (float) REV_COMBS;
+    //uncorrelated combs add up as the square root of their number; 1/8 for 8
+    rs_coeff = rs / sqrtf (8.0f * (float) REV_COMBS);
     settype (Ptype);
 };
 
 void
 Reverb::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Reverb::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 12;
     const int NUM_PRESETS = 13;
@@ -403,12 +466,11 @@ Reverb::setpreset (int npreset)
 
         FPreset::ReadPreset(8,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
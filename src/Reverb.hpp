@@ -39,6 +39,7 @@ public:
     void cleanup ();
 
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
 
@@ -58,7 +59,8 @@ private:
     void setlpf (int Plpf);
     void settype (int Ptype);
     void setroomsize (int Proomsize);
-    void processmono (int ch, float * output);
+    void processcombs (float * outl, float * outr);
+    void processaps (int ch, float * output);
 
 
 
@@ -104,6 +106,7 @@ private:
     int idelaylen, rdelaylen;
     int idelayk;
     int comblen[REV_COMBS * 2];
+    int minlen;			//of the combs, the longest block processcombs() may run
     int aplen[REV_APS * 2];
 
 
@@ -120,8 +123,13 @@ private:
 
     std::vector<float> comb[REV_COMBS * 2];
 
-    float combfb[REV_COMBS * 2];	//feedback-ul fiecarui filtru "comb"
-    float lpcomb[REV_COMBS * 2];	//pentru Filtrul LowPass
+    //Every comb, left then right, one lane each
+    static constexpr int kBlock = 64;
+    struct comblanes {
+        float fb[REV_COMBS * 2];	//feedback-ul fiecarui filtru "comb"
+        float lp[REV_COMBS * 2];	//pentru Filtrul LowPass
+        float io[kBlock][REV_COMBS * 2];	//delayed samples in, feedback out
+    } combs;
 
     std::vector<float> ap[REV_APS * 2];
     std::vector<float> inputbuf;
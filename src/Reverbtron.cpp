@@ -21,6 +21,7 @@
 
 */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
@@ -28,9 +29,35 @@
 #include "Reverbtron.hpp"
 #include "FPreset.hpp"
 #include "EmbeddedResource.hpp"
+#include "FileCache.hpp"
 #include "portable_crt.hpp"
 
-Reverbtron::Reverbtron (int DS, int uq, int dq)
+namespace {
+/*
+ * The time/level points of a tap file, as read. Immutable, shared through
+ * the cache.
+ */
+struct Taps {
+    std::vector<float> ftime, tdata;
+    int data_length{};
+    float maxtime{}, maxdata{};
+};
+}
+
+static FileCache<Taps> tapfiles;
+
+// Longest run of samples out() convolves at once
+static constexpr int kRun = 64;
+
+/*
+ * A tap file for the audio thread. convert_time() turns the points into
+ * taps there.
+ */
+struct Reverbtron::TapFile : LoadedFile {
+    std::shared_ptr<const Taps> taps;
+};
+
+Reverbtron::Reverbtron (int DS, int uq, int dq, float maxlength)
 {
     //default values
     Ppreset = 0;
@@ -42,7 +69,7 @@ Reverbtron::Reverbtron (int DS, int uq, int dq)
     Plength = 50;
     Puser = 0;
     Psafe = 0;
-    convlength = 10.0f;  //max reverb time
+    convlength = maxlength;  //max reverb time
     fb = 0.0f;
     feedback = 0.0f;
     maxtime = 0.0f;
@@ -58,11 +85,12 @@ Reverbtron::Reverbtron (int DS, int uq, int dq)
     data.resize(2000);
     rnddata.resize(2000);
     tdata.resize(2000);
-    lxn.resize(1 + maxx_size);
+    oldtime.resize(2000);
+    olddata.resize(2000);
+    lxn = std::make_unique<MultiTap>(1 + maxx_size);
     hrtf.resize(1 + hrtf_size);
     imax = nSAMPLE_RATE/2;  // 1/2 second available
     imdelay.resize(imax);
-    offset = 0;
     hoffset = 0;
     data_length=0;
     hlength = 0;
@@ -77,10 +105,12 @@ Reverbtron::Reverbtron (int DS, int uq, int dq)
     lpfr->setSR(nSAMPLE_RATE);
 
 
-    U_Resample = std::make_unique<Resample>(dq);  //Downsample, uses sinc interpolation for bandlimiting to avoid aliasing
-    D_Resample = std::make_unique<Resample>(uq);
+    U_Resample = std::make_unique<Resample>(dq, u_up);  //Downsample, uses sinc interpolation for bandlimiting to avoid aliasing
+    D_Resample = std::make_unique<Resample>(uq, u_down);
+    loader = std::make_unique<FileLoader>([this] (const FileRequest &req) { return loadfile (req); }, !offline);
 
     setpreset (Ppreset);
+    waitfile ();
     cleanup ();
 };
 
@@ -92,7 +122,7 @@ Reverbtron::~Reverbtron () = default;
 void
 Reverbtron::cleanup ()
 {
-    std::fill(lxn.begin(), lxn.end(), 0.0f);
+    lxn->cleanup();
     std::fill(hrtf.begin(), hrtf.end(), 0.0f);
 
     feedback = 0.0f;
@@ -102,102 +132,128 @@ Reverbtron::cleanup ()
 
 };
 
+/*
+ * How many samples, up to n, a run of out() may cover: the taps of all of
+ * them are read before the feedback of any is added, and the feedback of a
+ * sample lands back - 1 samples before it.
+ */
+static int
+runlength(const std::vector<int> &time, int length, int back, int n)
+{
+    for (int j = 0; j < length; j++)
+        if (time[j] >= back)
+            n = std::min(n, time[j] - back + 1);
+    return n;
+}
+
 /*
  * Effect output
  */
 void
 Reverbtron::out (float * smpsl, float * smpsr)
 {
-    int i, j, xindex, hindex;
+    int i, j, n, hindex;
     float l,lyn, hyn;
     float ldiff,rdiff;
+    float lyns[kRun], oyns[kRun];
+    takefile();
     int length = Plength;
     hlength = Pdiff;
-    int doffset;
+    const float fstep = 1.0f / (float) nPERIOD;
+    const int back = static_cast<int>(roomsize);
+
+    int run = kRun;
+    if (back > 0) {
+        run = runlength(time, length, back, run);
+        if (fading)
+            run = runlength(oldtime, oldlength, back, run);
+    }
 
     if(DS_state != 0) {
         memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
         memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
     }
 
 
-    for (i = 0; i < nPERIOD; i++) {
+    for (i = 0; i < nPERIOD; i += n) {
+        n = std::min(nPERIOD - i, run);
 
-        l = 0.5f*(smpsr[i] + smpsl[i]);
-        oldl = l * hidamp + oldl * (alpha_hidamp);  //apply damping while I'm in the loop
-        if(Prv) {
-            oldl = 0.5f*oldl - smpsl[i];
+        for (j = 0; j < n; j++) {
+            l = 0.5f*(smpsr[i + j] + smpsl[i + j]);
+            oldl = l * hidamp + oldl * (alpha_hidamp);  //apply damping while I'm in the loop
+            if(Prv) {
+                oldl = 0.5f*oldl - smpsl[i + j];
+            }
+            lxn->write(oldl);
         }
 
-        lxn[offset] = oldl;
-
-        //Convolve
-        lyn = 0.0f;
-        xindex = offset;
-
-        for (j =0; j<length; j++) {
-            xindex = offset + time[j];
-            if(xindex>=maxx_size) xindex -= maxx_size;
-            lyn += lxn[xindex] * data[j];		//this is all of the magic
+        //Convolve, every tap over the whole run
+        std::fill_n(lyns, n, 0.0f);
+        lxn->sum(time.data(), data.data(), length, lyns, n);		//this is all of the magic
+        if(fading) {
+            std::fill_n(oyns, n, 0.0f);
+            lxn->sum(oldtime.data(), olddata.data(), oldlength, oyns, n);
         }
 
-        hrtf[hoffset] = lyn;
-
-        if(Pdiff > 0) {
-            //Convolve again with approximated hrtf
-            hyn = 0.0f;
-            hindex = hoffset;
-
-            for (j =0; j<hlength; j++) {
-                hindex = hoffset + rndtime[j];
-                if(hindex>=hrtf_size) hindex -= hrtf_size;
-                hyn += hrtf[hindex] * rnddata[j];		//more magic
+        for (j = 0; j < n; j++) {
+            lyn = lyns[j];
+            if(fading) {
+                //crossfade from the taps of the previous file
+                lyn = oyns[j] + (lyn - oyns[j]) * (float) (i + j + 1) * fstep;
             }
-            lyn = hyn + (1.0f - diffusion)*lyn;
-        }
 
-        if(Pes) { // just so I have the code to get started
+            hrtf[hoffset] = lyn;
 
-            ldiff = lyn;
-            rdiff = imdelay[imctr];
+            if(Pdiff > 0) {
+                //Convolve again with approximated hrtf
+                hyn = 0.0f;
+                hindex = hoffset;
 
-            ldiff = lpfl->filterout_s(ldiff);
-            rdiff = lpfr->filterout_s(rdiff);
+                for (int k =0; k<hlength; k++) {
+                    hindex = hoffset + rndtime[k];
+                    if(hindex>=hrtf_size) hindex -= hrtf_size;
+                    hyn += hrtf[hindex] * rnddata[k];		//more magic
+                }
+                lyn = hyn + (1.0f - diffusion)*lyn;
+            }
 
-            imdelay[imctr] = decay*ldiff;
-            imctr--;
-            if (imctr<0) imctr = static_cast<int>(roomsize);
+            if(Pes) { // just so I have the code to get started
 
-            templ[i] = (lyn + ldiff ) * levpanl;
-            tempr[i] = (lyn + rdiff ) * levpanr;
+                ldiff = lyn;
+                rdiff = imdelay[imctr];
 
-            feedback = fb*rdiff*decay;
+                ldiff = lpfl->filterout_s(ldiff);
+                rdiff = lpfr->filterout_s(rdiff);
 
-        } else {
-            feedback = fb * lyn;
-            templ[i] = lyn * levpanl;
-            tempr[i] = lyn * levpanr;
+                imdelay[imctr] = decay*ldiff;
+                imctr--;
+                if (imctr<0) imctr = static_cast<int>(roomsize);
 
-        }
+                templ[i + j] = (lyn + ldiff ) * levpanl;
+                tempr[i + j] = (lyn + rdiff ) * levpanr;
 
-        offset--;
-        if (offset<0) offset = maxx_size;
+                feedback = fb*rdiff*decay;
 
-        doffset = static_cast<int>(offset + roomsize);
-        if (doffset>maxx_size) doffset -= maxx_size;
+            } else {
+                feedback = fb * lyn;
+                templ[i + j] = lyn * levpanl;
+                tempr[i + j] = lyn * levpanr;
 
-        hoffset--;
-        if (hoffset<0) hoffset = hrtf_size;
+            }
 
-        lxn[doffset] += feedback;
+            hoffset--;
+            if (hoffset<0) hoffset = hrtf_size;
 
-        xindex = static_cast<int>(offset + roomsize);
+            if (back > 0)
+                lxn->add(n - 1 - j + back - 1, feedback);
+        }
 
     };
+    fading = false;
 
     if(DS_state != 0) {
-        D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD,u_down);
+        D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD);
 
     } else {
         memcpy(smpsl, templ.data(),sizeof(float)*PERIOD);
@@ -239,93 +295,139 @@ Reverbtron::setpanning (int value)
     levpanr=level*rpanning;
 };
 
-int
-Reverbtron::setfile(int value)
+/*
+ * Ask the loader for the tap file Filenum, or Filename when Puser is set.
+ */
+void
+Reverbtron::requestfile()
+{
+    FileRequest req;
+    req.num = Filenum;
+    req.user = Puser;
+    req.name = Filename;
+    loader->request(req);
+}
+
+/*
+ * RT thread. Put a newly parsed file in place. The delay history is kept
+ * and out() fades from the old taps to the new ones.
+ */
+void
+Reverbtron::takefile()
+{
+    TapFile *file = static_cast<TapFile *>(loader->take());
+    if (!file)
+        return;
+
+    std::copy_n(time.begin(), Plength, oldtime.begin());
+    std::copy_n(data.begin(), Plength, olddata.begin());
+    oldlength = Plength;
+    fading = true;
+
+    const Taps &taps = *file->taps;
+    std::copy(taps.ftime.begin(), taps.ftime.end(), ftime.begin());
+    std::copy(taps.tdata.begin(), taps.tdata.end(), tdata.begin());
+    data_length = taps.data_length;
+    maxtime = taps.maxtime;
+    maxdata = taps.maxdata;
+    if (!file->found) {
+        Plength = 2;
+        error_num = 2;
+    }
+    convert_time();
+    loader->retire(file);
+}
+
+void
+Reverbtron::waitfile()
+{
+    loader->wait();
+    takefile();
+    fading = false;
+}
+
+/*
+ * Files are looked up in the shared cache by the hash of their contents
+ * before they are parsed again.
+ */
+std::unique_ptr<LoadedFile>
+Reverbtron::loadfile(const FileRequest &req) const
 {
     int i;
     float compresion = 0.0f;
     float quality = 0.0f;
     char wbuf[128];
 
-    FILE *fs = nullptr;
-    std::unique_ptr<MemStream> ms;
-
-    if(!Puser) {
-        Filenum = value;
-        if(Filenum >= 0 && Filenum < NUM_RVB_RESOURCES) {
-            ms = std::make_unique<MemStream>(rvb_resources[Filenum].data,
-                                             *rvb_resources[Filenum].len);
-        } else {
-            loaddefault();
-            return(0);
-        }
-    } else {
-        if ((fs = rkr::portable_fopen (Filename.data(), "r")) == nullptr) {
-            loaddefault();
-            return(0);
+    auto file = std::make_unique<TapFile>();
+    auto taps = std::make_shared<Taps>();
+    taps->ftime.resize(2000);
+    taps->tdata.resize(2000);
+    std::vector<float> &ftime = taps->ftime, &tdata = taps->tdata;
+    int &data_length = taps->data_length;
+
+    std::vector<unsigned char> bytes;
+    const unsigned char *fdata = nullptr;
+    std::size_t size = 0;
+    if(!req.user) {
+        if(req.num >= 0 && req.num < NUM_RVB_RESOURCES) {
+            fdata = rvb_resources[req.num].data;
+            size = *rvb_resources[req.num].len;
         }
+    } else if (read_file(req.name.data(), bytes)) {
+        fdata = bytes.data();
+        size = bytes.size();
     }
 
-    auto readline = [&](char* buf, int bufsize) -> char* {
-        if (ms) return ms->gets(buf, bufsize);
-        return fgets(buf, bufsize, fs);
-    };
+    if (!fdata) {
+        //two taps stand in for a missing file
+        file->found = false;
+        data_length = 2;
+        ftime[0] = 1.0f;
+        ftime[1] = 1.25f;
+        tdata[0] = 0.75f;
+        tdata[1] = 0.5f;
+        taps->maxtime = 1.25f;
+        taps->maxdata = 0.75f;
+        file->taps = std::move(taps);
+        return file;
+    }
 
-    cleanup();
-    std::fill(tdata.begin(), tdata.end(), 0.0f);
-    std::fill(ftime.begin(), ftime.end(), 0.0f);
+    const FileKey key{file_hash(fdata, size)};
+    if ((file->taps = tapfiles.find(key)))
+        return file;
 
+    MemStream ms(fdata, size);
 
 //Name
     memset(wbuf,0, sizeof(wbuf));
-    readline(wbuf,sizeof wbuf);
+    ms.gets(wbuf,sizeof wbuf);
 
 // Subsample Compresion Skip
     memset(wbuf,0, sizeof(wbuf));
-    readline(wbuf,sizeof wbuf);
+    ms.gets(wbuf,sizeof wbuf);
     RKR_SSCANF(wbuf,"%f,%f\n",&compresion,&quality);
 
 //Length
     memset(wbuf,0,sizeof(wbuf));
-    readline(wbuf,sizeof wbuf);
+    ms.gets(wbuf,sizeof wbuf);
     RKR_SSCANF(wbuf, "%d\n", &data_length);
     if(data_length>2000) data_length = 2000;
+    if(data_length<0) data_length = 0;
 //Time Data
     for(i=0; i<data_length; i++) {
         memset(wbuf,0, sizeof(wbuf));
-        readline(wbuf,sizeof wbuf);
+        ms.gets(wbuf,sizeof wbuf);
         RKR_SSCANF(wbuf,"%f,%f\n",&ftime[i],&tdata[i]);
     }
 
-    if(fs) fclose(fs);
-
-    maxtime = 0.0f;
-    maxdata = 0.0f;
-    float averaget = 0.0f;
-    float tempor = 0.0f;
     for(i=0; i<data_length; i++) {
-        if(ftime[i] > maxtime) maxtime = ftime[i];
-        if(tdata[i] > maxdata) maxdata = tdata[i];  //used to normalize so feedback is more predictable
-        if(i>0) {
-            tempor = ftime[i] - ftime[i-1];
-            if(tempor>averaget) averaget = tempor;
-        }
+        if(ftime[i] > taps->maxtime) taps->maxtime = ftime[i];
+        if(tdata[i] > taps->maxdata) taps->maxdata = tdata[i];  //used to normalize so feedback is more predictable
     }
 
-    cleanup();
-    convert_time();
-    return(1);
+    file->taps = tapfiles.insert(key, std::move(taps));
+    return file;
 };
-void Reverbtron::loaddefault()
-{
-    data_length = Plength = 2;
-    ftime[0] = 1.0f;
-    ftime[1] = 1.25f;
-    tdata[0] = 0.75f;
-    tdata[1] = 0.5f;
-    cleanup();
-    convert_time();
-}
 
 void Reverbtron::convert_time()
 {
@@ -395,7 +497,7 @@ void Reverbtron::convert_time()
     for (i =0; i<hrtf_tmp; i++) {
         tmptime = (int) (RND() * hrtf_size);
         rndtime[i] = tmptime;  //randomly jumble the head of the transfer function
-        rnddata[i] = 3.0f*(0.5f - RND())*data[tmptime];
+        rnddata[i] = 3.0f*(0.5f - RND())*data[tmptime * Plength / hrtf_size];  //weight from a tap the file has
     }
 
     if(Pfade > 0) {
@@ -533,6 +635,15 @@ Reverbtron::adjust(int DS)
 
 void
 Reverbtron::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Reverbtron::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 16;
     const int NUM_PRESETS = 9;
@@ -561,12 +672,11 @@ Reverbtron::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(40,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
@@ -608,7 +718,8 @@ Reverbtron::changepar (int npar, int value)
         levpanr=level*rpanning;
         break;
     case 8:
-        if(!setfile(value)) error_num=2;
+        if(!Puser) Filenum = value;
+        requestfile();
         break;
     case 9:
         Pstretch = value;
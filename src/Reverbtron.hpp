@@ -24,24 +24,30 @@
 #ifndef REVERBTRON_H
 #define REVERBTRON_H
 
+#include <memory>
 #include "dsp_constants.hpp"
 #include "Resample.hpp"
 #include "AnalogFilter.hpp"
+#include "FileLoader.hpp"
+#include "MultiTap.hpp"
 #include "Effect.hpp"
 
 
 class Reverbtron : public Effect
 {
 public:
-    Reverbtron (int DS, int uq, int dq);
+    Reverbtron (int DS, int uq, int dq, float maxlength = 10.0f);
     ~Reverbtron ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
-    int setfile (int value);
     void adjust(int DS);
+    /// Not on the RT thread: wait for the tap file asked for last and put
+    /// it in place, for an instance that is not playing yet.
+    void waitfile();
 
 
 
@@ -56,7 +62,11 @@ private:
     void setlpf (int Plpf);
     void setfb(int value);
     void convert_time();
-    void loaddefault();
+    void requestfile();
+    void takefile();
+
+    /// Worker thread: reads and parses the tap file.
+    std::unique_ptr<LoadedFile> loadfile(const FileRequest &req) const;
 
 
     //Parametrii
@@ -80,7 +90,6 @@ private:
 
     int imctr{};
     int imax{};
-    int offset{};
     int hoffset{};
     int maxx_size{};
     int data_length{};
@@ -99,7 +108,7 @@ private:
 
     float fstretch, idelay, ffade, maxtime, maxdata, decay, diffusion;
     float lpanning, rpanning, hidamp, alpha_hidamp, convlength, oldl;
-    std::vector<float> data, lxn, imdelay, ftime, tdata, rnddata, hrtf;
+    std::vector<float> data, imdelay, ftime, tdata, rnddata, hrtf;
     std::vector<float> templ, tempr;
     float level,fb, feedback,levpanl,levpanr;
     float roomsize{};
@@ -109,6 +118,16 @@ private:
 
 
     std::unique_ptr<AnalogFilter> lpfl, lpfr;	//filters
+    std::unique_ptr<MultiTap> lxn;
+
+    // The taps of the file before the last one, faded out over one period
+    std::vector<int> oldtime;
+    std::vector<float> olddata;
+    int oldlength{};
+    bool fading{};
+
+    struct TapFile;
+    std::unique_ptr<FileLoader> loader;
 };
 
 
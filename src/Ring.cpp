@@ -136,7 +136,7 @@ Ring::out (float * smpsl, float * smpsr)
             smpsr[i] *= tmpfactor;
         }
         offset += Pfreq;
-        if (offset > SAMPLE_RATE) offset -=SAMPLE_RATE;
+        if (offset >= SAMPLE_RATE) offset -=SAMPLE_RATE;
     }
 
 
@@ -199,6 +199,15 @@ Ring::setscale()
 
 void
 Ring::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Ring::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 13;
     const int NUM_PRESETS = 6;
@@ -220,14 +229,13 @@ Ring::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(21,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 };
 
 
@@ -3,11 +3,12 @@
   SPDX-License-Identifier: GPL-2.0-only
 
   RingBuffer.hpp - Lock-free single-producer single-consumer ring buffer
-  for real-time audio thread to GUI thread communication.
+  for communication between the real-time audio thread and the GUI thread
+  (telemetry RT → GUI, parameter commands GUI → RT).
 
   Usage:
-    Producer (RT thread): push(item)
-    Consumer (GUI thread): pop(item)
+    Producer thread: push(item)
+    Consumer thread: pop(item)
 
   Both ends are wait-free. If the buffer is full, push() returns false
   (caller should drop the data — never block in the RT thread).
@@ -35,7 +36,7 @@ class RingBuffer
 public:
     RingBuffer() = default;
 
-    /// Push an element into the buffer (producer / RT thread).
+    /// Push an element into the buffer (producer thread).
     /// @return true if the element was written, false if the buffer was full.
     [[nodiscard]] bool push(const T& item) noexcept
     {
@@ -48,7 +49,7 @@ public:
         return true;
     }
 
-    /// Pop an element from the buffer (consumer / GUI thread).
+    /// Pop an element from the buffer (consumer thread).
     /// @return true if an element was read, false if the buffer was empty.
     [[nodiscard]] bool pop(T& item) noexcept
     {
@@ -60,6 +61,14 @@ public:
         return true;
     }
 
+    /// Free slots (producer side). The consumer only adds to them, so this
+    /// many push() calls in a row are sure to succeed.
+    [[nodiscard]] std::size_t space() const noexcept
+    {
+        return (m_tail.load(std::memory_order_acquire) -
+                m_head.load(std::memory_order_relaxed) - 1) & kMask;
+    }
+
     /// Check if the buffer is empty (consumer side).
     [[nodiscard]] bool empty() const noexcept
     {
@@ -56,6 +56,9 @@ RyanWah::RyanWah ()
     filterr = std::make_unique<RBFilter> (0, 80.0f, 70.0f, 1);
     
     sidechain_filter = std::make_unique<AnalogFilter> (1, 630.0f, 1.0f, 1);
+    fmodl.resize(PERIOD);
+    fmodr.resize(PERIOD);
+    qmod.resize(PERIOD);
     setpreset (Ppreset);
 
     cleanup ();
@@ -101,15 +104,21 @@ RyanWah::out (float * smpsl, float * smpsr)
             lmod = (minfreq + lfol + rms)*maxfreq;
             rmod = (minfreq + lfor + rms)*maxfreq;
             if(variq) q = f_pow2((2.0f*(1.0f-rms)+1.0f));
+            qmod[i] = q;
+            fmodl[i] = rmod;
+            fmodr[i] = lmod;
+        }
+    };
+
+    if (Pamode) {
+        //Q only needs setting per sample when it follows the envelope
+        if (!variq) {
             filterl->setq(q);
             filterr->setq(q);
-            filterl->directmod(rmod);
-            filterr->directmod(lmod);
-            smpsl[i] = filterl->filterout_s (smpsl[i]);
-            smpsr[i] = filterr->filterout_s (smpsr[i]);
-
         }
-    };
+        filterl->filterout_mod (smpsl, fmodl.data(), variq ? qmod.data() : nullptr, PERIOD);
+        filterr->filterout_mod (smpsr, fmodr.data(), variq ? qmod.data() : nullptr, PERIOD);
+    }
 
     if (!Pamode) {
         rms = ms1 * ampsns + oldfbias2;
@@ -203,6 +212,16 @@ RyanWah::reinitfilter ()
 
 void
 RyanWah::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+    reinitfilter ();
+};
+
+void
+RyanWah::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 19;
     const int NUM_PRESETS = 6;
@@ -225,16 +244,12 @@ RyanWah::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(31,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
-
-    reinitfilter ();
 };
 
 
@@ -38,6 +38,7 @@ public:
     void out (float * smpsl, float * smpsr);
 
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -85,6 +86,7 @@ private:
     EffectLFO lfo;		//lfo-ul RyanWah
     std::unique_ptr<RBFilter> filterl, filterr;
     std::unique_ptr<AnalogFilter> sidechain_filter;
+    std::vector<float> fmodl, fmodr, qmod;     //per sample modulation for filterout_mod
 };
 
 #endif
@@ -39,6 +39,7 @@ SVFilter::SVFilter (unsigned char Ftype, float Ffreq, float Fq,
     firsttime = 1;
     if (stages >= MAX_FILTER_STAGES)
         stages = MAX_FILTER_STAGES;
+    ismp.reserve (PERIOD);
     cleanup ();
     setfreq_and_q (Ffreq, Fq);
 };
@@ -141,37 +142,57 @@ void
 SVFilter::singlefilterout (float * smp, fstage & x, parameters & par)
 {
     int i;
-    float *out = nullptr;
+
+    // The state stays in registers; smp could alias it as a member
+    float low = x.low, high = x.high, band = x.band, notch = x.notch;
+    const float f = par.f, q = par.q, q_sqrt = par.q_sqrt;
+
     switch (type) {
     case 0:
-        out = &x.low;
+        for (i = 0; i < PERIOD; i++) {
+            low = low + f * band;
+            high = q_sqrt * smp[i] - low - q * band;
+            band = f * high + band;
+            smp[i] = low;
+        };
         break;
     case 1:
-        out = &x.high;
+        for (i = 0; i < PERIOD; i++) {
+            low = low + f * band;
+            high = q_sqrt * smp[i] - low - q * band;
+            band = f * high + band;
+            smp[i] = high;
+        };
         break;
     case 2:
-        out = &x.band;
+        for (i = 0; i < PERIOD; i++) {
+            low = low + f * band;
+            high = q_sqrt * smp[i] - low - q * band;
+            band = f * high + band;
+            smp[i] = band;
+        };
         break;
     case 3:
-        out = &x.notch;
+        for (i = 0; i < PERIOD; i++) {
+            low = low + f * band;
+            high = q_sqrt * smp[i] - low - q * band;
+            band = f * high + band;
+            smp[i] = high + low;
+        };
         break;
     };
+    notch = high + low;
 
-    for (i = 0; i < PERIOD; i++) {
-        x.low = x.low + par.f * x.band;
-        x.high = par.q_sqrt * smp[i] - x.low - par.q * x.band;
-        x.band = par.f * x.high + x.band;
-        x.notch = x.high + x.low;
-
-        smp[i] = *out;
-    };
+    x.low = low;
+    x.high = high;
+    x.band = band;
+    x.notch = notch;
 };
 
 void
 SVFilter::filterout (float * smp)
 {
     int i;
-    std::vector<float> ismp;
 
     if (needsinterpolation != 0) {
         ismp.assign(smp, smp + PERIOD);
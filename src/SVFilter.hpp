@@ -27,6 +27,8 @@
 
 #include "dsp_constants.hpp"
 #include "Filter_.hpp"
+#include <vector>
+
 class SVFilter:public Filter_
 {
 public:
@@ -71,6 +73,7 @@ private:
     float freq;		//Frequency given in Hz
     float q;			//Q factor (resonance or Q factor)
     float gain;		//the gain of the filter (if are shelf/peak) filters
+    std::vector<float> ismp{};  // the old coefficients' output while interpolating
 
 };
 
@@ -20,6 +20,7 @@
 
 */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
@@ -29,7 +30,10 @@
 #include <time.h>
 #include "f_sin.hpp"
 
-Sequence::Sequence (long int Quality, int DS, int uq, int dq)
+// Longest run of samples the delay mode reads at once
+static constexpr int kRun = 64;
+
+Sequence::Sequence (long int Quality, int DS, int uq, int dq, int pmode)
 {
     hq = Quality;
     adjust(DS);
@@ -40,8 +44,8 @@ Sequence::Sequence (long int Quality, int DS, int uq, int dq)
     outi.resize(nPERIOD);
     outo.resize(nPERIOD);
 
-    U_Resample = std::make_unique<Resample>(dq);
-    D_Resample = std::make_unique<Resample>(uq);
+    U_Resample = std::make_unique<Resample>(dq, u_up);
+    D_Resample = std::make_unique<Resample>(uq, u_down);
 
     beats = std::make_unique<beattracker>();
 
@@ -88,7 +92,7 @@ Sequence::Sequence (long int Quality, int DS, int uq, int dq)
     avtime = 0.25f;
     avflag = 1;
 
-    PS = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE);
+    PS = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE, pmode);
     PS->ratio = 1.0f;
 
     cleanup ();
@@ -306,7 +310,7 @@ Sequence::out (float * smpsl, float * smpsr)
         if(DS_state != 0) {
             memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
             memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-            U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+            U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
         }
 
 
@@ -346,7 +350,7 @@ Sequence::out (float * smpsl, float * smpsr)
         memcpy(tempr.data(), outo.data(), sizeof(float)*nPERIOD);
 
         if(DS_state != 0) {
-            D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD,u_down);
+            D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD);
         } else {
             memcpy(smpsl, templ.data(),sizeof(float)*PERIOD);
             memcpy(smpsr, tempr.data(),sizeof(float)*PERIOD);
@@ -422,7 +426,7 @@ Sequence::out (float * smpsl, float * smpsr)
         if(DS_state != 0) {
             memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
             memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-            U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+            U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
         }
 
 
@@ -457,7 +461,7 @@ Sequence::out (float * smpsl, float * smpsr)
         memcpy(tempr.data(), outo.data(), sizeof(float)*nPERIOD);
 
         if(DS_state != 0) {
-            D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD,u_down);
+            D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD);
         } else {
             memcpy(smpsl, templ.data(),sizeof(float)*nPERIOD);
             memcpy(smpsr, tempr.data(),sizeof(float)*nPERIOD);
@@ -476,7 +480,7 @@ Sequence::out (float * smpsl, float * smpsr)
         if(DS_state != 0) {
             memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
             memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-            U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+            U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
         }
 
 
@@ -526,7 +530,7 @@ Sequence::out (float * smpsl, float * smpsr)
         }
 
         if(DS_state != 0) {
-            D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD,u_down);
+            D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD);
         } else {
             memcpy(smpsl, templ.data(),sizeof(float)*nPERIOD);
             memcpy(smpsr, tempr.data(),sizeof(float)*nPERIOD);
@@ -614,6 +618,57 @@ Sequence::out (float * smpsl, float * smpsr)
 
     case 8:  //delay
 
+        if (!Pamplitude) {
+            int j, k, m, n;
+            float ltimes[kRun], rtimes[kRun], ltaps[kRun], rtaps[kRun];
+
+            for (i = 0; i < PERIOD; i += m) {
+                m = std::min(PERIOD - i, kRun);
+
+                for (j = 0; j < m; j++) { //Maintain sequenced modulator
+
+                    if (++tcount >= intperiod) {
+                        tcount = 0;
+                        scount++;
+                        if(scount > 7) scount = 0;  //reset to beginning of sequence buffer
+                        dscount = (scount + Pstdiff) % 8;
+                    }
+
+                    ltimes[j] = tempodiv*fsequence[scount];
+                    rtimes[j] = tempodiv*fsequence[dscount];
+                }
+
+                for (j = 0; j < m; j += n) {
+                    //Read as many samples as the delay allows, then write the
+                    //rest of them as their feedback comes out
+                    ldelay->write(ldlyfb + smpsl[i + j]);
+                    rdelay->write(rdlyfb + smpsr[i + j]);
+
+                    n = ldelay->span_simple(&ltimes[j], 0, m - j);
+                    n = rdelay->span_simple(&rtimes[j], 0, n);
+                    ldelay->read_simple(&ltimes[j], 0, ltaps, n);
+                    rdelay->read_simple(&rtimes[j], 0, rtaps, n);
+
+                    for (k = 0; k < n; k++) {
+                        if (k) {
+                            ldelay->write(ldlyfb + smpsl[i + j + k]);
+                            rdelay->write(rdlyfb + smpsr[i + j + k]);
+                        }
+
+                        smpsl[i + j + k] = ltaps[k];
+                        smpsr[i + j + k] = rtaps[k];
+
+                        ldlyfb = fb*smpsl[i + j + k];
+                        rdlyfb = fb*smpsr[i + j + k];
+                    }
+                }
+
+            }
+            break;
+        }
+
+        //delay() and delay_simple() both write each sample here, so it stays
+        //a sample at a time
         for ( i = 0; i < PERIOD; i++) { //Maintain sequenced modulator
 
             if (++tcount >= intperiod) {
@@ -824,6 +879,15 @@ Sequence::settempo(int value)
 
 void
 Sequence::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Sequence::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 15;
     const int NUM_PRESETS = 10;
@@ -854,12 +918,11 @@ Sequence::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(37,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
@@ -34,17 +34,21 @@
 class Sequence : public Effect
 {
 public:
-    Sequence (long int Quality, int DS, int uq, int dq);
+    Sequence (long int Quality, int DS, int uq, int dq, int pmode = PitchShifter::REFERENCE);
     ~Sequence ();
     void cleanup ();
     void out (float * smpsl, float * smpr);
     void changepar (int npar, int value);
     int getpar (int npar);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void setranges(int value);
     void settempo(int value);
     void adjust(int DS);
 
+    /// Delay through the pitch shifter, seconds
+    float latency () const { return PS->latency (); }
+
 
 
 
@@ -99,6 +99,15 @@ ShelfBoost::setvolume (int value)
 
 void
 ShelfBoost::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+ShelfBoost::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 5;
     const int NUM_PRESETS = 4;
@@ -117,14 +126,12 @@ ShelfBoost::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(34,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
-
+    changes.cleanup ();
 };
 
 
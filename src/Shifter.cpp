@@ -30,7 +30,7 @@
 
 
 
-Shifter::Shifter (long int Quality, int DS, int uq, int dq)
+Shifter::Shifter (long int Quality, int DS, int uq, int dq, int pmode)
 {
 
 
@@ -44,10 +44,10 @@ Shifter::Shifter (long int Quality, int DS, int uq, int dq)
     outi.resize(nPERIOD);
     outo.resize(nPERIOD);
 
-    U_Resample = std::make_unique<Resample>(dq);
-    D_Resample = std::make_unique<Resample>(uq);
+    U_Resample = std::make_unique<Resample>(dq, u_up);
+    D_Resample = std::make_unique<Resample>(uq, u_down);
 
-    PS = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE);
+    PS = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE, pmode);
     PS->ratio = 1.0f;
 
     state = IDLE;
@@ -174,7 +174,7 @@ Shifter::out (float *smpsl, float *smpsr)
     if(DS_state != 0) {
         memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
         memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
     }
 
     for (i=0; i < nPERIOD; i++) {
@@ -238,7 +238,7 @@ Shifter::out (float *smpsl, float *smpsr)
 
 
     if(DS_state != 0) {
-        D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD,u_down);
+        D_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,nPERIOD);
 
     } else {
         memcpy(smpsl, templ.data(),sizeof(float)*PERIOD);
@@ -294,6 +294,15 @@ Shifter::setinterval (int value)
 
 void
 Shifter::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Shifter::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 10;
     const int NUM_PRESETS = 5;
@@ -313,14 +322,11 @@ Shifter::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(38,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-
-
 };
 
 
@@ -41,16 +41,20 @@ class Shifter : public Effect
 {
 
 public:
-    Shifter (long int Quality, int DS, int uq, int dq);
+    Shifter (long int Quality, int DS, int uq, int dq, int pmode = PitchShifter::REFERENCE);
     ~Shifter ();
     void out (float *smpsl, float *smpsr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
     void applyfilters (float * smpsl);
     void adjust(int DS);
 
+    /// Delay through the pitch shifter, seconds
+    float latency () const { return PS->latency (); }
+
     long int hq;
 
     std::vector<float> outi;
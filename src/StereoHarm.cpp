@@ -30,7 +30,7 @@
 
 
 
-StereoHarm::StereoHarm (long int Quality, int DS, int uq, int dq)
+StereoHarm::StereoHarm (long int Quality, int DS, int uq, int dq, int pmode)
 {
 
 
@@ -48,18 +48,24 @@ StereoHarm::StereoHarm (long int Quality, int DS, int uq, int dq)
     outol.resize(nPERIOD);
     outor.resize(nPERIOD);
 
-    U_Resample = std::make_unique<Resample>(dq);
-    D_Resample = std::make_unique<Resample>(uq);
+    U_Resample = std::make_unique<Resample>(dq, u_up);
+    D_Resample = std::make_unique<Resample>(uq, u_down);
 
 
     chromel=0.0;
     chromer=0.0;
 
 
-    PSl = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE);
-    PSl->ratio = 1.0f;
-    PSr = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE);
-    PSr->ratio = 1.0f;
+    // FAST: one engine for both sides, so a mono source is analysed once.
+    // Only while L and R are bit-identical; otherwise both are analysed.
+    if (pmode == PitchShifter::FAST) {
+        PSl = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE, pmode, 2);
+    } else {
+        PSl = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE, pmode);
+        PSr = std::make_unique<PitchShifter> (window, hq, nfSAMPLE_RATE, pmode);
+    }
+    ratiol = 1.0f;
+    ratior = 1.0f;
 
     Ppreset = 0;
     PMIDI = 0;
@@ -99,7 +105,7 @@ StereoHarm::out (float *smpsl, float *smpsr)
     if(DS_state != 0) {
         memcpy(templ.data(), smpsl,sizeof(float)*PERIOD);
         memcpy(tempr.data(), smpsr,sizeof(float)*PERIOD);
-        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD,u_up);
+        U_Resample->out(templ.data(),tempr.data(),smpsl,smpsr,PERIOD);
     }
 
 
@@ -121,24 +127,31 @@ StereoHarm::out (float *smpsl, float *smpsr)
     }
 
     if ((PMIDI) || (PSELECT)) {
-        PSl->ratio = r__ratio[1];
-        PSr->ratio = r__ratio[2];
+        ratiol = r__ratio[1];
+        ratior = r__ratio[2];
     }
 
-    if (PSl->ratio != 1.0f) {
-        PSl->smbPitchShift (PSl->ratio, nPERIOD, window, hq, nfSAMPLE_RATE, outil.data(), outol.data());
-    } else
-        memcpy(outol.data(),outil.data(),sizeof(float)*nPERIOD);
-
+    if (PSr == nullptr) {
+        const float ratios[2] = {ratiol, ratior};
+        const float *in[2] = {outil.data(), outir.data()};
+        float *out[2] = {ratiol != 1.0f ? outol.data() : nullptr,
+                         ratior != 1.0f ? outor.data() : nullptr};
+        PSl->shiftVoices (ratios, nPERIOD, in, out);
+    } else {
+        if (ratiol != 1.0f)
+            PSl->smbPitchShift (ratiol, nPERIOD, window, hq, nfSAMPLE_RATE, outil.data(), outol.data());
+        if (ratior != 1.0f)
+            PSr->smbPitchShift (ratior, nPERIOD, window, hq, nfSAMPLE_RATE, outir.data(), outor.data());
+    }
 
-    if (PSr->ratio != 1.0f) {
-        PSr->smbPitchShift (PSr->ratio, nPERIOD, window, hq, nfSAMPLE_RATE, outir.data(), outor.data());
-    } else
+    if (ratiol == 1.0f)
+        memcpy(outol.data(),outil.data(),sizeof(float)*nPERIOD);
+    if (ratior == 1.0f)
         memcpy(outor.data(),outir.data(),sizeof(float)*nPERIOD);
 
 
     if(DS_state != 0) {
-        D_Resample->out(outol.data(),outor.data(),templ.data(),tempr.data(),nPERIOD,u_down);
+        D_Resample->out(outol.data(),outor.data(),templ.data(),tempr.data(),nPERIOD);
     } else {
         memcpy(templ.data(), outol.data(),sizeof(float)*PERIOD);
         memcpy(tempr.data(), outor.data(),sizeof(float)*PERIOD);
@@ -194,7 +207,7 @@ StereoHarm::setinterval (int chan, int value)
     case 0:
         Pintervall = value;
         intervall = (float)Pintervall - 12.0f;
-        PSl->ratio = powf(2.0f,intervall / 12.0f)+chromel;
+        ratiol = powf(2.0f,intervall / 12.0f)+chromel;
         if (Pintervall % 12 == 0)
             mira = 0;
         else
@@ -204,7 +217,7 @@ StereoHarm::setinterval (int chan, int value)
     case 1:
         Pintervalr = value;
         intervalr = (float)Pintervalr - 12.0f;
-        PSr->ratio = powf(2.0f,intervalr / 12.0f)+chromer;
+        ratior = powf(2.0f,intervalr / 12.0f)+chromer;
         if (Pintervalr % 12 == 0)
             mira = 0;
         else
@@ -242,12 +255,12 @@ StereoHarm::setchrome (int chan, int value)
     case 0:
         Pchromel=value;
         chromel=(max-min)/4000.0f*(float)value;
-        PSl->ratio=powf(2.0f,intervall/12.0f)+chromel;
+        ratiol=powf(2.0f,intervall/12.0f)+chromel;
         break;
     case 1:
         Pchromer=value;
         chromer=(max-min)/4000.0f*(float)value;
-        PSr->ratio=powf(2.0f,intervalr/12.0f)+chromer;
+        ratior=powf(2.0f,intervalr/12.0f)+chromer;
         break;
     }
 
@@ -361,6 +374,15 @@ StereoHarm::setlrcross (int value)
 
 void
 StereoHarm::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+StereoHarm::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 12;
     const int NUM_PRESETS = 4;
@@ -376,19 +398,15 @@ StereoHarm::setpreset (int npreset)
 
     };
 
-    cleanup();
+    changes.cleanup ();
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(42,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
-
-
 };
 
 
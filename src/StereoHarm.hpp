@@ -36,15 +36,19 @@ class StereoHarm : public Effect
 {
 
 public:
-    StereoHarm (long int Quality, int DS, int uq, int dq);
+    StereoHarm (long int Quality, int DS, int uq, int dq, int pmode = PitchShifter::REFERENCE);
     ~StereoHarm ();
     void out (float *smpsl, float *smpsr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
     void adjust(int DS);
 
+    /// Delay through the pitch shifter, seconds
+    float latency () const { return PSl->latency (); }
+
 
     int Pintervall;
     int Pintervalr;
@@ -84,6 +88,7 @@ private:
 
 
     float gainl,gainr;
+    float ratiol,ratior;
     float intervall;
     float intervalr;
     float chromel;
@@ -99,7 +104,7 @@ private:
     std::unique_ptr<Resample> U_Resample;
     std::unique_ptr<Resample> D_Resample;
 
-    std::unique_ptr<PitchShifter> PSl, PSr;
+    std::unique_ptr<PitchShifter> PSl, PSr;    // PSr only in REFERENCE mode
 };
 
 #endif
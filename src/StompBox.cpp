@@ -26,7 +26,7 @@
 
 
 
-StompBox::StompBox ()
+StompBox::StompBox (int oversample)
 {
 
 
@@ -56,10 +56,10 @@ StompBox::StompBox ()
     ranti = std::make_unique<AnalogFilter> (0, 6000.0f, 0.707f, 1);
     lanti = std::make_unique<AnalogFilter> (0, 6000.0f, 0.707f, 1);
 
-    rwshape = std::make_unique<Waveshaper>();
-    lwshape = std::make_unique<Waveshaper>();
-    rwshape2 = std::make_unique<Waveshaper>();
-    lwshape2 = std::make_unique<Waveshaper>();
+    rwshape = std::make_unique<Waveshaper>(oversample);
+    lwshape = std::make_unique<Waveshaper>(oversample);
+    rwshape2 = std::make_unique<Waveshaper>(oversample);
+    lwshape2 = std::make_unique<Waveshaper>(oversample);
 
     cleanup ();
 
@@ -815,6 +815,15 @@ StompBox::setvolume (int value)
 
 void
 StompBox::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+StompBox::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 6;
     const int NUM_PRESETS = 8;
@@ -840,14 +849,12 @@ StompBox::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(39,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
-
+    changes.cleanup ();
 };
 
 
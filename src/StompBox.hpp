@@ -30,10 +30,12 @@
 class StompBox : public Effect
 {
 public:
-    StompBox ();
+    /// oversample as for Waveshaper
+    StompBox (int oversample = 0);
     ~StompBox ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -116,6 +116,15 @@ Sustainer::out (float * smpsl, float * smpsr)
 
 void
 Sustainer::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Sustainer::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 2;
     const int NUM_PRESETS = 3;
@@ -132,12 +141,11 @@ Sustainer::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(36,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
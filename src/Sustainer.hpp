@@ -37,6 +37,7 @@ public:
     void changepar (int npar, int value);
     int getpar (int npar);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
 
 
 
@@ -272,6 +272,15 @@ Synthfilter::setdepth (int Pdepth)
 
 void
 Synthfilter::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Synthfilter::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 16;
     const int NUM_PRESETS = 7;
@@ -297,13 +306,12 @@ Synthfilter::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(27,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
 
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
 };
 
 
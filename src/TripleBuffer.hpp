@@ -0,0 +1,65 @@
+/*
+  rakarrack - aass multi-effects processor
+  SPDX-License-Identifier: GPL-2.0-only
+
+  TripleBuffer.hpp - Lock-free single-producer single-consumer mailbox for
+  snapshots the real-time thread publishes to the GUI thread, where only
+  the most recent one matters (levels, tuner, tap tempo, effect timing).
+
+  Usage:
+    Producer thread: write(item)
+    Consumer thread: read(item)
+
+  Both ends are wait-free and never fail: write() replaces a snapshot the
+  consumer has not read yet, so nothing backs up while the GUI is not
+  polling.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+/// Lock-free SPSC mailbox holding the latest snapshot written.
+/// @tparam T  Element type (must be trivially copyable for RT safety)
+template <typename T>
+class TripleBuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "TripleBuffer element must be trivially copyable");
+
+public:
+    TripleBuffer() = default;
+
+    /// Publish a snapshot (producer thread).
+    void write(const T& item) noexcept
+    {
+        m_slots[m_back] = item;
+        const auto prev = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel);
+        m_back = prev & kIndex;
+    }
+
+    /// Take the latest snapshot (consumer thread).
+    /// @return true if one was written since the last read.
+    [[nodiscard]] bool read(T& item) noexcept
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & kFresh))
+            return false;
+        const auto prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = prev & kIndex;
+        item = m_slots[m_front];
+        return true;
+    }
+
+private:
+    static constexpr unsigned kIndex = 3;
+    static constexpr unsigned kFresh = 4;
+
+    // The three slots rotate between the producer (back), the exchange
+    // (middle, flagged fresh once written) and the consumer (front).
+    alignas(64) unsigned                 m_back{0};   // producer only
+    alignas(64) std::atomic<unsigned>    m_middle{1};
+    alignas(64) unsigned                 m_front{2};  // consumer only
+    alignas(64) std::array<T, 3>         m_slots{};
+};
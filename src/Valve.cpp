@@ -31,8 +31,16 @@
 
 
 
-Valve::Valve ()
+Valve::Valve (int oversample)
 {
+    period_coeff = Waveshaper::oversample (oversample);
+    if (period_coeff > 1) {
+        tmpl.resize(PERIOD * period_coeff);
+        tmpr.resize(PERIOD * period_coeff);
+        U_Resample = std::make_unique<Resample>(Wave_up_q, (double) period_coeff);
+        D_Resample = std::make_unique<Resample>(Wave_down_q, 1.0 / (double) period_coeff);
+    }
+
     lpfl = std::make_unique<AnalogFilter> (2, 22000.0f, 1.0f, 0);
     lpfr = std::make_unique<AnalogFilter> (2, 22000.0f, 1.0f, 0);
     hpfl = std::make_unique<AnalogFilter> (3, 20.0f, 1.0f, 0);
@@ -57,7 +65,7 @@ Valve::Valve ()
     dist = 0.0f;
     setlpf(127);
     sethpf(1);
-    atk = 1.0f - 40.0f/fSAMPLE_RATE;
+    atk = 1.0f - 40.0f/(fSAMPLE_RATE * (float) period_coeff);
 
     for(int i=0; i<10; i++) rm[i]=0.0;
     rm[0]=1.0f;
@@ -84,6 +92,10 @@ Valve::cleanup ()
     hpfl->cleanup ();
     lpfr->cleanup ();
     hpfr->cleanup ();
+    if (period_coeff > 1) {
+        U_Resample->cleanup ();
+        D_Resample->cleanup ();
+    }
     otml = 0.0f;
     itml=0.0f;
     otmr=0.0f;
@@ -102,14 +114,9 @@ Valve::cleanup ()
 void
 Valve::applyfilters (float * smpsl, float * smpsr)
 {
-    lpfl->filterout (smpsl);
-    hpfl->filterout (smpsl);
-
-    if (Pstereo != 0) {
-        //stereo
-        lpfr->filterout (smpsr);
-        hpfr->filterout (smpsr);
-    };
+    AnalogFilter *l[] = {lpfl.get(), hpfl.get()};
+    AnalogFilter *r[] = {lpfr.get(), hpfr.get()};
+    AnalogFilter::filterout_cascade (l, (Pstereo != 0) ? r : nullptr, 2, smpsl, smpsr);
 
 };
 
@@ -127,43 +134,22 @@ Valve::Wshape(float x)
 
 
 /*
- * Effect output
+ * The nonlinear stage, on n samples at the oversampled rate
  */
 void
-Valve::out (float * smpsl, float * smpsr)
+Valve::shape (float * smpsl, float * smpsr, int n)
 {
     int i;
-
-    float l, r, lout, rout, fx;
-
-
-    if (Pstereo != 0) {
-        //Stereo
-        for (i = 0; i < PERIOD; i++) {
-            smpsl[i] = smpsl[i] * inputvol;
-            smpsr[i] = smpsr[i] * inputvol;
-        };
-    } else {
-        for (i = 0; i < PERIOD; i++) {
-            smpsl[i] =
-                (smpsl[i]  +  smpsr[i] ) * inputvol;
-        };
-    };
-
-    harm->harm_out(smpsl,smpsr);
-
-
-    if (Pprefiltering != 0)
-        applyfilters (smpsl, smpsr);
+    float fx;
 
     if(Ped) {
-        for (i =0; i<PERIOD; i++) {
+        for (i =0; i<n; i++) {
             smpsl[i]=Wshape(smpsl[i]);
             if (Pstereo != 0) smpsr[i]=Wshape(smpsr[i]);
         }
     }
 
-    for (i =0; i<PERIOD; i++) { //soft limiting to 3.0 (max)
+    for (i =0; i<n; i++) { //soft limiting to 3.0 (max)
         fx = smpsl[i];
         if (fx>1.0f) fx = 3.0f - 2.0f/sqrtf(fx);
         smpsl[i] = fx;
@@ -173,7 +159,7 @@ Valve::out (float * smpsl, float * smpsr)
     }
 
     if (q == 0.0f) {
-        for (i =0; i<PERIOD; i++) {
+        for (i =0; i<n; i++) {
             if (smpsl[i] == q) fx = fdist;
             else fx =smpsl[i] / (1.0f - powf(2.0f,-dist * smpsl[i] ));
             otml = atk * otml + fx - itml;
@@ -181,7 +167,7 @@ Valve::out (float * smpsl, float * smpsr)
             smpsl[i]= otml;
         }
     } else {
-        for (i = 0; i < PERIOD; i++) {
+        for (i = 0; i < n; i++) {
             if (smpsl[i] == q) fx = fdist + qcoef;
             else fx =(smpsl[i] - q) / (1.0f - powf(2.0f,-dist * (smpsl[i] - q))) + qcoef;
             otml = atk * otml + fx - itml;
@@ -195,7 +181,7 @@ Valve::out (float * smpsl, float * smpsr)
     if (Pstereo != 0) {
 
         if (q == 0.0f) {
-            for (i =0; i<PERIOD; i++) {
+            for (i =0; i<n; i++) {
                 if (smpsr[i] == q) fx = fdist;
                 else fx = smpsr[i] / (1.0f - powf(2.0f,-dist * smpsr[i] ));
                 otmr = atk * otmr + fx - itmr;
@@ -204,7 +190,7 @@ Valve::out (float * smpsl, float * smpsr)
 
             }
         } else {
-            for (i = 0; i < PERIOD; i++) {
+            for (i = 0; i < n; i++) {
                 if (smpsr[i] == q) fx = fdist + qcoef;
                 else fx = (smpsr[i] - q) / (1.0f - powf(2.0f,-dist * (smpsr[i] - q))) + qcoef;
                 otmr = atk * otmr + fx - itmr;
@@ -215,7 +201,52 @@ Valve::out (float * smpsl, float * smpsr)
         }
 
     }
+};
+
+
+/*
+ * Effect output
+ */
+void
+Valve::out (float * smpsl, float * smpsr)
+{
+    int i;
 
+    float l, r, lout, rout;
+
+
+    if (Pstereo != 0) {
+        //Stereo
+        for (i = 0; i < PERIOD; i++) {
+            smpsl[i] = smpsl[i] * inputvol;
+            smpsr[i] = smpsr[i] * inputvol;
+        };
+    } else {
+        for (i = 0; i < PERIOD; i++) {
+            smpsl[i] =
+                (smpsl[i]  +  smpsr[i] ) * inputvol;
+        };
+    };
+
+    harm->harm_out(smpsl,smpsr);
+
+
+    if (Pprefiltering != 0)
+        applyfilters (smpsl, smpsr);
+
+    if (period_coeff > 1) {
+        const int n = PERIOD * period_coeff;
+        if (Pstereo != 0) {
+            U_Resample->out (smpsl, smpsr, tmpl.data(), tmpr.data(), PERIOD);
+            shape (tmpl.data(), tmpr.data(), n);
+            D_Resample->out (tmpl.data(), tmpr.data(), smpsl, smpsr, n);
+        } else {
+            U_Resample->mono_out (smpsl, tmpl.data(), PERIOD, n);
+            shape (tmpl.data(), tmpr.data(), n);
+            D_Resample->mono_out (tmpl.data(), smpsl, n, PERIOD);
+        }
+    } else
+        shape (smpsl, smpsr, PERIOD);
 
 
     if (Pprefiltering == 0)
@@ -327,6 +358,15 @@ Valve::setpresence(int value)
 
 void
 Valve::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Valve::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 13;
     const int NUM_PRESETS = 3;
@@ -343,13 +383,12 @@ Valve::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(19,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-    Ppreset = npreset;
-    cleanup ();
+    changes.cleanup ();
 };
 
 
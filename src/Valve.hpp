@@ -27,15 +27,18 @@
 #include "dsp_constants.hpp"
 #include "AnalogFilter.hpp"
 #include "HarmonicEnhancer.hpp"
+#include "Waveshaper.hpp"
 #include "Effect.hpp"
 
 class Valve : public Effect
 {
 public:
-    Valve ();
+    /// oversample as for Waveshaper, around the tube stage only
+    Valve (int oversample = 0);
     ~Valve ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     float Wshape(float x);
@@ -52,6 +55,7 @@ private:
     void sethpf (int Phpf);
     void setpresence(int value);
     void init_coefs();
+    void shape (float * smpsl, float * smpsr, int n);
 
 
     //Parametrii
@@ -80,6 +84,11 @@ private:
 
     std::unique_ptr<AnalogFilter> lpfl, lpfr, hpfl, hpfr;
     std::unique_ptr<HarmEnhancer> harm;
+
+    int period_coeff;
+    std::vector<float> tmpl, tmpr;
+    std::unique_ptr<Resample> U_Resample;
+    std::unique_ptr<Resample> D_Resample;
 };
 
 
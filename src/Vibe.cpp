@@ -79,7 +79,16 @@ Vibe::~Vibe ()
 void
 Vibe::cleanup ()
 {
-
+    for(int i = 0; i < 8; i++) {
+        vc[i].x1 = vc[i].y1 = 0.0f;
+        ecvc[i].x1 = ecvc[i].y1 = 0.0f;
+        vcvo[i].x1 = vcvo[i].y1 = 0.0f;
+        vevo[i].x1 = vevo[i].y1 = 0.0f;
+        oldcvolt[i] = 0.0f;
+    }
+    fbl = fbr = 0.0f;
+    stepl = stepr = 0.0f;
+    oldstepl = oldstepr = 0.0f;
 
 };
 
@@ -486,6 +495,14 @@ Vibe::setvolume (int value)
 
 void
 Vibe::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+};
+
+void
+Vibe::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 11;
     const int NUM_PRESETS = 8;
@@ -512,12 +529,11 @@ Vibe::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(45,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
 };
 
 void
@@ -42,6 +42,7 @@ public:
     void setvolume(int value);
     void setpanning(int value);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
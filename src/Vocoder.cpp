@@ -43,7 +43,9 @@ Vocoder::Vocoder (float *auxresampled_,int bands, int DS, int uq, int dq)
     Ppanning = 64;
     Plrcross = 100;
 
-    filterbank.resize(VOC_BANDS);
+    bank.assign((VOC_BANDS + kLanes - 1) / kLanes, bandgroup{});
+    sfreq.resize(VOC_BANDS);
+    sq.resize(VOC_BANDS);
     tmpl.resize(nPERIOD);
     tmpr.resize(nPERIOD);
     tsmpsl.resize(nPERIOD);
@@ -68,25 +70,9 @@ Vocoder::Vocoder (float *auxresampled_,int bands, int DS, int uq, int dq)
     cratio = 0.25f;
 
 
-    float center;
-    float qq;
-
-    A_Resample = std::make_unique<Resample>(dq);
-    U_Resample = std::make_unique<Resample>(dq);
-    D_Resample = std::make_unique<Resample>(uq);
-
-
-    for (int i = 0; i < VOC_BANDS; i++) {
-        center = (float) i * 20000.0f/((float) VOC_BANDS);
-        qq = 60.0f;
-
-        filterbank[i].l = std::make_unique<AnalogFilter> (4, center, qq, 0);
-        filterbank[i].l->setSR(nSAMPLE_RATE);
-        filterbank[i].r = std::make_unique<AnalogFilter> (4, center, qq, 0);
-        filterbank[i].r->setSR(nSAMPLE_RATE);
-        filterbank[i].aux = std::make_unique<AnalogFilter> (4, center, qq, 0);
-        filterbank[i].aux->setSR(nSAMPLE_RATE);
-    };
+    A_Resample = std::make_unique<Resample>(dq, u_up);
+    U_Resample = std::make_unique<Resample>(dq, u_up);
+    D_Resample = std::make_unique<Resample>(uq, u_down);
 
     vlp = std::make_unique<AnalogFilter> (2, 4000.0f, 1.0f, 1);
     vhp = std::make_unique<AnalogFilter> (3, 200.0f, 0.707f, 1);
@@ -107,15 +93,8 @@ Vocoder::~Vocoder () = default;
 void
 Vocoder::cleanup ()
 {
-    for(int k=0; k<VOC_BANDS; k++) {
-        filterbank[k].l->cleanup();
-        filterbank[k].r->cleanup();
-        filterbank[k].aux->cleanup();
-        filterbank[k].speak = 0.0f;
-        filterbank[k].gain = 0.0f;
-        filterbank[k].oldgain = 0.0f;
-
-    }
+    for (bandgroup &g : bank)   // the state, ax1 through oldgain
+        std::fill(std::begin(g.ax1), std::end(g.oldgain), 0.0f);
     vhp->cleanup();
     vlp->cleanup();
 
@@ -221,7 +200,7 @@ Vocoder::out (float * smpsl, float * smpsr)
 
 
     if(DS_state != 0) {
-        A_Resample->mono_out(auxresampled,tmpaux.data(),PERIOD,u_up,nPERIOD);
+        A_Resample->mono_out(auxresampled,tmpaux.data(),PERIOD,nPERIOD);
     } else
         memcpy(tmpaux.data(),auxresampled,sizeof(float)*nPERIOD);
 
@@ -259,43 +238,63 @@ Vocoder::out (float * smpsl, float * smpsr)
     auxtemp = 0.0f;
 
     if(DS_state != 0) {
-        U_Resample->out(smpsl,smpsr,tsmpsl.data(),tsmpsr.data(),PERIOD,u_up);
+        U_Resample->out(smpsl,smpsr,tsmpsl.data(),tsmpsr.data(),PERIOD);
     } else {
         memcpy(tsmpsl.data(),smpsl,sizeof(float)*nPERIOD);
         memcpy(tsmpsr.data(),smpsr,sizeof(float)*nPERIOD);
     }
 
 
-    memset(tmpl.data(),0,sizeof(float)*nPERIOD);
-    memset(tmpr.data(),0,sizeof(float)*nPERIOD);
-
-
-
-    for (j = 0; j < VOC_BANDS; j++) {
+    for (i = 0; i<nPERIOD; i++)
+        if(tmpaux[i]>maxgain) maxgain = tmpaux[i]; //vu meter level.
 
-        for (i = 0; i<nPERIOD; i++) {
-            auxtemp = tmpaux[i];
-
-            if(filterbank[j].speak < gate) filterbank[j].speak = 0.0f;  //gate
-            if(auxtemp>maxgain) maxgain = auxtemp; //vu meter level.
-
-            auxtemp = filterbank[j].aux->filterout_s(auxtemp);
-            if(fabs(auxtemp) > filterbank[j].speak) filterbank[j].speak = fabs(auxtemp);  //Leaky Peak detector
-
-            filterbank[j].speak*=prls;
-
-            filterbank[j].gain = beta * filterbank[j].oldgain + alpha * filterbank[j].speak;
-            filterbank[j].oldgain = filterbank[j].gain;
-
-
-            tempgain = (1.0f-ringworm)*filterbank[j].oldgain+ringworm*auxtemp;
-
-            tmpl[i] +=filterbank[j].l->filterout_s(tsmpsl[i])*tempgain;
-            tmpr[i] +=filterbank[j].r->filterout_s(tsmpsr[i])*tempgain;
-
-        };
+    const float g = gate, rl = prls, al = alpha, be = beta;
+    const float ring = ringworm, dry = 1.0f - ringworm;
 
+    // Every band at once for each sample, as AnalogFilter::filterout_s
+    // would run it, then the bands summed with one partial sum per lane
+    for (i = 0; i<nPERIOD; i++) {
+        const float a = tmpaux[i], sl = tsmpsl[i], sr = tsmpsr[i];
+        float suml[kLanes] = {}, sumr[kLanes] = {};
+
+        for (bandgroup &q : bank) {
+            for (j = 0; j < kLanes; j++) {
+                float s = q.speak[j] < g ? 0.0f : q.speak[j];  //gate
+
+                auxtemp = (a * q.c0[j]) + (q.ax2[j] * q.c2[j]) + (q.ay1[j] * q.d1[j]) + (q.ay2[j] * q.d2[j]);
+                q.ay2[j] = q.ay1[j];
+                q.ay1[j] = auxtemp + DENORMAL_GUARD;
+                q.ax2[j] = q.ax1[j];
+                q.ax1[j] = a;
+
+                s = fabsf(auxtemp) > s ? fabsf(auxtemp) : s;  //Leaky Peak detector
+                s *= rl;
+                q.speak[j] = s;
+
+                q.oldgain[j] = be * q.oldgain[j] + al * s;
+                tempgain = dry*q.oldgain[j]+ring*auxtemp;
+
+                float yl = (sl * q.c0[j]) + (q.lx2[j] * q.c2[j]) + (q.ly1[j] * q.d1[j]) + (q.ly2[j] * q.d2[j]);
+                q.ly2[j] = q.ly1[j];
+                q.ly1[j] = yl + DENORMAL_GUARD;
+                q.lx2[j] = q.lx1[j];
+                q.lx1[j] = sl;
+
+                float yr = (sr * q.c0[j]) + (q.rx2[j] * q.c2[j]) + (q.ry1[j] * q.d1[j]) + (q.ry2[j] * q.d2[j]);
+                q.ry2[j] = q.ry1[j];
+                q.ry1[j] = yr + DENORMAL_GUARD;
+                q.rx2[j] = q.rx1[j];
+                q.rx1[j] = sr;
+
+                suml[j] += yl * tempgain;
+                sumr[j] += yr * tempgain;
+            }
+        }
 
+        tmpl[i] = ((suml[0] + suml[1]) + (suml[2] + suml[3]))
+                  + ((suml[4] + suml[5]) + (suml[6] + suml[7]));
+        tmpr[i] = ((sumr[0] + sumr[1]) + (sumr[2] + sumr[3]))
+                  + ((sumr[4] + sumr[5]) + (sumr[6] + sumr[7]));
     };
 
 
@@ -306,7 +305,7 @@ Vocoder::out (float * smpsl, float * smpsr)
 
 
     if(DS_state != 0) {
-        D_Resample->out(tmpl.data(),tmpr.data(),smpsl,smpsr,nPERIOD,u_down);
+        D_Resample->out(tmpl.data(),tmpr.data(),smpsl,smpsr,nPERIOD);
     } else {
         memcpy(smpsl,tmpl.data(),sizeof(float)*nPERIOD);
         memcpy(smpsr,tmpr.data(),sizeof(float)*nPERIOD);
@@ -332,16 +331,44 @@ Vocoder::setbands (int numbands, float startfreq, float endfreq)
 
     for(k=0; k<=VOC_BANDS; k++) output[k] = start*f_pow2(((float) k)*pwer/fnumbands);
     for(k=0; k<VOC_BANDS; k++) {
-        filterbank[k].sfreq = output[k] + (output[k+1] - output[k])*0.5f;
-        filterbank[k].sq = filterbank[k].sfreq/(output[k+1] - output[k]);
+        sfreq[k] = output[k] + (output[k+1] - output[k])*0.5f;
+        sq[k] = sfreq[k]/(output[k+1] - output[k]);
 
-        filterbank[k].l->setfreq_and_q (filterbank[k].sfreq, filterbank[k].sq);
-        filterbank[k].r->setfreq_and_q (filterbank[k].sfreq, filterbank[k].sq);
-        filterbank[k].aux->setfreq_and_q (filterbank[k].sfreq, filterbank[k].sq);
+        setbandcoefs (k, sfreq[k], sq[k]);
     }
     cleanup();
 }
 
+/*
+ * Band pass coefficients, as AnalogFilter type 4 with no extra stages
+ */
+void
+Vocoder::setbandcoefs (int band, float freq, float q)
+{
+    bandgroup &g = bank[band / kLanes];
+    const int j = band % kLanes;
+
+    //do not allow frequencies bigger than samplerate/2
+    if (freq > (nSAMPLE_RATE / 2 - 500.0)) {
+        g.c0[j] = g.c2[j] = g.d1[j] = g.d2[j] = 0.0f;
+        return;
+    }
+    if (freq < 0.1)
+        freq = 0.1f;
+    if (q < 0.0)
+        q = 0.0;
+
+    float omega = D_PI * freq / nfSAMPLE_RATE;
+    float sn = sinf (omega);
+    float cs = cosf (omega);
+    float bw = sn / (2.0f * q);
+    float tmp = 1.0f + bw;
+    g.c0[j] = bw / tmp * sqrtf (q + 1.0f);
+    g.c2[j] = -bw / tmp * sqrtf (q + 1.0f);
+    g.d1[j] = -2.0f * cs / tmp * (-1.0f);
+    g.d2[j] = (1.0f - bw) / tmp * (-1.0f);
+}
+
 /*
  * Parameter control
  */
@@ -367,15 +394,8 @@ Vocoder::setpanning (int Ppanning)
 void
 Vocoder::init_filters()
 {
-    float ff, qq;
-
-    for (int ii = 0; ii < VOC_BANDS; ii++) {
-        ff = filterbank[ii].sfreq;
-        qq = filterbank[ii].sq;
-        filterbank[ii].l->setfreq_and_q (ff, qq);
-        filterbank[ii].r->setfreq_and_q (ff, qq);
-        filterbank[ii].aux->setfreq_and_q (ff, qq);
-    };
+    for (int ii = 0; ii < VOC_BANDS; ii++)
+        setbandcoefs (ii, sfreq[ii], sq[ii]);
 
 }
 
@@ -383,16 +403,22 @@ void
 Vocoder::adjustq(float q)
 {
 
-    for (int ii = 0; ii < VOC_BANDS; ii++) {
-        filterbank[ii].l->setq (q);
-        filterbank[ii].r->setq (q);
-        filterbank[ii].aux->setq (q);
-    };
+    for (int ii = 0; ii < VOC_BANDS; ii++)
+        setbandcoefs (ii, sfreq[ii], q);
 
 }
 
 void
 Vocoder::setpreset (int npreset)
+{
+    PresetChanges changes;
+    preset_changes (npreset, changes);
+    apply (changes);
+    Ppreset = npreset;
+};
+
+void
+Vocoder::preset_changes (int npreset, PresetChanges &changes)
 {
     const int PRESET_SIZE = 7;
     const int NUM_PRESETS = 4;
@@ -410,13 +436,11 @@ Vocoder::setpreset (int npreset)
     if(npreset>NUM_PRESETS-1) {
         FPreset::ReadPreset(35,npreset-NUM_PRESETS+1);
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, pdata[n]);
+            changes.add (n, pdata[n]);
     } else {
         for (int n = 0; n < PRESET_SIZE; n++)
-            changepar (n, presets[npreset][n]);
+            changes.add (n, presets[npreset][n]);
     }
-
-    Ppreset = npreset;
 };
 
 
@@ -36,6 +36,7 @@ public:
     ~Vocoder ();
     void out (float * smpsl, float * smpr);
     void setpreset (int npreset);
+    static void preset_changes (int npreset, PresetChanges &changes);
     void changepar (int npar, int value);
     int getpar (int npar);
     void cleanup ();
@@ -52,6 +53,7 @@ private:
     void init_filters();
     void adjustq(float q);
     void   setbands(int numbands, float startfreq, float endfreq);
+    void setbandcoefs(int band, float freq, float q);
     int VOC_BANDS;
     //Parametrii
     int Pvolume;	//This is master wet/dry mix like other FX...but I am finding it is not useful
@@ -83,12 +85,20 @@ private:
     std::vector<float> tsmpsl, tsmpsr;
     std::vector<float> tmpaux;
     std::vector<float> output{};
-    struct fbank {
-        float sfreq, sq,speak,gain,oldgain;
-        std::unique_ptr<AnalogFilter> l, r, aux;
 
+    // The band pass filter bank, kLanes bands to a group, so every band
+    // steps through a sample together. The aux, left and right filters of
+    // a band share its coefficients. Lanes past VOC_BANDS stay silent.
+    static constexpr int kLanes = 8;
+    struct bandgroup {
+        float c0[kLanes], c2[kLanes], d1[kLanes], d2[kLanes];   // c1 is 0
+        float ax1[kLanes], ax2[kLanes], ay1[kLanes], ay2[kLanes];
+        float lx1[kLanes], lx2[kLanes], ly1[kLanes], ly2[kLanes];
+        float rx1[kLanes], rx2[kLanes], ry1[kLanes], ry2[kLanes];
+        float speak[kLanes], oldgain[kLanes];
     };
-    std::vector<fbank> filterbank;
+    std::vector<bandgroup> bank;
+    std::vector<float> sfreq, sq;
 
     std::unique_ptr<AnalogFilter> vhp, vlp;
 
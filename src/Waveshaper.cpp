@@ -23,43 +23,19 @@
 */
 
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <memory>
 #include "Waveshaper.hpp"
 #include "f_sin.hpp"
 
-Waveshaper::Waveshaper()
+Waveshaper::Waveshaper(int amount)
 {
 
-
-    switch(Wave_res_amount) {
-    case 0:
-        period_coeff = 1;
-        ncSAMPLE_RATE=cSAMPLE_RATE;
-        break;
-    case 1:
-        period_coeff = 2;
-        ncSAMPLE_RATE=cSAMPLE_RATE/2.0f;
-        break;
-    case 2:
-        period_coeff = 4;
-        ncSAMPLE_RATE=cSAMPLE_RATE/4.0f;
-        break;
-    case 3:
-        period_coeff = 8;
-        ncSAMPLE_RATE=cSAMPLE_RATE/8.0f;
-        break;
-    case 4:
-        period_coeff = 12;
-        ncSAMPLE_RATE=cSAMPLE_RATE/12.0f;
-        break;
-    default:
-        period_coeff = 1;
-        ncSAMPLE_RATE=cSAMPLE_RATE;
-        break;
-    }
-
+    period_coeff = oversample(amount);
+    ncSAMPLE_RATE = cSAMPLE_RATE / (float) period_coeff;
 
     temps.resize(PERIOD * period_coeff);
     u_up= (double)period_coeff;
@@ -91,14 +67,26 @@ Waveshaper::Waveshaper()
     Vfactor = 1.5f;
     Vdyno = 0.0f;
 
-    U_Resample = std::make_unique<Resample>(Wave_up_q);  //Downsample, uses sinc interpolation for bandlimiting to avoid aliasing
-    D_Resample = std::make_unique<Resample>(Wave_down_q);
+    tables ();
+    scratch.resize(PERIOD * period_coeff);
+
+    if (period_coeff > 1) {
+        U_Resample = std::make_unique<Resample>(Wave_up_q, u_up);  //Downsample, uses sinc interpolation for bandlimiting to avoid aliasing
+        D_Resample = std::make_unique<Resample>(Wave_down_q, u_down);
+    }
 
 
 
 
 };
 
+int
+Waveshaper::oversample(int amount)
+{
+    static constexpr int factors[] = {1, 2, 4, 8, 12};
+    return (amount >= 0 && amount < 5) ? factors[amount] : 1;
+}
+
 void Waveshaper::cleanup()
 {
     compg = 0.0f;  //used by compression distortion
@@ -117,24 +105,123 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
 
     int nn=n;
 
-    if(Wave_res_amount > 0) {
+    if(period_coeff > 1) {
         nn=n*period_coeff;
-        U_Resample->mono_out(smps,temps.data(),n,u_up,nn);
+        U_Resample->mono_out(smps,temps.data(),n,nn);
     }
 
     else memcpy(temps.data(),smps,sizeof(float)*n);
 
-    int i;
     float ws = (float)drive / 127.0f + .00001f;
     ws = 1.0f - expf (-ws * 4.0f);
+
+    switch (type + 1) {
+    case 20:
+    case 24:
+    case 25:
+    case 27:
+    case 28:
+    case 29:
+        shapedynamic (nn, type, ws, eff);
+        break;
+    default:
+        shapestatic (nn, type, ws);
+        break;
+    };
+
+    if(period_coeff > 1) {
+        D_Resample->mono_out(temps.data(),smps,nn,n);
+    } else
+        memcpy(smps,temps.data(),sizeof(float)*n);
+
+
+};
+
+const std::array<Waveshaper::Table, Waveshaper::kTables>&
+Waveshaper::tables ()
+{
+    static const auto built = [] {
+        auto t = std::make_unique<std::array<Table, kTables>> ();
+        auto build = [&t] (int k, float lo, float hi, auto curve) {
+            Table& tk = (*t)[k];
+            tk.lo = lo;
+            tk.scale = (float) kTableSize / (hi - lo);
+            for (int j = 0; j <= kTableSize; j++)
+                tk.y[j] = curve (lo + (hi - lo) * (float) j / (float) kTableSize);
+        };
+        //atan over -1 .. 1, past that atan(x) = +-pi/2 - atan(1/x)
+        build (kAtan, -1.0f, 1.0f, [] (float x) { return atanf (x); });
+        //one period of the periodic ones
+        build (kSine, 0.0f, D_PI, [] (float x) { return f_sin (x); });
+        build (kZigzag, 0.0f, D_PI, [] (float x) { return asinf (f_sin (x)); });
+        build (kSine2, 0.0f, D_PI, [] (float x) { return f_sin (x + f_sin (2.0f * x)); });
+        build (kSineSine, 0.0f, D_PI, [] (float x) { return f_sin (x + f_sin (x)); });
+        //flat past +-10
+        build (kSigmoid, -10.0f, 10.0f, [] (float x) { return 0.5f - 1.0f / (expf (x) + 1.0f); });
+        //4^-16 is below float resolution at 1
+        build (kDiode, -16.0f, 16.0f, [] (float x) {
+            if (x>0.0f) return 1.0f - 1.0f/powf(4.0f, x);
+            else return -(1.0f - 1.0f/powf(4.0f, -x));
+        });
+        return t;
+    } ();
+    return *built;
+}
+
+// Linear interpolation in the table, held at its end values outside it
+void
+Waveshaper::lookup (const Table& t, const float * in, float * out, int n)
+{
+    const float *tab = t.y.data();
+    for (int i = 0; i < n; i++) {
+        float x = (in[i] - t.lo) * t.scale;
+        x = (x > 0.0f) ? std::min (x, (float) kTableSize) : 0.0f;   //and NaN to 0
+        int k = std::min ((int) x, kTableSize - 1);
+        float frac = x - (float) k;
+        out[i] = tab[k] + frac * (tab[k + 1] - tab[k]);
+    }
+}
+
+// The same for a table that holds one period, starting at 0
+void
+Waveshaper::lookup_periodic (const Table& t, const float * in, float * out, int n)
+{
+    const float *tab = t.y.data();
+    for (int i = 0; i < n; i++) {
+        float x = in[i] * t.scale;
+        int k = (int) x;
+        k -= (x < (float) k);   //floor
+        float frac = x - (float) k;
+        k &= kTableSize - 1;
+        out[i] = tab[k] + frac * (tab[k + 1] - tab[k]);
+    }
+}
+
+/*
+ * Curves of the current sample alone. The costly ones are read from
+ * tables(), scaled by the drive on the way in and out.
+ */
+void
+Waveshaper::shapestatic (int nn, int type, float ws)
+{
+    int i;
     float tmpv;
     float factor;
+    const auto& tab = tables ();
 
     switch (type + 1 ) {
     case 1:
         ws = powf (10.0f, ws * ws * 3.0f) - 1.0f + 0.001f;	//Arctangent
-        for (i = 0; i < nn; i++)
-            temps[i] = atanf (temps[i] * ws) / atanf (ws);
+        tmpv = atanf (ws);
+        for (i = 0; i < nn; i++) {
+            float tmp = temps[i] * ws;
+            scratch[i] = fabsf (tmp) > 1.0f ? 1.0f / tmp : tmp;
+        }
+        lookup (tab[kAtan], scratch.data(), scratch.data(), nn);
+        for (i = 0; i < nn; i++) {
+            float tmp = temps[i] * ws;
+            temps[i] = (fabsf (tmp) > 1.0f ? copysignf (p2, tmp) - scratch[i] : scratch[i]) / tmpv;
+        }
         break;
     case 2:
         ws = ws * ws * 32.0f + 0.0001f;	//Asymmetric
@@ -142,9 +229,11 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
             tmpv = f_sin (ws) + 0.1f;
         else
             tmpv = 1.1f;
-        for (i = 0; i < nn; i++) {
-            temps[i] = f_sin (temps[i] * (0.1f + ws - ws * temps[i])) / tmpv;
-        };
+        for (i = 0; i < nn; i++)
+            temps[i] *= (0.1f + ws - ws * temps[i]);
+        lookup_periodic (tab[kSine], temps.data(), temps.data(), nn);
+        for (i = 0; i < nn; i++)
+            temps[i] /= tmpv;
         break;
     case 3:
         ws = ws * ws * ws * 20.0f + 0.0001f;	//Pow
@@ -165,7 +254,10 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
         else
             tmpv = 1.0f;
         for (i = 0; i < nn; i++)
-            temps[i] = f_sin (temps[i] * ws) / tmpv;
+            temps[i] *= ws;
+        lookup_periodic (tab[kSine], temps.data(), temps.data(), nn);
+        for (i = 0; i < nn; i++)
+            temps[i] /= tmpv;
         break;
     case 5:
         ws = ws * ws + 0.000001f;	//Quantisize
@@ -179,7 +271,10 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
         else
             tmpv = 1.0f;
         for (i = 0; i < nn; i++)
-            temps[i] = asinf (f_sin (temps[i] * ws)) / tmpv;
+            temps[i] *= ws;
+        lookup_periodic (tab[kZigzag], temps.data(), temps.data(), nn);
+        for (i = 0; i < nn; i++)
+            temps[i] /= tmpv;
         break;
     case 7:
         ws = powf (2.0f, -ws * ws * 8.0f);	//Limiter
@@ -269,15 +364,11 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
             tmpv = 0.5f;
         else
             tmpv = 0.5f - 1.0f / (expf (ws) + 1.0f);
-        for (i = 0; i < nn; i++) {
-            float tmp = temps[i] * ws;
-            if (tmp < -10.0)
-                tmp = -10.0f;
-            else if (tmp > 10.0)
-                tmp = 10.0f;
-            tmp = 0.5f - 1.0f / (expf (tmp) + 1.0f);
-            temps[i] = tmp / tmpv;
-        };
+        for (i = 0; i < nn; i++)
+            temps[i] *= ws;
+        lookup (tab[kSigmoid], temps.data(), temps.data(), nn);
+        for (i = 0; i < nn; i++)
+            temps[i] /= tmpv;
         break;
     case 15:		//Sqrt "Crunch" -- Asymmetric square root distortion.
         ws = ws*ws*CRUNCH_GAIN + 1.0f;
@@ -341,8 +432,10 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
         else
             tmpv = 1.0f;
         for (i = 0; i < nn; i++)
-            temps[i]=f_sin(ws * temps[i] + f_sin( ws * 2.0f*temps[i]))/ tmpv;
-
+            temps[i] *= ws;
+        lookup_periodic (tab[kSine2], temps.data(), temps.data(), nn);
+        for (i = 0; i < nn; i++)
+            temps[i] /= tmpv;
         break;
 
     case 19:
@@ -351,10 +444,81 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
             tmpv = f_sin (ws);
         else
             tmpv = 1.0f;
+        if (tmpv < 1.0f) {  //the inner sine swings 1/tmpv radians, too fast for the table
+            for (i = 0; i < nn; i++)
+                temps[i]=f_sin(ws * temps[i] + f_sin(ws * temps[i])/tmpv);
+            break;
+        }
+        for (i = 0; i < nn; i++)
+            temps[i] *= ws;
+        lookup_periodic (tab[kSineSine], temps.data(), temps.data(), nn);
+        break;
+
+    case 21: //Overdrive
+        ws = powf (10.0f, ws * ws * 3.0f) - 1.0f + 0.001f;
+        for (i = 0; i < nn; i++) {
+            if(temps[i]>0.0f) temps[i] = sqrtf(temps[i]*ws);
+            else temps[i] = -sqrtf(-temps[i]*ws);
+        }
+        break;
+
+    case 22: //Soft
+        ws = powf(4.0f, ws*ws+1.0f);
+        for (i = 0; i < nn; i++) {
+            if(temps[i]>0.0f) temps[i] = ws*powf(temps[i],1.4142136f);
+            else temps[i] = ws* -powf(-temps[i],1.4142136f);
+        }
+        break;
+
+    case 23: //Super Soft
+
+        ws = powf (20.0f, ws * ws) + 0.5f;
+        factor = 1.0f / ws;
+        //above factor, x - factor and 1 - x add up to 1 - factor, so
+        //(x-factor)/(1+(x-factor)/(1-x))^2 is (x-factor)*(1-x)^2/(1-factor)^2
+        tmpv = 1.0f / ((1.0f - factor) * (1.0f - factor));
+        for (i = 0; i < nn; i++) {
+            float x = std::clamp (temps[i], -1.0f, 1.0f);
+            if (x > factor)
+                x = factor + (x - factor) * (1.0f - x) * (1.0f - x) * tmpv;
+            temps[i] = x * ws;
+        }
+        break;
+
+    case 26: //JFET
+
+        ws = powf (35.0f, ws * ws) + 4.0f;
+        factor = sqrt(1.0f / ws);
+        for (i = 0; i < nn; i++) {
+            temps[i] = temps[i] + factor;
+            if(temps[i] < 0.0) temps[i] = 0.0f;
+            temps[i] = 1.0f - 2.0f/(ws*temps[i]*temps[i] + 1.0f);
+        }
+        break;
+
+    case 30: //Diode clipper
+
+        ws = 5.0f + powf (110.0f, ws);
         for (i = 0; i < nn; i++)
-            temps[i]=f_sin(ws * temps[i] + f_sin(ws * temps[i])/tmpv);
+            temps[i] *= ws;
+        lookup (tab[kDiode], temps.data(), temps.data(), nn);
         break;
 
+
+    };
+
+};
+
+/*
+ * Curves that carry state from sample to sample
+ */
+void
+Waveshaper::shapedynamic (int nn, int type, float ws, int eff)
+{
+    int i;
+    float tmpv;
+
+    switch (type + 1 ) {
     case 20:  //Compression
         cratio = 1.0f - 0.25f * ws;
         ws =  1.5f*ws*CRUNCH_GAIN + 4.0f;
@@ -385,37 +549,6 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
         };
         break;
 
-    case 21: //Overdrive
-        ws = powf (10.0f, ws * ws * 3.0f) - 1.0f + 0.001f;
-        for (i = 0; i < nn; i++) {
-            if(temps[i]>0.0f) temps[i] = sqrtf(temps[i]*ws);
-            else temps[i] = -sqrtf(-temps[i]*ws);
-        }
-        break;
-
-    case 22: //Soft
-        ws = powf(4.0f, ws*ws+1.0f);
-        for (i = 0; i < nn; i++) {
-            if(temps[i]>0.0f) temps[i] = ws*powf(temps[i],1.4142136f);
-            else temps[i] = ws* -powf(-temps[i],1.4142136f);
-        }
-        break;
-
-    case 23: //Super Soft
-
-        ws = powf (20.0f, ws * ws) + 0.5f;
-        factor = 1.0f / ws;
-        for (i = 0; i < nn; i++) {
-            if(temps[i] > 1.0) temps[i] = 1.0f;
-            if(temps[i] < -1.0) temps[i] = -1.0f;
-
-            if(temps[i]<factor) temps[i]=temps[i];
-            else if(temps[i]>factor) temps[i]=factor+(temps[i]-factor)/powf(1.0f+((temps[i]-factor)/(1.0f-temps[i])),2.0f);
-            else if(temps[i]>1.0f) temps[i]=(factor+1.0f)*.5f;
-            temps[i]*=ws;
-        }
-        break;
-
     case 24:  // Hard Compression (used by stompboxes)
         cratio = 0.05f;
         if (eff) {
@@ -472,17 +605,6 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
         };
         break;
 
-    case 26: //JFET
-
-        ws = powf (35.0f, ws * ws) + 4.0f;
-        factor = sqrt(1.0f / ws);
-        for (i = 0; i < nn; i++) {
-            temps[i] = temps[i] + factor;
-            if(temps[i] < 0.0) temps[i] = 0.0f;
-            temps[i] = 1.0f - 2.0f/(ws*temps[i]*temps[i] + 1.0f);
-        }
-        break;
-
     case 27: //dyno JFET
 
         ws = powf (85.0f, ws * ws) + 10.0f;
@@ -539,28 +661,7 @@ Waveshaper::waveshapesmps (int n, float * smps, int type,
 
         }
         break;
-    case 30: //Diode clipper
-
-        ws = 5.0f + powf (110.0f, ws);
-
-        for (i = 0; i < nn; i++) {
-
-            tmpv = ws*temps[i];
-            if (tmpv>0.0f) tmpv = 1.0f - 1.0f/powf(4.0f, tmpv);
-            else tmpv = -(1.0f - 1.0f/powf(4.0f, -tmpv));
-            temps[i] = tmpv;
-
-        }
-        break;
-
 
     };
 
-    if(Wave_res_amount>= 0) {
-        D_Resample->mono_out(temps.data(),smps,nn,u_down,n);
-    } else
-        memcpy(smps,temps.data(),sizeof(float)*n);
-
-
 };
-
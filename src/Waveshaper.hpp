@@ -25,13 +25,17 @@
 #ifndef WAVESHAPER_H
 #define WAVESHAPER_H
 
+#include <array>
 #include "dsp_constants.hpp"
 #include "Resample.hpp"
 
 class Waveshaper
 {
 public:
-    Waveshaper ();
+    /// amount: 0 runs at the engine rate, 1..4 oversample the shaping
+    /// x2, x4, x8 or x12
+    explicit Waveshaper (int amount);
+    static int oversample (int amount);
     ~Waveshaper () = default;
 //Waveshaping
     void waveshapesmps (int n, float * smps, int type,
@@ -59,6 +63,24 @@ public:
     std::unique_ptr<Resample> U_Resample;
     std::unique_ptr<Resample> D_Resample;
 
+private:
+    void shapestatic (int nn, int type, float ws);
+    void shapedynamic (int nn, int type, float ws, int eff);
+
+    // The costly stateless curves, sampled at kTableSize + 1 points. They
+    // do not depend on the drive, which scales their input and output, so
+    // they are built once, by the first constructor, and shared.
+    static constexpr int kTableSize = 4096;
+    struct Table {
+        float lo, scale;
+        std::array<float, kTableSize + 1> y;
+    };
+    enum { kAtan, kSine, kZigzag, kSigmoid, kSine2, kSineSine, kDiode, kTables };
+    static const std::array<Table, kTables>& tables ();
+    static void lookup (const Table& t, const float * in, float * out, int n);
+    static void lookup_periodic (const Table& t, const float * in, float * out, int n);
+
+    std::vector<float> scratch;
 
 };
 
@@ -16,6 +16,7 @@
 */
 #include "delayline.hpp"
 #include "math.h"
+#include <algorithm>
 #include <cstdlib>
 #include "f_sin.hpp"
 
@@ -88,106 +89,254 @@ delayline::cleanup()
 };
 
 
-float
-delayline::delay_simple(float smps, float time_, int tap_, int touch,
-                        int reverse)
+/*
+*  One sample of delay_simple() for one tap: move the state v on to delay
+*  time_ with the line written up to zero_, and work out where to read.
+*  bufptr is the sample wanted and tmpptr the one faded from, while v.crossfade.
+*/
+inline void
+delayline::step_simple(simplevars &v, float time_, int zero_, int reverse,
+                       int &bufptr, int &tmpptr) const
 {
-    int dlytime = 0;
-    int bufptr = 0;
-
-    if (tap_ >= maxtaps)
-        tap = 0;
-    else
-        tap = tap_;
-
-    time[tap] = fSAMPLE_RATE * time_;	//convert to something that can be used as a delay line index
+    v.time = fSAMPLE_RATE * time_;	//convert to something that can be used as a delay line index
 
 //Do some checks to keep things in bounds
-    if (time[tap] > maxtime)
-        time[tap] = maxtime;
-    dlytime = lrintf(time[tap]);
-
-    if (crossfade[tap]) {
-        xfade[tap] += fadetime;
-        if (xfade[tap] >= 1.0f) {
-            xfade[tap] = 0.0f;
-            crossfade[tap] = 0;
-            oldtime[tap] = newtime[tap];
-            newtime[tap] = dlytime;
+    if (v.time > maxtime)
+        v.time = maxtime;
+    int dlytime = lrintf(v.time);
+
+    if (v.crossfade) {
+        v.xfade += fadetime;
+        if (v.xfade >= 1.0f) {
+            v.xfade = 0.0f;
+            v.crossfade = 0;
+            v.oldtime = v.newtime;
+            v.newtime = dlytime;
         }
     }
 
-    if (crossfade[tap] == 0) {
-        if (dlytime != oldtime[tap]) {
-            crossfade[tap] = 1;
-            xfade[tap] = 0.0f;
-            oldtime[tap] = newtime[tap];
-            newtime[tap] = dlytime;
+    if (v.crossfade == 0) {
+        if (dlytime != v.oldtime) {
+            v.crossfade = 1;
+            v.xfade = 0.0f;
+            v.oldtime = v.newtime;
+            v.newtime = dlytime;
         }
 
     }
 
+    dlytime = v.newtime;
 
-
-
-
-    dlytime = newtime[tap];
-
-//now put in the sample
-    if (touch) {		//make touch zero if you only want to pull samples off the delay line
-        ringbuffer[zero_index] = smps;
-        if (--zero_index < 0)
-            zero_index = maxdelaysmps - 1;
-    }
 //if we want reverse delay
 //you need to call this every time to keep the buffers up to date, and it's on a different tap
     if (reverse) {
 
-        bufptr = (dlytime + zero_index);	//this points to the sample we want to get
+        bufptr = (dlytime + zero_);	//this points to the sample we want to get
         if (bufptr >= maxdelaysmps)
             bufptr -= maxdelaysmps;
-        if (++rvptr > maxdelaysmps)
-            rvptr = 0;
+        if (++v.rvptr >= maxdelaysmps)
+            v.rvptr = 0;
 
-        if (bufptr > zero_index) {
-            if (rvptr > bufptr) {
-                rvptr = zero_index;
-                distance = 0;
+        if (bufptr > zero_) {
+            if (v.rvptr > bufptr) {
+                v.rvptr = zero_;
+                v.distance = 0;
             } else
-                distance = rvptr - zero_index;
-        } else if ((bufptr < zero_index) && (rvptr < zero_index)) {
-            if (rvptr > bufptr) {
-                rvptr = zero_index;
-                distance = 0;
+                v.distance = v.rvptr - zero_;
+        } else if ((bufptr < zero_) && (v.rvptr < zero_)) {
+            if (v.rvptr > bufptr) {
+                v.rvptr = zero_;
+                v.distance = 0;
             } else
-                distance =
-                    rvptr + maxdelaysmps - zero_index;
+                v.distance =
+                    v.rvptr + maxdelaysmps - zero_;
         } else
-            distance = rvptr - zero_index;
+            v.distance = v.rvptr - zero_;
 
 
-        bufptr = rvptr;	//this points to the sample we want to get
+        bufptr = v.rvptr;	//this points to the sample we want to get
 
     } else {
-        bufptr = (dlytime + zero_index);	//this points to the sample we want to get
+        bufptr = (dlytime + zero_);	//this points to the sample we want to get
         if (bufptr >= maxdelaysmps)
             bufptr -= maxdelaysmps;
     }
 
-    int oldnewdiff = newtime[tap] - oldtime[tap];
-    int tmpptr = 0;
-    if (crossfade[tap] != 0) {
-        tmpptr = bufptr + oldnewdiff;
+    tmpptr = bufptr;
+    if (v.crossfade != 0) {
+        tmpptr = bufptr + v.newtime - v.oldtime;
         if (tmpptr >= maxdelaysmps)
             tmpptr -= maxdelaysmps;
-        else if (tmpptr <= 0)
+        else if (tmpptr < 0)
             tmpptr += maxdelaysmps;
-        return (xfade[tap] * ringbuffer[bufptr] + (1.0f - xfade[tap]) * ringbuffer[tmpptr]);	//fade nicely to new tap
-    } else
+    }
+};
+
+inline delayline::simplevars
+delayline::load_simple(int tap_) const
+{
+    return simplevars{time[tap_], oldtime[tap_], newtime[tap_], crossfade[tap_],
+                      xfade[tap_], rvptr, distance};
+};
+
+inline void
+delayline::store_simple(int tap_, const simplevars &v)
+{
+    tap = tap_;
+    time[tap_] = v.time;
+    oldtime[tap_] = v.oldtime;
+    newtime[tap_] = v.newtime;
+    crossfade[tap_] = v.crossfade;
+    xfade[tap_] = v.xfade;
+    rvptr = v.rvptr;
+    distance = v.distance;
+};
+
+float
+delayline::delay_simple(float smps, float time_, int tap_, int touch,
+                        int reverse)
+{
+    int bufptr, tmpptr;
+
+    if (tap_ >= maxtaps)
+        tap_ = 0;
+
+//now put in the sample
+    if (touch)		//make touch zero if you only want to pull samples off the delay line
+        write(smps);
+
+    simplevars v = load_simple(tap_);
+    step_simple(v, time_, zero_index, reverse, bufptr, tmpptr);
+    store_simple(tap_, v);
+
+    if (v.crossfade != 0)
+        return (v.xfade * ringbuffer[bufptr] + (1.0f - v.xfade) * ringbuffer[tmpptr]);	//fade nicely to new tap
+    else
         return (ringbuffer[bufptr]);
 
 };
 
+/*
+*  The least of first..last modulo the line length
+*/
+inline int
+delayline::least_age(int first, int last) const
+{
+    if (last - first >= maxdelaysmps)
+        return 0;
+    int age = first % maxdelaysmps;
+    if (age < 0)
+        age += maxdelaysmps;
+    return (age + last - first >= maxdelaysmps) ? 0 : age;
+};
+
+/*
+*  Block use of delay_simple(). True if no crossfade of the tap starts or
+*  ends in the next n samples, so its times stay put. lo and hi are the least
+*  and most delay the run asks for, in samples.
+*/
+inline bool
+delayline::steady_simple(const float *time_, int tap_, int n, int &lo, int &hi) const
+{
+    float tlo = time_[0], thi = time_[0];
+    for (int j = 1; j < n; j++) {
+        tlo = std::min(tlo, time_[j]);
+        thi = std::max(thi, time_[j]);
+    }
+    lo = lrintf(std::min(fSAMPLE_RATE * tlo, maxtime));
+    hi = lrintf(std::min(fSAMPLE_RATE * thi, maxtime));
+
+    if (crossfade[tap_])	//with a sample to spare for the rounding of xfade
+        return xfade[tap_] + (float) (n + 2) * fadetime < 1.0f;
+    return lo == oldtime[tap_] && hi == oldtime[tap_];
+};
+
+/*
+*  Sample j of a run reads with the line written up to its own input, but
+*  only the first input of the run is there, so it must read at least j
+*  samples back. A tap reads newtime - 1 samples back, and
+*  2 * newtime - oldtime - 1 while it crossfades.
+*/
+int
+delayline::span_simple(const float *time_, int tap_, int n) const
+{
+    int lo, hi;
+
+    if (tap_ >= maxtaps)
+        tap_ = 0;
+
+    int newlo = newtime[tap_], newhi = newtime[tap_];
+    int oldlo = oldtime[tap_], oldhi = oldtime[tap_];
+    if (!steady_simple(time_, tap_, n, lo, hi)) {
+        //newtime takes a time the run asks for, oldtime that or the last newtime
+        newlo = std::min(lo, newlo);
+        newhi = std::max(hi, newhi);
+        oldlo = std::min(newlo, oldlo);
+        oldhi = std::max(newhi, oldhi);
+    }
+
+    n = std::min(n, least_age(newlo - 1, newhi - 1) + 1);
+    return std::min(n, least_age(2 * newlo - oldhi - 1, 2 * newhi - oldlo - 1) + 1);
+};
+
+void
+delayline::read_simple(const float *time_, int tap_, float *out, int n)
+{
+    int j, lo, hi, zero_, bufptr, tmpptr;
+
+    if (tap_ >= maxtaps)
+        tap_ = 0;
+
+    simplevars v = load_simple(tap_);
+
+    if (!steady_simple(time_, tap_, n, lo, hi)) {
+        for (j = 0; j < n; j++) {
+            zero_ = zero_index - j;
+            if (zero_ < 0)
+                zero_ += maxdelaysmps;
+            step_simple(v, time_[j], zero_, 0, bufptr, tmpptr);
+
+            if (v.crossfade != 0)
+                out[j] = v.xfade * ringbuffer[bufptr] + (1.0f - v.xfade) * ringbuffer[tmpptr];	//fade nicely to new tap
+            else
+                out[j] = ringbuffer[bufptr];
+        }
+        store_simple(tap_, v);
+        return;
+    }
+
+    //The taps are a run of the ring, backward
+    bufptr = v.newtime + zero_index;
+    if (bufptr >= maxdelaysmps)
+        bufptr -= maxdelaysmps;
+
+    if (v.crossfade) {
+        tmpptr = bufptr + v.newtime - v.oldtime;
+        if (tmpptr >= maxdelaysmps)
+            tmpptr -= maxdelaysmps;
+        else if (tmpptr < 0)
+            tmpptr += maxdelaysmps;
+
+        for (j = 0; j < n; j++) {
+            v.xfade += fadetime;
+            out[j] = v.xfade * ringbuffer[bufptr] + (1.0f - v.xfade) * ringbuffer[tmpptr];	//fade nicely to new tap
+            if (--bufptr < 0)
+                bufptr = maxdelaysmps - 1;
+            if (--tmpptr < 0)
+                tmpptr = maxdelaysmps - 1;
+        }
+    } else {
+        for (j = 0; j < n; j++) {
+            out[j] = ringbuffer[bufptr];
+            if (--bufptr < 0)
+                bufptr = maxdelaysmps - 1;
+        }
+    }
+
+    v.time = std::min(fSAMPLE_RATE * time_[n - 1], maxtime);
+    store_simple(tap_, v);
+};
+
 /*
 *  Interpolated delay line
 */
@@ -229,7 +378,7 @@ delayline::delay(float smps, float time_, int tap_, int touch,
         bufptr = (dlytime + zero_index);	//this points to the sample we want to get
         if (bufptr >= maxdelaysmps)
             bufptr -= maxdelaysmps;
-        if (++rvptr > maxdelaysmps)
+        if (++rvptr >= maxdelaysmps)
             rvptr = 0;
 
         if (bufptr > zero_index) {
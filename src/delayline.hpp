@@ -50,6 +50,26 @@ public:
     //in this case, multiply the sample by the envelope:
     // myreversedelayedsample = mydelayline->delay(input, delay_time, 0, 1, 1) * mydelayline->envelope;
 
+    //Block use of delay_simple(), a run of samples per call. The output is
+    //usually fed back into the input, so a run can be no longer than the
+    //shortest delay:
+    // mydelayline->write(first input of the run);
+    // n = mydelayline->span_simple(times, tap, n);  //least over the taps
+    // mydelayline->read_simple(times, tap, out, n);  //each tap
+    // mydelayline->write() the other n - 1 inputs as their feedback is known
+    //Reverse taps read right behind the input, so they stay delay_simple()
+    //calls made after each write.
+    inline void write(float smps)
+    {
+        ringbuffer[zero_index] = smps;
+        if (--zero_index < 0)
+            zero_index = maxdelaysmps - 1;
+    }
+    int span_simple(const float *time, int tap_, int n) const;
+    void read_simple(const float *time, int tap_, float *out, int n);
+    //time  - delay time of each sample of the run
+    //n     - samples in the run; span_simple() returns how many of them can be read
+
     float get_phaser(float smps, float lfo, int tap_, int stg);	//Allows you to use phaser directly without delay line
     //smps  - input sample
     //lfo   - ranges from 0 to 1
@@ -81,6 +101,20 @@ private:
     };
     std::vector<phasevars> pstruct;
 
+    //delay_simple() state of one tap, for the length of a run
+    struct simplevars {
+        float time;
+        int oldtime, newtime, crossfade;
+        float xfade;
+        int rvptr, distance;
+    };
+    simplevars load_simple(int tap_) const;
+    void store_simple(int tap_, const simplevars &v);
+    void step_simple(simplevars &v, float time_, int zero_, int reverse,
+                     int &bufptr, int &tmpptr) const;
+    bool steady_simple(const float *time_, int tap_, int n, int &lo, int &hi) const;
+    int least_age(int first, int last) const;
+
     float phaser(float fxn);
     float lagrange(float p0, float p1, float p2, float p3, float x_);
     float spline(float p0, float p1, float p2, float p3, float x_);
@@ -87,7 +87,7 @@ inline constexpr int OPEN = 3;
 inline constexpr int CLOSING = 4;
 inline constexpr float ENV_TR = 0.0001f;
 inline constexpr int HARMONICS = 11;
-inline constexpr int REV_COMBS = 8;
+inline constexpr int REV_COMBS = REVERB_COMBS;
 inline constexpr int REV_APS = 4;
 inline constexpr int MAX_SFILTER_STAGES = 12;
 
@@ -149,6 +149,9 @@ extern float cSAMPLE_RATE;
 extern float val_sum;
 extern float aFreq;
 extern int reconota;
+// Pitch in Hz found by RecNote on the chain input, before any effect, for
+// the PSOLA pitch shifters. It holds the last note found, 0 before any.
+extern float reco_freq;
 extern int Wave_res_amount;
 extern int Wave_up_q;
 extern int Wave_down_q;
@@ -163,5 +166,6 @@ extern std::array<float, 12> lfreqs;
 // Program state globals also used by some effects
 extern int error_num;
 extern int preset;
+extern int offline;
 
 #endif
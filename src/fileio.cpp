@@ -1197,15 +1197,10 @@ RKR::savefile (char *filename)
 
 
 
-void
+int
 RKR::loadfile (char *filename)
 {
     std::ifstream file(filename);
-    if (!file.is_open())
-        return;
-
-    New();
-
     std::string line;
     int l[MAX_EFFECT_SLOTS];
     std::fill(std::begin(l), std::end(l), EMPTY_SLOT);
@@ -1216,6 +1211,16 @@ RKR::loadfile (char *filename)
 
     // Order (line 15) — read once to get the effect ordering
     std::getline(file, line);
+    if (!file) {
+        char meslabel[128];
+        snprintf(meslabel, sizeof(meslabel), "%s %s", jack.name.data(), VERSION);
+        std::string message{"Can not load preset file "};
+        message += filename;
+        Message(1, meslabel, message.c_str());
+        return (0);
+    }
+
+    New();
     parse_csv(line, l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7],
               l[8], l[9], l[10], l[11], l[12], l[13], l[14], l[15]);
 
@@ -1289,468 +1294,360 @@ RKR::loadfile (char *filename)
     }
 
     Actualizar_Audio();
+    return (1);
 }
 
 
 void
 RKR::Actualizar_Audio ()
 {
-    int i,j;
+    int j;
 
 
     Bypass = 0;
-    for (i = 0; i < MAX_EFFECT_SLOTS; i++)
-        efx_order[i] = lv[10][i];
+    for (j = 0; j < MAX_EFFECT_SLOTS; j++)
+        efx_order[j] = lv[10][j];
     Harmonizer_Bypass=0;
     Ring_Bypass = 0;
     StereoHarm_Bypass = 0;
 
 
     for (j=0; j<MAX_EFFECT_SLOTS; j++) {
-        if (efx_order[j] == EMPTY_SLOT)
+        int type = efx_order[j];
+        int *bypass = Bypass_By_Type (type);
+        if (bypass == nullptr)
             continue;
-        switch(efx_order[j]) {
-        case 0: //EQ1
-            EQ1_Bypass = 0;
-            efx_EQ1->cleanup();
-            for (i = 0; i < 10; i++) {
-                efx_EQ1->changepar (i * 5 + 12, lv[7][i]);
-                efx_EQ1->changepar (i * 5 + 13, lv[7][11]);
-            }
-            efx_EQ1->changepar (0, lv[7][10]);
-            EQ1_Bypass = EQ1_B;
-            break;
-
-        case 1:// Compressor
-            Compressor_Bypass = 0;
-            efx_Compressor->cleanup();
-            for (i = 0; i <= 9; i++)
-                efx_Compressor->Compressor_Change (i + 1, lv[9][i]);
-            Compressor_Bypass = Compressor_B;
-            break;
-
-        case 2://Distortion
-
-            Distorsion_Bypass = 0;
-            efx_Distorsion->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_Distorsion->changepar (i, lv[6][i]);
-            Distorsion_Bypass = Distorsion_B;
-            break;
-
-        case 3://Overdrive
-
-            Overdrive_Bypass = 0;
-            efx_Overdrive->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_Overdrive->changepar (i, lv[5][i]);
-            Overdrive_Bypass = Overdrive_B;
-            break;
-
-        case 4://Echo
-
-            Echo_Bypass = 0;
-            efx_Echo->cleanup();
-            for (i = 0; i <= 8; i++)
-                efx_Echo->changepar (i, lv[1][i]);
-            Echo_Bypass = Echo_B;
-            break;
-
-        case 5://Chorus
-
-            Chorus_Bypass = 0;
-            efx_Chorus->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_Chorus->changepar (i, lv[2][i]);
-            Chorus_Bypass = Chorus_B;
-            break;
-
-        case 6://Phaser
-
-            Phaser_Bypass = 0;
-            efx_Phaser->cleanup();
-            for (i = 0; i <= 11; i++)
-                efx_Phaser->changepar (i,lv[4][i]);
-            Phaser_Bypass = Phaser_B;
-            break;
-
-        case 7://Flanger
-
-            Flanger_Bypass = 0;
-            efx_Flanger->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_Flanger->changepar (i, lv[3][i]);
-            Flanger_Bypass = Flanger_B;
-            break;
-
-        case 8://Reverb
-
-            Reverb_Bypass = 0;
-            efx_Rev->cleanup();
-            for (i = 0; i <= 11; i++)
-                efx_Rev->changepar (i, lv[0][i]);
-            Reverb_Bypass = Reverb_B;
-            break;
-
-        case 9://EQ2
-
-            EQ2_Bypass = 0;
-            efx_EQ2->cleanup();
-            for (i = 0; i < 3; i++) {
-                efx_EQ2->changepar (i * 5 + 11, lv[8][0 + i * 3]);
-                efx_EQ2->changepar (i * 5 + 12, lv[8][1 + i * 3]);
-                efx_EQ2->changepar (i * 5 + 13, lv[8][2 + i * 3]);
-            }
-            efx_EQ2->changepar (0, lv[8][9]);
-            EQ2_Bypass = EQ2_B;
-            break;
-
-        case 10://WhaWha
-
-            WhaWha_Bypass = 0;
-            efx_WhaWha->cleanup();
-            efx_WhaWha->setpreset (lv[11][10]);
-            for (i = 0; i <= 9; i++)
-                efx_WhaWha->changepar (i, lv[11][i]);
-            WhaWha_Bypass = WhaWha_B;
-            break;
-
-        case 11://Alienwah
-
-            Alienwah_Bypass = 0;
-            efx_Alienwah->cleanup();
-            for (i = 0; i <= 10; i++)
-                efx_Alienwah->changepar (i, lv[12][i]);
-            Alienwah_Bypass = Alienwah_B;
-            break;
-
-        case 12://Cabinet
-
-            Cabinet_Bypass = 0;
-            efx_Cabinet->cleanup();
-            Cabinet_setpreset (lv[13][0]);
-            efx_Cabinet->changepar (0,lv[13][1]);
-            Cabinet_Bypass = Cabinet_B;
-            break;
-
-        case 13://Pan
-
-            Pan_Bypass = 0;
-            efx_Pan->cleanup();
-            for (i = 0; i <= 8; i++)
-                efx_Pan->changepar (i, lv[14][i]);
-            Pan_Bypass = Pan_B;
-            break;
-
-        case 14://Harmonizer
-
-            Harmonizer_Bypass = 0;
-            efx_Har->cleanup();
-            for (i = 0; i <= 10; i++)
-                efx_Har->changepar (i, lv[15][i]);
-            Harmonizer_Bypass = Harmonizer_B;
-            break;
-
-        case 15://MusDelay
-
-            MusDelay_Bypass = 0;
-            efx_MusDelay->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_MusDelay->changepar (i, lv[16][i]);
-            MusDelay_Bypass = MusDelay_B;
-            break;
-
-        case 16://Gate
-
-            Gate_Bypass = 0;
-            efx_Gate->cleanup();
-            for (i = 0; i <= 6; i++)
-                efx_Gate->Gate_Change (i + 1,lv[17][i]);
-            Gate_Bypass = Gate_B;
-            break;
-
-        case 17://NewDist
-
-            NewDist_Bypass = 0;
-            efx_NewDist->cleanup();
-            for (i = 0; i <= 11; i++)
-                efx_NewDist->changepar (i, lv[18][i]);
-            NewDist_Bypass = NewDist_B;
-            break;
-
-        case 18://APhaser
-
-            APhaser_Bypass = 0;
-            efx_APhaser->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_APhaser->changepar (i, lv[19][i]);
-            APhaser_Bypass = APhaser_B;
-            break;
-
-        case 19://Valve
-
-            Valve_Bypass = 0;
-            efx_Valve->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_Valve->changepar (i, lv[20][i]);
-            Valve_Bypass = Valve_B;
-            break;
-
-        case 20://DFlange
+        *bypass = 0;
+        Config_Effect (type, Effect_By_Type (type));
+        if ((type == 42) && (lv[43][10])) RC->cleanup ();
+        *bypass = *Bypass_B_By_Type (type);
+    }
 
-            DFlange_Bypass = 0;
-            efx_DFlange->cleanup();
-            for (i = 0; i <= 14; i++)
-                efx_DFlange->changepar (i, lv[21][i]);
-            DFlange_Bypass = DFlange_B;
-            break;
+    // Parked effects got the preset above; the chain stays off until their
+    // full size copies are staged.
+    lazy_efx.unpark (efx_order.data(), MAX_EFFECT_SLOTS);
 
-        case 21://Ring
+    Bypass = Bypass_B;
+    if(needtoloadstate) {
+        calculavol(1);
+        calculavol(2);
+    }
 
-            Ring_Bypass = 0;
-            efx_Ring->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_Ring->changepar (i, lv[22][i]);
-            Ring_Bypass = Ring_B;
-            break;
+}
 
-        case 22://Exciter
 
-            Exciter_Bypass = 0;
-            efx_Exciter->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_Exciter->changepar (i, lv[23][i]);
-            Exciter_Bypass = Exciter_B;
-            break;
+void
+RKR::Config_Effect (int type, Effect *efx)
+{
 
-        case 23://MBDist
+    Config_Effect (type, efx, lv);
 
-            MBDist_Bypass = 0;
-            efx_MBDist->cleanup();
-            for (i = 0; i <= 14; i++)
-                efx_MBDist->changepar (i, lv[24][i]);
-            MBDist_Bypass = MBDist_B;
-            break;
+}
 
-        case 24://Arpie
 
-            Arpie_Bypass = 0;
-            efx_Arpie->cleanup();
-            for (i = 0; i <= 10; i++)
-                efx_Arpie->changepar (i, lv[25][i]);
-            Arpie_Bypass = Arpie_B;
-            break;
+/*
+ * Load the parameters of effect `type` from the table lv, the live lv[][]
+ * or a decoded preset's, into `efx`, which is either the live instance or
+ * a fresh one being prepared off the audio thread by PresetSwitcher.
+ */
+void
+RKR::Config_Effect (int type, Effect *efx, const Preset_Params &lv)
+{
+    int i;
 
-        case 25://Expander
+    switch(type) {
+    case 0: //EQ1
+        efx->cleanup();
+        for (i = 0; i < 10; i++) {
+            efx->changepar (i * 5 + 12, lv[7][i]);
+            efx->changepar (i * 5 + 13, lv[7][11]);
+        }
+        efx->changepar (0, lv[7][10]);
+        break;
 
-            Expander_Bypass = 0;
-            efx_Expander->cleanup();
-            for (i = 0; i <= 6; i++)
-                efx_Expander->Expander_Change (i + 1,lv[26][i]);
-            Expander_Bypass = Expander_B;
-            break;
+    case 1:// Compressor
+        efx->cleanup();
+        for (i = 0; i <= 9; i++)
+            efx->changepar (i + 1, lv[9][i]);
+        break;
 
-        case 26://Shuffle
+    case 2://Distortion
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[6][i]);
+        break;
 
-            Shuffle_Bypass = 0;
-            efx_Shuffle->cleanup();
-            for (i = 0; i <= 10; i++)
-                efx_Shuffle->changepar (i, lv[27][i]);
-            Shuffle_Bypass = Shuffle_B;
-            break;
+    case 3://Overdrive
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[5][i]);
+        break;
 
-        case 27://Synthfilter
+    case 4://Echo
+        efx->cleanup();
+        for (i = 0; i <= 8; i++)
+            efx->changepar (i, lv[1][i]);
+        break;
 
-            Synthfilter_Bypass = 0;
-            efx_Synthfilter->cleanup();
-            for (i = 0; i <= 15; i++)
-                efx_Synthfilter->changepar (i, lv[28][i]);
-            Synthfilter_Bypass = Synthfilter_B;
-            break;
+    case 5://Chorus
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[2][i]);
+        break;
 
-        case 28://MBVvol
+    case 6://Phaser
+        efx->cleanup();
+        for (i = 0; i <= 11; i++)
+            efx->changepar (i,lv[4][i]);
+        break;
 
-            MBVvol_Bypass = 0;
-            efx_MBVvol->cleanup();
-            for (i = 0; i <= 10; i++)
-                efx_MBVvol->changepar (i, lv[29][i]);
-            MBVvol_Bypass = MBVvol_B;
-            break;
+    case 7://Flanger
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[3][i]);
+        break;
 
-        case 29://Convolotron
+    case 8://Reverb
+        efx->cleanup();
+        for (i = 0; i <= 11; i++)
+            efx->changepar (i, lv[0][i]);
+        break;
 
-            Convol_Bypass = 0;
-            efx_Convol->cleanup();
-            for (i = 0; i <= 10; i++)
-                efx_Convol->changepar (i, lv[30][i]);
-            Convol_Bypass = Convol_B;
-            break;
+    case 9://EQ2
+        efx->cleanup();
+        for (i = 0; i < 3; i++) {
+            efx->changepar (i * 5 + 11, lv[8][0 + i * 3]);
+            efx->changepar (i * 5 + 12, lv[8][1 + i * 3]);
+            efx->changepar (i * 5 + 13, lv[8][2 + i * 3]);
+        }
+        efx->changepar (0, lv[8][9]);
+        break;
 
-        case 30://Looper
+    case 10://WhaWha
+        efx->cleanup();
+        efx->setpreset (lv[11][10]);
+        for (i = 0; i <= 9; i++)
+            efx->changepar (i, lv[11][i]);
+        break;
 
-            Looper_Bypass = 0;
-            // efx_Looper->cleanup();
-            for (i = 0; i <= 13; i++)
-                efx_Looper->loadpreset(i, lv[31][i]);
-            Looper_Bypass = Looper_B;
-            break;
+    case 11://Alienwah
+        efx->cleanup();
+        for (i = 0; i <= 10; i++)
+            efx->changepar (i, lv[12][i]);
+        break;
 
-        case 31://RyanWah
+    case 12://Cabinet
+        efx->cleanup();
+        Cabinet_setpreset (static_cast<EQ *> (efx), lv[13][0]);
+        efx->changepar (0,lv[13][1]);
+        break;
 
-            RyanWah_Bypass = 0;
-            efx_RyanWah->cleanup();
-            for (i = 0; i <= 18; i++)
-                efx_RyanWah->changepar (i, lv[32][i]);
-            RyanWah_Bypass = RyanWah_B;
-            break;
+    case 13://Pan
+        efx->cleanup();
+        for (i = 0; i <= 8; i++)
+            efx->changepar (i, lv[14][i]);
+        break;
 
-        case 32://RBEcho
+    case 14://Harmonizer
+        efx->cleanup();
+        for (i = 0; i <= 10; i++)
+            efx->changepar (i, lv[15][i]);
+        break;
 
-            RBEcho_Bypass = 0;
-            efx_RBEcho->cleanup();
-            for (i = 0; i <= 9; i++)
-                efx_RBEcho->changepar (i, lv[33][i]);
-            RBEcho_Bypass= RBEcho_B;
-            break;
+    case 15://MusDelay
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[16][i]);
+        break;
 
-        case 33://CoilCrafter
+    case 16://Gate
+        efx->cleanup();
+        for (i = 0; i <= 6; i++)
+            efx->changepar (i + 1, lv[17][i]);
+        break;
 
-            CoilCrafter_Bypass = 0;
-            efx_CoilCrafter->cleanup();
-            for (i = 0; i <= 8; i++)
-                efx_CoilCrafter->changepar (i, lv[34][i]);
-            CoilCrafter_Bypass = CoilCrafter_B;
-            break;
+    case 17://NewDist
+        efx->cleanup();
+        for (i = 0; i <= 11; i++)
+            efx->changepar (i, lv[18][i]);
+        break;
 
-        case 34://ShelfBoost
+    case 18://APhaser
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[19][i]);
+        break;
 
-            ShelfBoost_Bypass = 0;
-            efx_ShelfBoost->cleanup();
-            for (i = 0; i <= 4; i++)
-                efx_ShelfBoost->changepar (i, lv[35][i]);
-            ShelfBoost_Bypass = ShelfBoost_B;
-            break;
+    case 19://Valve
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[20][i]);
+        break;
 
-        case 35://Vocoder
+    case 20://DFlange
+        efx->cleanup();
+        for (i = 0; i <= 14; i++)
+            efx->changepar (i, lv[21][i]);
+        break;
 
-            Vocoder_Bypass = 0;
-            efx_Vocoder->cleanup();
-            for (i = 0; i <= 6; i++)
-                efx_Vocoder->changepar (i, lv[36][i]);
-            Vocoder_Bypass = Vocoder_B;
-            break;
+    case 21://Ring
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[22][i]);
+        break;
 
-        case 36://Sustainer
+    case 22://Exciter
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[23][i]);
+        break;
 
-            Sustainer_Bypass = 0;
-            efx_Sustainer->cleanup();
-            for (i = 0; i <= 1; i++)
-                efx_Sustainer->changepar (i, lv[37][i]);
-            Sustainer_Bypass = Sustainer_B;
-            break;
+    case 23://MBDist
+        efx->cleanup();
+        for (i = 0; i <= 14; i++)
+            efx->changepar (i, lv[24][i]);
+        break;
 
-        case 37://Sequence
+    case 24://Arpie
+        efx->cleanup();
+        for (i = 0; i <= 10; i++)
+            efx->changepar (i, lv[25][i]);
+        break;
 
-            Sequence_Bypass = 0;
-            efx_Sequence->cleanup();
-            for (i = 0; i <= 14; i++)
-                efx_Sequence->changepar (i, lv[38][i]);
-            Sequence_Bypass = Sequence_B;
-            break;
+    case 25://Expander
+        efx->cleanup();
+        for (i = 0; i <= 6; i++)
+            efx->changepar (i + 1, lv[26][i]);
+        break;
 
-        case 38://Shifter
+    case 26://Shuffle
+        efx->cleanup();
+        for (i = 0; i <= 10; i++)
+            efx->changepar (i, lv[27][i]);
+        break;
 
-            Shifter_Bypass = 0;
-            efx_Shifter->cleanup();
-            for (i = 0; i <= 9; i++)
-                efx_Shifter->changepar (i, lv[39][i]);
-            Shifter_Bypass = Shifter_B;
-            break;
+    case 27://Synthfilter
+        efx->cleanup();
+        for (i = 0; i <= 15; i++)
+            efx->changepar (i, lv[28][i]);
+        break;
 
-        case 39://StompBox
+    case 28://MBVvol
+        efx->cleanup();
+        for (i = 0; i <= 10; i++)
+            efx->changepar (i, lv[29][i]);
+        break;
 
-            StompBox_Bypass = 0;
-            efx_StompBox->cleanup();
-            for (i = 0; i <= 5; i++)
-                efx_StompBox->changepar (i, lv[40][i]);
-            StompBox_Bypass = StompBox_B;
-            break;
+    case 29://Convolotron
+        efx->cleanup();
+        for (i = 0; i <= 10; i++)
+            efx->changepar (i, lv[30][i]);
+        break;
 
-        case 40://Reverbtron
+    case 30://Looper
+        // efx_Looper->cleanup();
+        for (i = 0; i <= 13; i++)
+            static_cast<Looper *> (efx)->loadpreset(i, lv[31][i]);
+        break;
 
-            Reverbtron_Bypass = 0;
-            efx_Reverbtron->cleanup();
-            for (i = 0; i <= 15; i++)
-                efx_Reverbtron->changepar (i, lv[41][i]);
-            Reverbtron_Bypass = Reverbtron_B;
-            break;
+    case 31://RyanWah
+        efx->cleanup();
+        for (i = 0; i <= 18; i++)
+            efx->changepar (i, lv[32][i]);
+        break;
 
-        case 41://Echotron
+    case 32://RBEcho
+        efx->cleanup();
+        for (i = 0; i <= 9; i++)
+            efx->changepar (i, lv[33][i]);
+        break;
 
-            Echotron_Bypass = 0;
-            efx_Echotron->cleanup();
-            efx_Echotron->Pchange=1;
-            for (i = 0; i <= 15; i++)
-                efx_Echotron->changepar (i, lv[42][i]);
-            efx_Echotron->Pchange=0;
-            Echotron_Bypass = Echotron_B;
-            break;
+    case 33://CoilCrafter
+        efx->cleanup();
+        for (i = 0; i <= 8; i++)
+            efx->changepar (i, lv[34][i]);
+        break;
 
-        case 42://StereoHarm
+    case 34://ShelfBoost
+        efx->cleanup();
+        for (i = 0; i <= 4; i++)
+            efx->changepar (i, lv[35][i]);
+        break;
 
-            StereoHarm_Bypass = 0;
-            efx_StereoHarm->cleanup();
-            for (i = 0; i <= 11; i++)
-                efx_StereoHarm->changepar (i, lv[43][i]);
-            if (lv[43][10]) RC->cleanup ();
-            StereoHarm_Bypass = StereoHarm_B;
-            break;
+    case 35://Vocoder
+        efx->cleanup();
+        for (i = 0; i <= 6; i++)
+            efx->changepar (i, lv[36][i]);
+        break;
 
-        case 43://CompBand
+    case 36://Sustainer
+        efx->cleanup();
+        for (i = 0; i <= 1; i++)
+            efx->changepar (i, lv[37][i]);
+        break;
 
-            CompBand_Bypass = 0;
-            efx_CompBand->cleanup();
-            for (i = 0; i <= 12; i++)
-                efx_CompBand->changepar (i, lv[44][i]);
-            CompBand_Bypass = CompBand_B;
-            break;
+    case 37://Sequence
+        efx->cleanup();
+        for (i = 0; i <= 14; i++)
+            efx->changepar (i, lv[38][i]);
+        break;
 
-        case 44://OpticalTrem
+    case 38://Shifter
+        efx->cleanup();
+        for (i = 0; i <= 9; i++)
+            efx->changepar (i, lv[39][i]);
+        break;
 
-            Opticaltrem_Bypass = 0;
-            efx_Opticaltrem->cleanup();
-            for (i = 0; i <= 6; i++)
-                efx_Opticaltrem->changepar (i, lv[45][i]);
-            Opticaltrem_Bypass = Opticaltrem_B;
-            break;
+    case 39://StompBox
+        efx->cleanup();
+        for (i = 0; i <= 5; i++)
+            efx->changepar (i, lv[40][i]);
+        break;
 
-        case 45://Vibe
+    case 40://Reverbtron
+        efx->cleanup();
+        for (i = 0; i <= 15; i++)
+            efx->changepar (i, lv[41][i]);
+        break;
 
-            Vibe_Bypass = 0;
-            efx_Vibe->cleanup();
-            for (i = 0; i <= 10; i++)
-                efx_Vibe->changepar (i, lv[46][i]);
-            Vibe_Bypass = Vibe_B;
-            break;
+    case 41://Echotron
+        efx->cleanup();
+        static_cast<Echotron *> (efx)->Pchange=1;
+        for (i = 0; i <= 15; i++)
+            efx->changepar (i, lv[42][i]);
+        static_cast<Echotron *> (efx)->Pchange=0;
+        break;
 
-        case 46://Infinity
+    case 42://StereoHarm
+        efx->cleanup();
+        for (i = 0; i <= 11; i++)
+            efx->changepar (i, lv[43][i]);
+        break;
 
-            Infinity_Bypass = 0;
-            efx_Infinity->cleanup();
-            for (i = 0; i <= 17; i++)
-                efx_Infinity->changepar (i, lv[47][i]);
-            Infinity_Bypass = Infinity_B;
-            break;
+    case 43://CompBand
+        efx->cleanup();
+        for (i = 0; i <= 12; i++)
+            efx->changepar (i, lv[44][i]);
+        break;
 
-        }
-    }
+    case 44://OpticalTrem
+        efx->cleanup();
+        for (i = 0; i <= 6; i++)
+            efx->changepar (i, lv[45][i]);
+        break;
 
+    case 45://Vibe
+        efx->cleanup();
+        for (i = 0; i <= 10; i++)
+            efx->changepar (i, lv[46][i]);
+        break;
 
+    case 46://Infinity
+        efx->cleanup();
+        for (i = 0; i <= 17; i++)
+            efx->changepar (i, lv[47][i]);
+        break;
 
-    Bypass = Bypass_B;
-    if(needtoloadstate) {
-        calculavol(1);
-        calculavol(2);
     }
 
 }
@@ -2261,13 +2158,6 @@ void
 RKR::Bank_to_Preset (int i)
 {
 
-    int j, k;
-
-
-    memset(presets.Preset_Name.data(), 0, presets.Preset_Name.size());
-    safe_copy(presets.Preset_Name, presets.Bank[i].Preset_Name);
-    memset(presets.Author.data(), 0, presets.Author.size());
-    safe_copy(presets.Author, presets.Bank[i].Author);
     efx_Convol->Filename.fill(0);
     safe_copy(efx_Convol->Filename, presets.Bank[i].ConvoFiname);
     efx_Reverbtron->Filename.fill(0);
@@ -2275,84 +2165,110 @@ RKR::Bank_to_Preset (int i)
     efx_Echotron->Filename.fill(0);
     safe_copy(efx_Echotron->Filename, presets.Bank[i].EchoFiname);
 
+    Bank_to_State (i);
+
+    Actualizar_Audio ();
+
+    if((Tap_Updated) && (Tap_Bypass) && (Tap_TempoSet>0) && (Tap_TempoSet<601)) Update_tempo();
+
+};
+
+
+/*
+ * Copy everything of bank slot i except the effect instances themselves:
+ * names, parameter table, on/off flags, MIDI map and gains.
+ */
+void
+RKR::Bank_to_State (int i)
+{
+
+    Preset_State state;
+    Bank_to_State (i, state);
+    Load_State (state);
+
+};
+
+
+/*
+ * Row of lv[][] that holds the parameters of effect `type`. The first ten
+ * effects came in a different order than their types.
+ */
+static int
+param_row (int type)
+{
+
+    static const int rows[10] = {7, 9, 6, 5, 1, 2, 4, 3, 0, 8};
+    return (type < 10) ? rows[type] : type + 1;
+
+}
+
+
+/*
+ * Decode bank slot i into `state`, leaving the live engine alone, so it can
+ * run off the audio thread.
+ */
+void
+RKR::Bank_to_State (int i, Preset_State &state) const
+{
+
+    const Preset_Bank_Struct &bank = presets.Bank[i];
+
+    safe_copy(state.Preset_Name, bank.Preset_Name);
+    safe_copy(state.Author, bank.Author);
+
+    state.lv = bank.lv;
+    for (int type = 0; type < (int) state.bypass.size(); type++)
+        state.bypass[type] = bank.lv[param_row (type)][19];
+
+    state.XUserMIDI = bank.XUserMIDI;
+
+    state.Input_Gain = bank.Input_Gain;
+    state.Master_Volume = bank.Master_Volume;
+    state.Balance = bank.Balance;
+
+};
+
+
+/*
+ * Put a decoded bank slot in place. Copies only, so PresetSwitcher runs it
+ * on the audio thread at swap time.
+ */
+void
+RKR::Load_State (const Preset_State &state)
+{
+
+    int j, k;
+
+
+    memset(presets.Preset_Name.data(), 0, presets.Preset_Name.size());
+    safe_copy(presets.Preset_Name, state.Preset_Name);
+    memset(presets.Author.data(), 0, presets.Author.size());
+    safe_copy(presets.Author, state.Author);
+
 
     for (j = 0; j <=NumEffects; j++) {
         for (k = 0; k < 20; k++) {
-            lv[j][k] = presets.Bank[i].lv[j][k];
+            lv[j][k] = state.lv[j][k];
         }
     }
 
 
-    for (k = 0; k < MAX_EFFECT_SLOTS; k++)
-        efx_order[k] = presets.Bank[i].lv[10][k];
-
-
-    Reverb_B = presets.Bank[i].lv[0][19];
-    Echo_B = presets.Bank[i].lv[1][19];
-    Chorus_B = presets.Bank[i].lv[2][19];
-    Flanger_B = presets.Bank[i].lv[3][19];
-    Phaser_B = presets.Bank[i].lv[4][19];
-    Overdrive_B = presets.Bank[i].lv[5][19];
-    Distorsion_B = presets.Bank[i].lv[6][19];
-    EQ1_B = presets.Bank[i].lv[7][19];
-    EQ2_B = presets.Bank[i].lv[8][19];
-    Compressor_B = presets.Bank[i].lv[9][19];
-    WhaWha_B = presets.Bank[i].lv[11][19];
-    Alienwah_B = presets.Bank[i].lv[12][19];
-    Cabinet_B = presets.Bank[i].lv[13][19];
-    Pan_B = presets.Bank[i].lv[14][19];
-    Harmonizer_B = presets.Bank[i].lv[15][19];
-    MusDelay_B = presets.Bank[i].lv[16][19];
-    Gate_B = presets.Bank[i].lv[17][19];
-    NewDist_B = presets.Bank[i].lv[18][19];
-    APhaser_B = presets.Bank[i].lv[19][19];
-    Valve_B = presets.Bank[i].lv[20][19];
-    DFlange_B = presets.Bank[i].lv[21][19];
-    Ring_B = presets.Bank[i].lv[22][19];
-    Exciter_B = presets.Bank[i].lv[23][19];
-    MBDist_B = presets.Bank[i].lv[24][19];
-    Arpie_B = presets.Bank[i].lv[25][19];
-    Expander_B = presets.Bank[i].lv[26][19];
-    Shuffle_B = presets.Bank[i].lv[27][19];
-    Synthfilter_B = presets.Bank[i].lv[28][19];
-    MBVvol_B = presets.Bank[i].lv[29][19];
-    Convol_B = presets.Bank[i].lv[30][19];
-    Looper_B = presets.Bank[i].lv[31][19];
-    RyanWah_B = presets.Bank[i].lv[32][19];
-    RBEcho_B = presets.Bank[i].lv[33][19];
-    CoilCrafter_B = presets.Bank[i].lv[34][19];
-    ShelfBoost_B = presets.Bank[i].lv[35][19];
-    Vocoder_B = presets.Bank[i].lv[36][19];
-    Sustainer_B = presets.Bank[i].lv[37][19];
-    Sequence_B = presets.Bank[i].lv[38][19];
-    Shifter_B = presets.Bank[i].lv[39][19];
-    StompBox_B = presets.Bank[i].lv[40][19];
-    Reverbtron_B = presets.Bank[i].lv[41][19];
-    Echotron_B = presets.Bank[i].lv[42][19];
-    StereoHarm_B = presets.Bank[i].lv[43][19];
-    CompBand_B = presets.Bank[i].lv[44][19];
-    Opticaltrem_B = presets.Bank[i].lv[45][19];
-    Vibe_B = presets.Bank[i].lv[46][19];
-    Infinity_B = presets.Bank[i].lv[47][19];
+    for (j = 0; j < (int) state.bypass.size(); j++)
+        *Bypass_B_By_Type (j) = state.bypass[j];
 
 
     Bypass_B = Bypass;
 
 
-    memcpy(XUserMIDI.data(), presets.Bank[i].XUserMIDI.data(), sizeof(XUserMIDI));
-
-
+    XUserMIDI = state.XUserMIDI;
 
-    Actualizar_Audio ();
 
     if (actuvol == 0) {
-        Input_Gain = presets.Bank[i].Input_Gain;
-        Master_Volume = presets.Bank[i].Master_Volume;
-        Fraction_Bypass = presets.Bank[i].Balance;
+        Input_Gain = state.Input_Gain;
+        Master_Volume = state.Master_Volume;
+        Fraction_Bypass = state.Balance;
     }
 
-    if((Tap_Updated) && (Tap_Bypass) && (Tap_TempoSet>0) && (Tap_TempoSet<601)) Update_tempo();
-
 };
 
 
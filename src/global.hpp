@@ -28,8 +28,12 @@
 #include "PresetBank.hpp"
 #include "AppConfig.hpp"
 #include "compat_time.hpp"
+#include "EffectTimer.hpp"
+#include "LazyEffects.hpp"
 
 #include <signal.h>
+#include <utility>
+#include <vector>
 #include <jack/jack.h>
 #include <jack/midiport.h>
 #ifdef ENABLE_MIDI
@@ -38,6 +42,9 @@
 
 // Forward declarations for types used via std::unique_ptr in RKR class.
 class EngineController;
+class PresetSwitcher;
+class Effect;
+struct PresetChanges;
 class Reverb;
 class Chorus;
 class Echo;
@@ -147,6 +154,22 @@ struct JackClient {
     Port input_ports[16]{};
 };
 
+// How a chain slot blends the effect output with its input.
+enum ChainMix {
+    MIX_INSERT,             // effect output only
+    MIX_BOOST,              // effect output +6dB (Cabinet)
+    MIX_WETDRY,             // wet/dry by outvolume
+    MIX_WETDRY_SQUARED      // same with the dry gain squared (Reverb, MusDelay)
+};
+
+// One active slot of the compiled effect chain.
+struct ChainNode {
+    Effect *efx{};
+    int mix{};
+    int slot{};
+    int type{};
+};
+
 class RKR
 {
 
@@ -154,24 +177,41 @@ class RKR
 
 public:
 
-    RKR ();
+    RKR (int sample_rate = 0, int period = 0);
     ~RKR ();
 
     void Alg (float *inl, float *inr,float *origl, float *origr ,void *);
     void Control_Gain (float *origl, float *origr);
     void Control_Volume (float *origl, float *origr);
 
-    void Vol_Efx (int NumEffect, float volume);
-    void Vol2_Efx ();
-    void Vol3_Efx ();
     void cleanup_efx ();
     void midievents();
     void miramidi ();
     void calculavol (int i);
     void Bank_to_Preset (int Num);
+    void Bank_to_State (int i);
+    void Bank_to_State (int i, Preset_State &state) const;
+    void Load_State (const Preset_State &state);
     void Preset_to_Bank (int i);
     void Actualizar_Audio ();
-    void loadfile (char *filename);
+    void Config_Effect (int type, Effect *efx);
+    void Config_Effect (int type, Effect *efx, const Preset_Params &lv);
+    void Effect_Chain ();
+    void Run_Node (const ChainNode &node, float *l, float *r);
+    bool Chain_Changed ();
+    void Compile_Chain ();
+    Effect *Effect_By_Type (int type);
+    int *Bypass_By_Type (int type);
+    int *Bypass_B_By_Type (int type);
+    static int Preset_Count (int type);
+    void Effect_setpreset (int type, Effect *efx, int npreset);
+    std::unique_ptr<Effect> New_Effect (int type, bool parked = false);
+    template <template <class> class As>
+    std::unique_ptr<Effect> Make_Effect (int type, bool parked);
+    static void Preset_Changes (int type, int npreset, PresetChanges &changes);
+    std::vector<std::pair<int, int>> Config_Changes (int type, const Preset_Params &lv);
+    Effect *Swap_Effect (int type, Effect *fresh);
+    int loadfile (char *filename);
     void getbuf (char *buf, int j);
     void putbuf (char *buf, int j);
     void savefile (char *filename);
@@ -197,8 +237,14 @@ public:
     int Message (int prio, const char *labelwin, const char *message_text);
     char *PrefNom (const char *dato);
     void EQ1_setpreset (int npreset);
+    void EQ1_setpreset (EQ *eq, int npreset);
+    static void EQ1_preset_changes (int npreset, PresetChanges &changes);
     void EQ2_setpreset (int npreset);
+    void EQ2_setpreset (EQ *eq, int npreset);
+    static void EQ2_preset_changes (int npreset, PresetChanges &changes);
     int Cabinet_setpreset (int npreset);
+    int Cabinet_setpreset (EQ *cabinet, int npreset);
+    static int Cabinet_preset_changes (int npreset, PresetChanges &changes);
     void InitMIDI ();
     void ConnectMIDI ();
     void ActiveUn(int value);
@@ -397,9 +443,22 @@ public:
     int Infinity_B;
 
     int Cabinet_Preset;
-    std::array<std::array<int, 20>, 70> lv{};
+    Preset_Params lv{};
     std::array<int, 16> saved_order{};
     std::array<int, 16> efx_order{};
+
+    // Compiled from efx_order and the on/off flags by Compile_Chain()
+    std::array<ChainNode, MAX_EFFECT_SLOTS> chain{};
+    std::array<int, MAX_EFFECT_SLOTS> chain_order{};
+    std::array<int, MAX_EFFECT_SLOTS> chain_on{};
+    int chain_len{0};
+    bool chain_dirty{true};
+
+    // Per-slot out() timing, published by the JACK callback
+    EffectTimer efx_timer;
+
+    // Full size Convolotron/Looper/Reverbtron/Echotron only while in use
+    LazyEffects lazy_efx{*this};
     std::array<int, 16> new_order{};
     std::array<int, 60> availables{};
     std::array<int, MAX_EFFECT_SLOTS> active{};
@@ -442,6 +501,14 @@ public:
     int Ste_U_Q;
     int Ste_D_Q;
 
+    // Oversampling of the nonlinear stage only, as for Waveshaper
+    int Dist_Over;
+    int Ovrd_Over;
+    int NewD_Over;
+    int MBDi_Over;
+    int Stom_Over;
+    int Valv_Over;
+
     int Metro_Vol;
     int M_Metro_Sound;
     int deachide;
@@ -471,6 +538,7 @@ public:
     // Harmonizer
     int HarQual;
     int SteQual;
+    int PitchMode;      // PitchShifter::REFERENCE or FAST
 
     // Tap Tempo
 
@@ -593,6 +661,10 @@ public:
     /// JACK RT callback can push telemetry into the lock-free ring buffers.
     EngineController* m_controller{nullptr};
 
+    /// Prepares bank presets off the audio thread and swaps them in
+    /// between periods. Declared after the effects so it stops first.
+    std::unique_ptr<PresetSwitcher> switcher;
+
 #ifdef ENABLE_MIDI
     // Alsa MIDI
     snd_seq_t *midi_in, *midi_out;
@@ -24,6 +24,14 @@ static constexpr auto kBypassedStyle =
 static constexpr auto kLedOn  = "\xE2\x97\x89";   // ◉
 static constexpr auto kLedOff = "\xE2\x97\x8B";   // ○
 
+/// Format a duration in microseconds as "85 µs" or "1.25 ms".
+static QString formatMicros(float us)
+{
+    if (us < 1000.0f)
+        return QStringLiteral("%1 \u00B5s").arg(us, 0, 'f', 0);
+    return QStringLiteral("%1 ms").arg(us / 1000.0f, 0, 'f', 2);
+}
+
 // ---------------------------------------------------------------------------
 // Construction
 // ---------------------------------------------------------------------------
@@ -92,6 +100,25 @@ void EffectSlotBar::setSelectedSlot(int slot)
             .arg(active ? QString::fromUtf8(kLedOn) : QString::fromUtf8(kLedOff))
             .arg(QString::fromStdString(name))
             .arg(active ? tr("ON") : tr("OFF"));
+
+        // Average out() time of this slot, if it ran in the last window
+        const SlotTiming& t = m_timing.slots[static_cast<std::size_t>(i)];
+        if (active && t.calls > 0 && t.effect_type == effectType)
+        {
+            label += QStringLiteral("  %1").arg(formatMicros(t.avg_us));
+            const float budget = m_timing.budget_us > 0.0f ? m_timing.budget_us : 1.0f;
+            btn->setToolTip(
+                tr("out() per period: min %1, avg %2, max %3, p99 %4\n"
+                   "%5% of the %6 period")
+                    .arg(formatMicros(t.min_us), formatMicros(t.avg_us),
+                         formatMicros(t.max_us), formatMicros(t.p99_us))
+                    .arg(100.0f * t.avg_us / budget, 0, 'f', 1)
+                    .arg(formatMicros(m_timing.budget_us)));
+        }
+        else
+        {
+            btn->setToolTip(QString());
+        }
         btn->setText(label);
 
         if (i == m_selectedSlot)
@@ -115,3 +142,13 @@ void EffectSlotBar::syncFromEngine()
     // setSelectedSlot already updates labels, LEDs, and colors for all buttons.
     setSelectedSlot(m_selectedSlot);
 }
+
+// ---------------------------------------------------------------------------
+// Per-slot effect timing
+// ---------------------------------------------------------------------------
+
+void EffectSlotBar::updateTiming(const EffectTiming& timing)
+{
+    m_timing = timing;
+    setSelectedSlot(m_selectedSlot);
+}
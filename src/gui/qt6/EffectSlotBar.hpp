@@ -5,7 +5,8 @@
   Qt6 GUI — EffectSlotBar
 
   Horizontal row of up to 16 toggle buttons, one per effect slot in the chain.
-  Each button shows the effect name and active/bypass state.  Clicking a
+  Each button shows the effect name and active/bypass state, plus the average
+  time its effect took per period when effect timing is on.  Clicking a
   slot selects it for detailed editing in the panel area below.
 */
 
@@ -15,6 +16,8 @@
 
 #include <array>
 
+#include "EffectTimer.hpp"
+
 class EngineController;
 class QPushButton;
 
@@ -35,6 +38,9 @@ public:
     /// Update button labels and active states from engine.
     void syncFromEngine();
 
+    /// Show the latest per-slot timing on the buttons and their tooltips.
+    void updateTiming(const EffectTiming& timing);
+
 Q_SIGNALS:
     /// Emitted when user clicks a slot button.
     void slotSelected(int slotIndex);
@@ -43,4 +49,5 @@ private:
     EngineController& m_engine;
     std::array<QPushButton*, kEffectSlots> m_slotButtons{};
     int m_selectedSlot{0};
+    EffectTiming m_timing{};
 };
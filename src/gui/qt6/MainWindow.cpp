@@ -25,6 +25,7 @@
 #include "AppConfig.hpp"
 #include "global.hpp"
 
+#include <QAction>
 #include <QFileDialog>
 #include <QIcon>
 #include <QMenuBar>
@@ -139,6 +140,19 @@ void MainWindow::setupMenuBar()
                             }
                         });
 
+#ifdef ENABLE_EFFECT_TIMING
+    auto* timingAction = viewMenu->addAction(tr("Effect &Timing"));
+    timingAction->setCheckable(true);
+    timingAction->setChecked(m_engine.isEffectTimingEnabled());
+    connect(timingAction, &QAction::toggled, this,
+            [this](bool checked)
+            {
+                m_engine.setEffectTiming(checked);
+                if (!checked)
+                    m_slotBar->updateTiming(EffectTiming{});
+            });
+#endif
+
     // ── Windows menu ───────────────────────────────────────────────
     auto* windowsMenu = menuBar()->addMenu(tr("&Windows"));
     windowsMenu->addAction(tr("&Bank Manager"), QKeySequence(Qt::CTRL | Qt::Key_B),
@@ -253,15 +267,54 @@ void MainWindow::onGuiTick()
     // Delegate level/tuner/tap updates to the TopBar
     m_topBar->updateFromEngine();
 
-    // Update status bar with signal presence
+    // Update status bar with signal presence and the last preset switch
     AudioLevels levels;
     if (m_engine.pollLevels(levels))
     {
-        statusBar()->showMessage(
-            levels.have_signal
-                ? tr("Signal: YES")
-                : tr("Signal: no"));
+        QString msg = levels.have_signal
+                          ? tr("Signal: YES")
+                          : tr("Signal: no");
+        const PresetSwitchStats sw = m_engine.getPresetSwitchStats();
+        if (sw.switches > 0)
+            msg += tr("  |  Preset switch: %1 ms, audio thread %2 us")
+                       .arg(sw.last_latency_ms, 0, 'f', 1)
+                       .arg(sw.last_rt_us, 0, 'f', 0);
+        statusBar()->showMessage(msg);
+    }
+
+    EffectTiming timing;
+    // A snapshot can still be queued after timing was switched off
+    if (m_engine.pollEffectTiming(timing) && m_engine.isEffectTimingEnabled())
+        m_slotBar->updateTiming(timing);
+
+    // An order held back while its effects are rebuilt full size
+    m_engine.postPendingOrder();
+
+    // Refresh once a preset switch (from here, the bank window or MIDI) or
+    // a new order is applied, rather than blocking until the RT thread
+    // gets to it
+    const std::uint64_t switches = m_engine.getPresetSwitchStats().switches;
+    if (switches != m_presetSwitches && !m_engine.isPresetPending())
+    {
+        m_presetSwitches = switches;
+        m_slotBar->syncFromEngine();
+        m_topBar->syncFromEngine();
+        for (auto* panel : m_effectPanels)
+            if (panel)
+                panel->syncFromEngine();
+    }
+    if (m_orderPending && !m_engine.hasPendingCommands())
+    {
+        m_orderPending = false;
+        createEffectPanels();
+        m_slotBar->syncFromEngine();
     }
+    for (auto* panel : m_effectPanels)
+        if (panel)
+        {
+            panel->syncIfApplied();
+            panel->updateFromEngine();
+        }
 }
 
 // ---------------------------------------------------------------------------
@@ -283,16 +336,16 @@ void MainWindow::connectTopBarSignals()
     connect(m_topBar, &TopBar::presetChanged, this,
             [this](int index)
             {
-                auto& rkr = m_engine.engine();
-                rkr.Bank_to_Preset(index - 1);  // spinbox is 1-based, engine is 0-based
-                m_slotBar->syncFromEngine();
-                m_topBar->syncFromEngine();
-                for (auto* panel : m_effectPanels)
-                    if (panel)
-                        panel->syncFromEngine();
+                switchPreset(index - 1);  // spinbox is 1-based, engine is 0-based
             });
 }
 
+// Switch bank preset off the RT thread; onGuiTick() refreshes once it plays.
+void MainWindow::switchPreset(int bankSlot)
+{
+    m_engine.loadPreset(bankSlot);
+}
+
 // ---------------------------------------------------------------------------
 // File actions — Load / Save preset
 // ---------------------------------------------------------------------------
@@ -335,14 +388,7 @@ void MainWindow::nextPreset()
     auto& rkr = m_engine.engine();
     int current = rkr.presets.Selected_Preset;
     if (current < 60)
-    {
-        rkr.Bank_to_Preset(current + 1);
-        m_slotBar->syncFromEngine();
-        m_topBar->syncFromEngine();
-        for (auto* panel : m_effectPanels)
-            if (panel)
-                panel->syncFromEngine();
-    }
+        switchPreset(current + 1);
 }
 
 void MainWindow::previousPreset()
@@ -350,14 +396,7 @@ void MainWindow::previousPreset()
     auto& rkr = m_engine.engine();
     int current = rkr.presets.Selected_Preset;
     if (current > 1)
-    {
-        rkr.Bank_to_Preset(current - 1);
-        m_slotBar->syncFromEngine();
-        m_topBar->syncFromEngine();
-        for (auto* panel : m_effectPanels)
-            if (panel)
-                panel->syncFromEngine();
-    }
+        switchPreset(current - 1);
 }
 
 // ---------------------------------------------------------------------------
@@ -409,9 +448,8 @@ void MainWindow::showOrderDialog()
     OrderDialog dlg(m_engine, this);
     if (dlg.exec() == QDialog::Accepted)
     {
-        // Rebuild panels if order changed
-        createEffectPanels();
-        m_slotBar->syncFromEngine();
+        // onGuiTick() rebuilds the panels once the new order is applied
+        m_orderPending = true;
     }
 }
 
@@ -11,6 +11,7 @@
 #include <QTimer>
 
 #include <array>
+#include <cstdint>
 #include <memory>
 
 class EngineController;
@@ -73,6 +74,7 @@ private:
     void createEffectPanels();
     void connectTopBarSignals();
     void applyThemeFromEngine();
+    void switchPreset(int bankSlot);
 
     EngineController& m_engine;
     QTimer*           m_guiTimer{nullptr};
@@ -90,6 +92,10 @@ private:
     // Effect panels (one per slot)
     std::array<EffectPanel*, kMainEffectSlots> m_effectPanels{};
 
+    // Refreshes onGuiTick() owes once the RT thread catches up
+    std::uint64_t m_presetSwitches{0};
+    bool          m_orderPending{false};
+
     // Persistent dialogs (created on first use)
     BankDialog*      m_bankDialog{nullptr};
     HelpBrowser*     m_helpBrowser{nullptr};
@@ -157,7 +157,7 @@ void BankDialog::refreshBank()
 void BankDialog::onPresetClicked(int index)
 {
     m_selectedSlot = index;
-    m_engine.engine().Bank_to_Preset(index);
+    m_engine.loadPreset(index);
     refreshBank();
 }
 
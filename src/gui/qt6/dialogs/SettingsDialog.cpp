@@ -9,7 +9,9 @@
 #include "EngineController.hpp"
 #include "AppConfig.hpp"
 #include "global.hpp"
+#include "smbPitchShift.hpp"
 
+#include <algorithm>
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDialogButtonBox>
@@ -26,6 +28,17 @@
 #include <QTabWidget>
 #include <QVBoxLayout>
 
+namespace {
+
+// Distorsion, Overdrive, NewDist, MBDist, StompBox and Valve, in the order
+// of SettingsDialog::m_oversample
+constexpr int RKR::* kOversample[] = {
+    &RKR::Dist_Over, &RKR::Ovrd_Over, &RKR::NewD_Over,
+    &RKR::MBDi_Over, &RKR::Stom_Over, &RKR::Valv_Over
+};
+
+} // namespace
+
 SettingsDialog::SettingsDialog(EngineController& engine, QWidget* parent)
     : QDialog(parent)
     , m_engine(engine)
@@ -159,13 +172,37 @@ QWidget* SettingsDialog::createAudioTab()
 
     layout->addRow(upGroup);
 
-    // Looper
+    // Oversampling around just the nonlinear stage of each distortion, so
+    // the rest of the chain can stay at the engine rate
+    auto* overGroup = new QGroupBox(tr("Distortion Oversampling"), page);
+    auto* overLayout = new QFormLayout(overGroup);
+    const QString overNames[] = {
+        tr("Distortion:"), tr("Overdrive:"), tr("NewDist:"),
+        tr("MBDist:"), tr("StompBox:"), tr("Valve:")
+    };
+    for (int i = 0; i < 6; ++i) {
+        m_oversample[i] = new QComboBox(overGroup);
+        m_oversample[i]->addItems({tr("Off"), QStringLiteral("x2"), QStringLiteral("x4"),
+                                   QStringLiteral("x8"), QStringLiteral("x12")});
+        overLayout->addRow(overNames[i], m_oversample[i]);
+    }
+    layout->addRow(overGroup);
+
+    // Looper, longest loop. Only a few seconds stay in memory, the rest
+    // goes to a temporary file.
     m_looperSize = new QDoubleSpinBox(page);
-    m_looperSize->setRange(0.5, 30.0);
+    m_looperSize->setRange(0.5, 14400.0);
     m_looperSize->setSingleStep(0.5);
     m_looperSize->setSuffix(tr(" seconds"));
     layout->addRow(tr("Looper Size:"), m_looperSize);
 
+    // Convolotron, Reverbtron and Echotron buffers, freed when out of the chain
+    m_releaseEffects = new QSpinBox(page);
+    m_releaseEffects->setRange(0, 3600);
+    m_releaseEffects->setSuffix(tr(" seconds"));
+    m_releaseEffects->setSpecialValueText(tr("Never"));
+    layout->addRow(tr("Free Unused Effects After:"), m_releaseEffects);
+
     m_metroVol = new QSpinBox(page);
     m_metroVol->setRange(0, 127);
     layout->addRow(tr("Metronome Volume:"), m_metroVol);
@@ -181,6 +218,18 @@ QWidget* SettingsDialog::createAudioTab()
                             QStringLiteral("16"), QStringLiteral("32")});
     layout->addRow(tr("Stereo Harm Quality:"), m_steQuality);
 
+    // Index is PitchShifter::REFERENCE / FAST / PSOLA
+    m_pitchMode = new QComboBox(page);
+    m_pitchMode->addItems({tr("Reference (double precision)"), tr("Fast (single precision)"),
+                           tr("PSOLA (low latency)")});
+    layout->addRow(tr("Pitch Shifter:"), m_pitchMode);
+
+    // Of the shifters as built; a new mode applies as each is rebuilt.
+    // PSOLA lags half a period of the note played, so it shows its range
+    // and the value for the last note found.
+    m_pitchLatency = new QLabel(page);
+    layout->addRow(tr("Pitch Shifter Latency:"), m_pitchLatency);
+
     m_vocBands = new QComboBox(page);
     m_vocBands->addItems({QStringLiteral("16"), QStringLiteral("32"),
                           QStringLiteral("64"), QStringLiteral("128"),
@@ -366,13 +415,32 @@ void SettingsDialog::loadFromEngine()
         m_upsampleAmount->setCurrentIndex(rkr.UpAmo - 2);
     m_upQuality->setCurrentIndex(rkr.UpQual);
     m_downQuality->setCurrentIndex(rkr.DownQual);
+    for (int i = 0; i < 6; ++i) {
+        const int amount = rkr.*kOversample[i];
+        m_oversample[i]->setCurrentIndex((amount >= 0 && amount < 5) ? amount : 0);
+    }
     m_looperSize->setValue(static_cast<double>(rkr.looper_size));
+    m_releaseEffects->setValue(rkr.lazy_efx.release_time);
     m_metroVol->setValue(rkr.Metro_Vol);
     // Quality combos: values are 4/8/16/32 → indices 0-3
     m_harQuality->setCurrentIndex(
         rkr.HarQual == 4 ? 0 : rkr.HarQual == 8 ? 1 : rkr.HarQual == 16 ? 2 : 3);
     m_steQuality->setCurrentIndex(
         rkr.SteQual == 4 ? 0 : rkr.SteQual == 8 ? 1 : rkr.SteQual == 16 ? 2 : 3);
+    m_pitchMode->setCurrentIndex(std::clamp(rkr.PitchMode, 0, 2));
+    if (rkr.PitchMode == PitchShifter::PSOLA)
+        m_pitchLatency->setText(
+            tr("%1 to %2 ms by note, %3 ms for the last one")
+                .arg(1000.0f * PsolaShifter::latency(PsolaShifter::kMaxFreq), 0, 'f', 2)
+                .arg(1000.0f * PsolaShifter::latency(PsolaShifter::kMinFreq), 0, 'f', 1)
+                .arg(m_engine.getPitchShiftLatency(14), 0, 'f', 1));
+    else
+        m_pitchLatency->setText(
+            tr("Harmonizer %1 ms, Stereo Harm %2 ms, Shifter %3 ms, Sequence %4 ms")
+                .arg(m_engine.getPitchShiftLatency(14), 0, 'f', 1)
+                .arg(m_engine.getPitchShiftLatency(42), 0, 'f', 1)
+                .arg(m_engine.getPitchShiftLatency(38), 0, 'f', 1)
+                .arg(m_engine.getPitchShiftLatency(37), 0, 'f', 1));
     // Vocoder bands: 16/32/64/128/256 → indices 0-4
     int vocIdx = 0;
     if (rkr.VocBands == 32)  vocIdx = 1;
@@ -431,7 +499,10 @@ void SettingsDialog::applyToEngine()
     rkr.UpAmo        = m_upsampleAmount->currentData().toInt();
     rkr.UpQual       = m_upQuality->currentIndex();
     rkr.DownQual     = m_downQuality->currentIndex();
+    for (int i = 0; i < 6; ++i)
+        rkr.*kOversample[i] = m_oversample[i]->currentIndex();
     rkr.looper_size  = static_cast<float>(m_looperSize->value());
+    rkr.lazy_efx.release_time = m_releaseEffects->value();
     rkr.Metro_Vol    = m_metroVol->value();
 
     static constexpr int qualVals[] = {4, 8, 16, 32};
@@ -439,6 +510,7 @@ void SettingsDialog::applyToEngine()
     rkr.HarQual = (qi >= 0 && qi < 4) ? qualVals[qi] : 4;
     qi = m_steQuality->currentIndex();
     rkr.SteQual = (qi >= 0 && qi < 4) ? qualVals[qi] : 4;
+    rkr.PitchMode = std::clamp(m_pitchMode->currentIndex(), 0, 2);
 
     static constexpr int vocBandVals[] = {16, 32, 64, 128, 256};
     int vi = m_vocBands->currentIndex();
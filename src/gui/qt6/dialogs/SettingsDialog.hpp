@@ -16,6 +16,7 @@ class EngineController;
 class QCheckBox;
 class QComboBox;
 class QDoubleSpinBox;
+class QLabel;
 class QLineEdit;
 class QSpinBox;
 class QTabWidget;
@@ -66,10 +67,14 @@ private:
     QComboBox*      m_upsampleAmount{nullptr};
     QComboBox*      m_upQuality{nullptr};
     QComboBox*      m_downQuality{nullptr};
+    QComboBox*      m_oversample[6]{};
     QDoubleSpinBox* m_looperSize{nullptr};
+    QSpinBox* m_releaseEffects{nullptr};
     QSpinBox*       m_metroVol{nullptr};
     QComboBox*      m_harQuality{nullptr};
     QComboBox*      m_steQuality{nullptr};
+    QComboBox*      m_pitchMode{nullptr};
+    QLabel*         m_pitchLatency{nullptr};
     QComboBox*      m_vocBands{nullptr};
     QCheckBox*      m_limiterBeforeOutput{nullptr};
     QCheckBox*      m_db6Booster{nullptr};
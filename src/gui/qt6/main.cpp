@@ -192,7 +192,7 @@ int main(int argc, char* argv[])
             if (preset != 1000)
             {
                 if (preset > 0 && preset < 61)
-                    rkr.Bank_to_Preset(preset);
+                    controller.loadPreset(preset);
                 preset = 1000;
             }
 
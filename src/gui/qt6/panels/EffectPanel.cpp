@@ -89,11 +89,8 @@ void EffectPanel::setupHeader()
     connect(m_presetCombo, &QComboBox::currentIndexChanged, this,
             [this](int index)
             {
-                if (index >= 0)
-                {
-                    m_engine.setEffectPreset(m_effectIndex, index);
-                    syncFromEngine();
-                }
+                if (index >= 0 && m_engine.setEffectPreset(m_effectIndex, index))
+                    m_syncPending = true;
             });
 
     header->addWidget(m_onButton);
@@ -102,6 +99,19 @@ void EffectPanel::setupHeader()
     m_mainLayout->addLayout(header);
 }
 
+// ---------------------------------------------------------------------------
+// Deferred sync after a preset change
+// ---------------------------------------------------------------------------
+
+void EffectPanel::syncIfApplied()
+{
+    if (m_syncPending && !m_engine.hasPendingCommands())
+    {
+        m_syncPending = false;
+        syncFromEngine();
+    }
+}
+
 // ---------------------------------------------------------------------------
 // Body layout accessor
 // ---------------------------------------------------------------------------
@@ -42,6 +42,12 @@ public:
     virtual void syncFromEngine();
     /// Push all control values to the engine.
     virtual void syncToEngine();
+    /// syncFromEngine() once a preset picked in the combo is applied.
+    /// Called from the GUI timer.
+    void syncIfApplied();
+    /// Show what the engine reports while running. Called from the GUI
+    /// timer; most panels have nothing to show.
+    virtual void updateFromEngine() {}
 
     /// Factory:  Returns a panel for the given effect type.
     /// Falls back to a generic placeholder for unimplemented effects.
@@ -69,4 +75,5 @@ private:
     QVBoxLayout* m_bodyLayout  = nullptr;
     QPushButton* m_onButton    = nullptr;
     QComboBox*   m_presetCombo = nullptr;
+    bool         m_syncPending = false;
 };
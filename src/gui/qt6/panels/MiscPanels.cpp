@@ -6,6 +6,14 @@
 */
 
 #include "MiscPanels.hpp"
+#include "EngineController.hpp"
+
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
 
 // ═══════════════════════════════════════════════════════════════════════════
 // Exciter / HarmonicEnhancer (index 22) — 10 harmonic level sliders
@@ -108,8 +116,56 @@ static constexpr ParamDesc kLooperParams[] = {
     {17, "Meter Src",    0,   2, ParamDesc::Choice, kMeterSources},
 };
 
+static constexpr const char* kLoopFilter = "Rakarrack Loops (*.rkl);;All Files (*)";
+
 LooperPanel::LooperPanel(EngineController& e, QWidget* p)
-    : SliderPanel(e, 30, kLooperParams, p) {}
+    : SliderPanel(e, 30, kLooperParams, p)
+{
+    auto* row = new QHBoxLayout;
+    auto* save = new QPushButton(tr("Save Loop..."), this);
+    auto* load = new QPushButton(tr("Load Loop..."), this);
+    connect(save, &QPushButton::clicked, this, &LooperPanel::saveLoop);
+    connect(load, &QPushButton::clicked, this, &LooperPanel::loadLoop);
+    row->addWidget(save);
+    row->addWidget(load);
+    row->addStretch();
+    // Frames recorded faster than their part of the loop came back from disk
+    m_dropped = new QLabel(tr("Dropped: %1 frames").arg(0), this);
+    row->addWidget(m_dropped);
+    bodyLayout()->addLayout(row);
+}
+
+void LooperPanel::updateFromEngine()
+{
+    LooperStatus status;
+    if (m_engine.pollLooper(status))
+        m_dropped->setText(tr("Dropped: %1 frames").arg(status.dropped));
+}
+
+void LooperPanel::saveLoop()
+{
+    const QString path = QFileDialog::getSaveFileName(
+        this, tr("Save Loop"), QString(), tr(kLoopFilter));
+    if (path.isEmpty())
+        return;
+
+    if (!m_engine.saveLoop(path.toLocal8Bit().toStdString()))
+        QMessageBox::warning(this, tr("Save Loop"),
+                             tr("Could not write %1.").arg(path));
+}
+
+void LooperPanel::loadLoop()
+{
+    const QString path = QFileDialog::getOpenFileName(
+        this, tr("Load Loop"), QString(), tr(kLoopFilter));
+    if (path.isEmpty())
+        return;
+
+    // The tracks are read in the background and put in place stopped
+    if (!m_engine.loadLoop(path.toLocal8Bit().toStdString()))
+        QMessageBox::warning(this, tr("Load Loop"),
+                             tr("The audio engine did not respond."));
+}
 
 // ═══════════════════════════════════════════════════════════════════════════
 // Vocoder (index 35) — requires aux input
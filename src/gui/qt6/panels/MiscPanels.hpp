@@ -16,6 +16,8 @@
 
 #include "SliderPanel.hpp"
 
+class QLabel;
+
 class ExciterPanel : public SliderPanel
 {
 public:
@@ -38,6 +40,14 @@ class LooperPanel : public SliderPanel
 {
 public:
     explicit LooperPanel(EngineController& e, QWidget* p = nullptr);
+
+    void updateFromEngine() override;
+
+private:
+    void saveLoop();
+    void loadLoop();
+
+    QLabel* m_dropped = nullptr;
 };
 
 class VocoderPanel : public SliderPanel
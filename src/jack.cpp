@@ -153,6 +153,10 @@ jackprocess (jack_nframes_t nframes, [[maybe_unused]] void *arg)
 
     JackOUT->cpuload = jack_cpu_load(jackclient);
 
+    // Apply GUI changes between blocks, never while an effect is running.
+    if (JackOUT->m_controller)
+        JackOUT->m_controller->processCommands();
+
 
 #ifdef HAVE_JACK_TRANSPORT
     if((JackOUT->Tap_Bypass) && (JackOUT->Tap_Selection == 2)) {
@@ -280,6 +284,18 @@ jackprocess (jack_nframes_t nframes, [[maybe_unused]] void *arg)
             JackOUT->m_controller->pushTuner(tuner);
         }
 
+        // Looper transport, and frames it could not record
+        if (JackOUT->Looper_Bypass && JackOUT->efx_Looper)
+        {
+            LooperStatus looper;
+            looper.playing = JackOUT->efx_Looper->Pplay;
+            looper.stopped = JackOUT->efx_Looper->Pstop;
+            looper.quarter = JackOUT->efx_Looper->looper_qua;
+            looper.bar     = JackOUT->efx_Looper->looper_bar;
+            looper.dropped = JackOUT->efx_Looper->dropped();
+            JackOUT->m_controller->pushLooper(looper);
+        }
+
         // Tap tempo display flag
         if (JackOUT->Tap_Display)
         {
@@ -289,6 +305,12 @@ jackprocess (jack_nframes_t nframes, [[maybe_unused]] void *arg)
             JackOUT->m_controller->pushTapTempo(tap);
             JackOUT->Tap_Display = 0;
         }
+
+#ifdef ENABLE_EFFECT_TIMING
+        // Per-slot effect timing, once per window
+        if (JackOUT->efx_timer.end_period(PERIOD, SAMPLE_RATE))
+            JackOUT->m_controller->pushEffectTiming(JackOUT->efx_timer.last());
+#endif
     }
 
     memcpy (outl, JackOUT->efxoutl.data(),
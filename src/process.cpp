@@ -31,6 +31,7 @@
 #include "global.hpp"
 #include "AllEffects.hpp"
 #include "EmbeddedResource.hpp"
+#include "PresetSwitcher.hpp"
 #include "portable_crt.hpp"
 #ifdef ENABLE_MIDI
 #include "MIDIConverter.hpp"
@@ -38,12 +39,13 @@
 
 int Pexitprogram, preset;
 int commandline;
-int exitwithhelp, gui, nojack;
+int exitwithhelp, gui, nojack, offline;
 int PERIOD;
 std::array<int, POLY> note_active;
 std::array<int, POLY> rnote;
 std::array<int, POLY> gate;
 int reconota;
+float reco_freq;
 int maxx_len;
 int error_num;
 int stecla;
@@ -70,7 +72,12 @@ char *banktoload;
 Preferences rakarrack (Preferences::USER, WEBSITE, PACKAGE);
 MessageCallback gui_message_handler = nullptr;
 
-RKR::RKR ()
+/*
+ * With sample_rate and period > 0 the engine runs without a JACK client,
+ * on buffers the caller passes to Alg() (offline rendering). Otherwise it
+ * opens the client and takes both from the server.
+ */
+RKR::RKR (int sample_rate, int period)
 {
     db6booster=0;
     jdis=0;
@@ -103,20 +110,27 @@ RKR::RKR ()
 
     snprintf (temp, sizeof(temp), "rakarrack");
 
-    jack.client = jack_client_open (temp, jack.options, &jack.status, nullptr);
+    if ((sample_rate > 0) && (period > 0)) {
+        jack.client = nullptr;
+        snprintf (jack.name.data(), jack.name.size(), "%s", temp);
+        jack.sample_rate = sample_rate;
+        jack.period = period;
+    } else {
+        jack.client = jack_client_open (temp, jack.options, &jack.status, nullptr);
 
-    if (jack.client == nullptr) {
-        fprintf (stderr, "Cannot make a jack client, is jackd running?\n");
-        nojack = 1;
-        exitwithhelp = 1;
-        return;
+        if (jack.client == nullptr) {
+            fprintf (stderr, "Cannot make a jack client, is jackd running?\n");
+            nojack = 1;
+            exitwithhelp = 1;
+            return;
 
-    }
+        }
 
-    snprintf (jack.name.data(), jack.name.size(), "%s", jack_get_client_name (jack.client));
+        snprintf (jack.name.data(), jack.name.size(), "%s", jack_get_client_name (jack.client));
 
-    jack.sample_rate = jack_get_sample_rate (jack.client);
-    jack.period = jack_get_buffer_size (jack.client);
+        jack.sample_rate = jack_get_sample_rate (jack.client);
+        jack.period = jack_get_buffer_size (jack.client);
+    }
 
     rakarrack.get(PrefNom("Disable Warnings"),mess_dis,0);
     rakarrack.get (PrefNom ("Filter DC Offset"), DC_Offset, 0);
@@ -128,6 +142,8 @@ RKR::RKR ()
     Adjust_Upsample();
 
     rakarrack.get (PrefNom ("Looper Size"), looper_size, 1);
+    rakarrack.get (PrefNom ("Lazy Effects"), lazy_efx.enabled, 1);
+    rakarrack.get (PrefNom ("Release Unused Effects"), lazy_efx.release_time, 0);
     rakarrack.get (PrefNom ("Calibration"), aFreq, 440.0f);
     update_freqs(aFreq);
 
@@ -172,8 +188,17 @@ RKR::RKR ()
     rakarrack.get (PrefNom("Waveshape Up Quality"),Wave_up_q,4);
     rakarrack.get (PrefNom("Waveshape Down Quality"),Wave_down_q,2);
 
+    // Each distortion defaults to the old shared Waveshape Resampling
+    rakarrack.get (PrefNom("Distorsion Oversample"),Dist_Over,Wave_res_amount);
+    rakarrack.get (PrefNom("Overdrive Oversample"),Ovrd_Over,Wave_res_amount);
+    rakarrack.get (PrefNom("NewDist Oversample"),NewD_Over,Wave_res_amount);
+    rakarrack.get (PrefNom("MBDist Oversample"),MBDi_Over,Wave_res_amount);
+    rakarrack.get (PrefNom("StompBox Oversample"),Stom_Over,Wave_res_amount);
+    rakarrack.get (PrefNom("Valve Oversample"),Valv_Over,0);
+
     rakarrack.get (PrefNom ("Harmonizer Quality"), HarQual, 4);
     rakarrack.get (PrefNom ("StereoHarm Quality"), SteQual, 4);
+    rakarrack.get (PrefNom ("Pitch Shifter Mode"), PitchMode, PitchShifter::REFERENCE);
 
     rakarrack.get (PrefNom ("Auto Connect Jack"), config.aconnect_JA, 1);
     rakarrack.get (PrefNom ("Auto Connect Jack In"), config.aconnect_JIA, 1);
@@ -241,8 +266,8 @@ RKR::RKR ()
     efx_Echo = std::make_unique<Echo>();
     efx_Phaser = std::make_unique<Phaser>();
     efx_APhaser = std::make_unique<Analog_Phaser>();
-    efx_Distorsion = std::make_unique<Distorsion>();
-    efx_Overdrive = std::make_unique<Distorsion>();
+    efx_Distorsion = std::make_unique<Distorsion>(Dist_Over);
+    efx_Overdrive = std::make_unique<Distorsion>(Ovrd_Over);
     efx_EQ2 = std::make_unique<EQ>();
     efx_EQ1 = std::make_unique<EQ>();
     efx_Compressor = std::make_unique<Compressor>();
@@ -250,43 +275,44 @@ RKR::RKR ()
     efx_Alienwah = std::make_unique<Alienwah>();
     efx_Cabinet = std::make_unique<EQ>();
     efx_Pan = std::make_unique<Pan>();
-    efx_Har = std::make_unique<Harmonizer>((long) HarQual, Har_Down, Har_U_Q, Har_D_Q);
+    efx_Har = std::make_unique<Harmonizer>((long) HarQual, Har_Down, Har_U_Q, Har_D_Q, PitchMode);
     efx_MusDelay = std::make_unique<MusicDelay>();
     efx_Gate = std::make_unique<Gate>();
-    efx_NewDist = std::make_unique<NewDist>();
+    efx_NewDist = std::make_unique<NewDist>(NewD_Over);
     efx_FLimiter = std::make_unique<Compressor>();
-    efx_Valve = std::make_unique<Valve>();
+    efx_Valve = std::make_unique<Valve>(Valv_Over);
     efx_DFlange = std::make_unique<Dflange>();
     efx_Ring = std::make_unique<Ring>();
     efx_Exciter = std::make_unique<Exciter>();
-    efx_MBDist = std::make_unique<MBDist>();
+    efx_MBDist = std::make_unique<MBDist>(MBDi_Over);
     efx_Arpie = std::make_unique<Arpie>();
     efx_Expander = std::make_unique<Expander>();
     efx_Shuffle = std::make_unique<Shuffle>();
     efx_Synthfilter = std::make_unique<Synthfilter>();
     efx_MBVvol = std::make_unique<MBVvol>();
-    efx_Convol = std::make_unique<Convolotron>(Con_Down, Con_U_Q, Con_D_Q);
-    efx_Looper = std::make_unique<Looper>(looper_size);
+    efx_Convol.reset (static_cast<Convolotron *> (New_Effect (29, lazy_efx.enabled).release ()));
+    efx_Looper.reset (static_cast<Looper *> (New_Effect (30, lazy_efx.enabled).release ()));
     efx_RyanWah = std::make_unique<RyanWah>();
     efx_RBEcho = std::make_unique<RBEcho>();
     efx_CoilCrafter = std::make_unique<CoilCrafter>();
     efx_ShelfBoost = std::make_unique<ShelfBoost>();
     efx_Vocoder = std::make_unique<Vocoder>(auxresampled.data(), VocBands, Voc_Down, Voc_U_Q, Voc_D_Q);
     efx_Sustainer = std::make_unique<Sustainer>();
-    efx_Sequence = std::make_unique<Sequence>((long) HarQual, Seq_Down, Seq_U_Q, Seq_D_Q);
-    efx_Shifter = std::make_unique<Shifter>((long) HarQual, Shi_Down, Shi_U_Q, Shi_D_Q);
-    efx_StompBox = std::make_unique<StompBox>();
-    efx_Reverbtron = std::make_unique<Reverbtron>(Rev_Down, Rev_U_Q, Rev_D_Q);
-    efx_Echotron = std::make_unique<Echotron>();
-    efx_StereoHarm = std::make_unique<StereoHarm>((long) SteQual, Ste_Down, Ste_U_Q, Ste_D_Q);
+    efx_Sequence = std::make_unique<Sequence>((long) HarQual, Seq_Down, Seq_U_Q, Seq_D_Q, PitchMode);
+    efx_Shifter = std::make_unique<Shifter>((long) HarQual, Shi_Down, Shi_U_Q, Shi_D_Q, PitchMode);
+    efx_StompBox = std::make_unique<StompBox>(Stom_Over);
+    efx_Reverbtron.reset (static_cast<Reverbtron *> (New_Effect (40, lazy_efx.enabled).release ()));
+    efx_Echotron.reset (static_cast<Echotron *> (New_Effect (41, lazy_efx.enabled).release ()));
+    efx_StereoHarm = std::make_unique<StereoHarm>((long) SteQual, Ste_Down, Ste_U_Q, Ste_D_Q, PitchMode);
     efx_CompBand = std::make_unique<CompBand>();
     efx_Opticaltrem = std::make_unique<Opticaltrem>();
     efx_Vibe = std::make_unique<Vibe>();
     efx_Infinity = std::make_unique<Infinity>();
+    lazy_efx.init ();
 
-    U_Resample = std::make_unique<Resample>(UpQual);
-    D_Resample = std::make_unique<Resample>(DownQual);
-    A_Resample = std::make_unique<Resample>(3);
+    U_Resample = std::make_unique<Resample>(UpQual, upsample ? u_up : 1.0);
+    D_Resample = std::make_unique<Resample>(DownQual, upsample ? u_down : 1.0);
+    A_Resample = std::make_unique<Resample>(3, upsample ? u_up : 1.0);
 
     beat = std::make_unique<beattracker>();
     efx_Tuner = std::make_unique<Tuner>();
@@ -771,6 +797,8 @@ RKR::RKR ()
     New_Bank ();
     init_rkr ();
 
+    switcher = std::make_unique<PresetSwitcher>(*this);
+
 }
 
 
@@ -778,6 +806,47 @@ RKR::RKR ()
 RKR::~RKR () = default;
 
 
+/*
+ * Band layout of the 10 band EQ and the parametric EQ. Presets only store
+ * gains (and the parametric frequencies), so every instance needs this first.
+ */
+static void
+init_eq1_bands (EQ *eq)
+{
+
+    for (int i = 0; i <= 45; i += 5) {
+        eq->changepar (i + 10, 7);
+        eq->changepar (i + 14, 0);
+    }
+
+    eq->changepar (11, 31);
+    eq->changepar (16, 63);
+    eq->changepar (21, 125);
+    eq->changepar (26, 250);
+    eq->changepar (31, 500);
+    eq->changepar (36, 1000);
+    eq->changepar (41, 2000);
+    eq->changepar (46, 4000);
+    eq->changepar (51, 8000);
+    eq->changepar (56, 16000);
+
+}
+
+
+static void
+init_eq2_bands (EQ *eq)
+{
+
+    for (int i = 0; i <= 10; i += 5) {
+        eq->changepar (i + 10, 7);
+        eq->changepar (i + 13, 64);
+        eq->changepar (i + 14, 0);
+
+    }
+
+}
+
+
 
 
 void
@@ -788,28 +857,8 @@ RKR::init_rkr ()
     MIDIConverter_Bypass = 0;
     Metro_Bypass = 0;
 
-    for (int i = 0; i <= 45; i += 5) {
-        efx_EQ1->changepar (i + 10, 7);
-        efx_EQ1->changepar (i + 14, 0);
-    }
-
-    efx_EQ1->changepar (11, 31);
-    efx_EQ1->changepar (16, 63);
-    efx_EQ1->changepar (21, 125);
-    efx_EQ1->changepar (26, 250);
-    efx_EQ1->changepar (31, 500);
-    efx_EQ1->changepar (36, 1000);
-    efx_EQ1->changepar (41, 2000);
-    efx_EQ1->changepar (46, 4000);
-    efx_EQ1->changepar (51, 8000);
-    efx_EQ1->changepar (56, 16000);
-
-    for (int i = 0; i <= 10; i += 5) {
-        efx_EQ2->changepar (i + 10, 7);
-        efx_EQ2->changepar (i + 13, 64);
-        efx_EQ2->changepar (i + 14, 0);
-
-    }
+    init_eq1_bands (efx_EQ1.get());
+    init_eq2_bands (efx_EQ2.get());
 
 
     efx_FLimiter->Compressor_Change_Preset(0,3);
@@ -881,6 +930,7 @@ RKR::init_rkr ()
     }
     RC->cleanup ();
     reconota = -1;
+    reco_freq = 0.0f;
 
 }
 
@@ -925,6 +975,31 @@ RKR::ConnectMIDI ()
 
 int
 RKR::Cabinet_setpreset (int npreset)
+{
+
+    return (Cabinet_setpreset (efx_Cabinet.get(), npreset));
+
+}
+
+
+int
+RKR::Cabinet_setpreset (EQ *cabinet, int npreset)
+{
+
+    PresetChanges changes;
+    Cabinet_Preset = Cabinet_preset_changes (npreset, changes);
+    cabinet->apply (changes);
+
+    return (0);
+
+};
+
+
+/*
+ * Out of range presets load the first one, which is returned.
+ */
+int
+RKR::Cabinet_preset_changes (int npreset, PresetChanges &changes)
 {
 
     const int PRESET_SIZE = 81;
@@ -1030,27 +1105,43 @@ RKR::Cabinet_setpreset (int npreset)
     if (npreset > (NUM_PRESETS -1))
         npreset = 0;
     for (int n = 0; n < 16; n++) {
-        efx_Cabinet->changepar (n * 5 + 10, presets[npreset][n * 5]);
-        efx_Cabinet->changepar (n * 5 + 11, presets[npreset][n * 5 + 1]);
-        efx_Cabinet->changepar (n * 5 + 12, presets[npreset][n * 5 + 2]);
-        efx_Cabinet->changepar (n * 5 + 13, presets[npreset][n * 5 + 3]);
-        efx_Cabinet->changepar (n * 5 + 14, presets[npreset][n * 5 + 4]);
+        changes.add (n * 5 + 10, presets[npreset][n * 5]);
+        changes.add (n * 5 + 11, presets[npreset][n * 5 + 1]);
+        changes.add (n * 5 + 12, presets[npreset][n * 5 + 2]);
+        changes.add (n * 5 + 13, presets[npreset][n * 5 + 3]);
+        changes.add (n * 5 + 14, presets[npreset][n * 5 + 4]);
 
     }
 
-    Cabinet_Preset = npreset;
+    return (npreset);
+};
 
-    return (0);
 
 
-};
 
 
+void
+RKR::EQ1_setpreset (int npreset)
+{
 
+    EQ1_setpreset (efx_EQ1.get(), npreset);
+
+}
 
 
 void
-RKR::EQ1_setpreset (int npreset)
+RKR::EQ1_setpreset (EQ *eq, int npreset)
+{
+
+    PresetChanges changes;
+    EQ1_preset_changes (npreset, changes);
+    eq->apply (changes);
+
+};
+
+
+void
+RKR::EQ1_preset_changes (int npreset, PresetChanges &changes)
 {
 
     const int PRESET_SIZE = 12;
@@ -1067,16 +1158,16 @@ RKR::EQ1_setpreset (int npreset)
     if (npreset >= NUM_PRESETS) {
         FPreset::ReadPreset(0,npreset-NUM_PRESETS+1);
         for (int n = 0; n < 10; n++)
-            efx_EQ1->changepar (n * 5 + 12, pdata[n]);
-        efx_EQ1->changepar (0, pdata[10]);
+            changes.add (n * 5 + 12, pdata[n]);
+        changes.add (0, pdata[10]);
         for (int n = 0; n < 10; n++)
-            efx_EQ1->changepar (n * 5 + 13, pdata[11]);
+            changes.add (n * 5 + 13, pdata[11]);
     } else {
         for (int n = 0; n < 10; n++)
-            efx_EQ1->changepar (n * 5 + 12, presets[npreset][n]);
-        efx_EQ1->changepar (0, presets[npreset][10]);
+            changes.add (n * 5 + 12, presets[npreset][n]);
+        changes.add (0, presets[npreset][10]);
         for (int n = 0; n < 10; n++)
-            efx_EQ1->changepar (n * 5 + 13, presets[npreset][11]);
+            changes.add (n * 5 + 13, presets[npreset][11]);
     }
 };
 
@@ -1086,6 +1177,26 @@ void
 RKR::EQ2_setpreset (int npreset)
 {
 
+    EQ2_setpreset (efx_EQ2.get(), npreset);
+
+}
+
+
+void
+RKR::EQ2_setpreset (EQ *eq, int npreset)
+{
+
+    PresetChanges changes;
+    EQ2_preset_changes (npreset, changes);
+    eq->apply (changes);
+
+};
+
+
+void
+RKR::EQ2_preset_changes (int npreset, PresetChanges &changes)
+{
+
 
     const int PRESET_SIZE = 10;
     const int NUM_PRESETS = 3;
@@ -1103,20 +1214,20 @@ RKR::EQ2_setpreset (int npreset)
 
         FPreset::ReadPreset(9,npreset-NUM_PRESETS+1);
         for (int n = 0; n < 3; n++) {
-            efx_EQ2->changepar (n * 5 + 11, pdata[n * 3]);
-            efx_EQ2->changepar (n * 5 + 12, pdata[n * 3 + 1]);
-            efx_EQ2->changepar (n * 5 + 13, pdata[n * 3 + 2]);
+            changes.add (n * 5 + 11, pdata[n * 3]);
+            changes.add (n * 5 + 12, pdata[n * 3 + 1]);
+            changes.add (n * 5 + 13, pdata[n * 3 + 2]);
         }
-        efx_EQ2->changepar (0, pdata[9]);
+        changes.add (0, pdata[9]);
     }
 
     else {
         for (int n = 0; n < 3; n++) {
-            efx_EQ2->changepar (n * 5 + 11, presets[npreset][n * 3]);
-            efx_EQ2->changepar (n * 5 + 12, presets[npreset][n * 3 + 1]);
-            efx_EQ2->changepar (n * 5 + 13, presets[npreset][n * 3 + 2]);
+            changes.add (n * 5 + 11, presets[npreset][n * 3]);
+            changes.add (n * 5 + 12, presets[npreset][n * 3 + 1]);
+            changes.add (n * 5 + 13, presets[npreset][n * 3 + 2]);
         }
-        efx_EQ2->changepar (0, presets[npreset][9]);
+        changes.add (0, presets[npreset][9]);
     }
 };
 
@@ -1133,58 +1244,6 @@ RKR::add_metro()
 
 }
 
-void
-RKR::Vol2_Efx ()
-{
-    memcpy(smpl.data(),efxoutl.data(), PERIOD * sizeof(float));
-    memcpy(smpr.data(),efxoutr.data(), PERIOD * sizeof(float));
-}
-
-
-void
-RKR::Vol3_Efx ()
-{
-    int i;
-    float att=2.0f;
-
-    for (i = 0; i < PERIOD; i++) {
-        efxoutl[i] *= att;
-        efxoutr[i] *= att;
-    }
-
-    Vol2_Efx();
-
-}
-
-
-void
-RKR::Vol_Efx (int NumEffect, float volume)
-{
-    int i;
-    float v1, v2;
-
-    if (volume < 0.5f) {
-        v1 = 1.0f;
-        v2 = volume * 2.0f;
-    } else {
-        v1 = (1.0f - volume) * 2.0f;
-        v2 = 1.0f;
-    };
-
-
-    if ((NumEffect == 8) || (NumEffect == 15))
-        v2 *= v2;
-
-    for (i = 0; i < PERIOD; i++) {
-        efxoutl[i] = smpl[i] * v2 + efxoutl[i] * v1;
-        efxoutr[i] = smpr[i] * v2 + efxoutr[i] * v1;
-    };
-
-    Vol2_Efx();
-
-}
-
-
 void
 RKR::calculavol (int i)
 {
@@ -1230,8 +1289,8 @@ RKR::Control_Gain (float *origl, float *origr)
 
 
     if(upsample) {
-        U_Resample->out(origl,origr,efxoutl.data(),efxoutr.data(),jack.period,u_up);
-        if((checkforaux()) || (ACI_Bypass)) A_Resample->mono_out(auxdata.data(),auxresampled.data(),jack.period,u_up,PERIOD);
+        U_Resample->out(origl,origr,efxoutl.data(),efxoutr.data(),jack.period);
+        if((checkforaux()) || (ACI_Bypass)) A_Resample->mono_out(auxdata.data(),auxresampled.data(),jack.period,PERIOD);
     } else if((checkforaux()) || (ACI_Bypass)) memcpy(auxresampled.data(),auxdata.data(),sizeof(float)*jack.period);
 
     if(DC_Offset) {
@@ -1251,9 +1310,6 @@ RKR::Control_Gain (float *origl, float *origr)
 
 
     }
-    memcpy(smpl.data(),efxoutl.data(),sizeof(float)*PERIOD);
-    memcpy(smpr.data(),efxoutr.data(),sizeof(float)*PERIOD);
-
     temp_sum = (float)CLAMP (rap2dB (il_sum), -48.0, 15.0);
     val_il_sum = .6f * old_il_sum + .4f * temp_sum;
 
@@ -1320,7 +1376,7 @@ RKR::Control_Volume (float *origl,float *origr)
 
 
     if(upsample)
-        D_Resample->out(anall.data(),analr.data(),efxoutl.data(),efxoutr.data(),PERIOD,u_down);
+        D_Resample->out(anall.data(),analr.data(),efxoutl.data(),efxoutr.data(),PERIOD);
 
 
     if (OnCounter < t_periods) {
@@ -1452,7 +1508,6 @@ void
 RKR::Alg (float *inl1, float *inr1, float *origl, float *origr, void *)
 {
 
-    int i;
     int reco=0;
     int ponlast=0;
     memcpy(efxoutl.data(), inl1, sizeof(float) * PERIOD);
@@ -1460,6 +1515,13 @@ RKR::Alg (float *inl1, float *inr1, float *origl, float *origr, void *)
 
     if((t_timeout) && (Tap_Bypass)) TapTempo_Timeout(1);
 
+    // Full size instances for effects about to enter the chain
+    lazy_efx.swap_in ();
+
+    // Nothing to fade while the chain is off, take a prepared preset as is.
+    if ((!Bypass) && (switcher->pending()))
+        switcher->swap_in ();
+
     if (Bypass) {
 
         Control_Gain (origl, origr);
@@ -1529,352 +1591,638 @@ RKR::Alg (float *inl1, float *inr1, float *origl, float *origr, void *)
             }
         }
 
+        // PSOLA pitch shifters space their grains by the detected period
+        if ((PitchMode == PitchShifter::PSOLA) && (have_signal) && (!reco)
+            && ((Harmonizer_Bypass) || (StereoHarm_Bypass) || (Shifter_Bypass) || (Sequence_Bypass))) {
+            // On a copy: schmittFloat() filters its input in place
+            memcpy(anall.data(), efxoutl.data(), sizeof(float) * PERIOD);
+            memcpy(analr.data(), efxoutr.data(), sizeof(float) * PERIOD);
+            RecNote->schmittFloat (anall.data(), analr.data());
+            reco=1;
+        }
+        reco_freq = RecNote->afreq;
+
         if(ponlast) last=reconota;
 
-        for (i = 0; i < MAX_EFFECT_SLOTS; i++) {
-            if (efx_order[i] == EMPTY_SLOT)
-                continue;
-            switch (efx_order[i]) {
-            case 0:
-                if (EQ1_Bypass) {
-                    efx_EQ1->out (efxoutl.data(), efxoutr.data());
-                    Vol2_Efx ();
-                }
-                break;
+        if (switcher->pending())
+            switcher->crossfade ();
+        else
+            Effect_Chain ();
 
-            case 1:
-                if (Compressor_Bypass) {
-                    efx_Compressor->out (efxoutl.data(), efxoutr.data());
-                    Vol2_Efx ();
-                }
-                break;
+        if(Metro_Bypass) add_metro();
 
-            case 5:
-                if (Chorus_Bypass) {
-                    efx_Chorus->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (5, efx_Chorus->outvolume);
-                }
-                break;
+        Control_Volume (origl,origr);
 
-            case 7:
-                if (Flanger_Bypass) {
-                    efx_Flanger->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (7, efx_Flanger->outvolume);
-                }
-                break;
+    }
 
-            case 6:
-                if (Phaser_Bypass) {
-                    efx_Phaser->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (6, efx_Phaser->outvolume);
-                }
-                break;
+}
 
-            case 2:
-                if (Distorsion_Bypass) {
-                    efx_Distorsion->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (2, efx_Distorsion->outvolume);
-                }
-                break;
 
-            case 3:
-                if (Overdrive_Bypass) {
-                    efx_Overdrive->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (3, efx_Overdrive->outvolume);
-                }
-                break;
+/*
+ * Effect types are the numbers stored in efx_order[] and used by the
+ * switch in Effect_Chain(): 0 EQ1, 1 Compressor ... 46 Infinity.
+ */
+Effect *
+RKR::Effect_By_Type (int type)
+{
 
-            case 4:
-                if (Echo_Bypass) {
-                    efx_Echo->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (4, efx_Echo->outvolume);
-                }
-                break;
-            case 8:
-                if (Reverb_Bypass) {
-                    efx_Rev->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (8, efx_Rev->outvolume);
-                }
-                break;
+    switch (type) {
+    case 0: return efx_EQ1.get();
+    case 1: return efx_Compressor.get();
+    case 2: return efx_Distorsion.get();
+    case 3: return efx_Overdrive.get();
+    case 4: return efx_Echo.get();
+    case 5: return efx_Chorus.get();
+    case 6: return efx_Phaser.get();
+    case 7: return efx_Flanger.get();
+    case 8: return efx_Rev.get();
+    case 9: return efx_EQ2.get();
+    case 10: return efx_WhaWha.get();
+    case 11: return efx_Alienwah.get();
+    case 12: return efx_Cabinet.get();
+    case 13: return efx_Pan.get();
+    case 14: return efx_Har.get();
+    case 15: return efx_MusDelay.get();
+    case 16: return efx_Gate.get();
+    case 17: return efx_NewDist.get();
+    case 18: return efx_APhaser.get();
+    case 19: return efx_Valve.get();
+    case 20: return efx_DFlange.get();
+    case 21: return efx_Ring.get();
+    case 22: return efx_Exciter.get();
+    case 23: return efx_MBDist.get();
+    case 24: return efx_Arpie.get();
+    case 25: return efx_Expander.get();
+    case 26: return efx_Shuffle.get();
+    case 27: return efx_Synthfilter.get();
+    case 28: return efx_MBVvol.get();
+    case 29: return efx_Convol.get();
+    case 30: return efx_Looper.get();
+    case 31: return efx_RyanWah.get();
+    case 32: return efx_RBEcho.get();
+    case 33: return efx_CoilCrafter.get();
+    case 34: return efx_ShelfBoost.get();
+    case 35: return efx_Vocoder.get();
+    case 36: return efx_Sustainer.get();
+    case 37: return efx_Sequence.get();
+    case 38: return efx_Shifter.get();
+    case 39: return efx_StompBox.get();
+    case 40: return efx_Reverbtron.get();
+    case 41: return efx_Echotron.get();
+    case 42: return efx_StereoHarm.get();
+    case 43: return efx_CompBand.get();
+    case 44: return efx_Opticaltrem.get();
+    case 45: return efx_Vibe.get();
+    case 46: return efx_Infinity.get();
+    default: return nullptr;
+    }
 
-            case 9:
-                if (EQ2_Bypass) {
-                    efx_EQ2->out (efxoutl.data(), efxoutr.data());
-                    Vol2_Efx ();
-                }
-                break;
+}
 
-            case 10:
-                if (WhaWha_Bypass) {
-                    efx_WhaWha->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (10, efx_WhaWha->outvolume);
-                }
-                break;
 
-            case 11:
-                if (Alienwah_Bypass) {
-                    efx_Alienwah->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (11, efx_Alienwah->outvolume);
-                }
-                break;
+/*
+ * Per effect type: the live on/off flag, the one of the preset, how the
+ * effect output is blended with its input in the chain, and the number of
+ * factory presets (higher numbers are user presets read by FPreset).
+ */
+static const struct {
+    int RKR::*bypass;
+    int RKR::*bypass_b;
+    int mix;
+    int presets;
+} efx_flags[] = {
+    {&RKR::EQ1_Bypass, &RKR::EQ1_B, MIX_INSERT, 3},
+    {&RKR::Compressor_Bypass, &RKR::Compressor_B, MIX_INSERT, 7},
+    {&RKR::Distorsion_Bypass, &RKR::Distorsion_B, MIX_WETDRY, 6},
+    {&RKR::Overdrive_Bypass, &RKR::Overdrive_B, MIX_WETDRY, 2},
+    {&RKR::Echo_Bypass, &RKR::Echo_B, MIX_WETDRY, 9},
+    {&RKR::Chorus_Bypass, &RKR::Chorus_B, MIX_WETDRY, 5},
+    {&RKR::Phaser_Bypass, &RKR::Phaser_B, MIX_WETDRY, 6},
+    {&RKR::Flanger_Bypass, &RKR::Flanger_B, MIX_WETDRY, 10},
+    {&RKR::Reverb_Bypass, &RKR::Reverb_B, MIX_WETDRY_SQUARED, 13},
+    {&RKR::EQ2_Bypass, &RKR::EQ2_B, MIX_INSERT, 3},
+    {&RKR::WhaWha_Bypass, &RKR::WhaWha_B, MIX_WETDRY, 5},
+    {&RKR::Alienwah_Bypass, &RKR::Alienwah_B, MIX_WETDRY, 4},
+    {&RKR::Cabinet_Bypass, &RKR::Cabinet_B, MIX_BOOST, 11},
+    {&RKR::Pan_Bypass, &RKR::Pan_B, MIX_WETDRY, 2},
+    {&RKR::Harmonizer_Bypass, &RKR::Harmonizer_B, MIX_WETDRY, 3},
+    {&RKR::MusDelay_Bypass, &RKR::MusDelay_B, MIX_WETDRY_SQUARED, 3},
+    {&RKR::Gate_Bypass, &RKR::Gate_B, MIX_INSERT, 3},
+    {&RKR::NewDist_Bypass, &RKR::NewDist_B, MIX_WETDRY, 3},
+    {&RKR::APhaser_Bypass, &RKR::APhaser_B, MIX_WETDRY, 6},
+    {&RKR::Valve_Bypass, &RKR::Valve_B, MIX_WETDRY, 3},
+    {&RKR::DFlange_Bypass, &RKR::DFlange_B, MIX_INSERT, 9},
+    {&RKR::Ring_Bypass, &RKR::Ring_B, MIX_WETDRY, 6},
+    {&RKR::Exciter_Bypass, &RKR::Exciter_B, MIX_INSERT, 5},
+    {&RKR::MBDist_Bypass, &RKR::MBDist_B, MIX_WETDRY, 8},
+    {&RKR::Arpie_Bypass, &RKR::Arpie_B, MIX_WETDRY, 9},
+    {&RKR::Expander_Bypass, &RKR::Expander_B, MIX_INSERT, 3},
+    {&RKR::Shuffle_Bypass, &RKR::Shuffle_B, MIX_WETDRY, 4},
+    {&RKR::Synthfilter_Bypass, &RKR::Synthfilter_B, MIX_WETDRY, 7},
+    {&RKR::MBVvol_Bypass, &RKR::MBVvol_B, MIX_WETDRY, 3},
+    {&RKR::Convol_Bypass, &RKR::Convol_B, MIX_WETDRY, 4},
+    {&RKR::Looper_Bypass, &RKR::Looper_B, MIX_WETDRY, 2},
+    {&RKR::RyanWah_Bypass, &RKR::RyanWah_B, MIX_WETDRY, 6},
+    {&RKR::RBEcho_Bypass, &RKR::RBEcho_B, MIX_WETDRY, 3},
+    {&RKR::CoilCrafter_Bypass, &RKR::CoilCrafter_B, MIX_INSERT, 2},
+    {&RKR::ShelfBoost_Bypass, &RKR::ShelfBoost_B, MIX_INSERT, 4},
+    {&RKR::Vocoder_Bypass, &RKR::Vocoder_B, MIX_WETDRY, 4},
+    {&RKR::Sustainer_Bypass, &RKR::Sustainer_B, MIX_INSERT, 3},
+    {&RKR::Sequence_Bypass, &RKR::Sequence_B, MIX_WETDRY, 10},
+    {&RKR::Shifter_Bypass, &RKR::Shifter_B, MIX_WETDRY, 5},
+    {&RKR::StompBox_Bypass, &RKR::StompBox_B, MIX_INSERT, 8},
+    {&RKR::Reverbtron_Bypass, &RKR::Reverbtron_B, MIX_WETDRY, 9},
+    {&RKR::Echotron_Bypass, &RKR::Echotron_B, MIX_WETDRY, 5},
+    {&RKR::StereoHarm_Bypass, &RKR::StereoHarm_B, MIX_WETDRY, 4},
+    {&RKR::CompBand_Bypass, &RKR::CompBand_B, MIX_WETDRY, 3},
+    {&RKR::Opticaltrem_Bypass, &RKR::Opticaltrem_B, MIX_INSERT, 6},
+    {&RKR::Vibe_Bypass, &RKR::Vibe_B, MIX_WETDRY, 8},
+    {&RKR::Infinity_Bypass, &RKR::Infinity_B, MIX_WETDRY, 10}
+};
 
-            case 12:
-                if (Cabinet_Bypass) {
-                    efx_Cabinet->out (efxoutl.data(), efxoutr.data());
-                    Vol3_Efx ();
-                }
 
-                break;
+int *
+RKR::Bypass_By_Type (int type)
+{
 
-            case 13:
-                if (Pan_Bypass) {
-                    efx_Pan->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (13, efx_Pan->outvolume);
-                }
-                break;
+    if ((type < 0) || (type >= (int) std::size (efx_flags)))
+        return nullptr;
+    return &(this->*efx_flags[type].bypass);
 
-            case 14:
-                if (Harmonizer_Bypass) {
-                    efx_Har->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (14, efx_Har->outvolume);
-                }
-                break;
+}
 
-            case 15:
-                if (MusDelay_Bypass) {
-                    efx_MusDelay->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (15, efx_MusDelay->outvolume);
-                }
-                break;
 
-            case 16:
-                if (Gate_Bypass) {
-                    efx_Gate->out (efxoutl.data(), efxoutr.data());
-                    Vol2_Efx ();
-                }
-                break;
+int *
+RKR::Bypass_B_By_Type (int type)
+{
 
-            case 17:
-                if(NewDist_Bypass) {
-                    efx_NewDist->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx(17,efx_NewDist->outvolume);
-                }
-                break;
+    if ((type < 0) || (type >= (int) std::size (efx_flags)))
+        return nullptr;
+    return &(this->*efx_flags[type].bypass_b);
 
-            case 18:
-                if (APhaser_Bypass) {
-                    efx_APhaser->out (efxoutl.data(), efxoutr.data());
-                    Vol_Efx (18, efx_APhaser->outvolume);
-                }
-                break;
+}
 
-            case 19:
-                if (Valve_Bypass) {
-                    efx_Valve->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx (19, efx_Valve->outvolume);
-                }
-                break;
 
-            case 20:
-                if (DFlange_Bypass) {
-                    efx_DFlange->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx ();
-                }
-                break;
+int
+RKR::Preset_Count (int type)
+{
 
-            case 21:
-                if (Ring_Bypass) {
-                    efx_Ring->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx (21,efx_Ring->outvolume);
-                }
-                break;
+    if ((type < 0) || (type >= (int) std::size (efx_flags)))
+        return 0;
+    return efx_flags[type].presets;
 
-            case 22:
-                if (Exciter_Bypass) {
-                    efx_Exciter->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx();
-                }
-                break;
+}
 
-            case 23:
-                if (MBDist_Bypass) {
-                    efx_MBDist->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(23,efx_MBDist->outvolume);
-                }
-                break;
 
-            case 24:
-                if (Arpie_Bypass) {
-                    efx_Arpie->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(24,efx_Arpie->outvolume);
-                }
-                break;
+/*
+ * Load preset npreset into efx, an instance of effect `type`. Covers the
+ * types whose presets are not applied by Effect::setpreset().
+ */
+void
+RKR::Effect_setpreset (int type, Effect *efx, int npreset)
+{
 
-            case 25:
-                if (Expander_Bypass) {
-                    efx_Expander->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx();
-                }
-                break;
+    switch (type) {
+    case 0:
+        EQ1_setpreset (static_cast<EQ *> (efx), npreset);
+        break;
+    case 2:
+        static_cast<Distorsion *> (efx)->setpreset (0, npreset);
+        break;
+    case 3:
+        static_cast<Distorsion *> (efx)->setpreset (1, npreset);
+        break;
+    case 5:
+        static_cast<Chorus *> (efx)->setpreset (0, npreset);
+        break;
+    case 7:
+        static_cast<Chorus *> (efx)->setpreset (1, npreset);
+        break;
+    case 9:
+        EQ2_setpreset (static_cast<EQ *> (efx), npreset);
+        break;
+    case 12:
+        Cabinet_setpreset (static_cast<EQ *> (efx), npreset);
+        break;
+    default:
+        efx->setpreset (npreset);
+        break;
+    }
 
-            case 26:
-                if (Shuffle_Bypass) {
-                    efx_Shuffle->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(26,efx_Shuffle->outvolume);
-                }
-                break;
+}
 
-            case 27:
-                if (Synthfilter_Bypass) {
-                    efx_Synthfilter->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(27,efx_Synthfilter->outvolume);
-                }
-                break;
 
-            case 28:
-                if (MBVvol_Bypass) {
-                    efx_MBVvol->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(28,efx_MBVvol->outvolume);
-                }
-                break;
+namespace
+{
+template <class T>
+using Plain = T;
+
+// Logs the changepar() and cleanup() calls made while `recording` instead
+// of running them. A cleanup() is logged as parameter -1.
+struct ParamLog {
+    bool recording{false};
+    std::vector<std::pair<int, int>> changes;
+};
 
-            case 29:
-                if (Convol_Bypass) {
-                    efx_Convol->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(29,efx_Convol->outvolume);
-                }
-                break;
+template <class T>
+class Recorded final : public T, public ParamLog
+{
+public:
+    using T::T;
 
-            case 30:
-                if (Looper_Bypass) {
-                    efx_Looper->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(30,efx_Looper->outvolume);
-                }
-                break;
+    void changepar (int npar, int value) override
+    {
+        if (recording)
+            changes.emplace_back (npar, value);
+        else
+            T::changepar (npar, value);
+    }
 
-            case 31:
-                if (RyanWah_Bypass) {
-                    efx_RyanWah->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(31,efx_RyanWah->outvolume);
-                }
-                break;
+    void cleanup () override
+    {
+        if (recording)
+            changes.emplace_back (-1, 0);
+        else
+            T::cleanup ();
+    }
+};
+}
 
-            case 32:
-                if (RBEcho_Bypass) {
-                    efx_RBEcho->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(32,efx_RBEcho->outvolume);
-                }
-                break;
 
-            case 33:
-                if (CoilCrafter_Bypass) {
-                    efx_CoilCrafter->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx();
-                }
-                break;
+/*
+ * Build a new, unconfigured instance of effect `type` as As<class>, with the
+ * same construction arguments as the one made in RKR::RKR(). With `parked`
+ * the effects LazyEffects handles get buffers of kParkedLength seconds only.
+ * Allocates, so never call it from the audio thread.
+ */
+template <template <class> class As>
+std::unique_ptr<Effect>
+RKR::Make_Effect (int type, bool parked)
+{
 
-            case 34:
-                if (ShelfBoost_Bypass) {
-                    efx_ShelfBoost->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx();
-                }
-                break;
+    switch (type) {
+    case 0: {
+        auto eq = std::make_unique<As<EQ>>();
+        init_eq1_bands (eq.get());
+        return eq;
+    }
+    case 1: return std::make_unique<As<Compressor>>();
+    case 2: return std::make_unique<As<Distorsion>>(Dist_Over);
+    case 3: return std::make_unique<As<Distorsion>>(Ovrd_Over);
+    case 4: return std::make_unique<As<Echo>>();
+    case 5: return std::make_unique<As<Chorus>>();
+    case 6: return std::make_unique<As<Phaser>>();
+    case 7: return std::make_unique<As<Chorus>>();
+    case 8: return std::make_unique<As<Reverb>>();
+    case 9: {
+        auto eq = std::make_unique<As<EQ>>();
+        init_eq2_bands (eq.get());
+        return eq;
+    }
+    case 10: return std::make_unique<As<DynamicFilter>>();
+    case 11: return std::make_unique<As<Alienwah>>();
+    case 12: return std::make_unique<As<EQ>>();
+    case 13: return std::make_unique<As<Pan>>();
+    case 14: return std::make_unique<As<Harmonizer>>((long) HarQual, Har_Down, Har_U_Q, Har_D_Q, PitchMode);
+    case 15: return std::make_unique<As<MusicDelay>>();
+    case 16: return std::make_unique<As<Gate>>();
+    case 17: return std::make_unique<As<NewDist>>(NewD_Over);
+    case 18: return std::make_unique<As<Analog_Phaser>>();
+    case 19: return std::make_unique<As<Valve>>(Valv_Over);
+    case 20: return std::make_unique<As<Dflange>>();
+    case 21: return std::make_unique<As<Ring>>();
+    case 22: return std::make_unique<As<Exciter>>();
+    case 23: return std::make_unique<As<MBDist>>(MBDi_Over);
+    case 24: return std::make_unique<As<Arpie>>();
+    case 25: return std::make_unique<As<Expander>>();
+    case 26: return std::make_unique<As<Shuffle>>();
+    case 27: return std::make_unique<As<Synthfilter>>();
+    case 28: return std::make_unique<As<MBVvol>>();
+    case 29:
+        if (parked)
+            return std::make_unique<As<Convolotron>>(Con_Down, Con_U_Q, Con_D_Q, LazyEffects::kParkedLength);
+        return std::make_unique<As<Convolotron>>(Con_Down, Con_U_Q, Con_D_Q);
+    case 30: return std::make_unique<As<Looper>>(parked ? LazyEffects::kParkedLength : looper_size);
+    case 31: return std::make_unique<As<RyanWah>>();
+    case 32: return std::make_unique<As<RBEcho>>();
+    case 33: return std::make_unique<As<CoilCrafter>>();
+    case 34: return std::make_unique<As<ShelfBoost>>();
+    case 35: return std::make_unique<As<Vocoder>>(auxresampled.data(), VocBands, Voc_Down, Voc_U_Q, Voc_D_Q);
+    case 36: return std::make_unique<As<Sustainer>>();
+    case 37: return std::make_unique<As<Sequence>>((long) HarQual, Seq_Down, Seq_U_Q, Seq_D_Q, PitchMode);
+    case 38: return std::make_unique<As<Shifter>>((long) HarQual, Shi_Down, Shi_U_Q, Shi_D_Q, PitchMode);
+    case 39: return std::make_unique<As<StompBox>>(Stom_Over);
+    case 40:
+        if (parked)
+            return std::make_unique<As<Reverbtron>>(Rev_Down, Rev_U_Q, Rev_D_Q, LazyEffects::kParkedLength);
+        return std::make_unique<As<Reverbtron>>(Rev_Down, Rev_U_Q, Rev_D_Q);
+    case 41:
+        if (parked)
+            return std::make_unique<As<Echotron>>(LazyEffects::kParkedLength);
+        return std::make_unique<As<Echotron>>();
+    case 42: return std::make_unique<As<StereoHarm>>((long) SteQual, Ste_Down, Ste_U_Q, Ste_D_Q, PitchMode);
+    case 43: return std::make_unique<As<CompBand>>();
+    case 44: return std::make_unique<As<Opticaltrem>>();
+    case 45: return std::make_unique<As<Vibe>>();
+    case 46: return std::make_unique<As<Infinity>>();
+    default: return nullptr;
+    }
 
-            case 35:
-                if (Vocoder_Bypass) {
-                    efx_Vocoder->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(35,efx_Vocoder->outvolume);
-                }
-                break;
+}
 
-            case 36:
-                if (Sustainer_Bypass) {
-                    efx_Sustainer->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx();
-                }
-                break;
 
-            case 37:
-                if (Sequence_Bypass) {
-                    efx_Sequence->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(37,efx_Sequence->outvolume);
-                }
-                break;
+std::unique_ptr<Effect>
+RKR::New_Effect (int type, bool parked)
+{
 
-            case 38:
-                if (Shifter_Bypass) {
-                    efx_Shifter->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(38,efx_Shifter->outvolume);
-                }
-                break;
+    return Make_Effect<Plain> (type, parked);
 
-            case 39:
-                if (StompBox_Bypass) {
-                    efx_StompBox->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx();
-                }
-                break;
+}
 
-            case 40:
-                if (Reverbtron_Bypass) {
-                    efx_Reverbtron->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(40,efx_Reverbtron->outvolume);
-                }
-                break;
 
-            case 41:
-                if (Echotron_Bypass) {
-                    efx_Echotron->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(41,efx_Echotron->outvolume);
-                }
-                break;
+/*
+ * The changepar() calls, in order, that loading preset npreset into effect
+ * `type` makes, read from the effect's preset table: no instance needed and
+ * the live one is left alone. Parameter -1 stands for a cleanup() call.
+ * Looper's factory presets are loaded through loadpreset() instead. User
+ * presets are read from disk: not on the audio thread.
+ */
+void
+RKR::Preset_Changes (int type, int npreset, PresetChanges &changes)
+{
 
-            case 42:
-                if (StereoHarm_Bypass) {
-                    efx_StereoHarm->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(42,efx_StereoHarm->outvolume);
-                }
-                break;
+    switch (type) {
+    case 0: EQ1_preset_changes (npreset, changes); break;
+    case 1: Compressor::preset_changes (0, npreset, changes); break;
+    case 2: Distorsion::preset_changes (0, npreset, changes); break;
+    case 3: Distorsion::preset_changes (1, npreset, changes); break;
+    case 4: Echo::preset_changes (npreset, changes); break;
+    case 5: Chorus::preset_changes (0, npreset, changes); break;
+    case 6: Phaser::preset_changes (npreset, changes); break;
+    case 7: Chorus::preset_changes (1, npreset, changes); break;
+    case 8: Reverb::preset_changes (npreset, changes); break;
+    case 9: EQ2_preset_changes (npreset, changes); break;
+    case 10: DynamicFilter::preset_changes (npreset, changes); break;
+    case 11: Alienwah::preset_changes (npreset, changes); break;
+    case 12: Cabinet_preset_changes (npreset, changes); break;
+    case 13: Pan::preset_changes (npreset, changes); break;
+    case 14: Harmonizer::preset_changes (npreset, changes); break;
+    case 15: MusicDelay::preset_changes (npreset, changes); break;
+    case 16: Gate::preset_changes (npreset, changes); break;
+    case 17: NewDist::preset_changes (npreset, changes); break;
+    case 18: Analog_Phaser::preset_changes (npreset, changes); break;
+    case 19: Valve::preset_changes (npreset, changes); break;
+    case 20: Dflange::preset_changes (npreset, changes); break;
+    case 21: Ring::preset_changes (npreset, changes); break;
+    case 22: Exciter::preset_changes (npreset, changes); break;
+    case 23: MBDist::preset_changes (npreset, changes); break;
+    case 24: Arpie::preset_changes (npreset, changes); break;
+    case 25: Expander::preset_changes (npreset, changes); break;
+    case 26: Shuffle::preset_changes (npreset, changes); break;
+    case 27: Synthfilter::preset_changes (npreset, changes); break;
+    case 28: MBVvol::preset_changes (npreset, changes); break;
+    case 29: Convolotron::preset_changes (npreset, changes); break;
+    case 30: Looper::preset_changes (npreset, changes); break;
+    case 31: RyanWah::preset_changes (npreset, changes); break;
+    case 32: RBEcho::preset_changes (npreset, changes); break;
+    case 33: CoilCrafter::preset_changes (npreset, changes); break;
+    case 34: ShelfBoost::preset_changes (npreset, changes); break;
+    case 35: Vocoder::preset_changes (npreset, changes); break;
+    case 36: Sustainer::preset_changes (npreset, changes); break;
+    case 37: Sequence::preset_changes (npreset, changes); break;
+    case 38: Shifter::preset_changes (npreset, changes); break;
+    case 39: StompBox::preset_changes (npreset, changes); break;
+    case 40: Reverbtron::preset_changes (npreset, changes); break;
+    case 41: Echotron::preset_changes (npreset, changes); break;
+    case 42: StereoHarm::preset_changes (npreset, changes); break;
+    case 43: CompBand::preset_changes (npreset, changes); break;
+    case 44: Opticaltrem::preset_changes (npreset, changes); break;
+    case 45: Vibe::preset_changes (npreset, changes); break;
+    case 46: Infinity::preset_changes (npreset, changes); break;
+    default: break;
+    }
 
-            case 43:
-                if (CompBand_Bypass) {
-                    efx_CompBand->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(43,efx_CompBand->outvolume);
-                }
-                break;
+}
 
-            case 44:
-                if (Opticaltrem_Bypass) {
-                    efx_Opticaltrem->out(efxoutl.data(), efxoutr.data());
-                    Vol2_Efx();
-                }
-                break;
 
-            case 45:
-                if (Vibe_Bypass) {
-                    efx_Vibe->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(45,efx_Vibe->outvolume);
-                }
-                break;
+/*
+ * The changepar() and cleanup() calls, in order, that Config_Effect() makes
+ * to load effect `type` from the table lv, worked out on a scratch instance.
+ * Allocates: not on the audio thread.
+ */
+std::vector<std::pair<int, int>>
+RKR::Config_Changes (int type, const Preset_Params &lv)
+{
 
-            case 46:
-                if (Infinity_Bypass) {
-                    efx_Infinity->out(efxoutl.data(), efxoutr.data());
-                    Vol_Efx(46,efx_Infinity->outvolume);
+    std::unique_ptr<Effect> efx = Make_Effect<Recorded> (type, LazyEffects::parkable (type));
+    auto *log = dynamic_cast<ParamLog *> (efx.get ());
+    if (log == nullptr)
+        return {};
 
-                }
+    log->recording = true;
+    Config_Effect (type, efx.get (), lv);
+    return std::move (log->changes);
 
+}
 
 
-            }
+template <class T>
+static Effect *
+swap_efx (std::unique_ptr<T> &slot, Effect *fresh)
+{
+    Effect *old = slot.release ();
+    slot.reset (static_cast<T *> (fresh));
+    return old;
+}
 
-        }
 
-        if(Metro_Bypass) add_metro();
+/*
+ * Install `fresh` (made by New_Effect(type)) as the live effect of its type
+ * and return the previous instance, which the caller now owns. Only pointer
+ * moves, safe on the audio thread.
+ */
+Effect *
+RKR::Swap_Effect (int type, Effect *fresh)
+{
 
-        Control_Volume (origl,origr);
+    chain_dirty = true;
+
+    switch (type) {
+    case 0: return swap_efx (efx_EQ1, fresh);
+    case 1: return swap_efx (efx_Compressor, fresh);
+    case 2: return swap_efx (efx_Distorsion, fresh);
+    case 3: return swap_efx (efx_Overdrive, fresh);
+    case 4: return swap_efx (efx_Echo, fresh);
+    case 5: return swap_efx (efx_Chorus, fresh);
+    case 6: return swap_efx (efx_Phaser, fresh);
+    case 7: return swap_efx (efx_Flanger, fresh);
+    case 8: return swap_efx (efx_Rev, fresh);
+    case 9: return swap_efx (efx_EQ2, fresh);
+    case 10: return swap_efx (efx_WhaWha, fresh);
+    case 11: return swap_efx (efx_Alienwah, fresh);
+    case 12: return swap_efx (efx_Cabinet, fresh);
+    case 13: return swap_efx (efx_Pan, fresh);
+    case 14: return swap_efx (efx_Har, fresh);
+    case 15: return swap_efx (efx_MusDelay, fresh);
+    case 16: return swap_efx (efx_Gate, fresh);
+    case 17: return swap_efx (efx_NewDist, fresh);
+    case 18: return swap_efx (efx_APhaser, fresh);
+    case 19: return swap_efx (efx_Valve, fresh);
+    case 20: return swap_efx (efx_DFlange, fresh);
+    case 21: return swap_efx (efx_Ring, fresh);
+    case 22: return swap_efx (efx_Exciter, fresh);
+    case 23: return swap_efx (efx_MBDist, fresh);
+    case 24: return swap_efx (efx_Arpie, fresh);
+    case 25: return swap_efx (efx_Expander, fresh);
+    case 26: return swap_efx (efx_Shuffle, fresh);
+    case 27: return swap_efx (efx_Synthfilter, fresh);
+    case 28: return swap_efx (efx_MBVvol, fresh);
+    case 29: return swap_efx (efx_Convol, fresh);
+    case 30: return swap_efx (efx_Looper, fresh);
+    case 31: return swap_efx (efx_RyanWah, fresh);
+    case 32: return swap_efx (efx_RBEcho, fresh);
+    case 33: return swap_efx (efx_CoilCrafter, fresh);
+    case 34: return swap_efx (efx_ShelfBoost, fresh);
+    case 35: return swap_efx (efx_Vocoder, fresh);
+    case 36: return swap_efx (efx_Sustainer, fresh);
+    case 37: return swap_efx (efx_Sequence, fresh);
+    case 38: return swap_efx (efx_Shifter, fresh);
+    case 39: return swap_efx (efx_StompBox, fresh);
+    case 40: return swap_efx (efx_Reverbtron, fresh);
+    case 41: return swap_efx (efx_Echotron, fresh);
+    case 42: return swap_efx (efx_StereoHarm, fresh);
+    case 43: return swap_efx (efx_CompBand, fresh);
+    case 44: return swap_efx (efx_Opticaltrem, fresh);
+    case 45: return swap_efx (efx_Vibe, fresh);
+    case 46: return swap_efx (efx_Infinity, fresh);
+    default: return fresh;
+    }
+
+}
+
+
+/*
+ * The compiled chain is a flat list of the slots that are on. It is rebuilt
+ * when efx_order, an on/off flag or an effect instance has changed since
+ * the last compile.
+ */
+bool
+RKR::Chain_Changed ()
+{
+
+    if (chain_dirty)
+        return true;
+
+    for (int i = 0; i < MAX_EFFECT_SLOTS; i++) {
+        const int *on = Bypass_By_Type (efx_order[i]);
+        if ((efx_order[i] != chain_order[i]) || ((on ? *on : 0) != chain_on[i]))
+            return true;
+    }
+
+    return false;
+
+}
+
+
+void
+RKR::Compile_Chain ()
+{
 
+    chain_len = 0;
+    for (int i = 0; i < MAX_EFFECT_SLOTS; i++) {
+        const int type = efx_order[i];
+        const int *on = Bypass_By_Type (type);
+
+        chain_order[i] = type;
+        chain_on[i] = on ? *on : 0;
+        if (!chain_on[i])
+            continue;
+
+        Effect *efx = Effect_By_Type (type);
+        if (efx == nullptr)
+            continue;
+        chain[chain_len].efx = efx;
+        chain[chain_len].mix = efx_flags[type].mix;
+        chain[chain_len].slot = i;
+        chain[chain_len].type = type;
+        chain_len++;
     }
+    chain_dirty = false;
 
 }
 
+
+/*
+ * Run efxoutl/efxoutr through the active slots. Wet/dry effects keep a copy
+ * of their input in smpl/smpr and blend it back by outvolume:
+ *   outvolume < .5  full effect, input raised up to unity
+ *   outvolume > .5  full input, effect lowered down to silence
+ * With effect timing on, every out() call is timed for efx_timer.
+ */
+void
+RKR::Effect_Chain ()
+{
+
+    if (Chain_Changed ())
+        Compile_Chain ();
+
+    for (int n = 0; n < chain_len; n++)
+        Run_Node (chain[n], efxoutl.data(), efxoutr.data());
+
+}
+
+
+/*
+ * Run l/r through one compiled slot, in place.
+ */
+void
+RKR::Run_Node (const ChainNode &node, float *l, float *r)
+{
+    int i;
+    float v1, v2;
+    Effect *efx = node.efx;
+
+    if (node.mix >= MIX_WETDRY) {
+        memcpy (smpl.data(), l, sizeof(float) * PERIOD);
+        memcpy (smpr.data(), r, sizeof(float) * PERIOD);
+    }
+
+#ifdef ENABLE_EFFECT_TIMING
+    if (efx_timer.enabled ()) {
+        const auto start = EffectTimer::Clock::now ();
+        efx->out (l, r);
+        efx_timer.record (node.slot, node.type, EffectTimer::Clock::now () - start);
+    } else
+#endif
+        efx->out (l, r);
+
+    switch (node.mix) {
+    case MIX_INSERT:
+        break;
+
+    case MIX_BOOST:
+        for (i = 0; i < PERIOD; i++) {
+            l[i] *= 2.0f;
+            r[i] *= 2.0f;
+        }
+        break;
+
+    default:
+        if (efx->outvolume < 0.5f) {
+            v1 = 1.0f;
+            v2 = efx->outvolume * 2.0f;
+        } else {
+            v1 = (1.0f - efx->outvolume) * 2.0f;
+            v2 = 1.0f;
+        }
+        if (node.mix == MIX_WETDRY_SQUARED)
+            v2 *= v2;
+
+        for (i = 0; i < PERIOD; i++) {
+            l[i] = smpl[i] * v2 + l[i] * v1;
+            r[i] = smpr[i] * v2 + r[i] * v1;
+        }
+        break;
+    }
+
+}
@@ -65,6 +65,9 @@ RKR::miramidi ()
 {
 
     if (snd_seq_event_input_pending (midi_in, 1)) {
+        // Off the audio thread, the efx_* the events reach may be swapped
+        // out and retired meanwhile; keep them alive until we are done.
+        const auto hold = lazy_efx.hold ();
         do {
             midievents ();
 
@@ -39,6 +39,7 @@
 #include "dsp_constants.hpp"
 #include <cstdio>
 #include <cstring>
+#include "FFTWPlanner.hpp"
 #include "smbPitchShift.hpp"
 
 // -----------------------------------------------------------------------------------------------------------------
@@ -50,7 +51,9 @@
 	Time Fourier Transform.
 	Author: (c)1999-2006 Stephan M. Bernsee <smb [AT] dspdimension [DOT] com>
 */
-PitchShifter::PitchShifter (long fftFrameSize, long osamp, float sampleRate)
+PitchShifter::PitchShifter (long fftFrameSize, long osamp, float sampleRate, int mode_,
+                            int voices)
+    : mode(mode_), fSampleRate(sampleRate)
 {
 
     /* set up some handy variables */
@@ -84,27 +87,95 @@ PitchShifter::PitchShifter (long fftFrameSize, long osamp, float sampleRate)
     int nfftFrameSize = (int) fftFrameSize;
     //printf("nfs= %d, lfs= %ld\n", nfftFrameSize, fftFrameSize);
 
+    //Pre-compute window function
+    makeWindow(fftFrameSize);
+
+    if (mode == PSOLA) {
+        for (int v = 0; v < (voices > 0 ? voices : 1); v++)
+            fPsola.emplace_back(sampleRate);
+        return;
+    }
+
+    if (mode == FAST) {
+        fftwf_time = fftwf_alloc_real(nfftFrameSize);
+        fftwf_bins = fftwf_alloc_complex(fftFrameSize2 + 1);
+        memset(fftwf_time, 0, sizeof(float) * nfftFrameSize);
+        memset(fftwf_bins, 0, sizeof(fftwf_complex) * (fftFrameSize2 + 1));
+
+        {
+            std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+            fPlanForward = fftwf_plan_dft_r2c_1d(nfftFrameSize, fftwf_time, fftwf_bins, FFTW_ESTIMATE);
+            fPlanInverse = fftwf_plan_dft_c2r_1d(nfftFrameSize, fftwf_bins, fftwf_time, FFTW_ESTIMATE);
+        }
+
+        for (k = 0; k < fftFrameSize; k++) {
+            fWindow[k] = static_cast<float>(window[k]);
+            fOutWindow[k] = static_cast<float>(window[k] / (double) FS_osamp);
+        }
+        for (k = 0; k <= fftFrameSize2; k++)
+            fExpct[k] = static_cast<float>(remainder((double) k * expct, 2.0 * M_PI));
+        fAnaCoef = static_cast<float>((double) osamp / (2.0 * M_PI));
+        fSynCoef = static_cast<float>(2.0 * M_PI / (double) osamp);
+
+        fVoices.resize(voices > 0 ? voices : 1);
+        for (Voice &voice : fVoices) {
+            voice.inFIFO.assign(fftFrameSize, 0.0f);
+            voice.outFIFO.assign(stepSize, 0.0f);
+            voice.outputAccum.assign(2 * fftFrameSize, 0.0f);
+            voice.lastPhase.assign(fftFrameSize2 + 1, 0.0f);
+            voice.sumPhase.assign(fftFrameSize2 + 1, 0.0f);
+            voice.anaMagn.assign(fftFrameSize2 + 1, 0.0f);
+            voice.anaFreq.assign(fftFrameSize2 + 1, 0.0f);
+            voice.source = 0;
+        }
+        return;
+    }
+
     fftw_in = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * nfftFrameSize);
     fftw_out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * nfftFrameSize);
     memset(fftw_in, 0, sizeof(fftw_complex) * nfftFrameSize);
     memset(fftw_out, 0, sizeof(fftw_complex) * nfftFrameSize);
 
-    ftPlanForward = fftw_plan_dft_1d(nfftFrameSize, fftw_in, fftw_out, FFTW_FORWARD, FFTW_MEASURE);
-    ftPlanInverse = fftw_plan_dft_1d(nfftFrameSize, fftw_in, fftw_out, FFTW_BACKWARD, FFTW_MEASURE);
-
-    //Pre-compute window function
-    makeWindow(fftFrameSize);
+    std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+    ftPlanForward = fftw_plan_dft_1d(nfftFrameSize, fftw_in, fftw_out, FFTW_FORWARD, FFTW_ESTIMATE);
+    ftPlanInverse = fftw_plan_dft_1d(nfftFrameSize, fftw_in, fftw_out, FFTW_BACKWARD, FFTW_ESTIMATE);
 }
 
 PitchShifter::~PitchShifter ()
 {
 
+    if (mode == PSOLA)
+        return;
+    std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+    if (mode == FAST) {
+        fftwf_destroy_plan(fPlanForward);
+        fftwf_destroy_plan(fPlanInverse);
+        fftwf_free(fftwf_time);
+        fftwf_free(fftwf_bins);
+        return;
+    }
     fftw_destroy_plan(ftPlanForward);
     fftw_destroy_plan(ftPlanInverse);
     fftw_free(fftw_in);
     fftw_free(fftw_out);
 }
 
+float
+PitchShifter::latency (int mode, long fftFrameSize, long osamp, float sampleRate,
+                       float freq)
+{
+    if (mode == PSOLA)
+        return PsolaShifter::latency (freq);
+    return (float) (fftFrameSize - fftFrameSize / osamp) / sampleRate;
+}
+
+float
+PitchShifter::latency () const
+{
+    return latency (mode, 2 * fftFrameSize2, 2 * fftFrameSize2 / stepSize, fSampleRate,
+                    reco_freq);
+}
+
 void
 PitchShifter::makeWindow(long fftFrameSize)
 {
@@ -122,6 +193,11 @@ PitchShifter::smbPitchShift (float pitchShift, long numSampsToProcess,
     long i;
     float maxmag = 0.0f;
 
+    if (mode != REFERENCE) {
+        shiftVoices (&pitchShift, numSampsToProcess, &indata, &outdata);
+        return;
+    }
+
     /* main processing loop */
     for (i = 0; i < numSampsToProcess; i++) {
 
@@ -273,6 +349,231 @@ PitchShifter::smbPitchShift (float pitchShift, long numSampsToProcess,
 }
 
 
+// -----------------------------------------------------------------------------------------------------------------
+
+/*
+	FAST mode. Same algorithm and FIFO handling as smbPitchShift() above,
+	but in single precision on real FFTs, so only the fftFrameSize/2+1
+	non-negative bins are ever computed. Frequencies are kept in bins,
+	which makes the expected phase advance cancel out of the synthesis
+	step, and the summed phases are wrapped every frame so they keep their
+	precision. The polar conversions below have no branches; the
+	ternaries become blends and the per-bin loops vectorize.
+
+	Phase deviations are wrapped to the nearest multiple of 2 pi, as in
+	Bernsee's original. The REFERENCE path rounds qpd with lrint(), so a
+	deviation between pi/2 and pi ends up osamp bins off; that is
+	inaudible at ratio 1 but not once shifted, so the two paths only
+	agree closely at ratio 1.
+*/
+namespace
+{
+constexpr float kPi = 3.14159265f;
+constexpr float kHalfPi = 1.57079633f;
+constexpr float kTwoPi = 6.28318531f;
+
+// Nearest integer, for |x| < 2^31
+inline float
+fast_round (float x)
+{
+    return static_cast<float>(static_cast<int>(x + (x >= 0.0f ? 0.5f : -0.5f)));
+}
+
+// Into [-pi, pi]
+inline float
+wrap_phase (float x)
+{
+    return x - kTwoPi * fast_round (x * (1.0f / kTwoPi));
+}
+
+// Error below 2e-6 rad
+inline float
+fast_atan2 (float y, float x)
+{
+    const float ax = fabsf (x);
+    const float ay = fabsf (y);
+    const float mx = ax > ay ? ax : ay;
+    const float mn = ax > ay ? ay : ax;
+    const float a = mn / (mx + 1e-30f);
+    const float s = a * a;
+    float r = a * (0.99997726f + s * (-0.33262347f + s * (0.19354346f + s * (-0.11643287f
+              + s * (0.05265332f + s * -0.01172120f)))));
+    r = ay > ax ? kHalfPi - r : r;
+    r = x < 0.0f ? kPi - r : r;
+    return y < 0.0f ? -r : r;
+}
+
+// x in [-pi, pi], error below 4e-7
+inline void
+fast_sincos (float x, float &s, float &c)
+{
+    const float q = fast_round (x * (1.0f / kHalfPi));
+    const float r = x - q * kHalfPi;
+    const float r2 = r * r;
+    const float sr = r * (1.0f + r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f))));
+    const float cr = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f))));
+    const int quadrant = static_cast<int>(q) & 3;
+    const float sv = (quadrant & 1) ? cr : sr;
+    const float cv = (quadrant & 1) ? sr : cr;
+    s = (quadrant & 2) ? -sv : sv;
+    c = ((quadrant + 1) & 2) ? -cv : cv;
+}
+}
+
+void
+PitchShifter::shiftVoices (const float *ratios, long numSampsToProcess,
+                           const float *const *indata, float *const *outdata)
+{
+    const long fftFrameSize = 2 * fftFrameSize2;
+    const int voices = voiceCount ();
+
+    if (mode == PSOLA) {
+        for (int v = 0; v < voices; v++)
+            if (outdata[v] != nullptr)
+                fPsola[v].out (ratios[v], reco_freq, numSampsToProcess, indata[v], outdata[v]);
+        return;
+    }
+
+    for (long i = 0; i < numSampsToProcess; i++) {
+        // All inputs first: outdata may be indata
+        for (int v = 0; v < voices; v++)
+            fVoices[v].inFIFO[gRover] = indata[v][i];
+        for (int v = 0; v < voices; v++)
+            if (outdata[v] != nullptr)
+                outdata[v][i] = fVoices[v].outFIFO[gRover - inFifoLatency];
+        gRover++;
+
+        if (gRover >= fftFrameSize) {
+            gRover = inFifoLatency;
+            fastFrame (ratios, outdata);
+        }
+    }
+}
+
+void
+PitchShifter::fastFrame (const float *ratios, float *const *outdata)
+{
+    const int voices = voiceCount ();
+    const size_t frameBytes = 2 * fftFrameSize2 * sizeof (float);
+    const size_t binBytes = (fftFrameSize2 + 1) * sizeof (float);
+
+    // Compare against the first running voice before its analysis moves
+    // lastPhase on: same window and same previous phases give the same
+    // frame, bit for bit.
+    int leader = -1;
+    for (int v = 0; v < voices; v++) {
+        Voice &voice = fVoices[v];
+        if (outdata[v] == nullptr)
+            continue;
+        if (leader < 0) {
+            leader = v;
+            voice.source = v;
+            continue;
+        }
+        const Voice &lead = fVoices[leader];
+        const bool same = (memcmp (voice.inFIFO.data(), lead.inFIFO.data(), frameBytes) == 0)
+                          && (memcmp (voice.lastPhase.data(), lead.lastPhase.data(), binBytes) == 0);
+        voice.source = same ? leader : v;
+    }
+
+    for (int v = 0; v < voices; v++) {
+        if (outdata[v] == nullptr)
+            continue;
+        Voice &voice = fVoices[v];
+        if (voice.source == v)
+            fastAnalysis (v);
+        else
+            memcpy (voice.lastPhase.data(), fVoices[voice.source].lastPhase.data(), binBytes);
+        fastSynthesis (v, ratios[v]);
+    }
+
+    for (Voice &voice : fVoices)
+        memmove (voice.inFIFO.data(), voice.inFIFO.data() + stepSize,
+                 inFifoLatency * sizeof (float));
+}
+
+void
+PitchShifter::fastAnalysis (int v)
+{
+    // int indices: SSE has no vector int64 -> float conversion
+    const int fftFrameSize = 2 * static_cast<int>(fftFrameSize2);
+    const int bins = static_cast<int>(fftFrameSize2) + 1;
+    Voice &voice = fVoices[v];
+    const float *in = voice.inFIFO.data();
+    float *lastPhase = voice.lastPhase.data();
+    float *anaMagn = voice.anaMagn.data();
+    float *anaFreq = voice.anaFreq.data();
+    float *time = fftwf_time;
+    fftwf_complex *X = fftwf_bins;
+
+    for (int j = 0; j < fftFrameSize; j++)
+        time[j] = in[j] * fWindow[j];
+
+    fftwf_execute(fPlanForward);
+
+    /* magnitude and true frequency, in bins, of every partial */
+    for (int j = 0; j < bins; j++) {
+        const float re = X[j][0];
+        const float im = X[j][1];
+        const float phase = fast_atan2 (im, re);
+        const float delta = wrap_phase (phase - lastPhase[j] - fExpct[j]);
+        lastPhase[j] = phase;
+        anaMagn[j] = 2.0f * sqrtf (re * re + im * im);
+        anaFreq[j] = static_cast<float>(j) + delta * fAnaCoef;
+    }
+}
+
+void
+PitchShifter::fastSynthesis (int v, float pitchShift)
+{
+    const int fftFrameSize = 2 * static_cast<int>(fftFrameSize2);
+    const int bins = static_cast<int>(fftFrameSize2) + 1;
+    Voice &voice = fVoices[v];
+    const Voice &source = fVoices[voice.source];
+    const float *anaMagn = source.anaMagn.data();
+    const float *anaFreq = source.anaFreq.data();
+    float *sumPhase = voice.sumPhase.data();
+    float *accum = voice.outputAccum.data();
+    float *time = fftwf_time;
+    fftwf_complex *X = fftwf_bins;
+
+    /* ***************** PROCESSING ******************* */
+    memset (gSynMagn.data(), 0, bins * sizeof (float));
+    memset (gSynFreq.data(), 0, bins * sizeof (float));
+    for (int j = 0; j < bins; j++) {
+        const int index = static_cast<int>(j * pitchShift);
+        if (index < bins) {
+            gSynMagn[index] += anaMagn[j];
+            gSynFreq[index] = anaFreq[j] * pitchShift;
+        }
+    }
+
+    /* ***************** SYNTHESIS ******************* */
+    for (int j = 0; j < bins; j++) {
+        const float phase = wrap_phase (sumPhase[j] + gSynFreq[j] * fSynCoef);
+        sumPhase[j] = phase;
+        float s, c;
+        fast_sincos (phase, s, c);
+        X[j][0] = gSynMagn[j] * c;
+        X[j][1] = gSynMagn[j] * s;
+    }
+
+    /* c2r doubles every bin but DC and Nyquist, which smbPitchShift()
+       takes once; its output gain of 2 is folded into fOutWindow */
+    X[0][0] *= 2.0f;
+    X[0][1] = 0.0f;
+    X[fftFrameSize2][0] *= 2.0f;
+    X[fftFrameSize2][1] = 0.0f;
+
+    fftwf_execute(fPlanInverse);
+
+    for (int j = 0; j < fftFrameSize; j++)
+        accum[j] += fOutWindow[j] * time[j];
+    memcpy (voice.outFIFO.data(), accum, stepSize * sizeof (float));
+
+    memmove (accum, accum + stepSize, fftFrameSize * sizeof (float));
+}
+
 // -----------------------------------------------------------------------------------------------------------------
 void
 PitchShifter::smbFft (float *fftBuffer, long fftFrameSize, long sign)
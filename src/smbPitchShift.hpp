@@ -45,21 +45,65 @@
 #include <cstdio>
 #include <fftw3.h>
 #include <array>
+#include <vector>
+#include "PsolaShifter.hpp"
 
 inline constexpr int MAX_FRAME_LENGTH = 2048;
 class PitchShifter
 {
 public:
-    PitchShifter (long fftFrameSize, long osamp, float sampleRate);
+    /// REFERENCE is the original double precision complex FFT path. FAST
+    /// uses single precision real FFTs and polynomial atan2/sin/cos, with
+    /// the per-bin loops written so the compiler can vectorize them. PSOLA
+    /// hands the audio to PsolaShifter, which follows the pitch Recognize
+    /// finds on the chain input (reco_freq), not on the audio the shifter
+    /// is given, and lags by under one period instead of
+    /// fftFrameSize - stepSize samples.
+    enum Mode { REFERENCE = 0, FAST = 1, PSOLA = 2 };
+
+    PitchShifter (long fftFrameSize, long osamp, float sampleRate, int mode = REFERENCE,
+                  int voices = 1);
     ~PitchShifter ();
     void smbPitchShift (float pitchShift, long numSampsToProcess,
                         long fftFrameSize, long osamp, float sampleRate,
                         float *indata, float *outdata);
+
+    /// FAST and PSOLA modes: shift indata[v] by ratios[v] into outdata[v] for
+    /// each of the `voices` given to the constructor, in lockstep. A voice
+    /// whose input window and previous phases are bit-identical to the
+    /// first running voice's reuses that analysis and only pays for its
+    /// own synthesis, so harmonies of one source (pass the same buffer) or
+    /// a mono source copied to both sides of a stereo effect cost one
+    /// forward FFT per hop. Any difference, down to one sample bit, and
+    /// the voice is analysed on its own. Either way the output is that of
+    /// one single voice PitchShifter per voice (rakgolden --voices checks
+    /// it). A voice with a null outdata is not synthesized; its input is
+    /// still taken. PSOLA voices have nothing worth sharing and run on
+    /// their own.
+    void shiftVoices (const float *ratios, long numSampsToProcess,
+                      const float *const *indata, float *const *outdata);
+    int voiceCount () const
+    {
+        return static_cast<int>(mode == PSOLA ? fPsola.size() : fVoices.size());
+    }
+
+    /// Delay through a pitch shifter of the given mode and size, seconds.
+    /// For PSOLA it depends on the note: half a period of freq, from
+    /// 0.25 ms at kMaxFreq to 8.3 ms at kMinFreq (see PsolaShifter).
+    static float latency (int mode, long fftFrameSize, long osamp, float sampleRate,
+                          float freq);
+    /// As above, for the note playing now (reco_freq).
+    float latency () const;
     void smbFft (float *fftBuffer, long fftFrameSize, long sign);
     double smbAtan2 (double x, double y);
     float ratio;
 private:
     void makeWindow(long fftFrameSize);
+    void fastFrame (const float *ratios, float *const *outdata);
+    void fastAnalysis (int v);
+    void fastSynthesis (int v, float pitchShift);
+    int mode;
+    float fSampleRate;
     std::array<float, MAX_FRAME_LENGTH> gInFIFO{};
     std::array<float, MAX_FRAME_LENGTH> gOutFIFO{};
     std::array<float, 2 * MAX_FRAME_LENGTH> gFFTworksp{};
@@ -78,7 +122,26 @@ private:
 
     //FFTW variables
     fftw_complex *fftw_in{}, *fftw_out{};
-    fftw_plan ftPlanForward, ftPlanInverse;
+    fftw_plan ftPlanForward{}, ftPlanInverse{};
+
+    //FAST mode: float FFTW, frequencies kept in bins rather than Hz
+    std::array<float, MAX_FRAME_LENGTH> fWindow{};      // analysis window
+    std::array<float, MAX_FRAME_LENGTH> fOutWindow{};   // synthesis window, output gain included
+    std::array<float, MAX_FRAME_LENGTH / 2 + 1> fExpct{};   // expected phase advance, wrapped
+    float fAnaCoef{}, fSynCoef{};                       // osamp / 2pi, 2pi / osamp
+
+    struct Voice {
+        std::vector<float> inFIFO, outFIFO, outputAccum;
+        std::vector<float> lastPhase, sumPhase, anaMagn, anaFreq;
+        int source;     // voice whose analysis this hop uses
+    };
+    std::vector<Voice> fVoices;
+
+    //PSOLA mode: one time domain shifter per voice
+    std::vector<PsolaShifter> fPsola;
+    float *fftwf_time{};
+    fftwf_complex *fftwf_bins{};
+    fftwf_plan fPlanForward{}, fPlanInverse{};
 };
 
 